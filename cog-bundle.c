@@ -0,0 +1,333 @@
+/*
+ * cog-bundle.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "core/cog-bundle-format.h"
+#include "core/cog-mime-types.h"
+
+#include <errno.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static struct {
+    GStrv    mime_types;
+    gboolean verbose;
+    GStrv    arguments;
+} s_options = { NULL, };
+
+
+static GOptionEntry s_cli_options[] = {
+    { "mime-type", 'm', 0, G_OPTION_ARG_STRING_ARRAY, &s_options.mime_types,
+        "Use a MIME type for files with the given extension",
+        "EXT=TYPE" },
+    { "verbose", 'v', 0, G_OPTION_ARG_NONE, &s_options.verbose,
+        "Print the paths of files as they are added",
+        NULL },
+    { G_OPTION_REMAINING, '\0', 0, G_OPTION_ARG_FILENAME_ARRAY, &s_options.arguments,
+        "", "DIRECTORY OUTPUT" },
+    { NULL, }
+};
+
+
+typedef struct {
+    char   *path;       /* Relative to the bundled directory. */
+    char   *full_path;
+    char   *mime_type;
+    guint64 hash;
+    guint64 size;
+} BundleFile;
+
+
+static void
+bundle_file_free (void *pointer)
+{
+    BundleFile *file = pointer;
+    g_free (file->path);
+    g_free (file->full_path);
+    g_free (file->mime_type);
+    g_slice_free (BundleFile, file);
+}
+
+
+static int
+bundle_file_compare (const void *a, const void *b)
+{
+    const BundleFile *file_a = *((const BundleFile**) a);
+    const BundleFile *file_b = *((const BundleFile**) b);
+
+    if (file_a->hash != file_b->hash)
+        return (file_a->hash < file_b->hash) ? -1 : 1;
+    return strcmp (file_a->path, file_b->path);
+}
+
+
+static char*
+guess_mime_type (GHashTable *overrides, const char *path, const char *full_path)
+{
+    const char *extension = cog_path_get_extension (path);
+    if (extension) {
+        g_autofree char *key = g_ascii_strdown (extension, -1);
+        const char *mime_type = g_hash_table_lookup (overrides, key);
+        if (!mime_type)
+            mime_type = cog_mime_type_for_extension (extension);
+        if (mime_type)
+            return g_strdup (mime_type);
+    }
+
+    /* Fall back to sniffing the head of the file. */
+    guchar head[4096];
+    size_t head_size = 0;
+    FILE *fp = g_fopen (full_path, "rb");
+    if (fp) {
+        head_size = fread (head, 1, sizeof (head), fp);
+        fclose (fp);
+    }
+
+    g_autofree char *content_type = g_content_type_guess (path, head, head_size, NULL);
+    char *mime_type = g_content_type_get_mime_type (content_type);
+    return mime_type ? mime_type : g_strdup ("application/octet-stream");
+}
+
+
+static gboolean
+collect_files (GPtrArray  *files,
+               GHashTable *overrides,
+               const char *base_path,
+               const char *relative_path,
+               GError    **error)
+{
+    g_autofree char *dir_path = relative_path
+        ? g_build_filename (base_path, relative_path, NULL)
+        : g_strdup (base_path);
+
+    g_autoptr(GDir) dir = g_dir_open (dir_path, 0, error);
+    if (!dir)
+        return FALSE;
+
+    const char *name;
+    while ((name = g_dir_read_name (dir))) {
+        g_autofree char *path = relative_path
+            ? g_strconcat (relative_path, "/", name, NULL)
+            : g_strdup (name);
+        g_autofree char *full_path = g_build_filename (base_path, path, NULL);
+
+        GStatBuf st;
+        if (g_stat (full_path, &st) == -1) {
+            int errsv = errno;
+            g_set_error (error,
+                         G_FILE_ERROR,
+                         g_file_error_from_errno (errsv),
+                         "Cannot stat '%s': %s",
+                         full_path, g_strerror (errsv));
+            return FALSE;
+        }
+
+        if (S_ISDIR (st.st_mode)) {
+            if (!collect_files (files, overrides, base_path, path, error))
+                return FALSE;
+        } else if (S_ISREG (st.st_mode)) {
+            BundleFile *file = g_slice_new0 (BundleFile);
+            file->mime_type = guess_mime_type (overrides, path, full_path);
+            file->hash = cog_bundle_hash (path, strlen (path));
+            file->size = st.st_size;
+            file->path = g_steal_pointer (&path);
+            file->full_path = g_steal_pointer (&full_path);
+            g_ptr_array_add (files, file);
+        } else {
+            g_printerr ("Skipping '%s': not a regular file or directory\n", full_path);
+        }
+    }
+
+    return TRUE;
+}
+
+
+static inline guint64
+align_offset (guint64 offset)
+{
+    return (offset + COG_BUNDLE_DATA_ALIGNMENT - 1) & ~((guint64) COG_BUNDLE_DATA_ALIGNMENT - 1);
+}
+
+
+static gboolean
+write_padding (FILE *fp, guint64 *offset)
+{
+    static const char zeroes[COG_BUNDLE_DATA_ALIGNMENT] = { 0, };
+
+    const guint64 padding = align_offset (*offset) - *offset;
+    *offset += padding;
+    return fwrite (zeroes, 1, padding, fp) == padding;
+}
+
+
+static gboolean
+set_write_error (GError **error)
+{
+    int errsv = errno;
+    g_set_error (error,
+                 G_FILE_ERROR,
+                 g_file_error_from_errno (errsv),
+                 "Cannot write bundle: %s",
+                 g_strerror (errsv));
+    return FALSE;
+}
+
+
+static gboolean
+write_bundle (GPtrArray *files, FILE *fp, GError **error)
+{
+    if (files->len > G_MAXUINT32) {
+        g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED, "Too many files");
+        return FALSE;
+    }
+
+    /*
+     * Build the string table first, to know where the data section
+     * starts. MIME types are stored only once.
+     */
+    g_autoptr(GString) strings = g_string_new (NULL);
+    g_autoptr(GHashTable) mime_types = g_hash_table_new (g_str_hash, g_str_equal);
+    g_autofree CogBundleEntry *entries = g_new0 (CogBundleEntry, files->len);
+
+    guint64 data_size = 0;
+    for (unsigned i = 0; i < files->len; i++) {
+        const BundleFile *file = g_ptr_array_index (files, i);
+
+        entries[i].hash = GUINT64_TO_LE (file->hash);
+        entries[i].path_offset = GUINT32_TO_LE (strings->len);
+        g_string_append_len (strings, file->path, strlen (file->path) + 1);
+
+        void *mime_type_offset;
+        if (!g_hash_table_lookup_extended (mime_types, file->mime_type, NULL, &mime_type_offset)) {
+            mime_type_offset = GUINT_TO_POINTER (strings->len);
+            g_hash_table_insert (mime_types, file->mime_type, mime_type_offset);
+            g_string_append_len (strings, file->mime_type, strlen (file->mime_type) + 1);
+        }
+        entries[i].mime_type_offset = GUINT32_TO_LE (GPOINTER_TO_UINT (mime_type_offset));
+
+        data_size = align_offset (data_size);
+        entries[i].data_offset = GUINT64_TO_LE (data_size);
+        entries[i].data_size = GUINT64_TO_LE (file->size);
+        data_size += file->size;
+
+        if (strings->len > G_MAXUINT32) {
+            g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED, "String table too big");
+            return FALSE;
+        }
+    }
+
+    const guint64 strings_offset = sizeof (CogBundleHeader) + (guint64) files->len * sizeof (CogBundleEntry);
+    guint64 offset = strings_offset + strings->len;
+
+    CogBundleHeader header = {
+        .magic = COG_BUNDLE_MAGIC,
+        .version = GUINT32_TO_LE (COG_BUNDLE_VERSION),
+        .n_entries = GUINT32_TO_LE (files->len),
+        .strings_offset = GUINT64_TO_LE (strings_offset),
+        .data_offset = GUINT64_TO_LE (align_offset (offset)),
+    };
+
+    if (fwrite (&header, sizeof (header), 1, fp) != 1 ||
+        (files->len && fwrite (entries, sizeof (CogBundleEntry), files->len, fp) != files->len) ||
+        fwrite (strings->str, 1, strings->len, fp) != strings->len ||
+        !write_padding (fp, &offset))
+        return set_write_error (error);
+
+    for (unsigned i = 0; i < files->len; i++) {
+        const BundleFile *file = g_ptr_array_index (files, i);
+
+        if (s_options.verbose)
+            g_print ("%s (%s, %" G_GUINT64_FORMAT " bytes)\n", file->path, file->mime_type, file->size);
+
+        g_autoptr(GMappedFile) mapped_file = g_mapped_file_new (file->full_path, FALSE, error);
+        if (!mapped_file)
+            return FALSE;
+
+        const gsize size = g_mapped_file_get_length (mapped_file);
+        if (size != file->size) {
+            g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                         "File '%s' changed while creating the bundle", file->full_path);
+            return FALSE;
+        }
+
+        if (!write_padding (fp, &offset) ||
+            (size && fwrite (g_mapped_file_get_contents (mapped_file), 1, size, fp) != size))
+            return set_write_error (error);
+        offset += size;
+    }
+
+    return (fflush (fp) == 0) || set_write_error (error);
+}
+
+
+int
+main (int argc, char **argv)
+{
+    g_autoptr(GOptionContext) option_context = g_option_context_new (NULL);
+    g_option_context_set_summary (option_context,
+                                  "Pack the contents of DIRECTORY into the OUTPUT bundle file.");
+    g_option_context_add_main_entries (option_context, s_cli_options, NULL);
+
+    g_autoptr(GError) error = NULL;
+    if (!g_option_context_parse (option_context, &argc, &argv, &error)) {
+        g_printerr ("Command line error: %s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    if (!s_options.arguments || g_strv_length (s_options.arguments) != 2) {
+        g_printerr ("Expected a directory and an output file\n");
+        return EXIT_FAILURE;
+    }
+
+    g_autoptr(GHashTable) overrides = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    for (size_t i = 0; s_options.mime_types && s_options.mime_types[i]; i++) {
+        const char *equal = strchr (s_options.mime_types[i], '=');
+        if (!equal || equal == s_options.mime_types[i] || equal[1] == '\0') {
+            g_printerr ("Invalid MIME type specification '%s'\n", s_options.mime_types[i]);
+            return EXIT_FAILURE;
+        }
+        g_hash_table_replace (overrides,
+                              g_ascii_strdown (s_options.mime_types[i], equal - s_options.mime_types[i]),
+                              g_strdup (equal + 1));
+    }
+
+    const char *directory = s_options.arguments[0];
+    const char *output = s_options.arguments[1];
+
+    g_autoptr(GPtrArray) files = g_ptr_array_new_with_free_func (bundle_file_free);
+    if (!collect_files (files, overrides, directory, NULL, &error)) {
+        g_printerr ("%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+    g_ptr_array_sort (files, bundle_file_compare);
+
+    /* Write to a temporary file, which replaces the output once complete. */
+    g_autofree char *tmp_output = g_strconcat (output, ".tmp", NULL);
+    FILE *fp = g_fopen (tmp_output, "wb");
+    if (!fp) {
+        g_printerr ("Cannot create '%s': %s\n", tmp_output, g_strerror (errno));
+        return EXIT_FAILURE;
+    }
+
+    gboolean written = write_bundle (files, fp, &error);
+    if (fclose (fp) != 0 && written)
+        written = set_write_error (&error);
+    if (!written || g_rename (tmp_output, output) == -1) {
+        if (written)
+            g_printerr ("Cannot rename '%s': %s\n", tmp_output, g_strerror (errno));
+        else
+            g_printerr ("%s\n", error->message);
+        g_unlink (tmp_output);
+        return EXIT_FAILURE;
+    }
+
+    g_print ("Bundled %u files into %s\n", files->len, output);
+    return EXIT_SUCCESS;
+}
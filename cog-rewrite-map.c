@@ -0,0 +1,174 @@
+/*
+ * cog-rewrite-map.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "core/cog-rewrite-map-format.h"
+
+#include <gio/gio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static struct {
+    gboolean verbose;
+    GStrv    arguments;
+} s_options = { FALSE, };
+
+
+static GOptionEntry s_cli_options[] = {
+    { "verbose", 'v', 0, G_OPTION_ARG_NONE, &s_options.verbose,
+        "Print the rewrites as they are added",
+        NULL },
+    { G_OPTION_REMAINING, '\0', 0, G_OPTION_ARG_FILENAME_ARRAY, &s_options.arguments,
+        "", "INPUT OUTPUT" },
+    { NULL, }
+};
+
+
+static gboolean
+check_prefix (const char *prefix, GError **error)
+{
+    g_autofree char *scheme = g_uri_parse_scheme (prefix);
+    if (!scheme || !strstr (prefix, "://")) {
+        g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                     "Prefix '%s' is not an absolute URI", prefix);
+        return FALSE;
+    }
+    if (strpbrk (prefix, "?#")) {
+        g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                     "Prefix '%s' contains a query or fragment", prefix);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+
+static gboolean
+parse_rewrites (GHashTable *rewrites, const char *path, GError **error)
+{
+    g_autofree char *contents = NULL;
+    if (!g_file_get_contents (path, &contents, NULL, error))
+        return FALSE;
+
+    g_auto(GStrv) lines = g_strsplit (contents, "\n", -1);
+    for (unsigned i = 0; lines[i]; i++) {
+        char *line = g_strstrip (lines[i]);
+        if (line[0] == '\0' || line[0] == '#')
+            continue;
+
+        g_auto(GStrv) fields = g_strsplit_set (line, " \t", -1);
+        const char *prefix = NULL, *replacement = NULL;
+        unsigned n_fields = 0;
+        for (unsigned j = 0; fields[j]; j++) {
+            if (fields[j][0] == '\0')
+                continue;
+            if (n_fields == 0)
+                prefix = fields[j];
+            else if (n_fields == 1)
+                replacement = fields[j];
+            n_fields++;
+        }
+
+        if (n_fields != 2) {
+            g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                         "%s:%u: Expected a prefix and its replacement", path, i + 1);
+            return FALSE;
+        }
+
+        if (!check_prefix (prefix, error)) {
+            g_prefix_error (error, "%s:%u: ", path, i + 1);
+            return FALSE;
+        }
+
+        g_autofree char *replacement_scheme = g_uri_parse_scheme (replacement);
+        if (!replacement_scheme) {
+            g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                         "%s:%u: Replacement '%s' is not an absolute URI",
+                         path, i + 1, replacement);
+            return FALSE;
+        }
+
+        /* Prefixes must end in the same way, see cog-rewrite-map-format.h */
+        if (g_str_has_suffix (prefix, "/") != g_str_has_suffix (replacement, "/")) {
+            g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                         "%s:%u: Only one of '%s' and '%s' ends with a slash",
+                         path, i + 1, prefix, replacement);
+            return FALSE;
+        }
+
+        if (g_hash_table_contains (rewrites, prefix)) {
+            g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                         "%s:%u: Duplicate prefix '%s'", path, i + 1, prefix);
+            return FALSE;
+        }
+
+        if (s_options.verbose)
+            g_print ("%s -> %s\n", prefix, replacement);
+
+        g_hash_table_insert (rewrites, g_strdup (prefix), g_strdup (replacement));
+    }
+
+    return TRUE;
+}
+
+
+int
+main (int argc, char **argv)
+{
+    g_autoptr(GOptionContext) option_context = g_option_context_new (NULL);
+    g_option_context_set_summary (option_context,
+                                  "Compile the URI prefix rewrites listed in INPUT into the OUTPUT map file.");
+    g_option_context_add_main_entries (option_context, s_cli_options, NULL);
+
+    g_autoptr(GError) error = NULL;
+    if (!g_option_context_parse (option_context, &argc, &argv, &error)) {
+        g_printerr ("Command line error: %s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    if (!s_options.arguments || g_strv_length (s_options.arguments) != 2) {
+        g_printerr ("Expected an input and an output file\n");
+        return EXIT_FAILURE;
+    }
+
+    const char *input = s_options.arguments[0];
+    const char *output = s_options.arguments[1];
+
+    g_autoptr(GHashTable) rewrites = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    if (!parse_rewrites (rewrites, input, &error)) {
+        g_printerr ("%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    g_auto(GVariantBuilder) builder;
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{ss}"));
+    GHashTableIter iter;
+    void *key, *value;
+    g_hash_table_iter_init (&iter, rewrites);
+    while (g_hash_table_iter_next (&iter, &key, &value))
+        g_variant_builder_add (&builder, "{ss}", key, value);
+
+    g_autoptr(GVariant) map = g_variant_ref_sink (g_variant_new (COG_REWRITE_MAP_TYPE,
+                                                                 COG_REWRITE_MAP_MAGIC,
+                                                                 COG_REWRITE_MAP_VERSION,
+                                                                 &builder));
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+    g_autoptr(GVariant) swapped = g_variant_byteswap (map);
+    g_variant_unref (map);
+    map = g_steal_pointer (&swapped);
+#endif
+
+    if (!g_file_set_contents (output,
+                              g_variant_get_data (map),
+                              g_variant_get_size (map),
+                              &error)) {
+        g_printerr ("%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    g_print ("Compiled %u rewrites into %s\n", g_hash_table_size (rewrites), output);
+    return EXIT_SUCCESS;
+}
@@ -18,6 +18,9 @@
 # define HAVE_DEVICE_SCALING 0
 #endif /* WPE_CHECK_VERSION */
 
+/* Milliseconds to wait for the first frame after loading the home URI. */
+#define STARTUP_TRACE_FRAME_TIMEOUT 1000
+
 enum webprocess_fail_action {
     WEBPROCESS_FAIL_UNKNOWN = 0,
     WEBPROCESS_FAIL_ERROR_PAGE,
@@ -38,6 +41,10 @@ static struct {
     gdouble  device_scale_factor;
 #endif // HAVE_DEVICE_SCALING
     GStrv    dir_handlers;
+    GStrv    bundle_handlers;
+    GStrv    overlay_handlers;
+    GStrv    socket_handlers;
+    GStrv    scheme_flags;
     GStrv    arguments;
     char    *background_color;
     union {
@@ -49,9 +56,14 @@ static struct {
         enum webprocess_fail_action action_id;
     } on_failure;
     char *web_extensions_dir;
+    char *rewrite_map;
+    char *playlist;
+    int      slide_duration;
+    int      settle_time;
     gboolean ignore_tls_errors;
 } s_options = {
     .scale_factor = 1.0,
+    .settle_time = 500,
 #if HAVE_DEVICE_SCALING
     .device_scale_factor = 1.0,
 #endif // HAVE_DEVICE_SCALING
@@ -82,6 +94,18 @@ static GOptionEntry s_cli_options[] =
     { "dir-handler", 'd', 0, G_OPTION_ARG_STRING_ARRAY, &s_options.dir_handlers,
         "Add a URI scheme handler for a directory",
         "SCHEME:PATH" },
+    { "bundle-handler", '\0', 0, G_OPTION_ARG_STRING_ARRAY, &s_options.bundle_handlers,
+        "Add a URI scheme handler for a bundle file",
+        "SCHEME:FILE" },
+    { "overlay-handler", '\0', 0, G_OPTION_ARG_STRING_ARRAY, &s_options.overlay_handlers,
+        "Add a URI scheme handler for a stack of directories, bottom layer first",
+        "SCHEME:PATH[:PATH...]" },
+    { "socket-handler", '\0', 0, G_OPTION_ARG_STRING_ARRAY, &s_options.socket_handlers,
+        "Add a URI scheme handler which forwards requests to an HTTP server on a Unix socket",
+        "SCHEME:SOCKET" },
+    { "scheme-flags", '\0', 0, G_OPTION_ARG_STRING_ARRAY, &s_options.scheme_flags,
+        "Security flags for a URI scheme: secure, cors-enabled, local, display-isolated",
+        "SCHEME:FLAG[,FLAG...]" },
     { "webprocess-failure", '\0', 0, G_OPTION_ARG_STRING,
         &s_options.on_failure.action_name,
         "Action on WebProcess failures: error-page (default), exit, exit-ok, restart.",
@@ -98,6 +122,18 @@ static GOptionEntry s_cli_options[] =
     { "web-extensions-dir", '\0', 0, G_OPTION_ARG_STRING, &s_options.web_extensions_dir,
       "Load Web Extensions from given directory.",
       "PATH"},
+    { "rewrite-map", '\0', 0, G_OPTION_ARG_FILENAME, &s_options.rewrite_map,
+      "Rewrite URIs of resources using a map compiled with cog-rewrite-map.",
+      "PATH"},
+    { "playlist", '\0', 0, G_OPTION_ARG_FILENAME, &s_options.playlist,
+      "Rotate through the URLs listed in a file, preloading each next one off screen.",
+      "PATH"},
+    { "slide-duration", '\0', 0, G_OPTION_ARG_INT, &s_options.slide_duration,
+      "Seconds each playlist URL is shown before switching to the next one (default: 0, manual).",
+      "SECONDS"},
+    { "settle-time", '\0', 0, G_OPTION_ARG_INT, &s_options.settle_time,
+      "Milliseconds to wait after a playlist URL has loaded before it can be shown (default: 500).",
+      "MSEC"},
     { "ignore-tls-errors", '\0', 0, G_OPTION_ARG_NONE, &s_options.ignore_tls_errors,
         "Ignore TLS errors (default: disabled).", NULL },
     { G_OPTION_REMAINING, '\0', 0, G_OPTION_ARG_FILENAME_ARRAY, &s_options.arguments,
@@ -106,6 +142,42 @@ static GOptionEntry s_cli_options[] =
 };
 
 
+static gboolean
+add_scheme_flags (CogShell           *shell,
+                  const char         *scheme,
+                  const char * const *names,
+                  GError            **error)
+{
+    CogSchemeFlags flags = cog_shell_get_scheme_flags (shell, scheme);
+    if (!cog_scheme_flags_parse (names, &flags, error)) {
+        g_prefix_error (error, "URI scheme '%s': ", scheme);
+        return FALSE;
+    }
+
+    cog_shell_set_scheme_flags (shell, scheme, flags);
+    return TRUE;
+}
+
+
+static gboolean
+load_scheme_flags (CogShell *shell, GKeyFile *key_file, GError **error)
+{
+    static const char group[] = "scheme-flags";
+
+    g_auto(GStrv) keys = g_key_file_get_keys (key_file, group, NULL, error);
+    if (!keys)
+        return FALSE;
+
+    for (unsigned i = 0; keys[i]; i++) {
+        g_auto(GStrv) names = g_key_file_get_string_list (key_file, group, keys[i], NULL, error);
+        if (!names || !add_scheme_flags (shell, keys[i], (const char * const *) names, error))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+
 static gboolean
 load_settings (CogShell *shell, GKeyFile *key_file, GError **error)
 {
@@ -119,10 +191,320 @@ load_settings (CogShell *shell, GKeyFile *key_file, GError **error)
         }
     }
 
+    if (g_key_file_has_group (key_file, "scheme-flags") &&
+        !load_scheme_flags (shell, key_file, error))
+        return FALSE;
+
     return TRUE;
 }
 
 
+static gboolean
+load_dir_handler_mime_types (CogRequestHandler *handler, GKeyFile *key_file, GError **error)
+{
+    static const char group[] = "mime-types";
+
+    g_auto(GStrv) keys = g_key_file_get_keys (key_file, group, NULL, error);
+    if (!keys)
+        return FALSE;
+
+    for (unsigned i = 0; keys[i]; i++) {
+        g_autofree char *mime_type = g_key_file_get_string (key_file, group, keys[i], error);
+        if (!mime_type)
+            return FALSE;
+        cog_directory_files_handler_set_mime_type (COG_DIRECTORY_FILES_HANDLER (handler),
+                                                   keys[i],
+                                                   mime_type);
+    }
+
+    return TRUE;
+}
+
+
+static gboolean
+load_dir_handler_settings (CogRequestHandler *handler, GKeyFile *key_file, GError **error)
+{
+    static const char group[] = "dir-handler";
+
+    if (!key_file)
+        return TRUE;
+
+    if (g_key_file_has_group (key_file, "mime-types") &&
+        !load_dir_handler_mime_types (handler, key_file, error))
+        return FALSE;
+
+    if (!g_key_file_has_group (key_file, group))
+        return TRUE;
+
+    g_auto(GStrv) keys = g_key_file_get_keys (key_file, group, NULL, error);
+    if (!keys)
+        return FALSE;
+
+    for (unsigned i = 0; keys[i]; i++) {
+        /* Not a property, see preload_dir_handler(). */
+        if (strcmp (keys[i], "preload-manifest") == 0)
+            continue;
+
+        GParamSpec *pspec =
+            g_object_class_find_property (G_OBJECT_GET_CLASS (handler), keys[i]);
+        if (!pspec ||
+            !(pspec->flags & G_PARAM_WRITABLE) ||
+            (pspec->flags & G_PARAM_CONSTRUCT_ONLY))
+        {
+            g_set_error (error,
+                         G_KEY_FILE_ERROR,
+                         G_KEY_FILE_ERROR_KEY_NOT_FOUND,
+                         "Invalid directory handler setting '%s'",
+                         keys[i]);
+            return FALSE;
+        }
+
+        g_autoptr(GError) lookup_error = NULL;
+        switch (G_PARAM_SPEC_VALUE_TYPE (pspec)) {
+            case G_TYPE_BOOLEAN: {
+                gboolean value = g_key_file_get_boolean (key_file, group, keys[i], &lookup_error);
+                if (!lookup_error)
+                    g_object_set (handler, keys[i], value, NULL);
+                break;
+            }
+            case G_TYPE_UINT: {
+                guint64 value = g_key_file_get_uint64 (key_file, group, keys[i], &lookup_error);
+                if (!lookup_error && value > G_MAXUINT) {
+                    g_set_error (&lookup_error,
+                                 G_KEY_FILE_ERROR,
+                                 G_KEY_FILE_ERROR_INVALID_VALUE,
+                                 "Value for '%s' exceeds maximum integer size",
+                                 keys[i]);
+                }
+                if (!lookup_error)
+                    g_object_set (handler, keys[i], (guint) value, NULL);
+                break;
+            }
+            case G_TYPE_UINT64: {
+                guint64 value = g_key_file_get_uint64 (key_file, group, keys[i], &lookup_error);
+                if (!lookup_error)
+                    g_object_set (handler, keys[i], value, NULL);
+                break;
+            }
+            default:
+                g_set_error (&lookup_error,
+                             G_KEY_FILE_ERROR,
+                             G_KEY_FILE_ERROR_INVALID_VALUE,
+                             "Directory handler setting '%s' cannot be configured",
+                             keys[i]);
+        }
+
+        if (lookup_error) {
+            g_propagate_error (error, g_steal_pointer (&lookup_error));
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+static void
+on_dir_handler_preloaded (GObject      *source_object,
+                          GAsyncResult *result,
+                          void         *user_data)
+{
+    g_autoptr(GTimer) timer = user_data;
+
+    guint64 n_files, n_bytes;
+    g_autoptr(GError) error = NULL;
+    if (!cog_directory_files_handler_preload_finish (COG_DIRECTORY_FILES_HANDLER (source_object),
+                                                     result, &n_files, &n_bytes, &error)) {
+        g_warning ("Cannot preload files: %s", error->message);
+        return;
+    }
+
+    g_message ("Preloaded %" G_GUINT64_FORMAT " files (%" G_GUINT64_FORMAT " bytes) in %.2f ms",
+               n_files, n_bytes, g_timer_elapsed (timer, NULL) * 1000.0);
+}
+
+
+/*
+ * Warms up the page cache with the files listed in the "preload-manifest"
+ * from the configuration file. This is done as early as possible, so the
+ * reads happen while the web process is being launched.
+ */
+static void
+preload_dir_handler (CogRequestHandler *handler, GKeyFile *key_file)
+{
+    if (!key_file)
+        return;
+
+    g_autofree char *manifest_path =
+        g_key_file_get_string (key_file, "dir-handler", "preload-manifest", NULL);
+    if (!manifest_path)
+        return;
+
+    g_autoptr(GFile) manifest = g_file_new_for_commandline_arg (manifest_path);
+    cog_directory_files_handler_preload_async (COG_DIRECTORY_FILES_HANDLER (handler),
+                                               manifest,
+                                               NULL,
+                                               on_dir_handler_preloaded,
+                                               g_timer_new ());
+}
+
+
+/*
+ * Playlist mode: the next URL is loaded into an off-screen view from the
+ * shell pool, and once it has finished loading and the settle time has
+ * passed, it is swapped with the view on screen. The view switched away
+ * from is then reused to preload the following URL. Platforms keep
+ * rendering off-screen views at a reduced frame rate, so the settle time
+ * also lets the page paint its final state before being shown.
+ */
+static struct {
+    GStrv          uris;
+    unsigned       current;        /* Index of the URL shown. */
+    WebKitWebView *next_view;      /* Owned by the shell pool. */
+    gboolean       next_ready;
+    gboolean       advance_requested;
+    guint          settle_source;
+    guint          advance_source;
+} s_playlist = { NULL, };
+
+
+static void playlist_advance (CogShell *shell);
+
+
+static void
+playlist_clear_source (guint *source_id)
+{
+    if (*source_id) {
+        g_source_remove (*source_id);
+        *source_id = 0;
+    }
+}
+
+
+static gboolean
+on_playlist_settled (CogShell *shell)
+{
+    s_playlist.settle_source = 0;
+    s_playlist.next_ready = TRUE;
+
+    if (s_playlist.advance_requested)
+        playlist_advance (shell);
+
+    return G_SOURCE_REMOVE;
+}
+
+
+static void
+on_playlist_load_changed (WebKitWebView  *web_view,
+                          WebKitLoadEvent load_event,
+                          CogShell       *shell)
+{
+    if (web_view != s_playlist.next_view || load_event != WEBKIT_LOAD_FINISHED)
+        return;
+
+    playlist_clear_source (&s_playlist.settle_source);
+    s_playlist.settle_source = g_timeout_add ((unsigned) s_options.settle_time,
+                                              (GSourceFunc) on_playlist_settled,
+                                              shell);
+}
+
+
+static void
+playlist_preload_next (CogShell *shell)
+{
+    const unsigned n_uris = g_strv_length (s_playlist.uris);
+    const char *uri = s_playlist.uris[(s_playlist.current + 1) % n_uris];
+
+    s_playlist.next_ready = FALSE;
+    playlist_clear_source (&s_playlist.settle_source);
+
+    if (s_playlist.next_view)
+        webkit_web_view_load_uri (s_playlist.next_view, uri);
+}
+
+
+static gboolean
+on_playlist_advance_timeout (CogShell *shell)
+{
+    s_playlist.advance_source = 0;
+    playlist_advance (shell);
+    return G_SOURCE_REMOVE;
+}
+
+
+static void
+playlist_advance (CogShell *shell)
+{
+    const unsigned n_uris = g_strv_length (s_playlist.uris);
+
+    if (!s_playlist.next_view) {
+        /* Without a preload view, fall back to navigating in place. */
+        s_playlist.current = (s_playlist.current + 1) % n_uris;
+        webkit_web_view_load_uri (cog_shell_get_web_view (shell), s_playlist.uris[s_playlist.current]);
+    } else if (!s_playlist.next_ready) {
+        /* Switch as soon as the next view is ready. */
+        s_playlist.advance_requested = TRUE;
+        return;
+    } else {
+        WebKitWebView *previous_view = cog_shell_get_web_view (shell);
+        cog_shell_activate_view (shell, s_playlist.next_view);
+        s_playlist.next_view = previous_view;
+        s_playlist.current = (s_playlist.current + 1) % n_uris;
+        g_debug ("Playlist: switched to %s", s_playlist.uris[s_playlist.current]);
+        playlist_preload_next (shell);
+    }
+
+    s_playlist.advance_requested = FALSE;
+    playlist_clear_source (&s_playlist.advance_source);
+    if (s_options.slide_duration) {
+        s_playlist.advance_source = g_timeout_add_seconds ((unsigned) s_options.slide_duration,
+                                                           (GSourceFunc) on_playlist_advance_timeout,
+                                                           shell);
+    }
+}
+
+
+static void
+on_startup_playlist (GApplication *application, void *user_data G_GNUC_UNUSED)
+{
+    if (!s_playlist.uris || g_strv_length (s_playlist.uris) < 2)
+        return;
+
+    CogShell *shell = cog_launcher_get_shell (COG_LAUNCHER (application));
+
+    s_playlist.next_view = cog_shell_create_view (shell);
+    if (s_playlist.next_view) {
+        g_signal_connect (s_playlist.next_view, "load-changed", G_CALLBACK (on_playlist_load_changed), shell);
+        g_signal_connect (cog_shell_get_web_view (shell), "load-changed", G_CALLBACK (on_playlist_load_changed), shell);
+    } else {
+        g_warning ("Cannot create a view to preload playlist URLs, they will be loaded on screen.");
+    }
+
+    playlist_preload_next (shell);
+
+    if (s_options.slide_duration) {
+        s_playlist.advance_source = g_timeout_add_seconds ((unsigned) s_options.slide_duration,
+                                                           (GSourceFunc) on_playlist_advance_timeout,
+                                                           shell);
+    }
+}
+
+
+static void
+on_action_next_slide (G_GNUC_UNUSED GAction  *action,
+                      G_GNUC_UNUSED GVariant *param,
+                      CogLauncher            *launcher)
+{
+    if (!s_playlist.uris) {
+        g_warning ("Cannot switch to the next slide: no playlist in use.");
+        return;
+    }
+
+    if (g_strv_length (s_playlist.uris) > 1)
+        playlist_advance (cog_launcher_get_shell (launcher));
+}
+
+
 static int
 string_to_webprocess_fail_action (const char *action)
 {
@@ -148,9 +530,9 @@ string_to_webprocess_fail_action (const char *action)
 
 
 static int
-on_handle_local_options (GApplication *application,
-                         GVariantDict *options,
-                         void         *user_data)
+handle_local_options (GApplication *application,
+                      GVariantDict *options,
+                      void         *user_data)
 {
     if (s_options.version) {
         g_print ("%s (WPE WebKit %u.%u.%u)\n",
@@ -178,8 +560,29 @@ on_handle_local_options (GApplication *application,
         s_options.on_failure.action_id = action_id;
     }
 
+    if (s_options.slide_duration < 0) {
+        g_printerr ("%s: Invalid slide duration: %d\n", g_get_prgname (), s_options.slide_duration);
+        return EXIT_FAILURE;
+    }
+    if (s_options.settle_time < 0) {
+        g_printerr ("%s: Invalid settle time: %d\n", g_get_prgname (), s_options.settle_time);
+        return EXIT_FAILURE;
+    }
+
     const char *uri = NULL;
-    if (!s_options.arguments) {
+    if (s_options.playlist) {
+        if (s_options.arguments) {
+            g_printerr ("%s: Cannot use a URL together with a playlist.\n", g_get_prgname ());
+            return EXIT_FAILURE;
+        }
+
+        g_autoptr(GError) error = NULL;
+        if (!(s_playlist.uris = cog_uri_list_load (s_options.playlist, &error))) {
+            g_printerr ("%s: Cannot load playlist: %s\n", g_get_prgname (), error->message);
+            return EXIT_FAILURE;
+        }
+        uri = s_playlist.uris[0];
+    } else if (!s_options.arguments) {
         if (!(uri = g_getenv ("COG_URL"))) {
 #ifdef COG_DEFAULT_HOME_URI
             uri = COG_DEFAULT_HOME_URI;
@@ -205,12 +608,56 @@ on_handle_local_options (GApplication *application,
     g_strfreev (s_options.arguments);
     s_options.arguments = NULL;
 
+    g_autoptr(CogShell) shell = cog_launcher_get_shell (COG_LAUNCHER (application));
+
+    /*
+     * The configuration file is loaded before creating the URI handlers,
+     * as it may contain settings for them.
+     */
+    g_autoptr(GKeyFile) key_file = NULL;
+    if (s_options.config_file) {
+        g_autoptr(GFile) file =
+            g_file_new_for_commandline_arg (s_options.config_file);
+        g_autofree char *config_file_path = g_file_get_path (file);
+
+        if (!g_file_query_exists (file, NULL)) {
+            g_printerr ("%s: File does not exist: %s\n",
+                        g_get_prgname (), config_file_path);
+            return EXIT_FAILURE;
+        }
+
+        g_autoptr(GError) error = NULL;
+        key_file = g_key_file_new ();
+        if (!g_key_file_load_from_file (key_file,
+                                        config_file_path,
+                                        G_KEY_FILE_NONE,
+                                        &error) ||
+            !load_settings (shell, key_file, &error))
+        {
+            g_printerr ("%s: Cannot load configuration file: %s\n",
+                        g_get_prgname (), error->message);
+            return EXIT_FAILURE;
+        }
+
+        g_object_set (shell, "config-file", g_key_file_ref (key_file), NULL);
+    }
+
+    /* Flags from the command line are added to those from the configuration. */
+    for (size_t i = 0; s_options.scheme_flags && s_options.scheme_flags[i]; i++) {
+        g_autofree char *scheme = NULL;
+        CogSchemeFlags flags;
+        if (!cog_scheme_flags_parse_spec (s_options.scheme_flags[i], &scheme, &flags, &error)) {
+            g_printerr ("%s: %s\n", g_get_prgname (), error->message);
+            return EXIT_FAILURE;
+        }
+        cog_shell_set_scheme_flags (shell, scheme, cog_shell_get_scheme_flags (shell, scheme) | flags);
+    }
+
     /*
      * Validate the supplied local URI handler specification and check
      * whether the directory exists. Note that this creation of the
      * corresponding CogURIHandler objects is done at GApplication::startup.
      */
-    g_autoptr(CogShell) shell = cog_launcher_get_shell (COG_LAUNCHER (application));
     for (size_t i = 0; s_options.dir_handlers && s_options.dir_handlers[i]; i++) {
         char *colon = strchr (s_options.dir_handlers[i], ':');
         if (!colon) {
@@ -241,54 +688,133 @@ on_handle_local_options (GApplication *application,
 
         *colon = '\0';  /* NULL-terminate the URI scheme name. */
         g_autoptr(CogRequestHandler) handler = cog_directory_files_handler_new (file);
-        cog_shell_set_request_handler (shell, s_options.dir_handlers[i], handler);
+        if (!load_dir_handler_settings (handler, key_file, &error)) {
+            g_printerr ("%s: Cannot configure '%s' URI handler: %s\n",
+                        g_get_prgname (), s_options.dir_handlers[i], error->message);
+            return EXIT_FAILURE;
+        }
+
+        preload_dir_handler (handler, key_file);
+
+        /* Allow mounting more directories at runtime, see "cogctl mount". */
+        g_autoptr(CogRequestHandler) routes_handler = cog_prefix_routes_handler_new (handler);
+        cog_shell_set_request_handler (shell, s_options.dir_handlers[i], routes_handler);
     }
 
-    s_options.home_uri = g_steal_pointer (&utf8_uri);
+    for (size_t i = 0; s_options.bundle_handlers && s_options.bundle_handlers[i]; i++) {
+        char *colon = strchr (s_options.bundle_handlers[i], ':');
+        if (!colon || colon == s_options.bundle_handlers[i] || colon[1] == '\0') {
+            g_printerr ("%s: Invalid URI handler specification '%s'\n",
+                        g_get_prgname (), s_options.bundle_handlers[i]);
+            return EXIT_FAILURE;
+        }
 
-    if (s_options.config_file) {
-        g_autoptr(GFile) file =
-            g_file_new_for_commandline_arg (s_options.config_file);
-        g_autofree char *config_file_path = g_file_get_path (file);
+        g_autoptr(GFile) file = g_file_new_for_commandline_arg (colon + 1);
 
-        if (!g_file_query_exists (file, NULL)) {
-            g_printerr ("%s: File does not exist: %s\n",
-                        g_get_prgname (), config_file_path);
+        g_autoptr(GError) error = NULL;
+        g_autoptr(CogRequestHandler) handler = cog_bundle_files_handler_new (file, &error);
+        if (!handler) {
+            g_printerr ("%s: %s\n", g_get_prgname (), error->message);
             return EXIT_FAILURE;
         }
 
+        *colon = '\0';  /* NULL-terminate the URI scheme name. */
+        g_autoptr(CogRequestHandler) routes_handler = cog_prefix_routes_handler_new (handler);
+        cog_shell_set_request_handler (shell, s_options.bundle_handlers[i], routes_handler);
+    }
+
+    for (size_t i = 0; s_options.overlay_handlers && s_options.overlay_handlers[i]; i++) {
+        char *colon = strchr (s_options.overlay_handlers[i], ':');
+        if (!colon || colon == s_options.overlay_handlers[i] || colon[1] == '\0') {
+            g_printerr ("%s: Invalid URI handler specification '%s'\n",
+                        g_get_prgname (), s_options.overlay_handlers[i]);
+            return EXIT_FAILURE;
+        }
+
+        g_auto(GStrv) layers = g_strsplit (colon + 1, ":", -1);
+
         g_autoptr(GError) error = NULL;
-        g_autoptr(GKeyFile) key_file = g_key_file_new ();
-        if (!g_key_file_load_from_file (key_file,
-                                        config_file_path,
-                                        G_KEY_FILE_NONE,
-                                        &error) ||
-            !load_settings (shell, key_file, &error))
-        {
-            g_printerr ("%s: Cannot load configuration file: %s\n",
-                        g_get_prgname (), error->message);
+        g_autoptr(CogRequestHandler) handler =
+            cog_overlay_files_handler_new ((const char * const *) layers, &error);
+        if (!handler) {
+            g_printerr ("%s: %s\n", g_get_prgname (), error->message);
             return EXIT_FAILURE;
         }
 
-        g_object_set (shell, "config-file", g_key_file_ref (key_file), NULL);
+        *colon = '\0';  /* NULL-terminate the URI scheme name. */
+        g_autoptr(CogRequestHandler) routes_handler = cog_prefix_routes_handler_new (handler);
+        cog_shell_set_request_handler (shell, s_options.overlay_handlers[i], routes_handler);
+    }
+
+    for (size_t i = 0; s_options.socket_handlers && s_options.socket_handlers[i]; i++) {
+        char *colon = strchr (s_options.socket_handlers[i], ':');
+        if (!colon || colon == s_options.socket_handlers[i] || colon[1] == '\0') {
+            g_printerr ("%s: Invalid URI handler specification '%s'\n",
+                        g_get_prgname (), s_options.socket_handlers[i]);
+            return EXIT_FAILURE;
+        }
+
+        *colon = '\0';  /* NULL-terminate the URI scheme name. */
+        g_autoptr(CogRequestHandler) handler = cog_socket_proxy_handler_new (colon + 1);
+        g_autoptr(CogRequestHandler) routes_handler = cog_prefix_routes_handler_new (handler);
+        cog_shell_set_request_handler (shell, s_options.socket_handlers[i], routes_handler);
     }
 
+    s_options.home_uri = g_steal_pointer (&utf8_uri);
+
     g_object_set (shell, "device-scale-factor", s_options.device_scale_factor, NULL);
 
+#ifdef COG_WEB_EXTENSIONS_DIR
+    /* The rewrite map is used by the web extension shipped with Cog. */
+    if (s_options.rewrite_map && !s_options.web_extensions_dir)
+        s_options.web_extensions_dir = g_strdup (COG_WEB_EXTENSIONS_DIR);
+#endif // COG_WEB_EXTENSIONS_DIR
+
     if (s_options.web_extensions_dir != NULL) {
         webkit_web_context_set_web_extensions_directory (cog_shell_get_web_context (shell),
                                                          s_options.web_extensions_dir);
     }
 
+    if (s_options.rewrite_map) {
+        g_autoptr(GFile) file = g_file_new_for_commandline_arg (s_options.rewrite_map);
+        g_auto(GVariantBuilder) user_data;
+        g_variant_builder_init (&user_data, G_VARIANT_TYPE_VARDICT);
+        g_variant_builder_add (&user_data, "{sv}", "rewrite-map",
+                               g_variant_new_string (g_file_peek_path (file)));
+        webkit_web_context_set_web_extensions_initialization_user_data (cog_shell_get_web_context (shell),
+                                                                        g_variant_builder_end (&user_data));
+    }
+
     webkit_web_context_set_tls_errors_policy (cog_shell_get_web_context (shell),
                                               s_options.ignore_tls_errors
                                               ? WEBKIT_TLS_ERRORS_POLICY_IGNORE
                                               : WEBKIT_TLS_ERRORS_POLICY_FAIL);
 
+    /* Applied before startup, which may launch a web process early. */
+    if (s_options.doc_viewer) {
+        webkit_web_context_set_cache_model (cog_shell_get_web_context (shell),
+                                            WEBKIT_CACHE_MODEL_DOCUMENT_VIEWER);
+    }
+
     return -1;  /* Continue startup. */
 }
 
 
+static int
+on_handle_local_options (GApplication *application,
+                         GVariantDict *options,
+                         void         *user_data)
+{
+    cog_startup_trace_end ("parse-options");
+
+    cog_startup_trace_begin ("handle-local-options");
+    int status = handle_local_options (application, options, user_data);
+    cog_startup_trace_end ("handle-local-options");
+
+    return status;
+}
+
+
 static gboolean
 platform_setup (CogShell *shell)
 {
@@ -311,14 +837,20 @@ platform_setup (CogShell *shell)
     g_debug ("%s: Platform plugin: %s", __func__, platform_soname);
 
     g_autoptr(CogPlatform) platform = cog_platform_new ();
-    if (!cog_platform_try_load (platform, platform_soname)) {
+    cog_startup_trace_begin ("platform-load");
+    gboolean loaded = cog_platform_try_load (platform, platform_soname);
+    cog_startup_trace_end ("platform-load");
+    if (!loaded) {
         g_warning ("Could not load: %s (possible cause: %s).\n",
                    platform_soname, strerror (errno));
         return FALSE;
     }
 
     g_autoptr(GError) error = NULL;
-    if (!cog_platform_setup (platform, shell, "", &error)) {
+    cog_startup_trace_begin ("platform-setup");
+    gboolean setup = cog_platform_setup (platform, shell, "", &error);
+    cog_startup_trace_end ("platform-setup");
+    if (!setup) {
         g_warning ("Platform setup failed: %s", error->message);
         return FALSE;
     }
@@ -335,6 +867,11 @@ on_shutdown (CogLauncher *launcher G_GNUC_UNUSED, void *user_data G_GNUC_UNUSED)
 {
     g_debug ("%s: Platform = %p", __func__, s_options.platform);
 
+    playlist_clear_source (&s_playlist.settle_source);
+    playlist_clear_source (&s_playlist.advance_source);
+    s_playlist.next_view = NULL;
+    g_clear_pointer (&s_playlist.uris, g_strfreev);
+
     if (s_options.platform) {
         cog_platform_teardown (s_options.platform);
         g_clear_pointer (&s_options.platform, cog_platform_free);
@@ -350,20 +887,51 @@ on_web_view_create (WebKitWebView          *web_view,
     return NULL;
 }
 
-static WebKitWebView*
-on_create_view (CogShell *shell, void *user_data G_GNUC_UNUSED)
+static void
+on_web_view_load_changed_trace (WebKitWebView  *web_view,
+                                WebKitLoadEvent load_event,
+                                void           *user_data G_GNUC_UNUSED)
 {
-    WebKitWebContext *web_context = cog_shell_get_web_context (shell);
+    g_autofree char *name =
+        g_strconcat ("load-", cog_g_enum_get_nick (WEBKIT_TYPE_LOAD_EVENT, load_event), NULL);
+    cog_startup_trace_mark (name);
 
-    if (s_options.doc_viewer) {
-        webkit_web_context_set_cache_model (web_context,
-                                            WEBKIT_CACHE_MODEL_DOCUMENT_VIEWER);
+    /*
+     * Startup is considered done once the home URI has been loaded, and
+     * its contents have been shown on screen.
+     */
+    if (load_event == WEBKIT_LOAD_FINISHED) {
+        g_signal_handlers_disconnect_by_func (web_view, on_web_view_load_changed_trace, NULL);
+        cog_startup_trace_finish_after_frame (STARTUP_TRACE_FRAME_TIMEOUT);
     }
+}
+
+static void
+on_initialize_web_extensions_trace (WebKitWebContext *web_context G_GNUC_UNUSED,
+                                    void             *user_data G_GNUC_UNUSED)
+{
+    cog_startup_trace_mark ("web-process-launch");
+}
+
+static WebKitWebView*
+create_view (CogShell *shell)
+{
+    WebKitWebContext *web_context = cog_shell_get_web_context (shell);
 
     WebKitWebViewBackend *view_backend = NULL;
 
+    /*
+     * Additional views for the pool need their own view backend, which
+     * only platform plug-ins that can present multiple views provide.
+     */
+    if (cog_shell_get_web_view (shell) &&
+        (!s_options.platform || !cog_platform_supports_multiple_views (s_options.platform))) {
+        g_warning ("Platform does not support multiple web views.");
+        return NULL;
+    }
+
     // Try to load the platform plug-in specified in the command line.
-    if (platform_setup (shell)) {
+    if (s_options.platform || platform_setup (shell)) {
         g_autoptr(GError) error = NULL;
         view_backend = cog_platform_get_view_backend (s_options.platform, NULL, &error);
         if (!view_backend) {
@@ -438,13 +1006,32 @@ on_create_view (CogShell *shell, void *user_data G_GNUC_UNUSED)
     cog_web_view_connect_default_progress_handlers (web_view);
     cog_web_view_connect_default_error_handlers (web_view);
 
-    g_message("trace %s %s", __func__, "load_uri");
-    webkit_web_view_load_uri (web_view, s_options.home_uri);
-    g_clear_pointer (&s_options.home_uri, g_free);
+    // Only the initial view loads the home URI.
+    if (s_options.home_uri) {
+        g_signal_connect (web_view, "load-changed", G_CALLBACK (on_web_view_load_changed_trace), NULL);
+        webkit_web_view_load_uri (web_view, s_options.home_uri);
+        g_clear_pointer (&s_options.home_uri, g_free);
+    }
 
     return g_steal_pointer (&web_view);
 }
 
+static WebKitWebView*
+on_create_view (CogShell *shell, void *user_data G_GNUC_UNUSED)
+{
+    cog_startup_trace_begin ("create-view");
+    WebKitWebView *web_view = create_view (shell);
+    cog_startup_trace_end ("create-view");
+    return web_view;
+}
+
+static void
+on_notify_web_view (CogShell *shell, GParamSpec *pspec G_GNUC_UNUSED, void *user_data G_GNUC_UNUSED)
+{
+    if (s_options.platform)
+        cog_platform_set_active_view (s_options.platform, cog_shell_get_web_view (shell));
+}
+
 static void
 on_action_resize (G_GNUC_UNUSED GAction *action,
                   GVariant              *param,
@@ -469,7 +1056,7 @@ main (int argc, char *argv[])
         g_set_prgname (dir_separator ? dir_separator + 1 : argv[0]);
         g_set_application_name ("Cog");
     }
-    g_message("trace %s", __func__);
+    cog_startup_trace_mark ("main");
 
     g_autoptr(GApplication) app = G_APPLICATION (cog_launcher_get_default ());
     g_application_add_main_option_entries (app, s_cli_options);
@@ -477,12 +1064,24 @@ main (int argc, char *argv[])
     cog_launcher_add_web_cookies_option_entries (COG_LAUNCHER (app));
     cog_launcher_add_web_permissions_option_entries (COG_LAUNCHER (app));
     cog_launcher_add_action (COG_LAUNCHER(app), "resize", on_action_resize, G_VARIANT_TYPE_STRING);
+    cog_launcher_add_action (COG_LAUNCHER(app), "next-slide", on_action_next_slide, NULL);
 
     g_signal_connect (app, "shutdown", G_CALLBACK (on_shutdown), NULL);
+    g_signal_connect_after (app, "startup", G_CALLBACK (on_startup_playlist), NULL);
     g_signal_connect (app, "handle-local-options",
                       G_CALLBACK (on_handle_local_options), NULL);
     g_signal_connect (cog_launcher_get_shell (COG_LAUNCHER (app)), "create-view",
                       G_CALLBACK (on_create_view), NULL);
-
-    return g_application_run (app, argc, argv);
+    g_signal_connect (cog_launcher_get_shell (COG_LAUNCHER (app)), "notify::web-view",
+                      G_CALLBACK (on_notify_web_view), NULL);
+    g_signal_connect (cog_shell_get_web_context (cog_launcher_get_shell (COG_LAUNCHER (app))),
+                      "initialize-web-extensions",
+                      G_CALLBACK (on_initialize_web_extensions_trace), NULL);
+
+    cog_startup_trace_begin ("parse-options");
+    int status = g_application_run (app, argc, argv);
+
+    /* Write the trace also when startup did not get to load a page. */
+    cog_startup_trace_finish ();
+    return status;
 }
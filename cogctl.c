@@ -46,30 +46,44 @@ static GOptionEntry s_cli_options[] = {
 };
 
 
+#define COG_STATS_GET_REQUEST_STATS  "com.igalia.Cog.Stats", "GetRequestStats"
+
+
+static GVariant*
+call_method_with_reply (const char         *iface,
+                        const char         *method,
+                        GVariant           *params,
+                        const GVariantType *reply_type,
+                        GError            **error)
+{
+    const GBusType bus_type =
+        s_options.system_bus ? G_BUS_TYPE_SYSTEM : G_BUS_TYPE_SESSION;
+    g_autoptr(GDBusConnection) conn = g_bus_get_sync (bus_type, NULL, error);
+    if (!conn)
+        return NULL;
+
+    return g_dbus_connection_call_sync (conn,
+                                        s_options.appid,
+                                        s_options.objpath,
+                                        iface,
+                                        method,
+                                        params,
+                                        reply_type,
+                                        G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                                        -1,
+                                        NULL,
+                                        error);
+}
+
+
 static gboolean
 call_method (const char *iface,
              const char *method,
              GVariant   *params,
              GError    **error)
 {
-    const GBusType bus_type =
-        s_options.system_bus ? G_BUS_TYPE_SYSTEM : G_BUS_TYPE_SESSION;
-    g_autoptr(GDBusConnection) conn = g_bus_get_sync (bus_type, NULL, error);
-    if (!error)
-        return FALSE;
-
     g_autoptr(GVariant) result =
-        g_dbus_connection_call_sync (conn,
-                                     s_options.appid,
-                                     s_options.objpath,
-                                     iface,
-                                     method,
-                                     params,
-                                     NULL,
-                                     G_DBUS_CALL_FLAGS_NO_AUTO_START,
-                                     -1,
-                                     NULL,
-                                     error);
+        call_method_with_reply (iface, method, params, NULL, error);
     return !!result;
 }
 
@@ -209,6 +223,58 @@ cmd_resize (const char               *name,
 }
 
 
+static int
+cmd_mount (const char               *name,
+           G_GNUC_UNUSED const void *data,
+           int                       argc,
+           char                    **argv)
+{
+    cmd_check_simple_help ("mount SCHEME PREFIX PATH", 3, &argc, &argv);
+
+    /* Relative paths would be resolved from the directory where Cog runs. */
+    g_autoptr(GFile) file = g_file_new_for_commandline_arg (argv[3]);
+    g_autofree char *path = g_file_get_path (file);
+    if (!path) {
+        g_printerr ("Path is not local: %s\n", argv[3]);
+        return EXIT_FAILURE;
+    }
+
+    g_autoptr(GVariantBuilder) param =
+        g_variant_builder_new (G_VARIANT_TYPE ("av"));
+    g_variant_builder_add (param, "v", g_variant_new ("(sss)", argv[1], argv[2], path));
+    GVariant *params = g_variant_new ("(sava{sv})", "mount", param, NULL);
+
+    g_autoptr(GError) error = NULL;
+    if (!call_method (GTK_ACTIONS_ACTIVATE, params, &error)) {
+        g_printerr ("%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+static int
+cmd_unmount (const char               *name,
+             G_GNUC_UNUSED const void *data,
+             int                       argc,
+             char                    **argv)
+{
+    cmd_check_simple_help ("unmount SCHEME PREFIX", 2, &argc, &argv);
+
+    g_autoptr(GVariantBuilder) param =
+        g_variant_builder_new (G_VARIANT_TYPE ("av"));
+    g_variant_builder_add (param, "v", g_variant_new ("(ss)", argv[1], argv[2]));
+    GVariant *params = g_variant_new ("(sava{sv})", "unmount", param, NULL);
+
+    g_autoptr(GError) error = NULL;
+    if (!call_method (GTK_ACTIONS_ACTIVATE, params, &error)) {
+        g_printerr ("%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
 static int
 cmd_ping (const char               *name,
           G_GNUC_UNUSED const void *data,
@@ -222,6 +288,97 @@ cmd_ping (const char               *name,
 }
 
 
+/*
+ * Estimates a percentile from a latency histogram, returning the upper
+ * limit of the bucket which contains it, in milliseconds.
+ */
+static double
+latency_percentile (GVariant *latency, guint64 count, double percentile)
+{
+    const guint64 target = (guint64) (count * percentile + 0.5);
+    guint64 limit = 0, seen = 0;
+
+    GVariantIter iter;
+    guint64 bucket_count;
+    g_variant_iter_init (&iter, latency);
+    while (g_variant_iter_next (&iter, "(tt)", &limit, &bucket_count)) {
+        seen += bucket_count;
+        if (seen >= target)
+            break;
+    }
+    return limit / 1000.0;
+}
+
+
+static int
+cmd_stats (const char               *name,
+           G_GNUC_UNUSED const void *data,
+           int                       argc,
+           char                    **argv)
+{
+    cmd_check_simple_help (name, 0, &argc, &argv);
+
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GVariant) result =
+        call_method_with_reply (COG_STATS_GET_REQUEST_STATS, NULL,
+                                G_VARIANT_TYPE ("(a{sa{sv}})"), &error);
+    if (!result) {
+        g_printerr ("%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    g_autoptr(GVariant) schemes = g_variant_get_child_value (result, 0);
+    if (g_variant_n_children (schemes) == 0) {
+        g_print ("No request handlers installed\n");
+        return EXIT_SUCCESS;
+    }
+
+    g_print ("%-12s %10s %8s %12s %9s %9s %9s %9s\n",
+             "SCHEME", "REQUESTS", "ERRORS", "BYTES",
+             "MEAN(ms)", "P50(ms)", "P90(ms)", "P99(ms)");
+
+    GVariantIter iter;
+    const char *scheme;
+    GVariant *stats;
+    g_variant_iter_init (&iter, schemes);
+    while (g_variant_iter_loop (&iter, "{&s@a{sv}}", &scheme, &stats)) {
+        guint64 requests = 0, errors = 0, bytes = 0, total_time = 0;
+        g_variant_lookup (stats, "requests", "t", &requests);
+        g_variant_lookup (stats, "errors", "t", &errors);
+        g_variant_lookup (stats, "bytes", "t", &bytes);
+        g_variant_lookup (stats, "total-time", "t", &total_time);
+
+        g_autoptr(GVariant) latency =
+            g_variant_lookup_value (stats, "latency", G_VARIANT_TYPE ("a(tt)"));
+
+        guint64 finished = 0;
+        if (latency) {
+            GVariantIter latency_iter;
+            guint64 bucket_count;
+            g_variant_iter_init (&latency_iter, latency);
+            while (g_variant_iter_next (&latency_iter, "(tt)", NULL, &bucket_count))
+                finished += bucket_count;
+        }
+
+        if (finished) {
+            g_print ("%-12s %10" G_GUINT64_FORMAT " %8" G_GUINT64_FORMAT " %12" G_GUINT64_FORMAT
+                     " %9.2f %9.2f %9.2f %9.2f\n",
+                     scheme, requests, errors, bytes,
+                     total_time / 1000.0 / finished,
+                     latency_percentile (latency, finished, 0.50),
+                     latency_percentile (latency, finished, 0.90),
+                     latency_percentile (latency, finished, 0.99));
+        } else {
+            g_print ("%-12s %10" G_GUINT64_FORMAT " %8" G_GUINT64_FORMAT " %12" G_GUINT64_FORMAT
+                     " %9s %9s %9s %9s\n",
+                     scheme, requests, errors, bytes, "-", "-", "-", "-");
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
 static int
 cmd_help (const char *name,
           const void *data,
@@ -305,11 +462,21 @@ cmd_find_by_name (const char *name)
             .data = "previous",
             .handler = cmd_generic_alias,
         },
+        {
+            .name = "mount",
+            .desc = "Serve a directory on a URI scheme path prefix",
+            .handler = cmd_mount,
+        },
         {
             .name = "next",
             .desc = "Navigate forward in the page view history",
             .handler = cmd_generic_no_args,
         },
+        {
+            .name = "next-slide",
+            .desc = "Switch to the next URL of the playlist",
+            .handler = cmd_generic_no_args,
+        },
         {
             .name = "ping",
             .desc = "Check whether Cog is running",
@@ -330,6 +497,16 @@ cmd_find_by_name (const char *name)
             .desc = "Reload the current page",
             .handler = cmd_generic_no_args,
         },
+        {
+            .name = "stats",
+            .desc = "Show statistics about custom URI scheme requests",
+            .handler = cmd_stats,
+        },
+        {
+            .name = "unmount",
+            .desc = "Stop serving a URI scheme path prefix",
+            .handler = cmd_unmount,
+        },
         {
             .name = NULL,
         },
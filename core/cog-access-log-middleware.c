@@ -0,0 +1,195 @@
+/*
+ * cog-access-log-middleware.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "cog-access-log-middleware.h"
+
+/**
+ * CogAccessLogMiddleware:
+ *
+ * Middleware which logs a line for each finished request.
+ *
+ * Lines contain the request URI, followed by the HTTP status code, the
+ * length of the response body (or `-` if unknown) and its MIME type.
+ * Requests finished with an error are logged along with the error message.
+ */
+
+struct _CogAccessLogMiddleware {
+    GObject parent;
+
+    gboolean enabled;
+};
+
+enum {
+    PROP_0,
+    PROP_ENABLED,
+    N_PROPERTIES,
+};
+
+static GParamSpec *s_properties[N_PROPERTIES] = { NULL, };
+
+
+static void
+on_request_finished (WebKitURISchemeRequest *request,
+                     const CogRequestResult *result,
+                     void                   *user_data G_GNUC_UNUSED)
+{
+    const char *uri = webkit_uri_scheme_request_get_uri (request);
+
+    if (result->error) {
+        g_message ("%s error: %s", uri, result->error->message);
+    } else if (result->length < 0) {
+        g_message ("%s %u - %s", uri, result->status,
+                   result->mime_type ? result->mime_type : "-");
+    } else {
+        g_message ("%s %u %" G_GINT64_FORMAT " %s", uri, result->status, result->length,
+                   result->mime_type ? result->mime_type : "-");
+    }
+}
+
+
+static void
+cog_access_log_middleware_run (CogRequestMiddleware   *middleware,
+                               WebKitURISchemeRequest *request,
+                               CogRequestHandler      *next)
+{
+    CogAccessLogMiddleware *self = COG_ACCESS_LOG_MIDDLEWARE (middleware);
+
+    if (self->enabled)
+        cog_request_add_finished_callback (request, on_request_finished, NULL, NULL);
+
+    cog_request_handler_run (next, request);
+}
+
+
+static void
+cog_access_log_middleware_iface_init (CogRequestMiddlewareInterface *iface)
+{
+    iface->run = cog_access_log_middleware_run;
+}
+
+
+G_DEFINE_TYPE_WITH_CODE (CogAccessLogMiddleware,
+                         cog_access_log_middleware,
+                         G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (COG_TYPE_REQUEST_MIDDLEWARE,
+                                                cog_access_log_middleware_iface_init))
+
+
+static void
+cog_access_log_middleware_get_property (GObject    *object,
+                                        unsigned    prop_id,
+                                        GValue     *value,
+                                        GParamSpec *pspec)
+{
+    CogAccessLogMiddleware *self = COG_ACCESS_LOG_MIDDLEWARE (object);
+    switch (prop_id) {
+        case PROP_ENABLED:
+            g_value_set_boolean (value, cog_access_log_middleware_get_enabled (self));
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+
+static void
+cog_access_log_middleware_set_property (GObject      *object,
+                                        unsigned      prop_id,
+                                        const GValue *value,
+                                        GParamSpec   *pspec)
+{
+    CogAccessLogMiddleware *self = COG_ACCESS_LOG_MIDDLEWARE (object);
+    switch (prop_id) {
+        case PROP_ENABLED:
+            cog_access_log_middleware_set_enabled (self, g_value_get_boolean (value));
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+
+static void
+cog_access_log_middleware_class_init (CogAccessLogMiddlewareClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    object_class->get_property = cog_access_log_middleware_get_property;
+    object_class->set_property = cog_access_log_middleware_set_property;
+
+    /**
+     * CogAccessLogMiddleware:enabled: (attributes org.gtk.Property.get=cog_access_log_middleware_get_enabled org.gtk.Property.set=cog_access_log_middleware_set_enabled):
+     *
+     * Whether requests are logged. When disabled, requests are passed
+     * to the next handler without any additional work.
+     */
+    s_properties[PROP_ENABLED] =
+        g_param_spec_boolean ("enabled",
+                              "Enabled",
+                              "Whether to log requests",
+                              TRUE,
+                              G_PARAM_READWRITE |
+                              G_PARAM_CONSTRUCT |
+                              G_PARAM_STATIC_STRINGS);
+
+    g_object_class_install_properties (object_class, N_PROPERTIES, s_properties);
+}
+
+
+static void
+cog_access_log_middleware_init (CogAccessLogMiddleware *self G_GNUC_UNUSED)
+{
+}
+
+
+/**
+ * cog_access_log_middleware_new:
+ *
+ * Creates a new middleware which logs finished requests.
+ *
+ * Returns: (transfer full): A new middleware.
+ */
+CogRequestMiddleware*
+cog_access_log_middleware_new (void)
+{
+    return g_object_new (COG_TYPE_ACCESS_LOG_MIDDLEWARE, NULL);
+}
+
+/**
+ * cog_access_log_middleware_get_enabled:
+ * @self: a #CogAccessLogMiddleware
+ *
+ * Gets the value of the [property@Cog.AccessLogMiddleware:enabled] property.
+ *
+ * Returns: Whether requests are logged.
+ */
+gboolean
+cog_access_log_middleware_get_enabled (CogAccessLogMiddleware *self)
+{
+    g_return_val_if_fail (COG_IS_ACCESS_LOG_MIDDLEWARE (self), FALSE);
+    return self->enabled;
+}
+
+/**
+ * cog_access_log_middleware_set_enabled:
+ * @self: a #CogAccessLogMiddleware
+ * @enabled: Whether to log requests.
+ *
+ * Sets the value of the [property@Cog.AccessLogMiddleware:enabled] property.
+ */
+void
+cog_access_log_middleware_set_enabled (CogAccessLogMiddleware *self,
+                                       gboolean                enabled)
+{
+    g_return_if_fail (COG_IS_ACCESS_LOG_MIDDLEWARE (self));
+
+    enabled = !!enabled;
+    if (self->enabled == enabled)
+        return;
+
+    self->enabled = enabled;
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_ENABLED]);
+}
@@ -0,0 +1,36 @@
+/*
+ * cog-access-log-middleware.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#if !(defined(COG_INSIDE_COG__) && COG_INSIDE_COG__)
+# error "Do not include this header directly, use <cog.h> instead"
+#endif
+
+#include "cog-request-middleware.h"
+
+G_BEGIN_DECLS
+
+#define COG_TYPE_ACCESS_LOG_MIDDLEWARE  (cog_access_log_middleware_get_type ())
+
+G_DECLARE_FINAL_TYPE (CogAccessLogMiddleware,
+                      cog_access_log_middleware,
+                      COG, ACCESS_LOG_MIDDLEWARE,
+                      GObject)
+
+struct _CogAccessLogMiddlewareClass {
+    GObjectClass parent_class;
+};
+
+
+CogRequestMiddleware* cog_access_log_middleware_new         (void);
+
+gboolean              cog_access_log_middleware_get_enabled (CogAccessLogMiddleware *self);
+void                  cog_access_log_middleware_set_enabled (CogAccessLogMiddleware *self,
+                                                             gboolean                enabled);
+
+G_END_DECLS
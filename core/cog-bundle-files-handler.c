@@ -0,0 +1,455 @@
+/*
+ * cog-bundle-files-handler.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "cog-bundle-files-handler.h"
+#include "cog-bundle-format.h"
+#include <gio/gio.h>
+#include <string.h>
+
+/**
+ * CogBundleFilesHandler:
+ *
+ * Request handler implementation that loads content from a bundle file.
+ *
+ * A bundle packs the contents of a directory into a single file, which
+ * can be created with the `cog-bundle` tool. Bundles contain an index of
+ * the files, sorted by the hash of their paths, and their contents.
+ *
+ * The bundle file is mapped into memory once, and looking up a path is a
+ * binary search over the index. Responses use slices of the mapped file,
+ * so no data is copied and no file system access is needed to answer
+ * requests. This is suitable for applications made of a large amount of
+ * small files, which are slow to deploy and open individually.
+ *
+ * As with [class@Cog.DirectoryFilesHandler], requests for paths which
+ * correspond to a directory are answered with its `index.html` file.
+ */
+
+struct _CogBundleFilesHandler {
+    GObject parent;
+
+    GFile                *bundle_file;
+    unsigned              strip_components;
+
+    GBytes               *contents;
+    const CogBundleEntry *entries;
+    guint32               n_entries;
+    const char           *strings;
+    gsize                 strings_size;
+    GBytes               *data;
+};
+
+enum {
+    PROP_0,
+    PROP_BUNDLE_FILE,
+    PROP_STRIP_COMPONENTS,
+    N_PROPERTIES,
+};
+
+static GParamSpec *s_properties[N_PROPERTIES] = { NULL, };
+
+
+static const char*
+cog_bundle_files_handler_get_string (CogBundleFilesHandler *self,
+                                     guint32                offset)
+{
+    /* The strings section is NUL-terminated, checked on initialization. */
+    offset = GUINT32_FROM_LE (offset);
+    return (offset < self->strings_size) ? self->strings + offset : NULL;
+}
+
+
+static const CogBundleEntry*
+cog_bundle_files_handler_lookup (CogBundleFilesHandler *self,
+                                 const char            *path,
+                                 size_t                 length)
+{
+    const guint64 hash = cog_bundle_hash (path, length);
+
+    /* Find the first entry with a matching hash. */
+    guint32 lo = 0, hi = self->n_entries;
+    while (lo < hi) {
+        guint32 mid = lo + (hi - lo) / 2;
+        if (GUINT64_FROM_LE (self->entries[mid].hash) < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    /* Check the paths of all the entries with the same hash. */
+    for (; lo < self->n_entries && GUINT64_FROM_LE (self->entries[lo].hash) == hash; lo++) {
+        const char *entry_path =
+            cog_bundle_files_handler_get_string (self, self->entries[lo].path_offset);
+        if (entry_path && strncmp (entry_path, path, length) == 0 && entry_path[length] == '\0')
+            return &self->entries[lo];
+    }
+
+    return NULL;
+}
+
+
+static void
+cog_bundle_files_handler_run (CogRequestHandler      *request_handler,
+                              WebKitURISchemeRequest *request)
+{
+    CogBundleFilesHandler *handler = COG_BUNDLE_FILES_HANDLER (request_handler);
+
+    g_autoptr(SoupURI) uri =
+        soup_uri_new (webkit_uri_scheme_request_get_uri (request));
+
+    /*
+     * If we get an empty path, redirect to the root resource "/", otherwise
+     * subresources cannot load properly as there would be no base URI.
+     */
+    const char *uri_path = soup_uri_get_path (uri);
+    if (uri_path[0] != '/') {
+        soup_uri_set_path (uri, "/");
+        g_autofree char *uri_string = soup_uri_to_string (uri, FALSE);
+        webkit_web_view_load_uri (webkit_uri_scheme_request_get_web_view (request), uri_string);
+        return;
+    }
+
+    g_autofree char *decoded_path = g_uri_unescape_string (uri_path, NULL);
+    if (!decoded_path) {
+        g_autoptr(GError) error = g_error_new (G_IO_ERROR,
+                                               G_IO_ERROR_INVALID_FILENAME,
+                                               "Invalid path in URI: %s",
+                                               uri_path);
+        cog_request_finish_error (request, error);
+        return;
+    }
+
+    /* Paths in bundles do not have leading slashes. */
+    const char *path = decoded_path;
+    while (path[0] == '/')
+        ++path;
+
+    /*
+     * Discard non-empty leading path components, in the same way as
+     * CogDirectoryFilesHandler does.
+     */
+    for (unsigned i = 0; i < handler->strip_components && path[0] != '\0'; i++) {
+        while (path[0] != '/' && path[0] != '\0')
+            ++path;
+        while (path[0] == '/')
+            ++path;
+    }
+
+    /*
+     * Try the path as-is first, unless it obviously names a directory,
+     * and then the "index.html" file it may contain.
+     */
+    size_t length = strlen (path);
+    const CogBundleEntry *entry = NULL;
+    if (length > 0 && path[length - 1] != '/')
+        entry = cog_bundle_files_handler_lookup (handler, path, length);
+
+    if (!entry) {
+        g_autoptr(GString) index_path = g_string_new_len (path, length);
+        if (length > 0 && path[length - 1] != '/')
+            g_string_append_c (index_path, '/');
+        g_string_append (index_path, "index.html");
+        entry = cog_bundle_files_handler_lookup (handler, index_path->str, index_path->len);
+    }
+
+    if (!entry) {
+        g_autoptr(GError) error = g_error_new (G_IO_ERROR,
+                                               G_IO_ERROR_NOT_FOUND,
+                                               "Path '%s' not found in bundle",
+                                               path);
+        cog_request_finish_error (request, error);
+        return;
+    }
+
+    /*
+     * Bounds of the data are checked here instead of when loading the
+     * bundle, to avoid touching the whole index on startup.
+     */
+    const guint64 data_size = g_bytes_get_size (handler->data);
+    const guint64 offset = GUINT64_FROM_LE (entry->data_offset);
+    const guint64 size = GUINT64_FROM_LE (entry->data_size);
+    const char *mime_type = cog_bundle_files_handler_get_string (handler, entry->mime_type_offset);
+    if (offset > data_size || size > data_size - offset || !mime_type) {
+        g_autoptr(GError) error = g_error_new (cog_bundle_files_handler_error_quark (),
+                                               COG_BUNDLE_FILES_HANDLER_ERROR_INVALID_BUNDLE,
+                                               "Invalid bundle entry for path '%s'",
+                                               path);
+        cog_request_finish_error (request, error);
+        return;
+    }
+
+    g_autoptr(GBytes) contents = g_bytes_new_from_bytes (handler->data, offset, size);
+    cog_request_finish_bytes (request, contents, mime_type);
+}
+
+
+static void
+cog_bundle_files_handler_iface_init (CogRequestHandlerInterface *iface)
+{
+    iface->run = cog_bundle_files_handler_run;
+}
+
+
+static gboolean
+cog_bundle_files_handler_initable_init (GInitable    *initable,
+                                        GCancellable *cancellable G_GNUC_UNUSED,
+                                        GError      **error)
+{
+    CogBundleFilesHandler *self = COG_BUNDLE_FILES_HANDLER (initable);
+
+    g_autofree char *path = g_file_get_path (self->bundle_file);
+    if (!path) {
+        g_autofree char *uri = g_file_get_uri (self->bundle_file);
+        g_set_error (error,
+                     cog_bundle_files_handler_error_quark (),
+                     COG_BUNDLE_FILES_HANDLER_ERROR_PATH_NOT_NATIVE,
+                     "Path is not local: %s", uri);
+        return FALSE;
+    }
+
+    g_autoptr(GMappedFile) mapped_file = g_mapped_file_new (path, FALSE, error);
+    if (!mapped_file)
+        return FALSE;
+
+    g_autoptr(GBytes) contents = g_mapped_file_get_bytes (mapped_file);
+    gsize size = 0;
+    const char *base = g_bytes_get_data (contents, &size);
+
+    const CogBundleHeader *header = (const CogBundleHeader*) base;
+    if (size < sizeof (CogBundleHeader) ||
+        memcmp (header->magic, COG_BUNDLE_MAGIC, sizeof (header->magic)) != 0) {
+        g_set_error (error,
+                     cog_bundle_files_handler_error_quark (),
+                     COG_BUNDLE_FILES_HANDLER_ERROR_INVALID_BUNDLE,
+                     "File is not a bundle: %s", path);
+        return FALSE;
+    }
+
+    if (GUINT32_FROM_LE (header->version) != COG_BUNDLE_VERSION) {
+        g_set_error (error,
+                     cog_bundle_files_handler_error_quark (),
+                     COG_BUNDLE_FILES_HANDLER_ERROR_INVALID_BUNDLE,
+                     "Unsupported bundle version %" G_GUINT32_FORMAT ": %s",
+                     GUINT32_FROM_LE (header->version), path);
+        return FALSE;
+    }
+
+    const guint32 n_entries = GUINT32_FROM_LE (header->n_entries);
+    const guint64 entries_end = sizeof (CogBundleHeader) + (guint64) n_entries * sizeof (CogBundleEntry);
+    const guint64 strings_offset = GUINT64_FROM_LE (header->strings_offset);
+    const guint64 data_offset = GUINT64_FROM_LE (header->data_offset);
+
+    if (entries_end > strings_offset ||
+        strings_offset > data_offset ||
+        data_offset > size ||
+        (data_offset > strings_offset && base[data_offset - 1] != '\0')) {
+        g_set_error (error,
+                     cog_bundle_files_handler_error_quark (),
+                     COG_BUNDLE_FILES_HANDLER_ERROR_INVALID_BUNDLE,
+                     "Bundle is truncated or corrupted: %s", path);
+        return FALSE;
+    }
+
+    self->entries = (const CogBundleEntry*) (base + sizeof (CogBundleHeader));
+    self->n_entries = n_entries;
+    self->strings = base + strings_offset;
+    self->strings_size = data_offset - strings_offset;
+    self->data = g_bytes_new_from_bytes (contents, data_offset, size - data_offset);
+    self->contents = g_steal_pointer (&contents);
+
+    g_debug ("%s: Loaded %s, %" G_GUINT32_FORMAT " entries, %zu bytes",
+             __func__, path, n_entries, size);
+    return TRUE;
+}
+
+
+static void
+cog_bundle_files_handler_initable_iface_init (GInitableIface *iface)
+{
+    iface->init = cog_bundle_files_handler_initable_init;
+}
+
+
+G_DEFINE_TYPE_WITH_CODE (CogBundleFilesHandler,
+                         cog_bundle_files_handler,
+                         G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_INITABLE,
+                                                cog_bundle_files_handler_initable_iface_init)
+                         G_IMPLEMENT_INTERFACE (COG_TYPE_REQUEST_HANDLER,
+                                                cog_bundle_files_handler_iface_init))
+
+
+static void
+cog_bundle_files_handler_get_property (GObject    *object,
+                                       unsigned    prop_id,
+                                       GValue     *value,
+                                       GParamSpec *pspec)
+{
+    CogBundleFilesHandler *handler = COG_BUNDLE_FILES_HANDLER (object);
+    switch (prop_id) {
+        case PROP_BUNDLE_FILE:
+            g_value_set_object (value, handler->bundle_file);
+            break;
+        case PROP_STRIP_COMPONENTS:
+            g_value_set_uint (value, cog_bundle_files_handler_get_strip_components (handler));
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+
+static void
+cog_bundle_files_handler_set_property (GObject      *object,
+                                       unsigned      prop_id,
+                                       const GValue *value,
+                                       GParamSpec   *pspec)
+{
+    CogBundleFilesHandler *handler = COG_BUNDLE_FILES_HANDLER (object);
+    switch (prop_id) {
+        case PROP_BUNDLE_FILE:
+            handler->bundle_file = g_value_dup_object (value);
+            break;
+        case PROP_STRIP_COMPONENTS:
+            cog_bundle_files_handler_set_strip_components (handler,
+                                                           g_value_get_uint (value));
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+
+static void
+cog_bundle_files_handler_dispose (GObject *object)
+{
+    CogBundleFilesHandler *handler = COG_BUNDLE_FILES_HANDLER (object);
+
+    handler->entries = NULL;
+    handler->n_entries = 0;
+    handler->strings = NULL;
+    handler->strings_size = 0;
+    g_clear_pointer (&handler->data, g_bytes_unref);
+    g_clear_pointer (&handler->contents, g_bytes_unref);
+    g_clear_object (&handler->bundle_file);
+
+    G_OBJECT_CLASS (cog_bundle_files_handler_parent_class)->dispose (object);
+}
+
+
+static void
+cog_bundle_files_handler_class_init (CogBundleFilesHandlerClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    object_class->get_property = cog_bundle_files_handler_get_property;
+    object_class->set_property = cog_bundle_files_handler_set_property;
+    object_class->dispose = cog_bundle_files_handler_dispose;
+
+    /**
+     * CogBundleFilesHandler:bundle-file:
+     *
+     * Bundle file from which to “serve” resources.
+     */
+    s_properties[PROP_BUNDLE_FILE] =
+        g_param_spec_object ("bundle-file",
+                             "Bundle file",
+                             "Bundle file where to load files from",
+                             G_TYPE_FILE,
+                             G_PARAM_READWRITE |
+                             G_PARAM_CONSTRUCT_ONLY |
+                             G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogBundleFilesHandler:strip-components: (attributes org.gtk.Property.get=cog_bundle_files_handler_get_strip_components org.gtk.Property.set=cog_bundle_files_handler_set_strip_components):
+     *
+     * Number of leading path components to strip (ignore) at the beginning
+     * of request URIs. See [property@Cog.DirectoryFilesHandler:strip-components].
+     */
+    s_properties[PROP_STRIP_COMPONENTS] =
+        g_param_spec_uint ("strip-components",
+                           "Strip path components",
+                           "Number of leading URI path components to ignore",
+                           0, G_MAXUINT, 0,
+                           G_PARAM_READWRITE |
+                           G_PARAM_CONSTRUCT |
+                           G_PARAM_STATIC_STRINGS);
+
+    g_object_class_install_properties (object_class, N_PROPERTIES, s_properties);
+}
+
+
+static void
+cog_bundle_files_handler_init (CogBundleFilesHandler *self G_GNUC_UNUSED)
+{
+}
+
+
+G_DEFINE_QUARK (CogBundleFilesHandlerError, cog_bundle_files_handler_error)
+
+
+/**
+ * cog_bundle_files_handler_new:
+ * @bundle_file: Bundle file to serve files from.
+ * @error: Location where to store an error, if any.
+ *
+ * Creates a new handler which serves files from a bundle file.
+ *
+ * The bundle file is mapped into memory and its header is validated.
+ *
+ * Returns: (transfer full) (nullable): A new request handler, or %NULL
+ *   if the bundle cannot be loaded.
+ */
+CogRequestHandler*
+cog_bundle_files_handler_new (GFile   *bundle_file,
+                              GError **error)
+{
+    g_return_val_if_fail (G_IS_FILE (bundle_file), NULL);
+    g_return_val_if_fail (!error || !*error, NULL);
+
+    return g_initable_new (COG_TYPE_BUNDLE_FILES_HANDLER,
+                           NULL,
+                           error,
+                           "bundle-file", bundle_file,
+                           NULL);
+}
+
+/**
+ * cog_bundle_files_handler_get_strip_components:
+ * @self: a #CogBundleFilesHandler
+ *
+ * Gets the value of the [property@Cog.BundleFilesHandler:strip-components]
+ * property.
+ *
+ * Returns: Number of leading URI path components to ignore.
+ */
+unsigned
+cog_bundle_files_handler_get_strip_components (CogBundleFilesHandler *self)
+{
+    g_return_val_if_fail (COG_IS_BUNDLE_FILES_HANDLER (self), 0);
+    return self->strip_components;
+}
+
+/**
+ * cog_bundle_files_handler_set_strip_components:
+ * @self: a #CogBundleFilesHandler
+ * @count: Number of leading URI path components to ignore.
+ *
+ * Sets the value of the [property@Cog.BundleFilesHandler:strip-components]
+ * property.
+ */
+void
+cog_bundle_files_handler_set_strip_components (CogBundleFilesHandler *self,
+                                               unsigned               count)
+{
+    g_return_if_fail (COG_IS_BUNDLE_FILES_HANDLER (self));
+
+    if (self->strip_components == count)
+        return;
+
+    self->strip_components = count;
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_STRIP_COMPONENTS]);
+}
@@ -0,0 +1,52 @@
+/*
+ * cog-bundle-files-handler.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#ifndef COG_BUNDLE_FILES_HANDLER_H
+#define COG_BUNDLE_FILES_HANDLER_H
+
+#if !(defined(COG_INSIDE_COG__) && COG_INSIDE_COG__)
+# error "Do not include this header directly, use <cog.h> instead"
+#endif
+
+#include "cog-request-handler.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GFile  GFile;
+typedef struct _GError GError;
+
+#define COG_TYPE_BUNDLE_FILES_HANDLER  (cog_bundle_files_handler_get_type ())
+
+G_DECLARE_FINAL_TYPE (CogBundleFilesHandler,
+                      cog_bundle_files_handler,
+                      COG, BUNDLE_FILES_HANDLER,
+                      GObject)
+
+struct _CogBundleFilesHandlerClass {
+    GObjectClass parent_class;
+};
+
+
+enum {
+    COG_BUNDLE_FILES_HANDLER_ERROR_PATH_NOT_NATIVE,
+    COG_BUNDLE_FILES_HANDLER_ERROR_INVALID_BUNDLE,
+};
+
+
+GQuark             cog_bundle_files_handler_error_quark         (void);
+CogRequestHandler* cog_bundle_files_handler_new                 (GFile   *bundle_file,
+                                                                 GError **error);
+
+unsigned           cog_bundle_files_handler_get_strip_components
+                                                                (CogBundleFilesHandler *self);
+void               cog_bundle_files_handler_set_strip_components
+                                                                (CogBundleFilesHandler *self,
+                                                                 unsigned               count);
+
+G_END_DECLS
+
+#endif /* !COG_BUNDLE_FILES_HANDLER_H */
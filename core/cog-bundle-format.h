@@ -0,0 +1,74 @@
+/*
+ * cog-bundle-format.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Layout of bundle files, as written by the cog-bundle tool and served by
+ * CogBundleFilesHandler. All integers are stored in little endian order.
+ *
+ *   +-----------------+
+ *   | CogBundleHeader |
+ *   +-----------------+
+ *   | CogBundleEntry  |  n_entries items, sorted by (hash, path)
+ *   | ...             |
+ *   +-----------------+
+ *   | strings         |  NUL-terminated paths and MIME types
+ *   +-----------------+
+ *   | data            |  file contents, each blob aligned to
+ *   | ...             |  COG_BUNDLE_DATA_ALIGNMENT bytes
+ *   +-----------------+
+ *
+ * Paths are relative to the bundled directory, use '/' as separator, and
+ * do not have a leading slash. Offsets of strings are relative to the
+ * start of the strings section, and offsets of blobs relative to the
+ * start of the data section.
+ */
+
+#define COG_BUNDLE_MAGIC           "CogBndl"
+#define COG_BUNDLE_VERSION         1
+#define COG_BUNDLE_DATA_ALIGNMENT  16
+
+typedef struct {
+    char    magic[8];       /* COG_BUNDLE_MAGIC, including the NUL. */
+    guint32 version;
+    guint32 n_entries;
+    guint64 strings_offset;
+    guint64 data_offset;
+} CogBundleHeader;
+
+typedef struct {
+    guint64 hash;           /* cog_bundle_hash() of the path. */
+    guint32 path_offset;
+    guint32 mime_type_offset;
+    guint64 data_offset;
+    guint64 data_size;
+} CogBundleEntry;
+
+G_STATIC_ASSERT (sizeof (CogBundleHeader) == 32);
+G_STATIC_ASSERT (sizeof (CogBundleEntry) == 32);
+
+
+/*
+ * 64-bit FNV-1a hash of the first "length" bytes of a path.
+ */
+static inline guint64
+cog_bundle_hash (const char *path, size_t length)
+{
+    guint64 hash = G_GUINT64_CONSTANT (0xcbf29ce484222325);
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (guchar) path[i];
+        hash *= G_GUINT64_CONSTANT (0x100000001b3);
+    }
+    return hash;
+}
+
+G_END_DECLS
@@ -0,0 +1,487 @@
+/*
+ * cog-cache-middleware.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "cog-cache-middleware.h"
+#include <string.h>
+
+/**
+ * CogCacheMiddleware:
+ *
+ * Middleware which keeps responses in memory.
+ *
+ * Successful responses whose body is provided in memory by the next
+ * handler, that is, finished using [func@Cog.request_finish_bytes], are
+ * stored using the request URI as key. Further requests for the same URI
+ * are answered from the cache without involving the next handler.
+ *
+ * Handlers which produce streamed responses are not affected. The least
+ * recently used responses are evicted when the total size of the stored
+ * contents exceeds the [property@Cog.CacheMiddleware:max-bytes] limit,
+ * and responses can optionally expire after a certain amount of time,
+ * see [property@Cog.CacheMiddleware:max-age]. As the middleware does not
+ * know where responses come from, they are never validated otherwise; use
+ * [method@Cog.CacheMiddleware.clear] when the content changes.
+ */
+
+#define DEFAULT_MAX_BYTES  (4 * 1024 * 1024)
+
+typedef struct {
+    char    *uri;
+    char    *mime_type;
+    GBytes  *contents;
+    guint64  size;
+    gint64   expires;   /* Monotonic time, in microseconds; zero for never. */
+    GList    link;      /* Position in the LRU list, data points to self. */
+} CacheEntry;
+
+struct _CogCacheMiddleware {
+    GObject parent;
+
+    gboolean    enabled;
+    guint64     max_bytes;
+    unsigned    max_age;
+
+    guint64     size;
+    GHashTable *entries;    /* (string, CacheEntry) */
+    GQueue      lru;        /* Most recently used entries first. */
+};
+
+enum {
+    PROP_0,
+    PROP_ENABLED,
+    PROP_MAX_BYTES,
+    PROP_MAX_AGE,
+    N_PROPERTIES,
+};
+
+static GParamSpec *s_properties[N_PROPERTIES] = { NULL, };
+
+
+static void
+cache_entry_free (void *pointer)
+{
+    CacheEntry *entry = pointer;
+    g_clear_pointer (&entry->uri, g_free);
+    g_clear_pointer (&entry->mime_type, g_free);
+    g_clear_pointer (&entry->contents, g_bytes_unref);
+    g_slice_free (CacheEntry, entry);
+}
+
+
+static void
+cog_cache_middleware_remove (CogCacheMiddleware *self,
+                             CacheEntry         *entry)
+{
+    g_queue_unlink (&self->lru, &entry->link);
+    self->size -= entry->size;
+    g_hash_table_remove (self->entries, entry->uri);
+}
+
+
+static void
+cog_cache_middleware_trim (CogCacheMiddleware *self,
+                           guint64             max_bytes)
+{
+    while (self->size > max_bytes) {
+        CacheEntry *entry = g_queue_peek_tail (&self->lru);
+        g_assert (entry);
+        g_debug ("%s: Evicting '%s'", __func__, entry->uri);
+        cog_cache_middleware_remove (self, entry);
+    }
+}
+
+
+static CacheEntry*
+cog_cache_middleware_lookup (CogCacheMiddleware *self,
+                             const char         *uri)
+{
+    CacheEntry *entry = g_hash_table_lookup (self->entries, uri);
+    if (!entry)
+        return NULL;
+
+    if (entry->expires && g_get_monotonic_time () >= entry->expires) {
+        g_debug ("%s: Expired entry '%s'", __func__, uri);
+        cog_cache_middleware_remove (self, entry);
+        return NULL;
+    }
+
+    /* Move to the front of the LRU list. */
+    g_queue_unlink (&self->lru, &entry->link);
+    g_queue_push_head_link (&self->lru, &entry->link);
+    return entry;
+}
+
+
+static void
+cog_cache_middleware_insert (CogCacheMiddleware *self,
+                             const char         *uri,
+                             GBytes             *contents,
+                             const char         *mime_type)
+{
+    const guint64 size = g_bytes_get_size (contents);
+    if (size > self->max_bytes)
+        return;
+
+    CacheEntry *entry = g_hash_table_lookup (self->entries, uri);
+    if (entry)
+        cog_cache_middleware_remove (self, entry);
+
+    entry = g_slice_new0 (CacheEntry);
+    entry->uri = g_strdup (uri);
+    entry->mime_type = g_strdup (mime_type);
+    entry->contents = g_bytes_ref (contents);
+    entry->size = size;
+    if (self->max_age)
+        entry->expires = g_get_monotonic_time () + (gint64) self->max_age * G_USEC_PER_SEC;
+    entry->link.data = entry;
+
+    g_hash_table_insert (self->entries, entry->uri, entry);
+    g_queue_push_head_link (&self->lru, &entry->link);
+    self->size += size;
+
+    cog_cache_middleware_trim (self, self->max_bytes);
+}
+
+
+/*
+ * Only plain GET requests can be answered with a stored response. Range
+ * requests would need the response to be sliced, so they are left to the
+ * next handler as well.
+ */
+static gboolean
+request_is_cacheable (WebKitURISchemeRequest *request)
+{
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+    const char *method = webkit_uri_scheme_request_get_http_method (request);
+    if (method && strcmp (method, "GET") != 0)
+        return FALSE;
+
+    SoupMessageHeaders *headers = webkit_uri_scheme_request_get_http_headers (request);
+    if (headers && soup_message_headers_get_one (headers, "Range"))
+        return FALSE;
+#endif /* WEBKIT_CHECK_VERSION */
+
+    return TRUE;
+}
+
+
+static void
+on_request_finished (WebKitURISchemeRequest *request,
+                     const CogRequestResult *result,
+                     void                   *user_data)
+{
+    CogCacheMiddleware *self = user_data;
+
+    if (self->enabled && !result->error && result->contents && result->status == SOUP_STATUS_OK) {
+        cog_cache_middleware_insert (self,
+                                     webkit_uri_scheme_request_get_uri (request),
+                                     result->contents,
+                                     result->mime_type);
+    }
+}
+
+
+static void
+cog_cache_middleware_run (CogRequestMiddleware   *middleware,
+                          WebKitURISchemeRequest *request,
+                          CogRequestHandler      *next)
+{
+    CogCacheMiddleware *self = COG_CACHE_MIDDLEWARE (middleware);
+
+    if (!self->enabled || !self->max_bytes || !request_is_cacheable (request))
+        return cog_request_handler_run (next, request);
+
+    CacheEntry *entry = cog_cache_middleware_lookup (self,
+                                                     webkit_uri_scheme_request_get_uri (request));
+    if (entry) {
+        g_debug ("%s: Hit '%s'", __func__, entry->uri);
+        g_autoptr(GBytes) contents = g_bytes_ref (entry->contents);
+        g_autofree char *mime_type = g_strdup (entry->mime_type);
+        cog_request_finish_bytes (request, contents, mime_type);
+        return;
+    }
+
+    cog_request_add_finished_callback (request,
+                                       on_request_finished,
+                                       g_object_ref (self),
+                                       g_object_unref);
+    cog_request_handler_run (next, request);
+}
+
+
+static void
+cog_cache_middleware_iface_init (CogRequestMiddlewareInterface *iface)
+{
+    iface->run = cog_cache_middleware_run;
+}
+
+
+G_DEFINE_TYPE_WITH_CODE (CogCacheMiddleware,
+                         cog_cache_middleware,
+                         G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (COG_TYPE_REQUEST_MIDDLEWARE,
+                                                cog_cache_middleware_iface_init))
+
+
+static void
+cog_cache_middleware_get_property (GObject    *object,
+                                   unsigned    prop_id,
+                                   GValue     *value,
+                                   GParamSpec *pspec)
+{
+    CogCacheMiddleware *self = COG_CACHE_MIDDLEWARE (object);
+    switch (prop_id) {
+        case PROP_ENABLED:
+            g_value_set_boolean (value, cog_cache_middleware_get_enabled (self));
+            break;
+        case PROP_MAX_BYTES:
+            g_value_set_uint64 (value, cog_cache_middleware_get_max_bytes (self));
+            break;
+        case PROP_MAX_AGE:
+            g_value_set_uint (value, cog_cache_middleware_get_max_age (self));
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+
+static void
+cog_cache_middleware_set_property (GObject      *object,
+                                   unsigned      prop_id,
+                                   const GValue *value,
+                                   GParamSpec   *pspec)
+{
+    CogCacheMiddleware *self = COG_CACHE_MIDDLEWARE (object);
+    switch (prop_id) {
+        case PROP_ENABLED:
+            cog_cache_middleware_set_enabled (self, g_value_get_boolean (value));
+            break;
+        case PROP_MAX_BYTES:
+            cog_cache_middleware_set_max_bytes (self, g_value_get_uint64 (value));
+            break;
+        case PROP_MAX_AGE:
+            cog_cache_middleware_set_max_age (self, g_value_get_uint (value));
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+
+static void
+cog_cache_middleware_finalize (GObject *object)
+{
+    CogCacheMiddleware *self = COG_CACHE_MIDDLEWARE (object);
+
+    g_queue_init (&self->lru);
+    g_clear_pointer (&self->entries, g_hash_table_unref);
+
+    G_OBJECT_CLASS (cog_cache_middleware_parent_class)->finalize (object);
+}
+
+
+static void
+cog_cache_middleware_class_init (CogCacheMiddlewareClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    object_class->get_property = cog_cache_middleware_get_property;
+    object_class->set_property = cog_cache_middleware_set_property;
+    object_class->finalize = cog_cache_middleware_finalize;
+
+    /**
+     * CogCacheMiddleware:enabled: (attributes org.gtk.Property.get=cog_cache_middleware_get_enabled org.gtk.Property.set=cog_cache_middleware_set_enabled):
+     *
+     * Whether responses are cached. When disabled, requests are passed
+     * to the next handler without any additional work. Stored responses
+     * are kept, and used again if the middleware is enabled later on.
+     */
+    s_properties[PROP_ENABLED] =
+        g_param_spec_boolean ("enabled",
+                              "Enabled",
+                              "Whether to cache responses",
+                              TRUE,
+                              G_PARAM_READWRITE |
+                              G_PARAM_CONSTRUCT |
+                              G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogCacheMiddleware:max-bytes: (attributes org.gtk.Property.get=cog_cache_middleware_get_max_bytes org.gtk.Property.set=cog_cache_middleware_set_max_bytes):
+     *
+     * Maximum amount of memory, in bytes, used to store responses.
+     */
+    s_properties[PROP_MAX_BYTES] =
+        g_param_spec_uint64 ("max-bytes",
+                             "Maximum cache size",
+                             "Maximum size in bytes of the cached responses",
+                             0, G_MAXUINT64, DEFAULT_MAX_BYTES,
+                             G_PARAM_READWRITE |
+                             G_PARAM_CONSTRUCT |
+                             G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogCacheMiddleware:max-age: (attributes org.gtk.Property.get=cog_cache_middleware_get_max_age org.gtk.Property.set=cog_cache_middleware_set_max_age):
+     *
+     * Time, in seconds, after which stored responses expire. A value of
+     * zero keeps responses until they are evicted.
+     */
+    s_properties[PROP_MAX_AGE] =
+        g_param_spec_uint ("max-age",
+                           "Maximum age",
+                           "Seconds after which cached responses expire",
+                           0, G_MAXUINT, 0,
+                           G_PARAM_READWRITE |
+                           G_PARAM_CONSTRUCT |
+                           G_PARAM_STATIC_STRINGS);
+
+    g_object_class_install_properties (object_class, N_PROPERTIES, s_properties);
+}
+
+
+static void
+cog_cache_middleware_init (CogCacheMiddleware *self)
+{
+    self->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, cache_entry_free);
+    g_queue_init (&self->lru);
+}
+
+
+/**
+ * cog_cache_middleware_new:
+ *
+ * Creates a new middleware which stores responses in memory.
+ *
+ * Returns: (transfer full): A new middleware.
+ */
+CogRequestMiddleware*
+cog_cache_middleware_new (void)
+{
+    return g_object_new (COG_TYPE_CACHE_MIDDLEWARE, NULL);
+}
+
+/**
+ * cog_cache_middleware_get_enabled:
+ * @self: a #CogCacheMiddleware
+ *
+ * Gets the value of the [property@Cog.CacheMiddleware:enabled] property.
+ *
+ * Returns: Whether responses are cached.
+ */
+gboolean
+cog_cache_middleware_get_enabled (CogCacheMiddleware *self)
+{
+    g_return_val_if_fail (COG_IS_CACHE_MIDDLEWARE (self), FALSE);
+    return self->enabled;
+}
+
+/**
+ * cog_cache_middleware_set_enabled:
+ * @self: a #CogCacheMiddleware
+ * @enabled: Whether to cache responses.
+ *
+ * Sets the value of the [property@Cog.CacheMiddleware:enabled] property.
+ */
+void
+cog_cache_middleware_set_enabled (CogCacheMiddleware *self,
+                                  gboolean            enabled)
+{
+    g_return_if_fail (COG_IS_CACHE_MIDDLEWARE (self));
+
+    enabled = !!enabled;
+    if (self->enabled == enabled)
+        return;
+
+    self->enabled = enabled;
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_ENABLED]);
+}
+
+/**
+ * cog_cache_middleware_get_max_bytes:
+ * @self: a #CogCacheMiddleware
+ *
+ * Gets the value of the [property@Cog.CacheMiddleware:max-bytes] property.
+ *
+ * Returns: Maximum size of the cached responses, in bytes.
+ */
+guint64
+cog_cache_middleware_get_max_bytes (CogCacheMiddleware *self)
+{
+    g_return_val_if_fail (COG_IS_CACHE_MIDDLEWARE (self), 0);
+    return self->max_bytes;
+}
+
+/**
+ * cog_cache_middleware_set_max_bytes:
+ * @self: a #CogCacheMiddleware
+ * @max_bytes: Maximum size of the cached responses, in bytes.
+ *
+ * Sets the value of the [property@Cog.CacheMiddleware:max-bytes] property.
+ * Stored responses are evicted as needed to honor the new limit.
+ */
+void
+cog_cache_middleware_set_max_bytes (CogCacheMiddleware *self,
+                                    guint64             max_bytes)
+{
+    g_return_if_fail (COG_IS_CACHE_MIDDLEWARE (self));
+
+    if (self->max_bytes == max_bytes)
+        return;
+
+    self->max_bytes = max_bytes;
+    cog_cache_middleware_trim (self, max_bytes);
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_MAX_BYTES]);
+}
+
+/**
+ * cog_cache_middleware_get_max_age:
+ * @self: a #CogCacheMiddleware
+ *
+ * Gets the value of the [property@Cog.CacheMiddleware:max-age] property.
+ *
+ * Returns: Time after which responses expire, in seconds.
+ */
+unsigned
+cog_cache_middleware_get_max_age (CogCacheMiddleware *self)
+{
+    g_return_val_if_fail (COG_IS_CACHE_MIDDLEWARE (self), 0);
+    return self->max_age;
+}
+
+/**
+ * cog_cache_middleware_set_max_age:
+ * @self: a #CogCacheMiddleware
+ * @seconds: Time after which responses expire, or zero.
+ *
+ * Sets the value of the [property@Cog.CacheMiddleware:max-age] property.
+ * The new value applies only to responses stored afterwards.
+ */
+void
+cog_cache_middleware_set_max_age (CogCacheMiddleware *self,
+                                  unsigned            seconds)
+{
+    g_return_if_fail (COG_IS_CACHE_MIDDLEWARE (self));
+
+    if (self->max_age == seconds)
+        return;
+
+    self->max_age = seconds;
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_MAX_AGE]);
+}
+
+/**
+ * cog_cache_middleware_clear:
+ * @self: a #CogCacheMiddleware
+ *
+ * Removes all the stored responses.
+ */
+void
+cog_cache_middleware_clear (CogCacheMiddleware *self)
+{
+    g_return_if_fail (COG_IS_CACHE_MIDDLEWARE (self));
+
+    cog_cache_middleware_trim (self, 0);
+}
@@ -0,0 +1,46 @@
+/*
+ * cog-cache-middleware.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#if !(defined(COG_INSIDE_COG__) && COG_INSIDE_COG__)
+# error "Do not include this header directly, use <cog.h> instead"
+#endif
+
+#include "cog-request-middleware.h"
+
+G_BEGIN_DECLS
+
+#define COG_TYPE_CACHE_MIDDLEWARE  (cog_cache_middleware_get_type ())
+
+G_DECLARE_FINAL_TYPE (CogCacheMiddleware,
+                      cog_cache_middleware,
+                      COG, CACHE_MIDDLEWARE,
+                      GObject)
+
+struct _CogCacheMiddlewareClass {
+    GObjectClass parent_class;
+};
+
+
+CogRequestMiddleware* cog_cache_middleware_new           (void);
+
+gboolean              cog_cache_middleware_get_enabled   (CogCacheMiddleware *self);
+void                  cog_cache_middleware_set_enabled   (CogCacheMiddleware *self,
+                                                          gboolean            enabled);
+
+guint64               cog_cache_middleware_get_max_bytes (CogCacheMiddleware *self);
+void                  cog_cache_middleware_set_max_bytes (CogCacheMiddleware *self,
+                                                          guint64             max_bytes);
+
+unsigned              cog_cache_middleware_get_max_age   (CogCacheMiddleware *self);
+void                  cog_cache_middleware_set_max_age   (CogCacheMiddleware *self,
+                                                          unsigned            seconds);
+
+void                  cog_cache_middleware_clear         (CogCacheMiddleware *self);
+
+G_END_DECLS
@@ -0,0 +1,17 @@
+/*
+ * cog-directory-files-handler-private.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#include "cog-directory-files-handler.h"
+
+G_BEGIN_DECLS
+
+G_GNUC_INTERNAL
+gboolean cog_directory_files_handler_preload_path_is_valid (const char *path);
+
+G_END_DECLS
@@ -5,8 +5,19 @@
  * Distributed under terms of the MIT license.
  */
 
-#include "cog-directory-files-handler.h"
+#include "cog-directory-files-handler-private.h"
+#include "cog-io-pool.h"
+#include "cog-mime-types.h"
+#if COG_USE_ZSTD
+# include "cog-zstd-decompressor.h"
+#endif
+#include <errno.h>
+#include <fcntl.h>
 #include <gio/gio.h>
+#include <gio/gunixinputstream.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 /**
  * CogDirectoryFilesHandler:
@@ -19,143 +30,933 @@
  * also uses the URI host component. If a resolved path points to a
  * local directory and it contains a file named `index.html`, it will
  * be used as the response.
+ *
+ * Optionally, the contents of small files can be kept in memory, see
+ * [property@Cog.DirectoryFilesHandler:cache-max-bytes]. Requests for
+ * cached files are answered right away, without any additional I/O
+ * other than checking that the file has not been modified.
+ *
+ * Setting [property@Cog.DirectoryFilesHandler:map-files] makes the
+ * handler map files into memory instead of reading them through a
+ * stream, which avoids intermediate copies for large files.
+ *
+ * The MIME types of files with extensions commonly used for Web content
+ * are obtained from a built-in table, which can be extended or overriden
+ * with [method@Cog.DirectoryFilesHandler.set_mime_type]. Other files have
+ * their types guessed using [func@Gio.content_type_guess].
+ *
+ * When [property@Cog.DirectoryFilesHandler:cache-metadata] is enabled,
+ * the results of resolving paths are remembered, including paths which
+ * do not exist. Directories are watched for changes to invalidate the
+ * stored results, unless [property@Cog.DirectoryFilesHandler:immutable]
+ * is set to indicate that the contents of the base path never change.
+ *
+ * When built against WPE WebKit 2.36 or newer, requests which include a
+ * `Range` header are answered with the requested part of the file, which
+ * allows seeking in media files without reading them from the start.
+ * Files are mapped into memory to produce partial responses.
+ *
+ * Setting [property@Cog.DirectoryFilesHandler:serve-compressed] allows
+ * storing files compressed: when a requested file does not exist but a
+ * compressed version with the `.gz` (or `.zst`, if support is enabled at
+ * build time) suffix does, its contents are decompressed while they are
+ * being sent.
+ *
+ * Concurrent requests for the same path are coalesced: while a file is
+ * being resolved, further requests for it wait for the result, and when
+ * its contents are read into memory they are shared by all of them.
+ *
+ * File system access is done in a pool of threads owned by Cog, where
+ * documents, scripts and style sheets are loaded before other resources.
  */
 
+typedef struct {
+    char    *key;       /* Path resolved from the request URI. */
+    char    *path;      /* Path of the file read, used to validate the entry. */
+    char    *mime_type;
+    GBytes  *contents;
+    guint64  size;
+    gint64   mtime;     /* Modification time, in microseconds. */
+    GList    link;      /* Position in the LRU list, data points to self. */
+} CacheEntry;
+
 struct _CogDirectoryFilesHandler {
     GObject  parent;
     GFile   *base_path;
+    int      base_fd;
     gboolean use_host;
     unsigned strip_components;
+    gboolean map_files;
+    gboolean serve_compressed;
+
+    guint64     cache_max_bytes;
+    guint64     cache_max_entry_size;
+    guint64     cache_size;
+    GHashTable *cache;      /* (string, CacheEntry) */
+    GQueue      cache_lru;  /* Most recently used entries first. */
+
+    GHashTable *mime_types; /* (string, string) */
+
+    gboolean    cache_metadata;
+    gboolean    immutable;
+    GHashTable *metadata;   /* (string, MetadataEntry) */
+    GHashTable *monitors;   /* (string, GFileMonitor) */
+
+    GHashTable *inflight;   /* (string, RequestData) */
 };
 
+/*
+ * Result of resolving a path. For paths which could not be found "error"
+ * is set, otherwise the rest of fields are used to skip looking up the
+ * "index.html" file for directories, and guessing the MIME type.
+ */
+typedef struct {
+    GError  *error;
+    gboolean is_index;
+    char    *mime_type;
+} MetadataEntry;
+
+/* Limit on the number of stored entries, the cache is emptied if reached. */
+#define METADATA_MAX_ENTRIES 4096
+
 enum {
     PROP_0,
     PROP_BASE_PATH,
     PROP_USE_HOST,
     PROP_STRIP_COMPONENTS,
+    PROP_CACHE_MAX_BYTES,
+    PROP_CACHE_MAX_ENTRY_SIZE,
+    PROP_MAP_FILES,
+    PROP_CACHE_METADATA,
+    PROP_IMMUTABLE,
+    PROP_SERVE_COMPRESSED,
     N_PROPERTIES,
 };
 
 static GParamSpec *s_properties[N_PROPERTIES] = { NULL, };
 
-static const char s_file_query_attributes[] =
-    G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
-    G_FILE_ATTRIBUTE_STANDARD_SIZE ","
-    G_FILE_ATTRIBUTE_STANDARD_TYPE;
 
-static void* s_request_resolving_index = (void*) 0xCAFECAFE;
+typedef enum {
+    COMPRESSION_NONE,
+    COMPRESSION_GZIP,
+    COMPRESSION_ZSTD,
+} Compression;
+
+/* Suffixes of compressed files, in order of preference. */
+static const struct {
+    const char *suffix;
+    Compression compression;
+} s_compressed_suffixes[] = {
+#if COG_USE_ZSTD
+    { ".zst", COMPRESSION_ZSTD },
+#endif
+    { ".gz",  COMPRESSION_GZIP },
+};
 
-G_DEFINE_QUARK (cog-directory-files-handler-data, cog_directory_files_handler);
+static GConverter*
+compression_create_decompressor (Compression compression)
+{
+    switch (compression) {
+        case COMPRESSION_GZIP:
+            return G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+#if COG_USE_ZSTD
+        case COMPRESSION_ZSTD:
+            return cog_zstd_decompressor_new ();
+#endif
+        default:
+            g_assert_not_reached ();
+    }
+}
+
+/*
+ * State kept around while a request is being resolved. The worker thread
+ * only uses the base directory descriptor, the relative path and the
+ * options copied from the handler; the rest of fields are results which
+ * are used back in the main thread.
+ *
+ * The "cache_key" is the path initially resolved from the URI, which may
+ * be different from the path of the file actually read (e.g. when it
+ * points to a directory containing an "index.html" file).
+ *
+ * Requests for the same "cache_key" made while another is in flight are
+ * queued in "waiters", which is only used from the main thread. The worker
+ * thread checks "has_waiters" to decide whether to read small files into
+ * memory, so their contents can be shared.
+ */
+typedef struct {
+    WebKitURISchemeRequest *request;
+    char                   *cache_key;
+    char                   *relative_path;
+    int                     base_fd;
+    gboolean                map_file;
+    gboolean                load_contents;
+    guint64                 load_max_size;
+    gboolean                has_range;
+    SoupRange               range;
+    gboolean                serve_compressed;
+    guint64                 coalesce_max_size;
+    GQueue                  waiters;
+    gint                    has_waiters;  /* (atomic) */
+
+    char                   *mime_type;
+    char                   *index_mime_type;
+    gboolean                from_metadata;
+    CogIOPriority           priority;
+
+    int                     fd;
+    struct stat             st;
+    gboolean                is_index;
+    Compression             compression;
+    GBytes                 *contents;
+} RequestData;
+
+
+static RequestData*
+request_data_new (CogDirectoryFilesHandler *handler,
+                  WebKitURISchemeRequest   *request,
+                  const char               *cache_key,
+                  const char               *relative_path)
+{
+    RequestData *data = g_slice_new0 (RequestData);
+    data->request = g_object_ref (request);
+    data->cache_key = g_strdup (cache_key);
+    data->relative_path = g_strdup (relative_path);
+    data->base_fd = handler->base_fd;
+    data->map_file = handler->map_files;
+    data->load_contents = handler->cache_max_bytes > 0;
+    data->load_max_size = MIN (handler->cache_max_bytes, handler->cache_max_entry_size);
+    data->serve_compressed = handler->serve_compressed;
+    data->coalesce_max_size = handler->cache_max_entry_size;
+    data->fd = -1;
+    return data;
+}
 
 
 static void
-on_file_read_async_completed (GObject      *source_object,
-                              GAsyncResult *result,
-                              void         *user_data)
+request_data_free (RequestData *data)
 {
-    g_autoptr(GFile) file = G_FILE (g_object_ref (source_object));
-    g_autoptr(WebKitURISchemeRequest) request = WEBKIT_URI_SCHEME_REQUEST (user_data);
+    if (data->fd != -1)
+        close (data->fd);
+
+    RequestData *waiter;
+    while ((waiter = g_queue_pop_head (&data->waiters)))
+        request_data_free (waiter);
+
+    g_clear_object (&data->request);
+    g_clear_pointer (&data->cache_key, g_free);
+    g_clear_pointer (&data->relative_path, g_free);
+    g_clear_pointer (&data->mime_type, g_free);
+    g_clear_pointer (&data->index_mime_type, g_free);
+    g_clear_pointer (&data->contents, g_bytes_unref);
+    g_slice_free (RequestData, data);
+}
 
-    g_autoptr(GError) error = NULL;
-    g_autoptr(GFileInputStream) file_stream =
-        g_file_read_finish (file, result, &error);
-
-    if (file_stream) {
-        g_autoptr(GInputStream) stream =
-            g_buffered_input_stream_new (G_INPUT_STREAM (file_stream));
-        g_autoptr(GFileInfo) info =
-            G_FILE_INFO (g_object_steal_qdata (source_object, cog_directory_files_handler_quark ()));
-        guint64 size =
-            g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
-        const char *mime_type =
-            g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE);
-       
-        g_debug("read file %s size:%ld type:%s",
-                g_file_get_path(file), (long)size, mime_type);
-
-        webkit_uri_scheme_request_finish (request, stream, size, mime_type);
+
+static void
+cache_entry_free (void *pointer)
+{
+    CacheEntry *entry = pointer;
+    g_clear_pointer (&entry->key, g_free);
+    g_clear_pointer (&entry->path, g_free);
+    g_clear_pointer (&entry->mime_type, g_free);
+    g_clear_pointer (&entry->contents, g_bytes_unref);
+    g_slice_free (CacheEntry, entry);
+}
+
+
+static void
+cache_remove (CogDirectoryFilesHandler *handler,
+              CacheEntry               *entry)
+{
+    g_queue_unlink (&handler->cache_lru, &entry->link);
+    handler->cache_size -= entry->size;
+    g_hash_table_remove (handler->cache, entry->key);
+}
+
+
+static void
+cache_trim (CogDirectoryFilesHandler *handler,
+            guint64                   max_bytes)
+{
+    while (handler->cache_size > max_bytes) {
+        CacheEntry *entry = g_queue_peek_tail (&handler->cache_lru);
+        g_assert (entry);
+        g_debug ("%s: Evicting '%s'", __func__, entry->path);
+        cache_remove (handler, entry);
+    }
+}
+
+
+static inline gboolean
+cache_accepts_size (CogDirectoryFilesHandler *handler,
+                    guint64                   size)
+{
+    return handler->cache_max_bytes > 0 &&
+        size <= handler->cache_max_bytes &&
+        size <= handler->cache_max_entry_size;
+}
+
+
+static inline gint64
+stat_get_mtime (const struct stat *st)
+{
+    return (gint64) st->st_mtim.tv_sec * G_USEC_PER_SEC + st->st_mtim.tv_nsec / 1000;
+}
+
+
+static CacheEntry*
+cache_lookup (CogDirectoryFilesHandler *handler,
+              const char               *key)
+{
+    if (!handler->cache)
+        return NULL;
+
+    CacheEntry *entry = g_hash_table_lookup (handler->cache, key);
+    if (!entry)
+        return NULL;
+
+    /*
+     * A single stat() call is enough to check whether the cached contents
+     * are still valid; it is much cheaper than going through the thread
+     * pool used to resolve requests.
+     */
+    struct stat st;
+    if (stat (entry->path, &st) != 0 || !S_ISREG (st.st_mode) ||
+        (guint64) st.st_size != entry->size ||
+        stat_get_mtime (&st) != entry->mtime)
+    {
+        g_debug ("%s: Stale entry '%s'", __func__, entry->path);
+        cache_remove (handler, entry);
+        return NULL;
+    }
+
+    /* Move to the front of the LRU list. */
+    g_queue_unlink (&handler->cache_lru, &entry->link);
+    g_queue_push_head_link (&handler->cache_lru, &entry->link);
+    return entry;
+}
+
+
+static void
+cache_insert (CogDirectoryFilesHandler *handler,
+              RequestData              *data)
+{
+    const guint64 size = g_bytes_get_size (data->contents);
+    if (!cache_accepts_size (handler, size))
+        return;
+
+    if (!handler->cache) {
+        handler->cache = g_hash_table_new_full (g_str_hash,
+                                                g_str_equal,
+                                                NULL,
+                                                cache_entry_free);
+    }
+
+    CacheEntry *entry = g_hash_table_lookup (handler->cache, data->cache_key);
+    if (entry)
+        cache_remove (handler, entry);
+
+    entry = g_slice_new0 (CacheEntry);
+    entry->key = g_strdup (data->cache_key);
+    entry->path = data->is_index
+        ? g_build_filename (data->cache_key, "index.html", NULL)
+        : g_strdup (data->cache_key);
+    entry->mime_type = g_strdup (data->mime_type);
+    entry->contents = g_bytes_ref (data->contents);
+    entry->size = size;
+    entry->mtime = stat_get_mtime (&data->st);
+    entry->link.data = entry;
+
+    g_hash_table_insert (handler->cache, entry->key, entry);
+    g_queue_push_head_link (&handler->cache_lru, &entry->link);
+    handler->cache_size += size;
+
+    cache_trim (handler, handler->cache_max_bytes);
+}
+
+
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+/*
+ * Obtain the byte range from the "Range" header of a request, if any. Only
+ * requests for a single range are handled, otherwise the complete contents
+ * are sent, which is allowed by RFC 7233.
+ */
+static gboolean
+request_get_range (WebKitURISchemeRequest *request,
+                   SoupRange              *range)
+{
+    SoupMessageHeaders *headers = webkit_uri_scheme_request_get_http_headers (request);
+    if (!headers)
+        return FALSE;
+
+    SoupRange *ranges = NULL;
+    int n_ranges = 0;
+    if (!soup_message_headers_get_ranges (headers, 0, &ranges, &n_ranges))
+        return FALSE;
+
+    gboolean single = (n_ranges == 1);
+    if (single)
+        *range = ranges[0];
+
+    soup_message_headers_free_ranges (headers, ranges);
+    return single;
+}
+
+
+/*
+ * Calculate the absolute positions of the first and last bytes of a range,
+ * which may have been specified as a suffix or without an end position.
+ */
+static gboolean
+range_resolve (const SoupRange *range,
+               goffset          total,
+               goffset         *start,
+               goffset         *end)
+{
+    if (range->start < 0) {
+        *start = MAX (0, total + range->start);
+        *end = total - 1;
     } else {
-        /*
-         * TODO: Generate a nicer error page.
-         */
-        g_assert (error);
-        webkit_uri_scheme_request_finish_error (request, error);
+        *start = range->start;
+        *end = (range->end < 0 || range->end >= total) ? total - 1 : range->end;
     }
+    return *start < total && *start <= *end;
 }
 
 
 static void
-on_file_query_info_async_completed (GObject      *source_object,
-                                    GAsyncResult *result,
-                                    void         *user_data)
+request_finish_range (WebKitURISchemeRequest *request,
+                      GBytes                 *contents,
+                      const char             *mime_type,
+                      const SoupRange        *range)
 {
-    g_autoptr(GFile) file = G_FILE (g_object_ref (source_object));
-    g_autoptr(WebKitURISchemeRequest) request = WEBKIT_URI_SCHEME_REQUEST (user_data);
+    g_autoptr(SoupMessageHeaders) headers =
+        soup_message_headers_new (SOUP_MESSAGE_HEADERS_RESPONSE);
+    soup_message_headers_replace (headers, "Accept-Ranges", "bytes");
+
+    const goffset total = g_bytes_get_size (contents);
+    g_autoptr(WebKitURISchemeResponse) response = NULL;
+    goffset start, end, length;
+    unsigned status;
+
+    if (range_resolve (range, total, &start, &end)) {
+        g_autoptr(GBytes) slice = g_bytes_new_from_bytes (contents, start, end - start + 1);
+        g_autoptr(GInputStream) stream = g_memory_input_stream_new_from_bytes (slice);
+        length = g_bytes_get_size (slice);
+        status = SOUP_STATUS_PARTIAL_CONTENT;
+        response = webkit_uri_scheme_response_new (stream, length);
+        soup_message_headers_set_content_range (headers, start, end, total);
+    } else {
+        g_autoptr(GInputStream) stream = g_memory_input_stream_new ();
+        length = 0;
+        status = SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE;
+        response = webkit_uri_scheme_response_new (stream, length);
+        g_autofree char *content_range = g_strdup_printf ("bytes */%" G_GOFFSET_FORMAT, total);
+        soup_message_headers_replace (headers, "Content-Range", content_range);
+    }
+
+    webkit_uri_scheme_response_set_status (response, status, NULL);
+    webkit_uri_scheme_response_set_content_type (response, mime_type);
+    webkit_uri_scheme_response_set_http_headers (response, g_steal_pointer (&headers));
+    cog_request_finish_with_response (request, response, status, length, mime_type);
+}
+#else
+static inline gboolean
+request_get_range (WebKitURISchemeRequest *request G_GNUC_UNUSED,
+                   SoupRange              *range G_GNUC_UNUSED)
+{
+    return FALSE;
+}
+#endif /* WEBKIT_CHECK_VERSION */
+
+
+static void
+request_finish_bytes (WebKitURISchemeRequest *request,
+                      GBytes                 *contents,
+                      const char             *mime_type,
+                      const SoupRange        *range)
+{
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+    if (range)
+        return request_finish_range (request, contents, mime_type, range);
+#else
+    g_assert (!range);
+#endif /* WEBKIT_CHECK_VERSION */
+
+    cog_request_finish_bytes (request, contents, mime_type);
+}
+
+
+static const char*
+lookup_mime_type (CogDirectoryFilesHandler *handler,
+                  const char               *extension)
+{
+    if (!extension)
+        return NULL;
+
+    if (handler->mime_types) {
+        char key[32];
+        if (strlen (extension) < sizeof (key)) {
+            for (unsigned i = 0; (key[i] = g_ascii_tolower (extension[i])); i++)
+                ;
+            const char *mime_type = g_hash_table_lookup (handler->mime_types, key);
+            if (mime_type)
+                return mime_type;
+        }
+    }
+
+    return cog_mime_type_for_extension (extension);
+}
+
+
+static gboolean
+open_at (int          dir_fd,
+         const char  *path,
+         int         *out_fd,
+         struct stat *st,
+         GError     **error)
+{
+    /*
+     * Use O_NONBLOCK to avoid getting stuck opening FIFOs. It does not
+     * have any effect on regular files, which are the only ones read.
+     */
+    int fd = openat (dir_fd, path, O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+    if (fd == -1 || fstat (fd, st) == -1) {
+        int saved_errno = errno;
+        if (fd != -1)
+            close (fd);
+        g_set_error (error,
+                     G_IO_ERROR,
+                     g_io_error_from_errno (saved_errno),
+                     "Cannot open '%s': %s",
+                     path,
+                     g_strerror (saved_errno));
+        return FALSE;
+    }
+
+    *out_fd = fd;
+    return TRUE;
+}
+
+
+/*
+ * Opens a file for a request. If the file does not exist and serving
+ * compressed files is enabled, tries opening a compressed version of it.
+ * The error from opening the uncompressed file is kept when none exist.
+ */
+static gboolean
+request_data_open_at (RequestData *data,
+                      int          dir_fd,
+                      const char  *path,
+                      GError     **error)
+{
+    if (open_at (dir_fd, path, &data->fd, &data->st, error))
+        return TRUE;
+
+    if (!data->serve_compressed || !g_error_matches (*error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+        return FALSE;
+
+    for (unsigned i = 0; i < G_N_ELEMENTS (s_compressed_suffixes); i++) {
+        g_autofree char *compressed_path = g_strconcat (path, s_compressed_suffixes[i].suffix, NULL);
+        if (!open_at (dir_fd, compressed_path, &data->fd, &data->st, NULL))
+            continue;
+
+        if (S_ISREG (data->st.st_mode)) {
+            data->compression = s_compressed_suffixes[i].compression;
+            g_clear_error (error);
+            return TRUE;
+        }
+
+        close (data->fd);
+        data->fd = -1;
+    }
+
+    return FALSE;
+}
+
+
+static char*
+guess_mime_type (int         fd,
+                 const char *name)
+{
+    /*
+     * Try first guessing from the file name alone, and only read
+     * the head of the file when that is not enough.
+     */
+    gboolean uncertain = FALSE;
+    g_autofree char *content_type = g_content_type_guess (name, NULL, 0, &uncertain);
+
+    if (uncertain) {
+        guchar buffer[4096];
+        ssize_t n_read = pread (fd, buffer, sizeof (buffer), 0);
+        if (n_read > 0) {
+            g_free (content_type);
+            content_type = g_content_type_guess (name, buffer, n_read, NULL);
+        }
+    }
+
+    char *mime_type = g_content_type_get_mime_type (content_type);
+    return mime_type ? mime_type : g_strdup ("application/octet-stream");
+}
+
+
+static GBytes*
+read_contents (int      fd,
+               gsize    size,
+               GError **error)
+{
+    g_autofree char *buffer = g_malloc (size);
+    gsize n_total = 0;
+
+    while (n_total < size) {
+        ssize_t n_read = pread (fd, buffer + n_total, size - n_total, n_total);
+        if (n_read == 0)
+            break;  /* File was truncated after fstat(). */
+        if (n_read == -1) {
+            if (errno == EINTR)
+                continue;
+            int saved_errno = errno;
+            g_set_error (error,
+                         G_IO_ERROR,
+                         g_io_error_from_errno (saved_errno),
+                         "Cannot read file: %s",
+                         g_strerror (saved_errno));
+            return NULL;
+        }
+        n_total += n_read;
+    }
+
+    return g_bytes_new_take (g_steal_pointer (&buffer), n_total);
+}
 
+
+/*
+ * Resolves a request in a single trip to a worker thread: the file is
+ * opened relative to the base directory descriptor, and its type and size
+ * are obtained from the same descriptor, which will be later used to read
+ * the contents. Directories are resolved to their "index.html" file.
+ */
+static void
+resolve_request_thread (GTask        *task,
+                        void         *source_object G_GNUC_UNUSED,
+                        void         *task_data,
+                        GCancellable *cancellable G_GNUC_UNUSED)
+{
+    RequestData *data = task_data;
     g_autoptr(GError) error = NULL;
-    g_autoptr(GFileInfo) info = g_file_query_info_finish (file, result, &error);
 
-    if (!info) {
-        g_assert (error);
-        webkit_uri_scheme_request_finish_error (request, error);
+    if (!request_data_open_at (data, data->base_fd, data->relative_path, &error))
+        return g_task_return_error (task, g_steal_pointer (&error));
+
+    if (S_ISDIR (data->st.st_mode)) {
+        int dir_fd = data->fd;
+        data->fd = -1;
+        data->is_index = TRUE;
+
+        gboolean opened = request_data_open_at (data, dir_fd, "index.html", &error);
+        close (dir_fd);
+
+        if (!opened)
+            return g_task_return_error (task, g_steal_pointer (&error));
+
+        g_free (data->mime_type);
+        data->mime_type = g_steal_pointer (&data->index_mime_type);
+    }
+
+    if (!S_ISREG (data->st.st_mode)) {
+        if (data->is_index) {
+            g_set_error (&error,
+                         cog_directory_files_handler_error_quark (),
+                         COG_DIRECTORY_FILES_HANDLER_ERROR_CANNOT_RESOLVE,
+                         "Path '%s/index.html' does not represent a regular file",
+                         data->cache_key);
+        } else {
+            g_set_error (&error,
+                         cog_directory_files_handler_error_quark (),
+                         COG_DIRECTORY_FILES_HANDLER_ERROR_CANNOT_RESOLVE,
+                         "Path '%s' does not represent a regular file or directory",
+                         data->cache_key);
+        }
+        return g_task_return_error (task, g_steal_pointer (&error));
+    }
+
+    /*
+     * Compressed files are always streamed, and their type can only be
+     * guessed from the name: sniffing would see the compressed data.
+     */
+    if (data->compression != COMPRESSION_NONE) {
+        if (!data->mime_type)
+            data->mime_type = guess_mime_type (-1, data->is_index ? "index.html" : data->relative_path);
+        g_task_return_boolean (task, TRUE);
+        return;
+    }
+
+    if (!data->mime_type)
+        data->mime_type = guess_mime_type (data->fd, data->is_index ? "index.html" : data->relative_path);
+
+    /*
+     * Partial responses are produced by slicing the contents, mapping the
+     * file makes that possible without reading the parts before the range.
+     */
+    if (data->map_file || data->has_range) {
+        g_autoptr(GMappedFile) mapped_file = g_mapped_file_new_from_fd (data->fd, FALSE, &error);
+        if (mapped_file) {
+            /*
+             * The returned GBytes keeps a reference to the mapping, which
+             * gets unmapped once the last reference to the bytes is dropped.
+             */
+            data->contents = g_mapped_file_get_bytes (mapped_file);
+        } else {
+            /*
+             * Fall back to reading the file through a stream. Range
+             * requests get the complete file, which is valid as well.
+             */
+            g_debug ("%s: Cannot map %s, reading instead: %s", __func__,
+                     data->cache_key, error->message);
+            g_clear_error (&error);
+        }
+    } else if ((data->load_contents && (guint64) data->st.st_size <= data->load_max_size) ||
+               (g_atomic_int_get (&data->has_waiters) &&
+                (guint64) data->st.st_size <= data->coalesce_max_size)) {
+        data->contents = read_contents (data->fd, data->st.st_size, &error);
+        if (!data->contents)
+            return g_task_return_error (task, g_steal_pointer (&error));
+    }
+
+    g_task_return_boolean (task, TRUE);
+}
+
+
+static void
+metadata_entry_free (void *pointer)
+{
+    MetadataEntry *entry = pointer;
+    g_clear_error (&entry->error);
+    g_clear_pointer (&entry->mime_type, g_free);
+    g_slice_free (MetadataEntry, entry);
+}
+
+
+static void
+on_directory_changed (GFileMonitor             *monitor G_GNUC_UNUSED,
+                      GFile                    *file,
+                      GFile                    *other_file G_GNUC_UNUSED,
+                      GFileMonitorEvent         event,
+                      CogDirectoryFilesHandler *handler)
+{
+    switch (event) {
+        case G_FILE_MONITOR_EVENT_CHANGED:
+        case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+            /* Contents changes do not affect resolved paths. */
+            break;
+        default:
+            g_debug ("%s: %s changed, clearing metadata cache", __func__,
+                     g_file_peek_path (file));
+            if (handler->metadata)
+                g_hash_table_remove_all (handler->metadata);
+    }
+}
+
+
+static void
+metadata_watch_directory (CogDirectoryFilesHandler *handler,
+                          const char               *path)
+{
+    if (handler->immutable)
+        return;
+
+    if (!handler->monitors) {
+        handler->monitors = g_hash_table_new_full (g_str_hash,
+                                                   g_str_equal,
+                                                   g_free,
+                                                   g_object_unref);
+    } else if (g_hash_table_contains (handler->monitors, path)) {
+        return;
+    }
+
+    /*
+     * Note that monitors can be created for directories which do not
+     * exist (yet), this is needed to notice when missing files appear.
+     */
+    g_autoptr(GFile) directory = g_file_new_for_path (path);
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GFileMonitor) monitor =
+        g_file_monitor_directory (directory, G_FILE_MONITOR_WATCH_MOVES, NULL, &error);
+    if (!monitor) {
+        g_warning ("Cannot watch directory '%s': %s", path, error->message);
         return;
     }
 
-    GFileType type =
-        g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_STANDARD_TYPE);
+    g_signal_connect_object (monitor, "changed", G_CALLBACK (on_directory_changed), handler, 0);
+    g_hash_table_insert (handler->monitors, g_strdup (path), g_steal_pointer (&monitor));
+}
+
+
+static void
+metadata_insert (CogDirectoryFilesHandler *handler,
+                 RequestData              *data,
+                 const GError             *error)
+{
+    if (!handler->metadata) {
+        handler->metadata = g_hash_table_new_full (g_str_hash,
+                                                   g_str_equal,
+                                                   g_free,
+                                                   metadata_entry_free);
+    } else if (g_hash_table_size (handler->metadata) >= METADATA_MAX_ENTRIES) {
+        g_hash_table_remove_all (handler->metadata);
+    }
+
+    MetadataEntry *entry = g_slice_new0 (MetadataEntry);
+    entry->is_index = data->is_index;
+    if (error)
+        entry->error = g_error_copy (error);
+    else
+        entry->mime_type = g_strdup (data->mime_type);
+
+    g_hash_table_replace (handler->metadata, g_strdup (data->cache_key), entry);
+
+    /*
+     * Watch the directory which contains the file actually opened, or
+     * the one which would contain it in the case of missing files.
+     */
+    if (data->is_index) {
+        metadata_watch_directory (handler, data->cache_key);
+    } else {
+        g_autofree char *dirname = g_path_get_dirname (data->cache_key);
+        metadata_watch_directory (handler, dirname);
+    }
+}
+
+
+static void on_resolve_request_completed (GObject      *source_object,
+                                          GAsyncResult *result,
+                                          void         *user_data);
+
+
+static void
+request_data_dispatch (CogDirectoryFilesHandler *handler,
+                       RequestData              *data)
+{
+    g_autoptr(GTask) task = g_task_new (handler, NULL, on_resolve_request_completed, NULL);
+    g_task_set_source_tag (task, request_data_dispatch);
+    g_task_set_task_data (task, data, (GDestroyNotify) request_data_free);
+    cog_io_pool_run_in_thread (task, resolve_request_thread, data->priority);
+}
+
+
+/*
+ * Completes the requests which waited for another to be resolved. Errors
+ * and contents loaded in memory are shared, but streams cannot be shared
+ * and in that case the waiting requests are resolved on their own.
+ */
+static void
+request_data_complete_waiters (CogDirectoryFilesHandler *handler,
+                               RequestData              *data,
+                               GError                   *error)
+{
+    RequestData *waiter;
+    while ((waiter = g_queue_pop_head (&data->waiters))) {
+        if (error) {
+            cog_request_finish_error (waiter->request, error);
+        } else if (data->contents) {
+            request_finish_bytes (waiter->request,
+                                  data->contents,
+                                  data->mime_type,
+                                  waiter->has_range ? &waiter->range : NULL);
+        } else {
+            request_data_dispatch (handler, waiter);
+            continue;
+        }
+        request_data_free (waiter);
+    }
+}
+
+
+static void
+on_resolve_request_completed (GObject      *source_object,
+                              GAsyncResult *result,
+                              void         *user_data G_GNUC_UNUSED)
+{
+    CogDirectoryFilesHandler *handler = COG_DIRECTORY_FILES_HANDLER (source_object);
+    RequestData *data = g_task_get_task_data (G_TASK (result));
+
+    /* Further requests for the same path cannot wait for this one now. */
+    if (g_hash_table_lookup (handler->inflight, data->cache_key) == data)
+        g_hash_table_remove (handler->inflight, data->cache_key);
+
+    if (!g_queue_is_empty (&data->waiters)) {
+        g_debug ("%s: Coalesced %u requests for %s", __func__,
+                 g_queue_get_length (&data->waiters), data->cache_key);
+    }
+
+    g_autoptr(GError) error = NULL;
+    if (!g_task_propagate_boolean (G_TASK (result), &error)) {
+        g_assert (error);
 
-    if (type == G_FILE_TYPE_REGULAR) {
         /*
-         * The current file information will be retrieved by 
-         * on_file_read_async_completed() to avoid querying again.
+         * Only remember missing files, other errors (e.g. permissions)
+         * may be transient and are not worth watching for.
          */
-        g_object_set_qdata_full (source_object,
-                                 cog_directory_files_handler_quark (),
-                                 g_steal_pointer (&info),
-                                 g_object_unref);
-        g_file_read_async (file,
-                           G_PRIORITY_DEFAULT,
-                           NULL,
-                           on_file_read_async_completed,
-                           g_steal_pointer (&request));
-    } else if (type == G_FILE_TYPE_DIRECTORY) {
+        if (handler->cache_metadata) {
+            if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) ||
+                g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_DIRECTORY))
+                metadata_insert (handler, data, error);
+            else if (handler->metadata)
+                g_hash_table_remove (handler->metadata, data->cache_key);
+        }
+
         /*
-         * If the requst has been marked, it means this function is being
-         * called after having previously found a directory. In that case,
-         * do not try to resolve "index.html" a second time and produce
-         * an error instead.
+         * TODO: Generate a nicer error page.
          */
-        if (s_request_resolving_index == g_object_get_qdata (G_OBJECT (request),
-                                                             cog_directory_files_handler_quark ()))
-        {
-            g_autofree char *path = g_file_get_path (file);
-            error = g_error_new (cog_directory_files_handler_error_quark (),
-                                 COG_DIRECTORY_FILES_HANDLER_ERROR_CANNOT_RESOLVE,
-                                 "Path '%s' does not represent a regular file",
-                                 path);
-            webkit_uri_scheme_request_finish_error (request, error);
-        } else {
-            /* Mark request as being resolved for its index. */
-            g_object_set_qdata (G_OBJECT (request),
-                                cog_directory_files_handler_quark (),
-                                s_request_resolving_index);
-            g_autoptr(GFile) index = g_file_get_child (file, "index.html");
-            g_file_query_info_async (index,
-                                     s_file_query_attributes,
-                                     G_FILE_QUERY_INFO_NONE,
-                                     G_PRIORITY_DEFAULT,
-                                     NULL,
-                                     on_file_query_info_async_completed,
-                                     g_steal_pointer (&request));
-        }
+        cog_request_finish_error (data->request, error);
+        request_data_complete_waiters (handler, data, error);
+        return;
+    }
+
+    if (handler->cache_metadata && !data->from_metadata)
+        metadata_insert (handler, data, NULL);
+
+    if (data->compression != COMPRESSION_NONE) {
+        /*
+         * The converter stream cannot be polled because the file
+         * descriptor refers to a regular file, which makes GIO run
+         * reads (and therefore decompression) in worker threads.
+         * The length of the decompressed data is not known.
+         */
+        g_autoptr(GInputStream) base_stream = g_unix_input_stream_new (data->fd, TRUE);
+        data->fd = -1;  /* Now owned by the stream. */
+
+        g_autoptr(GConverter) decompressor = compression_create_decompressor (data->compression);
+        g_autoptr(GInputStream) stream = g_converter_input_stream_new (base_stream, decompressor);
+
+        g_debug ("%s: Decompressing %s%s size:%" G_GUINT64_FORMAT " type:%s", __func__,
+                 data->cache_key, data->is_index ? "/index.html" : "",
+                 (guint64) data->st.st_size, data->mime_type);
+
+        cog_request_finish (data->request, stream, -1, data->mime_type);
+    } else if (data->contents) {
+        cache_insert (handler, data);
+
+        g_debug ("%s: Loaded %s%s size:%zu type:%s", __func__,
+                 data->cache_key, data->is_index ? "/index.html" : "",
+                 g_bytes_get_size (data->contents), data->mime_type);
+
+        request_finish_bytes (data->request,
+                              data->contents,
+                              data->mime_type,
+                              data->has_range ? &data->range : NULL);
     } else {
-        g_autofree char *path = g_file_get_path (file);
-        error = g_error_new (cog_directory_files_handler_error_quark (),
-                             COG_DIRECTORY_FILES_HANDLER_ERROR_CANNOT_RESOLVE,
-                             "Path '%s' does not represent a regular file or directory",
-                             path);
-        webkit_uri_scheme_request_finish_error (request, error);
+        g_autoptr(GInputStream) stream = g_unix_input_stream_new (data->fd, TRUE);
+        data->fd = -1;  /* Now owned by the stream. */
+
+        g_debug ("%s: Read %s%s size:%" G_GUINT64_FORMAT " type:%s", __func__,
+                 data->cache_key, data->is_index ? "/index.html" : "",
+                 (guint64) data->st.st_size, data->mime_type);
+
+        cog_request_finish (data->request, stream, data->st.st_size, data->mime_type);
     }
+
+    request_data_complete_waiters (handler, data, NULL);
 }
 
 
@@ -189,7 +990,7 @@ cog_directory_files_handler_run (CogRequestHandler      *request_handler,
                                                    G_FILE_ERROR_INVAL,
                                                    "No host in URI: %s",
                                                    uri_string);
-            webkit_uri_scheme_request_finish_error (request, error);
+            cog_request_finish_error (request, error);
             return;
         }
         base_path = g_file_get_child (handler->base_path, host);
@@ -243,17 +1044,86 @@ cog_directory_files_handler_run (CogRequestHandler      *request_handler,
                                                    "contained in base path '%s'",
                                                    g_file_peek_path (file),
                                                    g_file_peek_path (base_path));
-            return webkit_uri_scheme_request_finish_error (request, error);
+            return cog_request_finish_error (request, error);
         }
     }
 
-    g_file_query_info_async (file,
-                             s_file_query_attributes,
-                             G_FILE_QUERY_INFO_NONE,
-                             G_PRIORITY_DEFAULT,
-                             NULL,
-                             on_file_query_info_async_completed,
-                             g_object_ref (request));
+    SoupRange range;
+    const gboolean has_range = request_get_range (request, &range);
+
+    CacheEntry *entry = cache_lookup (handler, g_file_peek_path (file));
+    if (entry) {
+        g_debug ("%s: Cache hit for %s", __func__, entry->path);
+        request_finish_bytes (request,
+                              entry->contents,
+                              entry->mime_type,
+                              has_range ? &range : NULL);
+        return;
+    }
+
+    /*
+     * The worker thread opens files relative to the descriptor of the
+     * base directory. Note that the relative path is NULL when the file
+     * is the same as the base directory.
+     */
+    g_autofree char *relative_path = g_file_get_relative_path (handler->base_path, file);
+
+    RequestData *data = request_data_new (handler,
+                                          request,
+                                          g_file_peek_path (file),
+                                          relative_path ? relative_path : ".");
+    data->has_range = has_range;
+    if (has_range)
+        data->range = range;
+
+    MetadataEntry *metadata = handler->metadata
+        ? g_hash_table_lookup (handler->metadata, data->cache_key)
+        : NULL;
+
+    if (metadata && metadata->error) {
+        g_debug ("%s: Cached error for %s", __func__, data->cache_key);
+        cog_request_finish_error (request, metadata->error);
+        request_data_free (data);
+        return;
+    }
+
+    if (metadata) {
+        /* Path already known, skip resolving the index and guessing. */
+        if (metadata->is_index) {
+            char *index_path = g_build_filename (data->relative_path, "index.html", NULL);
+            g_free (data->relative_path);
+            data->relative_path = index_path;
+            data->is_index = TRUE;
+        }
+        data->mime_type = g_strdup (metadata->mime_type);
+        data->from_metadata = TRUE;
+    } else {
+        /*
+         * Look up MIME types here, the worker thread will only need to guess
+         * them when the file extension is not known. The path may turn out to
+         * be a directory, so the type for "index.html" is looked up as well.
+         */
+        data->mime_type = g_strdup (lookup_mime_type (handler, cog_path_get_extension (path)));
+        data->index_mime_type = g_strdup (lookup_mime_type (handler, "html"));
+    }
+
+    /*
+     * Paths without a known type are likely directories, which means
+     * they would be served using their "index.html" documents.
+     */
+    data->priority = cog_io_priority_for_request (request,
+                                                  data->mime_type ? data->mime_type : data->index_mime_type);
+
+    RequestData *inflight = g_hash_table_lookup (handler->inflight, data->cache_key);
+    if (inflight) {
+        g_queue_push_tail (&inflight->waiters, data);
+        g_atomic_int_set (&inflight->has_waiters, TRUE);
+        return;
+    }
+
+    /* The key is owned by the request data, removed when completed. */
+    g_hash_table_insert (handler->inflight, data->cache_key, data);
+    request_data_dispatch (handler, data);
 }
 
 
@@ -288,6 +1158,24 @@ cog_directory_files_handler_get_property (GObject    *object,
         case PROP_STRIP_COMPONENTS:
             g_value_set_uint (value, cog_directory_files_handler_get_strip_components (handler));
             break;
+        case PROP_CACHE_MAX_BYTES:
+            g_value_set_uint64 (value, cog_directory_files_handler_get_cache_max_bytes (handler));
+            break;
+        case PROP_CACHE_MAX_ENTRY_SIZE:
+            g_value_set_uint64 (value, cog_directory_files_handler_get_cache_max_entry_size (handler));
+            break;
+        case PROP_MAP_FILES:
+            g_value_set_boolean (value, cog_directory_files_handler_get_map_files (handler));
+            break;
+        case PROP_CACHE_METADATA:
+            g_value_set_boolean (value, cog_directory_files_handler_get_cache_metadata (handler));
+            break;
+        case PROP_IMMUTABLE:
+            g_value_set_boolean (value, cog_directory_files_handler_get_immutable (handler));
+            break;
+        case PROP_SERVE_COMPRESSED:
+            g_value_set_boolean (value, cog_directory_files_handler_get_serve_compressed (handler));
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -314,6 +1202,30 @@ cog_directory_files_handler_set_property (GObject      *object,
             cog_directory_files_handler_set_strip_components (handler,
                                                               g_value_get_uint (value));
             break;
+        case PROP_CACHE_MAX_BYTES:
+            cog_directory_files_handler_set_cache_max_bytes (handler,
+                                                             g_value_get_uint64 (value));
+            break;
+        case PROP_CACHE_MAX_ENTRY_SIZE:
+            cog_directory_files_handler_set_cache_max_entry_size (handler,
+                                                                  g_value_get_uint64 (value));
+            break;
+        case PROP_MAP_FILES:
+            cog_directory_files_handler_set_map_files (handler,
+                                                       g_value_get_boolean (value));
+            break;
+        case PROP_CACHE_METADATA:
+            cog_directory_files_handler_set_cache_metadata (handler,
+                                                            g_value_get_boolean (value));
+            break;
+        case PROP_IMMUTABLE:
+            cog_directory_files_handler_set_immutable (handler,
+                                                       g_value_get_boolean (value));
+            break;
+        case PROP_SERVE_COMPRESSED:
+            cog_directory_files_handler_set_serve_compressed (handler,
+                                                              g_value_get_boolean (value));
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -328,6 +1240,14 @@ cog_directory_files_handler_constructed (GObject *object)
     CogDirectoryFilesHandler *handler = COG_DIRECTORY_FILES_HANDLER (object);
 
     g_return_if_fail (cog_directory_files_handler_is_suitable_path (handler->base_path, NULL));
+
+    handler->base_fd = open (g_file_peek_path (handler->base_path),
+                             O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (handler->base_fd == -1) {
+        g_warning ("Cannot open base path '%s': %s",
+                   g_file_peek_path (handler->base_path),
+                   g_strerror (errno));
+    }
 }
 
 
@@ -338,10 +1258,35 @@ cog_directory_files_handler_dispose (GObject *object)
 
     g_clear_object (&handler->base_path);
 
+    g_queue_init (&handler->cache_lru);
+    handler->cache_size = 0;
+    g_clear_pointer (&handler->cache, g_hash_table_unref);
+
+    g_clear_pointer (&handler->mime_types, g_hash_table_unref);
+
+    g_clear_pointer (&handler->metadata, g_hash_table_unref);
+    g_clear_pointer (&handler->monitors, g_hash_table_unref);
+
+    g_clear_pointer (&handler->inflight, g_hash_table_unref);
+
     G_OBJECT_CLASS (cog_directory_files_handler_parent_class)->dispose (object);
 }
 
 
+static void
+cog_directory_files_handler_finalize (GObject *object)
+{
+    CogDirectoryFilesHandler *handler = COG_DIRECTORY_FILES_HANDLER (object);
+
+    if (handler->base_fd != -1) {
+        close (handler->base_fd);
+        handler->base_fd = -1;
+    }
+
+    G_OBJECT_CLASS (cog_directory_files_handler_parent_class)->finalize (object);
+}
+
+
 static void
 cog_directory_files_handler_class_init (CogDirectoryFilesHandlerClass *klass)
 {
@@ -350,6 +1295,7 @@ cog_directory_files_handler_class_init (CogDirectoryFilesHandlerClass *klass)
     object_class->set_property = cog_directory_files_handler_set_property;
     object_class->constructed = cog_directory_files_handler_constructed;
     object_class->dispose = cog_directory_files_handler_dispose;
+    object_class->finalize = cog_directory_files_handler_finalize;
 
     /**
      * CogDirectoryFilesHandler:base-path:
@@ -377,31 +1323,148 @@ cog_directory_files_handler_class_init (CogDirectoryFilesHandlerClass *klass)
      * - When disabled, a subdirectory named `some/path` will be
      *   searched for inside the `base-path`.
      */
-    s_properties[PROP_USE_HOST] =
-        g_param_spec_boolean ("use-host",
-                              "Use URI host",
-                              "Use the host from the URI authority part as top-level subdirectory",
+    s_properties[PROP_USE_HOST] =
+        g_param_spec_boolean ("use-host",
+                              "Use URI host",
+                              "Use the host from the URI authority part as top-level subdirectory",
+                              FALSE,
+                              G_PARAM_READWRITE |
+                              G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogDirectoryFilesHandler:strip-components: (attributes org.gtk.Property.get=cog_directory_files_handler_get_strip_components org.gtk.Property.set=cog_directory_files_handler_set_strip_components):
+     *
+     * Number of leading path components to strip (ignore) at the beginning
+     * of request URIs.
+     *
+     * For example, when set to `2`, a  request for an URI with path
+     * `/a/b/c/d.html` will ignore the `/a/b` prefix and search for `c/d.html`.
+     */
+    s_properties[PROP_STRIP_COMPONENTS] =
+        g_param_spec_uint ("strip-components",
+                           "Strip path components",
+                           "Number of leading URI path components to ignore",
+                           0, G_MAXUINT, 0,
+                           G_PARAM_READWRITE |
+                           G_PARAM_CONSTRUCT |
+                           G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogDirectoryFilesHandler:cache-max-bytes: (attributes org.gtk.Property.get=cog_directory_files_handler_get_cache_max_bytes org.gtk.Property.set=cog_directory_files_handler_set_cache_max_bytes):
+     *
+     * Maximum amount of memory, in bytes, used to keep the contents of
+     * served files in memory. When the limit is reached, the least
+     * recently used files are discarded first.
+     *
+     * Cached contents are validated using the size and modification time
+     * of files before being used. The default value of zero disables the
+     * cache.
+     */
+    s_properties[PROP_CACHE_MAX_BYTES] =
+        g_param_spec_uint64 ("cache-max-bytes",
+                             "Maximum cache size",
+                             "Maximum amount of memory used to cache file contents",
+                             0, G_MAXUINT64, 0,
+                             G_PARAM_READWRITE |
+                             G_PARAM_CONSTRUCT |
+                             G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogDirectoryFilesHandler:cache-max-entry-size: (attributes org.gtk.Property.get=cog_directory_files_handler_get_cache_max_entry_size org.gtk.Property.set=cog_directory_files_handler_set_cache_max_entry_size):
+     *
+     * Maximum size, in bytes, of files whose contents may be kept in
+     * the cache. Larger files are always read from disk.
+     */
+    s_properties[PROP_CACHE_MAX_ENTRY_SIZE] =
+        g_param_spec_uint64 ("cache-max-entry-size",
+                             "Maximum cache entry size",
+                             "Maximum size of files which may be cached",
+                             0, G_MAXUINT64, 256 * 1024,
+                             G_PARAM_READWRITE |
+                             G_PARAM_CONSTRUCT |
+                             G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogDirectoryFilesHandler:map-files: (attributes org.gtk.Property.get=cog_directory_files_handler_get_map_files org.gtk.Property.set=cog_directory_files_handler_set_map_files):
+     *
+     * Whether to map files into memory to serve their contents.
+     *
+     * When enabled, regular files are mapped with [struct@GLib.MappedFile]
+     * and their contents handed to WebKit without intermediate copies,
+     * sharing pages with the system page cache. Files which cannot be
+     * mapped are read using a stream.
+     *
+     * Note that files must not be truncated while mapped, which would
+     * make the process crash when accessing their contents.
+     */
+    s_properties[PROP_MAP_FILES] =
+        g_param_spec_boolean ("map-files",
+                              "Map files",
+                              "Map files into memory instead of reading them",
+                              FALSE,
+                              G_PARAM_READWRITE |
+                              G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogDirectoryFilesHandler:cache-metadata: (attributes org.gtk.Property.get=cog_directory_files_handler_get_cache_metadata org.gtk.Property.set=cog_directory_files_handler_set_cache_metadata):
+     *
+     * Whether to remember the results of resolving paths.
+     *
+     * When enabled, the handler remembers whether paths point to existing
+     * files, which `index.html` file to use for directories, and the MIME
+     * type of files. Requests for missing files are answered without
+     * accessing the file system at all.
+     *
+     * Directories are watched for changes, which invalidate the stored
+     * results; see [property@Cog.DirectoryFilesHandler:immutable].
+     */
+    s_properties[PROP_CACHE_METADATA] =
+        g_param_spec_boolean ("cache-metadata",
+                              "Cache metadata",
+                              "Remember results of resolving paths, including missing files",
+                              FALSE,
+                              G_PARAM_READWRITE |
+                              G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogDirectoryFilesHandler:immutable: (attributes org.gtk.Property.get=cog_directory_files_handler_get_immutable org.gtk.Property.set=cog_directory_files_handler_set_immutable):
+     *
+     * Whether the contents of the base path never change.
+     *
+     * When enabled, directories are not watched for changes and the results
+     * remembered when [property@Cog.DirectoryFilesHandler:cache-metadata]
+     * is enabled are never invalidated. This is suitable e.g. for read-only
+     * file systems.
+     */
+    s_properties[PROP_IMMUTABLE] =
+        g_param_spec_boolean ("immutable",
+                              "Immutable",
+                              "Whether the contents of the base path never change",
                               FALSE,
                               G_PARAM_READWRITE |
                               G_PARAM_STATIC_STRINGS);
 
     /**
-     * CogDirectoryFilesHandler:strip-components: (attributes org.gtk.Property.get=cog_directory_files_handler_get_strip_components org.gtk.Property.set=cog_directory_files_handler_set_strip_components):
+     * CogDirectoryFilesHandler:serve-compressed: (attributes org.gtk.Property.get=cog_directory_files_handler_get_serve_compressed org.gtk.Property.set=cog_directory_files_handler_set_serve_compressed):
      *
-     * Number of leading path components to strip (ignore) at the beginning
-     * of request URIs.
+     * Whether to serve compressed versions of files which do not exist.
      *
-     * For example, when set to `2`, a  request for an URI with path
-     * `/a/b/c/d.html` will ignore the `/a/b` prefix and search for `c/d.html`.
+     * When enabled, a request for `script.js` can be answered using the
+     * contents of `script.js.gz`, which are decompressed on the fly. Files
+     * compressed with Zstandard (`script.js.zst`) are supported as well if
+     * enabled at build time.
+     *
+     * Uncompressed files are always preferred when they exist. Compressed
+     * files are not kept in the content cache, and do not support range
+     * requests.
      */
-    s_properties[PROP_STRIP_COMPONENTS] =
-        g_param_spec_uint ("strip-components",
-                           "Strip path components",
-                           "Number of leading URI path components to ignore",
-                           0, G_MAXUINT, 0,
-                           G_PARAM_READWRITE |
-                           G_PARAM_CONSTRUCT |
-                           G_PARAM_STATIC_STRINGS);
+    s_properties[PROP_SERVE_COMPRESSED] =
+        g_param_spec_boolean ("serve-compressed",
+                              "Serve compressed",
+                              "Serve compressed versions of files which do not exist",
+                              FALSE,
+                              G_PARAM_READWRITE |
+                              G_PARAM_STATIC_STRINGS);
 
     g_object_class_install_properties (object_class, N_PROPERTIES, s_properties);
 }
@@ -410,6 +1473,14 @@ cog_directory_files_handler_class_init (CogDirectoryFilesHandlerClass *klass)
 static void
 cog_directory_files_handler_init (CogDirectoryFilesHandler *handler)
 {
+    handler->base_fd = -1;
+    g_queue_init (&handler->cache_lru);
+
+    /*
+     * In-flight requests keep a reference to the handler, so this table
+     * is always empty when the handler gets disposed.
+     */
+    handler->inflight = g_hash_table_new (g_str_hash, g_str_equal);
 }
 
 
@@ -534,3 +1605,487 @@ cog_directory_files_handler_set_strip_components (CogDirectoryFilesHandler *self
     self->strip_components = count;
     g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_STRIP_COMPONENTS]);
 }
+
+/**
+ * cog_directory_files_handler_get_cache_max_bytes:
+ * @self: a #CogDirectoryFilesHandler
+ *
+ * Gets the value of the [property@Cog.DirectoryFilesHandler:cache-max-bytes]
+ * property.
+ *
+ * Returns: Maximum amount of memory used to cache file contents.
+ */
+guint64
+cog_directory_files_handler_get_cache_max_bytes (CogDirectoryFilesHandler *self)
+{
+    g_return_val_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self), 0);
+    return self->cache_max_bytes;
+}
+
+/**
+ * cog_directory_files_handler_set_cache_max_bytes:
+ * @self: a #CogDirectoryFilesHandler
+ * @max_bytes: Maximum amount of memory used to cache file contents.
+ *
+ * Sets the value of the [property@Cog.DirectoryFilesHandler:cache-max-bytes]
+ * property. Cached contents are discarded as needed to honor the new limit.
+ */
+void
+cog_directory_files_handler_set_cache_max_bytes (CogDirectoryFilesHandler *self,
+                                                 guint64                   max_bytes)
+{
+    g_return_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self));
+
+    if (self->cache_max_bytes == max_bytes)
+        return;
+
+    self->cache_max_bytes = max_bytes;
+    cache_trim (self, max_bytes);
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_CACHE_MAX_BYTES]);
+}
+
+/**
+ * cog_directory_files_handler_get_cache_max_entry_size:
+ * @self: a #CogDirectoryFilesHandler
+ *
+ * Gets the value of the [property@Cog.DirectoryFilesHandler:cache-max-entry-size]
+ * property.
+ *
+ * Returns: Maximum size of files which may be cached.
+ */
+guint64
+cog_directory_files_handler_get_cache_max_entry_size (CogDirectoryFilesHandler *self)
+{
+    g_return_val_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self), 0);
+    return self->cache_max_entry_size;
+}
+
+/**
+ * cog_directory_files_handler_set_cache_max_entry_size:
+ * @self: a #CogDirectoryFilesHandler
+ * @max_size: Maximum size of files which may be cached.
+ *
+ * Sets the value of the [property@Cog.DirectoryFilesHandler:cache-max-entry-size]
+ * property. Entries already in the cache are not affected.
+ */
+void
+cog_directory_files_handler_set_cache_max_entry_size (CogDirectoryFilesHandler *self,
+                                                      guint64                   max_size)
+{
+    g_return_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self));
+
+    if (self->cache_max_entry_size == max_size)
+        return;
+
+    self->cache_max_entry_size = max_size;
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_CACHE_MAX_ENTRY_SIZE]);
+}
+
+/**
+ * cog_directory_files_handler_get_map_files:
+ * @self: a #CogDirectoryFilesHandler
+ *
+ * Gets the value of the [property@Cog.DirectoryFilesHandler:map-files]
+ * property.
+ *
+ * Returns: Whether files are mapped into memory.
+ */
+gboolean
+cog_directory_files_handler_get_map_files (CogDirectoryFilesHandler *self)
+{
+    g_return_val_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self), FALSE);
+    return self->map_files;
+}
+
+/**
+ * cog_directory_files_handler_set_map_files:
+ * @self: a #CogDirectoryFilesHandler
+ * @map_files: Whether to map files into memory.
+ *
+ * Sets the value of the [property@Cog.DirectoryFilesHandler:map-files]
+ * property.
+ */
+void
+cog_directory_files_handler_set_map_files (CogDirectoryFilesHandler *self,
+                                           gboolean                  map_files)
+{
+    g_return_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self));
+
+    map_files = map_files ? TRUE : FALSE;
+    if (self->map_files == map_files)
+        return;
+
+    self->map_files = map_files;
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_MAP_FILES]);
+}
+
+/**
+ * cog_directory_files_handler_set_mime_type:
+ * @self: a #CogDirectoryFilesHandler
+ * @extension: File name extension, without the leading dot.
+ * @mime_type: (nullable): MIME type for files with the extension.
+ *
+ * Configures the MIME type used for files with a given @extension,
+ * overriding the built-in table. Passing %NULL as @mime_type removes
+ * a previously configured override.
+ *
+ * Extensions are matched case-insensitively.
+ */
+void
+cog_directory_files_handler_set_mime_type (CogDirectoryFilesHandler *self,
+                                           const char               *extension,
+                                           const char               *mime_type)
+{
+    g_return_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self));
+    g_return_if_fail (extension != NULL && extension[0] != '\0');
+
+    if (!self->mime_types) {
+        if (!mime_type)
+            return;
+        self->mime_types = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    }
+
+    if (mime_type)
+        g_hash_table_insert (self->mime_types, g_ascii_strdown (extension, -1), g_strdup (mime_type));
+    else {
+        g_autofree char *key = g_ascii_strdown (extension, -1);
+        g_hash_table_remove (self->mime_types, key);
+    }
+
+    /* Cached entries and metadata may have a different type, discard them. */
+    cache_trim (self, 0);
+    if (self->metadata)
+        g_hash_table_remove_all (self->metadata);
+}
+
+/**
+ * cog_directory_files_handler_get_cache_metadata:
+ * @self: a #CogDirectoryFilesHandler
+ *
+ * Gets the value of the [property@Cog.DirectoryFilesHandler:cache-metadata]
+ * property.
+ *
+ * Returns: Whether the results of resolving paths are remembered.
+ */
+gboolean
+cog_directory_files_handler_get_cache_metadata (CogDirectoryFilesHandler *self)
+{
+    g_return_val_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self), FALSE);
+    return self->cache_metadata;
+}
+
+/**
+ * cog_directory_files_handler_set_cache_metadata:
+ * @self: a #CogDirectoryFilesHandler
+ * @cache_metadata: Whether to remember the results of resolving paths.
+ *
+ * Sets the value of the [property@Cog.DirectoryFilesHandler:cache-metadata]
+ * property. Disabling it discards the stored results.
+ */
+void
+cog_directory_files_handler_set_cache_metadata (CogDirectoryFilesHandler *self,
+                                                gboolean                  cache_metadata)
+{
+    g_return_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self));
+
+    cache_metadata = cache_metadata ? TRUE : FALSE;
+    if (self->cache_metadata == cache_metadata)
+        return;
+
+    self->cache_metadata = cache_metadata;
+    if (!cache_metadata) {
+        g_clear_pointer (&self->metadata, g_hash_table_unref);
+        g_clear_pointer (&self->monitors, g_hash_table_unref);
+    }
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_CACHE_METADATA]);
+}
+
+/**
+ * cog_directory_files_handler_get_immutable:
+ * @self: a #CogDirectoryFilesHandler
+ *
+ * Gets the value of the [property@Cog.DirectoryFilesHandler:immutable]
+ * property.
+ *
+ * Returns: Whether the contents of the base path are assumed to never change.
+ */
+gboolean
+cog_directory_files_handler_get_immutable (CogDirectoryFilesHandler *self)
+{
+    g_return_val_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self), FALSE);
+    return self->immutable;
+}
+
+/**
+ * cog_directory_files_handler_set_immutable:
+ * @self: a #CogDirectoryFilesHandler
+ * @immutable: Whether the contents of the base path never change.
+ *
+ * Sets the value of the [property@Cog.DirectoryFilesHandler:immutable]
+ * property.
+ */
+void
+cog_directory_files_handler_set_immutable (CogDirectoryFilesHandler *self,
+                                           gboolean                  immutable)
+{
+    g_return_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self));
+
+    immutable = immutable ? TRUE : FALSE;
+    if (self->immutable == immutable)
+        return;
+
+    self->immutable = immutable;
+
+    /*
+     * Stop watching when the contents are now immutable. Otherwise,
+     * discard stored results, as changes have not been watched for.
+     */
+    if (immutable)
+        g_clear_pointer (&self->monitors, g_hash_table_unref);
+    else if (self->metadata)
+        g_hash_table_remove_all (self->metadata);
+
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_IMMUTABLE]);
+}
+
+/**
+ * cog_directory_files_handler_get_serve_compressed:
+ * @self: a #CogDirectoryFilesHandler
+ *
+ * Gets the value of the [property@Cog.DirectoryFilesHandler:serve-compressed]
+ * property.
+ *
+ * Returns: Whether compressed versions of files are served.
+ */
+gboolean
+cog_directory_files_handler_get_serve_compressed (CogDirectoryFilesHandler *self)
+{
+    g_return_val_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self), FALSE);
+    return self->serve_compressed;
+}
+
+/**
+ * cog_directory_files_handler_set_serve_compressed:
+ * @self: a #CogDirectoryFilesHandler
+ * @serve_compressed: Whether to serve compressed versions of files.
+ *
+ * Sets the value of the [property@Cog.DirectoryFilesHandler:serve-compressed]
+ * property.
+ */
+void
+cog_directory_files_handler_set_serve_compressed (CogDirectoryFilesHandler *self,
+                                                  gboolean                  serve_compressed)
+{
+    g_return_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self));
+
+    serve_compressed = serve_compressed ? TRUE : FALSE;
+    if (self->serve_compressed == serve_compressed)
+        return;
+
+    self->serve_compressed = serve_compressed;
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_SERVE_COMPRESSED]);
+}
+
+/*
+ * Checks whether a path listed in a preload manifest stays inside the
+ * base directory: absolute paths and ".." components are rejected.
+ */
+gboolean
+cog_directory_files_handler_preload_path_is_valid (const char *path)
+{
+    if (path[0] == '/')
+        return FALSE;
+
+    for (const char *component = path; component; ) {
+        const char *slash = strchr (component, '/');
+        const size_t length = slash ? (size_t) (slash - component) : strlen (component);
+        if (length == 2 && component[0] == '.' && component[1] == '.')
+            return FALSE;
+        component = slash ? slash + 1 : NULL;
+    }
+    return TRUE;
+}
+
+
+typedef struct {
+    GFile  *manifest;
+    guint64 n_files;
+    guint64 n_bytes;
+} PreloadData;
+
+
+static void
+preload_data_free (void *pointer)
+{
+    PreloadData *data = pointer;
+    g_clear_object (&data->manifest);
+    g_slice_free (PreloadData, data);
+}
+
+
+#define PRELOAD_BATCH_SIZE  32
+#define PRELOAD_CHUNK_SIZE  (128 * 1024)
+
+/*
+ * Reads a file into the page cache, discarding the data. This returns
+ * once the reads hinted with posix_fadvise() are done, and reads the file
+ * on systems where hinting is not supported.
+ */
+static void
+preload_read_file (int   fd,
+                   char *buffer)
+{
+    for (off_t offset = 0;;) {
+        ssize_t n_read = pread (fd, buffer, PRELOAD_CHUNK_SIZE, offset);
+        if (n_read > 0)
+            offset += n_read;
+        else if (n_read == 0 || errno != EINTR)
+            break;
+    }
+}
+
+
+/*
+ * Hints the kernel to start reading each of the listed files into the page
+ * cache, and then waits for the reads to finish. Files are handled in
+ * batches: the advice for all the files in a batch returns without waiting,
+ * so their I/O gets queued at once instead of being issued one after
+ * another as the web engine discovers the resources.
+ */
+static void
+preload_thread (GTask        *task,
+                void         *source_object,
+                void         *task_data,
+                GCancellable *cancellable)
+{
+    CogDirectoryFilesHandler *handler = source_object;
+    PreloadData *data = task_data;
+
+    g_autoptr(GError) error = NULL;
+    g_autofree char *contents = NULL;
+    if (!g_file_load_contents (data->manifest, cancellable, &contents, NULL, NULL, &error))
+        return g_task_return_error (task, g_steal_pointer (&error));
+
+    g_autofree char *buffer = g_malloc (PRELOAD_CHUNK_SIZE);
+    int batch[PRELOAD_BATCH_SIZE];
+    unsigned batch_size = 0;
+
+    g_auto(GStrv) lines = g_strsplit (contents, "\n", -1);
+    for (unsigned i = 0; lines[i]; i++) {
+        char *path = g_strstrip (lines[i]);
+        if (path[0] != '\0' && path[0] != '#') {
+            int fd;
+            struct stat st;
+            if (!cog_directory_files_handler_preload_path_is_valid (path)) {
+                g_warning ("Preload path '%s' not contained in base path '%s'",
+                           path, g_file_peek_path (handler->base_path));
+            } else if (!open_at (handler->base_fd, path, &fd, &st, &error)) {
+                g_debug ("%s", error->message);
+                g_clear_error (&error);
+            } else if (!S_ISREG (st.st_mode)) {
+                close (fd);
+            } else {
+#ifdef POSIX_FADV_WILLNEED
+                posix_fadvise (fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+                batch[batch_size++] = fd;
+                data->n_files++;
+                data->n_bytes += st.st_size;
+            }
+        }
+
+        if (batch_size == PRELOAD_BATCH_SIZE || (!lines[i + 1] && batch_size)) {
+            for (unsigned j = 0; j < batch_size; j++) {
+                preload_read_file (batch[j], buffer);
+                close (batch[j]);
+            }
+            batch_size = 0;
+
+            if (g_task_return_error_if_cancelled (task))
+                return;
+        }
+    }
+
+    g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * cog_directory_files_handler_preload_async:
+ * @self: a #CogDirectoryFilesHandler
+ * @manifest: File listing the paths to preload.
+ * @cancellable: (nullable): A #GCancellable.
+ * @callback: Function called when all the files have been read.
+ * @user_data: User data for the @callback.
+ *
+ * Asks the operating system to read into its page cache the files listed
+ * in a @manifest, in a low priority job of the pool of threads used to
+ * serve requests, and waits for the reads to finish. This is useful to warm
+ * up the cache before the web engine starts requesting resources, which
+ * can considerably speed up the first page load after a cold boot.
+ *
+ * The @manifest is a text file with one path per line, relative to the
+ * [property@Cog.DirectoryFilesHandler:base-path]. Empty lines and lines
+ * starting with a `#` character are ignored, and so are paths which
+ * cannot be opened.
+ */
+void
+cog_directory_files_handler_preload_async (CogDirectoryFilesHandler *self,
+                                           GFile                    *manifest,
+                                           GCancellable             *cancellable,
+                                           GAsyncReadyCallback       callback,
+                                           void                     *user_data)
+{
+    g_return_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self));
+    g_return_if_fail (G_IS_FILE (manifest));
+
+    PreloadData *data = g_slice_new0 (PreloadData);
+    data->manifest = g_object_ref (manifest);
+
+    g_autoptr(GTask) task = g_task_new (self, cancellable, callback, user_data);
+    g_task_set_source_tag (task, cog_directory_files_handler_preload_async);
+    g_task_set_task_data (task, data, preload_data_free);
+
+    if (self->base_fd == -1) {
+        g_task_return_new_error (task,
+                                 G_IO_ERROR,
+                                 G_IO_ERROR_NOT_FOUND,
+                                 "Base path '%s' could not be opened",
+                                 g_file_peek_path (self->base_path));
+        return;
+    }
+
+    cog_io_pool_run_in_thread (task, preload_thread, COG_IO_PRIORITY_LOW);
+}
+
+/**
+ * cog_directory_files_handler_preload_finish:
+ * @self: a #CogDirectoryFilesHandler
+ * @result: A #GAsyncResult.
+ * @n_files: (out) (optional): Number of files preloaded.
+ * @n_bytes: (out) (optional): Total size of the preloaded files.
+ * @error: Location where to store an error.
+ *
+ * Finishes an operation started with
+ * [method@Cog.DirectoryFilesHandler.preload_async].
+ *
+ * Returns: Whether the manifest could be read.
+ */
+gboolean
+cog_directory_files_handler_preload_finish (CogDirectoryFilesHandler *self,
+                                            GAsyncResult             *result,
+                                            guint64                  *n_files,
+                                            guint64                  *n_bytes,
+                                            GError                  **error)
+{
+    g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+
+    if (!g_task_propagate_boolean (G_TASK (result), error))
+        return FALSE;
+
+    const PreloadData *data = g_task_get_task_data (G_TASK (result));
+    if (n_files)
+        *n_files = data->n_files;
+    if (n_bytes)
+        *n_bytes = data->n_bytes;
+    return TRUE;
+}
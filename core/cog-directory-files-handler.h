@@ -52,6 +52,53 @@ void               cog_directory_files_handler_set_strip_components
                                                                 (CogDirectoryFilesHandler *self,
                                                                  unsigned                  count);
 
+guint64            cog_directory_files_handler_get_cache_max_bytes
+                                                                (CogDirectoryFilesHandler *self);
+void               cog_directory_files_handler_set_cache_max_bytes
+                                                                (CogDirectoryFilesHandler *self,
+                                                                 guint64                   max_bytes);
+
+guint64            cog_directory_files_handler_get_cache_max_entry_size
+                                                                (CogDirectoryFilesHandler *self);
+void               cog_directory_files_handler_set_cache_max_entry_size
+                                                                (CogDirectoryFilesHandler *self,
+                                                                 guint64                   max_size);
+
+void               cog_directory_files_handler_set_mime_type    (CogDirectoryFilesHandler *self,
+                                                                 const char               *extension,
+                                                                 const char               *mime_type);
+
+gboolean           cog_directory_files_handler_get_map_files    (CogDirectoryFilesHandler *self);
+void               cog_directory_files_handler_set_map_files    (CogDirectoryFilesHandler *self,
+                                                                 gboolean                  map_files);
+
+gboolean           cog_directory_files_handler_get_cache_metadata
+                                                                (CogDirectoryFilesHandler *self);
+void               cog_directory_files_handler_set_cache_metadata
+                                                                (CogDirectoryFilesHandler *self,
+                                                                 gboolean                  cache_metadata);
+
+gboolean           cog_directory_files_handler_get_immutable    (CogDirectoryFilesHandler *self);
+void               cog_directory_files_handler_set_immutable    (CogDirectoryFilesHandler *self,
+                                                                 gboolean                  immutable);
+
+gboolean           cog_directory_files_handler_get_serve_compressed
+                                                                (CogDirectoryFilesHandler *self);
+void               cog_directory_files_handler_set_serve_compressed
+                                                                (CogDirectoryFilesHandler *self,
+                                                                 gboolean                  serve_compressed);
+
+void               cog_directory_files_handler_preload_async    (CogDirectoryFilesHandler *self,
+                                                                 GFile                    *manifest,
+                                                                 GCancellable             *cancellable,
+                                                                 GAsyncReadyCallback       callback,
+                                                                 void                     *user_data);
+gboolean           cog_directory_files_handler_preload_finish   (CogDirectoryFilesHandler *self,
+                                                                 GAsyncResult             *result,
+                                                                 guint64                  *n_files,
+                                                                 guint64                  *n_bytes,
+                                                                 GError                  **error);
+
 G_END_DECLS
 
 #endif /* !COG_DIRECTORY_FILES_HANDLER_H */
@@ -0,0 +1,199 @@
+/*
+ * cog-io-pool.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "cog-io-pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Pool of threads used by request handlers to perform blocking I/O.
+ *
+ * Using a separate pool instead of g_task_run_in_thread() avoids competing
+ * for threads with the rest of the process, and allows running jobs by
+ * priority, so loading resources needed to display a page (documents,
+ * scripts, style sheets) is not delayed by bursts of image or media loads.
+ *
+ * The amount of threads can be set with the COG_IO_POOL_THREADS
+ * environment variable.
+ */
+
+#define IO_POOL_DEFAULT_THREADS 4
+#define IO_POOL_MAX_THREADS     64
+
+typedef struct {
+    GTask          *task;
+    GTaskThreadFunc task_func;
+    CogIOPriority   priority;
+    guint           sequence;
+} IOJob;
+
+
+static int
+io_job_compare (const void *a, const void *b, void *user_data G_GNUC_UNUSED)
+{
+    const IOJob *job_a = a;
+    const IOJob *job_b = b;
+
+    if (job_a->priority != job_b->priority)
+        return (job_a->priority < job_b->priority) ? -1 : 1;
+
+    /* Handles wrap-around of the sequence counter. */
+    return (int) (job_a->sequence - job_b->sequence);
+}
+
+
+static void
+io_job_run (void *data, void *user_data G_GNUC_UNUSED)
+{
+    IOJob *job = data;
+
+    (*job->task_func) (job->task,
+                       g_task_get_source_object (job->task),
+                       g_task_get_task_data (job->task),
+                       g_task_get_cancellable (job->task));
+
+    g_object_unref (job->task);
+    g_slice_free (IOJob, job);
+}
+
+
+static unsigned
+io_pool_get_max_threads (void)
+{
+    const char *env_value = g_getenv ("COG_IO_POOL_THREADS");
+    if (env_value) {
+        char *end = NULL;
+        guint64 value = g_ascii_strtoull (env_value, &end, 10);
+        if (end && *end == '\0' && value > 0 && value <= IO_POOL_MAX_THREADS)
+            return value;
+        g_warning ("Invalid COG_IO_POOL_THREADS value '%s', using %u threads",
+                   env_value, IO_POOL_DEFAULT_THREADS);
+    }
+    return IO_POOL_DEFAULT_THREADS;
+}
+
+
+static GThreadPool*
+io_pool_get (void)
+{
+    static GThreadPool *pool = NULL;
+
+    if (g_once_init_enter (&pool)) {
+        g_autoptr(GError) error = NULL;
+        GThreadPool *new_pool = g_thread_pool_new (io_job_run,
+                                                   NULL,
+                                                   io_pool_get_max_threads (),
+                                                   FALSE,
+                                                   &error);
+        if (!new_pool)
+            g_error ("Cannot create I/O thread pool: %s", error->message);
+
+        g_thread_pool_set_sort_function (new_pool, io_job_compare, NULL);
+        g_once_init_leave (&pool, new_pool);
+    }
+
+    return pool;
+}
+
+
+/*
+ * cog_io_pool_run_in_thread:
+ * @task: A #GTask.
+ * @task_func: Function to run in a thread of the pool.
+ * @priority: Priority of the task.
+ *
+ * Runs a task in the I/O pool. This works like g_task_run_in_thread(),
+ * and the task function is expected to return a value for the task.
+ */
+void
+cog_io_pool_run_in_thread (GTask          *task,
+                           GTaskThreadFunc task_func,
+                           CogIOPriority   priority)
+{
+    static guint s_sequence = 0;
+
+    g_return_if_fail (G_IS_TASK (task));
+    g_return_if_fail (task_func);
+
+    IOJob *job = g_slice_new (IOJob);
+    job->task = g_object_ref (task);
+    job->task_func = task_func;
+    job->priority = priority;
+    job->sequence = (guint) g_atomic_int_add (&s_sequence, 1);
+
+    g_autoptr(GError) error = NULL;
+    if (!g_thread_pool_push (io_pool_get (), job, &error)) {
+        g_object_unref (job->task);
+        g_slice_free (IOJob, job);
+        g_task_return_error (task, g_steal_pointer (&error));
+    }
+}
+
+
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+static CogIOPriority
+io_priority_for_fetch_dest (const char *dest)
+{
+    static const char * const high_priority[] = {
+        "document", "frame", "iframe", "script", "style",
+        "worker", "sharedworker", "serviceworker",
+    };
+    static const char * const low_priority[] = {
+        "audio", "image", "track", "video",
+    };
+
+    for (unsigned i = 0; i < G_N_ELEMENTS (high_priority); i++)
+        if (g_ascii_strcasecmp (dest, high_priority[i]) == 0)
+            return COG_IO_PRIORITY_HIGH;
+
+    for (unsigned i = 0; i < G_N_ELEMENTS (low_priority); i++)
+        if (g_ascii_strcasecmp (dest, low_priority[i]) == 0)
+            return COG_IO_PRIORITY_LOW;
+
+    return COG_IO_PRIORITY_DEFAULT;
+}
+#endif /* WEBKIT_CHECK_VERSION */
+
+
+/*
+ * cog_io_priority_for_request:
+ * @request: A request.
+ * @mime_type: (nullable): MIME type of the requested resource, if known.
+ *
+ * Determines the priority for loading a resource. The `Sec-Fetch-Dest`
+ * request header is used when available, otherwise the MIME type is
+ * used to guess how the resource is going to be used.
+ *
+ * Returns: Priority for I/O done to load the resource.
+ */
+CogIOPriority
+cog_io_priority_for_request (WebKitURISchemeRequest *request,
+                             const char             *mime_type)
+{
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+    SoupMessageHeaders *headers = webkit_uri_scheme_request_get_http_headers (request);
+    const char *dest = headers ? soup_message_headers_get_one (headers, "Sec-Fetch-Dest") : NULL;
+    if (dest && strcmp (dest, "empty") != 0)
+        return io_priority_for_fetch_dest (dest);
+#endif /* WEBKIT_CHECK_VERSION */
+
+    if (!mime_type)
+        return COG_IO_PRIORITY_DEFAULT;
+
+    if (g_str_has_prefix (mime_type, "image/") ||
+        g_str_has_prefix (mime_type, "audio/") ||
+        g_str_has_prefix (mime_type, "video/"))
+        return COG_IO_PRIORITY_LOW;
+
+    if (strcmp (mime_type, "text/html") == 0 ||
+        strcmp (mime_type, "application/xhtml+xml") == 0 ||
+        strcmp (mime_type, "text/javascript") == 0 ||
+        strcmp (mime_type, "text/css") == 0)
+        return COG_IO_PRIORITY_HIGH;
+
+    return COG_IO_PRIORITY_DEFAULT;
+}
@@ -0,0 +1,35 @@
+/*
+ * cog-io-pool.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <wpe/webkit.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Priorities of jobs run in the I/O pool. Jobs with a higher priority
+ * (smaller value) are run first, and jobs with the same priority are run
+ * in the order in which they were submitted.
+ */
+typedef enum {
+    COG_IO_PRIORITY_HIGH,       /* Documents, scripts, style sheets. */
+    COG_IO_PRIORITY_DEFAULT,
+    COG_IO_PRIORITY_LOW,        /* Images, media. */
+} CogIOPriority;
+
+G_GNUC_INTERNAL
+void          cog_io_pool_run_in_thread   (GTask                  *task,
+                                           GTaskThreadFunc         task_func,
+                                           CogIOPriority           priority);
+
+G_GNUC_INTERNAL
+CogIOPriority cog_io_priority_for_request (WebKitURISchemeRequest *request,
+                                           const char             *mime_type);
+
+G_END_DECLS
@@ -0,0 +1,312 @@
+/*
+ * cog-latency-middleware.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "cog-latency-middleware.h"
+
+/**
+ * CogLatencyMiddleware:
+ *
+ * Middleware which measures the time taken to answer requests.
+ *
+ * The time is measured from the moment a request reaches the middleware
+ * until the next handler finishes it, and is accumulated into statistics
+ * which can be retrieved with [method@Cog.LatencyMiddleware.get_stats].
+ * Requests which take longer than the
+ * [property@Cog.LatencyMiddleware:slow-threshold] are logged.
+ */
+
+struct _CogLatencyMiddleware {
+    GObject parent;
+
+    gboolean enabled;
+    unsigned slow_threshold;
+
+    guint64  count;
+    gint64   total_time;
+    gint64   max_time;
+};
+
+enum {
+    PROP_0,
+    PROP_ENABLED,
+    PROP_SLOW_THRESHOLD,
+    N_PROPERTIES,
+};
+
+static GParamSpec *s_properties[N_PROPERTIES] = { NULL, };
+
+
+static void
+on_request_finished (WebKitURISchemeRequest *request,
+                     const CogRequestResult *result,
+                     void                   *user_data)
+{
+    CogLatencyMiddleware *self = user_data;
+
+    const gint64 elapsed = g_get_monotonic_time () - result->start_time;
+
+    self->count++;
+    self->total_time += elapsed;
+    if (elapsed > self->max_time)
+        self->max_time = elapsed;
+
+    if (self->slow_threshold && elapsed >= (gint64) self->slow_threshold * 1000) {
+        g_message ("Slow request (%.3f ms): %s",
+                   elapsed / 1000.0, webkit_uri_scheme_request_get_uri (request));
+    } else {
+        g_debug ("%s: %.3f ms for %s", __func__,
+                 elapsed / 1000.0, webkit_uri_scheme_request_get_uri (request));
+    }
+}
+
+
+static void
+cog_latency_middleware_run (CogRequestMiddleware   *middleware,
+                            WebKitURISchemeRequest *request,
+                            CogRequestHandler      *next)
+{
+    CogLatencyMiddleware *self = COG_LATENCY_MIDDLEWARE (middleware);
+
+    if (self->enabled) {
+        cog_request_add_finished_callback (request,
+                                           on_request_finished,
+                                           g_object_ref (self),
+                                           g_object_unref);
+    }
+
+    cog_request_handler_run (next, request);
+}
+
+
+static void
+cog_latency_middleware_iface_init (CogRequestMiddlewareInterface *iface)
+{
+    iface->run = cog_latency_middleware_run;
+}
+
+
+G_DEFINE_TYPE_WITH_CODE (CogLatencyMiddleware,
+                         cog_latency_middleware,
+                         G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (COG_TYPE_REQUEST_MIDDLEWARE,
+                                                cog_latency_middleware_iface_init))
+
+
+static void
+cog_latency_middleware_get_property (GObject    *object,
+                                     unsigned    prop_id,
+                                     GValue     *value,
+                                     GParamSpec *pspec)
+{
+    CogLatencyMiddleware *self = COG_LATENCY_MIDDLEWARE (object);
+    switch (prop_id) {
+        case PROP_ENABLED:
+            g_value_set_boolean (value, cog_latency_middleware_get_enabled (self));
+            break;
+        case PROP_SLOW_THRESHOLD:
+            g_value_set_uint (value, cog_latency_middleware_get_slow_threshold (self));
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+
+static void
+cog_latency_middleware_set_property (GObject      *object,
+                                     unsigned      prop_id,
+                                     const GValue *value,
+                                     GParamSpec   *pspec)
+{
+    CogLatencyMiddleware *self = COG_LATENCY_MIDDLEWARE (object);
+    switch (prop_id) {
+        case PROP_ENABLED:
+            cog_latency_middleware_set_enabled (self, g_value_get_boolean (value));
+            break;
+        case PROP_SLOW_THRESHOLD:
+            cog_latency_middleware_set_slow_threshold (self, g_value_get_uint (value));
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+
+static void
+cog_latency_middleware_class_init (CogLatencyMiddlewareClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    object_class->get_property = cog_latency_middleware_get_property;
+    object_class->set_property = cog_latency_middleware_set_property;
+
+    /**
+     * CogLatencyMiddleware:enabled: (attributes org.gtk.Property.get=cog_latency_middleware_get_enabled org.gtk.Property.set=cog_latency_middleware_set_enabled):
+     *
+     * Whether requests are measured. When disabled, requests are passed
+     * to the next handler without any additional work.
+     */
+    s_properties[PROP_ENABLED] =
+        g_param_spec_boolean ("enabled",
+                              "Enabled",
+                              "Whether to measure requests",
+                              TRUE,
+                              G_PARAM_READWRITE |
+                              G_PARAM_CONSTRUCT |
+                              G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogLatencyMiddleware:slow-threshold: (attributes org.gtk.Property.get=cog_latency_middleware_get_slow_threshold org.gtk.Property.set=cog_latency_middleware_set_slow_threshold):
+     *
+     * Time, in milliseconds, after which requests are considered slow and
+     * logged. A value of zero disables logging slow requests.
+     */
+    s_properties[PROP_SLOW_THRESHOLD] =
+        g_param_spec_uint ("slow-threshold",
+                           "Slow request threshold",
+                           "Milliseconds after which requests are logged as slow",
+                           0, G_MAXUINT, 0,
+                           G_PARAM_READWRITE |
+                           G_PARAM_CONSTRUCT |
+                           G_PARAM_STATIC_STRINGS);
+
+    g_object_class_install_properties (object_class, N_PROPERTIES, s_properties);
+}
+
+
+static void
+cog_latency_middleware_init (CogLatencyMiddleware *self G_GNUC_UNUSED)
+{
+}
+
+
+/**
+ * cog_latency_middleware_new:
+ *
+ * Creates a new middleware which measures the time taken to answer requests.
+ *
+ * Returns: (transfer full): A new middleware.
+ */
+CogRequestMiddleware*
+cog_latency_middleware_new (void)
+{
+    return g_object_new (COG_TYPE_LATENCY_MIDDLEWARE, NULL);
+}
+
+/**
+ * cog_latency_middleware_get_enabled:
+ * @self: a #CogLatencyMiddleware
+ *
+ * Gets the value of the [property@Cog.LatencyMiddleware:enabled] property.
+ *
+ * Returns: Whether requests are measured.
+ */
+gboolean
+cog_latency_middleware_get_enabled (CogLatencyMiddleware *self)
+{
+    g_return_val_if_fail (COG_IS_LATENCY_MIDDLEWARE (self), FALSE);
+    return self->enabled;
+}
+
+/**
+ * cog_latency_middleware_set_enabled:
+ * @self: a #CogLatencyMiddleware
+ * @enabled: Whether to measure requests.
+ *
+ * Sets the value of the [property@Cog.LatencyMiddleware:enabled] property.
+ */
+void
+cog_latency_middleware_set_enabled (CogLatencyMiddleware *self,
+                                    gboolean              enabled)
+{
+    g_return_if_fail (COG_IS_LATENCY_MIDDLEWARE (self));
+
+    enabled = !!enabled;
+    if (self->enabled == enabled)
+        return;
+
+    self->enabled = enabled;
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_ENABLED]);
+}
+
+/**
+ * cog_latency_middleware_get_slow_threshold:
+ * @self: a #CogLatencyMiddleware
+ *
+ * Gets the value of the [property@Cog.LatencyMiddleware:slow-threshold]
+ * property.
+ *
+ * Returns: Threshold for slow requests, in milliseconds.
+ */
+unsigned
+cog_latency_middleware_get_slow_threshold (CogLatencyMiddleware *self)
+{
+    g_return_val_if_fail (COG_IS_LATENCY_MIDDLEWARE (self), 0);
+    return self->slow_threshold;
+}
+
+/**
+ * cog_latency_middleware_set_slow_threshold:
+ * @self: a #CogLatencyMiddleware
+ * @milliseconds: Threshold for slow requests, or zero.
+ *
+ * Sets the value of the [property@Cog.LatencyMiddleware:slow-threshold]
+ * property.
+ */
+void
+cog_latency_middleware_set_slow_threshold (CogLatencyMiddleware *self,
+                                           unsigned              milliseconds)
+{
+    g_return_if_fail (COG_IS_LATENCY_MIDDLEWARE (self));
+
+    if (self->slow_threshold == milliseconds)
+        return;
+
+    self->slow_threshold = milliseconds;
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_SLOW_THRESHOLD]);
+}
+
+/**
+ * cog_latency_middleware_get_stats:
+ * @self: a #CogLatencyMiddleware
+ * @count: (out) (optional): Number of measured requests.
+ * @total_time: (out) (optional): Total time taken by requests, in microseconds.
+ * @max_time: (out) (optional): Time taken by the slowest request, in microseconds.
+ *
+ * Retrieves the statistics accumulated since the middleware was created,
+ * or since the last call to [method@Cog.LatencyMiddleware.reset_stats].
+ */
+void
+cog_latency_middleware_get_stats (CogLatencyMiddleware *self,
+                                  guint64              *count,
+                                  gint64               *total_time,
+                                  gint64               *max_time)
+{
+    g_return_if_fail (COG_IS_LATENCY_MIDDLEWARE (self));
+
+    if (count)
+        *count = self->count;
+    if (total_time)
+        *total_time = self->total_time;
+    if (max_time)
+        *max_time = self->max_time;
+}
+
+/**
+ * cog_latency_middleware_reset_stats:
+ * @self: a #CogLatencyMiddleware
+ *
+ * Resets the accumulated statistics.
+ */
+void
+cog_latency_middleware_reset_stats (CogLatencyMiddleware *self)
+{
+    g_return_if_fail (COG_IS_LATENCY_MIDDLEWARE (self));
+
+    self->count = 0;
+    self->total_time = 0;
+    self->max_time = 0;
+}
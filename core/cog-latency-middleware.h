@@ -0,0 +1,46 @@
+/*
+ * cog-latency-middleware.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#if !(defined(COG_INSIDE_COG__) && COG_INSIDE_COG__)
+# error "Do not include this header directly, use <cog.h> instead"
+#endif
+
+#include "cog-request-middleware.h"
+
+G_BEGIN_DECLS
+
+#define COG_TYPE_LATENCY_MIDDLEWARE  (cog_latency_middleware_get_type ())
+
+G_DECLARE_FINAL_TYPE (CogLatencyMiddleware,
+                      cog_latency_middleware,
+                      COG, LATENCY_MIDDLEWARE,
+                      GObject)
+
+struct _CogLatencyMiddlewareClass {
+    GObjectClass parent_class;
+};
+
+
+CogRequestMiddleware* cog_latency_middleware_new                (void);
+
+gboolean              cog_latency_middleware_get_enabled        (CogLatencyMiddleware *self);
+void                  cog_latency_middleware_set_enabled        (CogLatencyMiddleware *self,
+                                                                 gboolean              enabled);
+
+unsigned              cog_latency_middleware_get_slow_threshold (CogLatencyMiddleware *self);
+void                  cog_latency_middleware_set_slow_threshold (CogLatencyMiddleware *self,
+                                                                 unsigned              milliseconds);
+
+void                  cog_latency_middleware_get_stats          (CogLatencyMiddleware *self,
+                                                                 guint64              *count,
+                                                                 gint64               *total_time,
+                                                                 gint64               *max_time);
+void                  cog_latency_middleware_reset_stats        (CogLatencyMiddleware *self);
+
+G_END_DECLS
@@ -9,9 +9,12 @@
 #include "cog-launcher.h"
 #include "cog-shell.h"
 #include "cog-request-handler.h"
+#include "cog-directory-files-handler.h"
+#include "cog-prefix-routes-handler.h"
 #include "cog-webkit-utils.h"
 #include "cog-utils.h"
 
+#include <errno.h>
 #include <glib-unix.h>
 #include <stdlib.h>
 #include <string.h>
@@ -54,9 +57,18 @@ struct _CogLauncher {
     GApplication parent;
     CogShell    *shell;
     gboolean     allow_all_requests;
+    GPtrArray   *mount_roots;
 
     guint        sigint_source;
     guint        sigterm_source;
+
+    guint        stats_registration_id;
+
+#if COG_DBUS_SYSTEM_BUS
+    GDBusConnection    *system_bus;
+    guint               system_bus_stats_registration_id;
+    GSimpleActionGroup *system_bus_actions;
+#endif // COG_DBUS_SYSTEM_BUS
 };
 
 G_DEFINE_TYPE (CogLauncher, cog_launcher, G_TYPE_APPLICATION)
@@ -104,6 +116,128 @@ on_action_open (G_GNUC_UNUSED GAction *action,
                               g_variant_get_string (param, NULL));
 }
 
+/*
+ * Resolves a path to its canonical form and checks whether it is one of
+ * the allowed mount roots, or contained in one of them. Returns the
+ * canonical path, or NULL if mounting the path is not allowed.
+ */
+static char*
+cog_launcher_resolve_mount_path (CogLauncher *launcher,
+                                 const char  *path,
+                                 GError     **error)
+{
+    if (!launcher->mount_roots || !launcher->mount_roots->len) {
+        g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED,
+                             "Mounting directories is not enabled (see --mount-root)");
+        return NULL;
+    }
+
+    g_autofree char *resolved = realpath (path, NULL);
+    if (!resolved) {
+        int errsv = errno;
+        g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+                     "Cannot resolve path: %s", g_strerror (errsv));
+        return NULL;
+    }
+
+    for (unsigned i = 0; i < launcher->mount_roots->len; i++) {
+        const char *root = g_ptr_array_index (launcher->mount_roots, i);
+        size_t root_len = strlen (root);
+        if (strncmp (resolved, root, root_len) == 0 &&
+            (resolved[root_len] == '\0' || resolved[root_len] == '/' || root[root_len - 1] == '/'))
+            return g_steal_pointer (&resolved);
+    }
+
+    g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED,
+                         "Path is not inside an allowed mount root");
+    return NULL;
+}
+
+/*
+ * Mounts a directory on a path prefix of a custom URI scheme. If the
+ * scheme has no handler, a CogPrefixRoutesHandler is installed for it.
+ * An existing route for the same prefix gets replaced; as both requests
+ * and actions are handled in the main thread, requests never see the
+ * prefix unmounted in between.
+ *
+ * Only directories below the roots given with --mount-root may be
+ * mounted, and the canonical path is mounted so that replacing a
+ * symbolic link afterwards cannot redirect the route elsewhere.
+ */
+static void
+on_action_mount (G_GNUC_UNUSED GAction *action,
+                 GVariant              *param,
+                 CogLauncher           *launcher)
+{
+    g_return_if_fail (g_variant_is_of_type (param, G_VARIANT_TYPE ("(sss)")));
+
+    const char *scheme, *path_prefix, *base_path;
+    g_variant_get (param, "(&s&s&s)", &scheme, &path_prefix, &base_path);
+
+    if (path_prefix[0] != '/') {
+        g_warning ("Cannot mount '%s' on '%s:%s': Path prefix must start with a slash",
+                   base_path, scheme, path_prefix);
+        return;
+    }
+
+    g_autoptr(GError) error = NULL;
+    g_autofree char *resolved_path = cog_launcher_resolve_mount_path (launcher, base_path, &error);
+    if (!resolved_path) {
+        g_warning ("Cannot mount '%s' on '%s:%s': %s",
+                   base_path, scheme, path_prefix, error->message);
+        return;
+    }
+    base_path = resolved_path;
+
+    g_autoptr(GFile) base_file = g_file_new_for_path (base_path);
+    if (!cog_directory_files_handler_is_suitable_path (base_file, &error)) {
+        g_warning ("Cannot mount '%s' on '%s:%s': %s",
+                   base_path, scheme, path_prefix, error->message);
+        return;
+    }
+
+    CogRequestHandler *handler = cog_shell_get_request_handler (launcher->shell, scheme);
+    if (!handler) {
+        g_autoptr(CogRequestHandler) routes_handler = cog_prefix_routes_handler_new (NULL);
+        cog_shell_set_request_handler (launcher->shell, scheme, routes_handler);
+        handler = routes_handler;
+    } else if (!COG_IS_PREFIX_ROUTES_HANDLER (handler)) {
+        g_warning ("Cannot mount '%s' on '%s:%s': The handler for the scheme does not support mounting",
+                   base_path, scheme, path_prefix);
+        return;
+    }
+
+    cog_prefix_routes_handler_unmount (COG_PREFIX_ROUTES_HANDLER (handler), path_prefix);
+    if (!cog_prefix_routes_handler_mount_path (COG_PREFIX_ROUTES_HANDLER (handler),
+                                               path_prefix,
+                                               base_path)) {
+        g_warning ("Cannot mount '%s' on '%s:%s'", base_path, scheme, path_prefix);
+        return;
+    }
+
+    g_message ("Mounted '%s' on '%s:%s'", base_path, scheme, path_prefix);
+}
+
+static void
+on_action_unmount (G_GNUC_UNUSED GAction *action,
+                   GVariant              *param,
+                   CogLauncher           *launcher)
+{
+    g_return_if_fail (g_variant_is_of_type (param, G_VARIANT_TYPE ("(ss)")));
+
+    const char *scheme, *path_prefix;
+    g_variant_get (param, "(&s&s)", &scheme, &path_prefix);
+
+    CogRequestHandler *handler = cog_shell_get_request_handler (launcher->shell, scheme);
+    if (!handler || !COG_IS_PREFIX_ROUTES_HANDLER (handler) || path_prefix[0] != '/' ||
+        !cog_prefix_routes_handler_unmount (COG_PREFIX_ROUTES_HANDLER (handler), path_prefix)) {
+        g_warning ("Cannot unmount '%s:%s': No such route", scheme, path_prefix);
+        return;
+    }
+
+    g_message ("Unmounted '%s:%s'", scheme, path_prefix);
+}
+
 static gboolean
 on_signal_quit (CogLauncher *launcher)
 {
@@ -129,6 +263,8 @@ on_notify_web_view (CogShell *shell, GParamSpec * arg G_GNUC_UNUSED, CogLauncher
 {
     WebKitWebView* web_view = cog_shell_get_web_view (shell);
 
+    /* Views from the pool may be activated more than once. */
+    g_signal_handlers_disconnect_by_func (web_view, G_CALLBACK (on_permission_request), launcher);
     g_signal_connect (web_view, "permission-request", G_CALLBACK (on_permission_request), launcher);
 }
 
@@ -182,7 +318,18 @@ cog_launcher_startup (GApplication *application)
 static void
 cog_launcher_shutdown (GApplication *application)
 {
-    cog_shell_shutdown (cog_launcher_get_shell (COG_LAUNCHER (application)));
+    CogLauncher *launcher = COG_LAUNCHER (application);
+
+#if COG_DBUS_SYSTEM_BUS
+    if (launcher->system_bus_stats_registration_id) {
+        g_dbus_connection_unregister_object (launcher->system_bus,
+                                             launcher->system_bus_stats_registration_id);
+        launcher->system_bus_stats_registration_id = 0;
+    }
+    g_clear_object (&launcher->system_bus);
+#endif // COG_DBUS_SYSTEM_BUS
+
+    cog_shell_shutdown (cog_launcher_get_shell (launcher));
 
     G_APPLICATION_CLASS (cog_launcher_parent_class)->shutdown (application);
 }
@@ -201,10 +348,124 @@ cog_launcher_dispose (GObject *object)
     g_clear_handle_id (&launcher->sigint_source, g_source_remove);
     g_clear_handle_id (&launcher->sigterm_source, g_source_remove);
 
+    g_clear_pointer (&launcher->mount_roots, g_ptr_array_unref);
+#if COG_DBUS_SYSTEM_BUS
+    g_clear_object (&launcher->system_bus_actions);
+#endif // COG_DBUS_SYSTEM_BUS
+
     G_OBJECT_CLASS (cog_launcher_parent_class)->dispose (object);
 }
 
 
+/*
+ * The com.igalia.Cog.Stats interface is exported next to the action group,
+ * and allows querying the statistics collected by the shell.
+ */
+static const char s_stats_interface_xml[] =
+    "<node>"
+    "  <interface name='com.igalia.Cog.Stats'>"
+    "    <method name='GetRequestStats'>"
+    "      <arg type='a{sa{sv}}' name='stats' direction='out'/>"
+    "    </method>"
+    "  </interface>"
+    "</node>";
+
+static void
+on_stats_method_call (G_GNUC_UNUSED GDBusConnection *connection,
+                      G_GNUC_UNUSED const char      *sender,
+                      G_GNUC_UNUSED const char      *object_path,
+                      G_GNUC_UNUSED const char      *interface_name,
+                      const char                    *method_name,
+                      G_GNUC_UNUSED GVariant        *parameters,
+                      GDBusMethodInvocation         *invocation,
+                      void                          *userdata)
+{
+    CogLauncher *launcher = userdata;
+
+    if (g_strcmp0 (method_name, "GetRequestStats") == 0) {
+        GVariant *stats = cog_shell_get_request_stats (launcher->shell);
+        g_dbus_method_invocation_return_value (invocation,
+                                               g_variant_new_tuple (&stats, 1));
+    } else {
+        g_dbus_method_invocation_return_error (invocation,
+                                               G_DBUS_ERROR,
+                                               G_DBUS_ERROR_UNKNOWN_METHOD,
+                                               "Unknown method %s",
+                                               method_name);
+    }
+}
+
+static guint
+cog_launcher_export_stats (CogLauncher     *launcher,
+                           GDBusConnection *connection,
+                           const char      *object_path,
+                           GError         **error)
+{
+    static GDBusNodeInfo *node_info = NULL;
+    static const GDBusInterfaceVTable vtable = {
+        .method_call = on_stats_method_call,
+    };
+
+    if (g_once_init_enter (&node_info)) {
+        GDBusNodeInfo *info = g_dbus_node_info_new_for_xml (s_stats_interface_xml, NULL);
+        g_assert (info);
+        g_once_init_leave (&node_info, info);
+    }
+
+    return g_dbus_connection_register_object (connection,
+                                              object_path,
+                                              node_info->interfaces[0],
+                                              &vtable,
+                                              launcher,
+                                              NULL,
+                                              error);
+}
+
+
+static gboolean
+cog_launcher_dbus_register (GApplication    *application,
+                            GDBusConnection *connection,
+                            const char      *object_path,
+                            GError         **error)
+{
+    if (!G_APPLICATION_CLASS (cog_launcher_parent_class)->dbus_register (application,
+                                                                           connection,
+                                                                           object_path,
+                                                                           error))
+        return FALSE;
+
+    /*
+     * Failing to export the statistics is not fatal, the application is
+     * still usable without them.
+     */
+    CogLauncher *launcher = COG_LAUNCHER (application);
+    g_autoptr(GError) stats_error = NULL;
+    launcher->stats_registration_id =
+        cog_launcher_export_stats (launcher, connection, object_path, &stats_error);
+    if (!launcher->stats_registration_id)
+        g_warning ("Cannot expose statistics interface: %s", stats_error->message);
+
+    return TRUE;
+}
+
+
+static void
+cog_launcher_dbus_unregister (GApplication    *application,
+                              GDBusConnection *connection,
+                              const char      *object_path)
+{
+    CogLauncher *launcher = COG_LAUNCHER (application);
+    if (launcher->stats_registration_id) {
+        g_dbus_connection_unregister_object (connection, launcher->stats_registration_id);
+        launcher->stats_registration_id = 0;
+    }
+
+    G_APPLICATION_CLASS (cog_launcher_parent_class)->dbus_unregister (application,
+                                                                      connection,
+                                                                      object_path);
+}
+
+
 #if COG_DBUS_SYSTEM_BUS
 static void
 on_system_bus_acquired (GDBusConnection *connection,
@@ -213,13 +474,41 @@ on_system_bus_acquired (GDBusConnection *connection,
 {
     g_autofree char* object_path =
         cog_appid_to_dbus_object_path (g_application_get_application_id (G_APPLICATION (userdata)));
+    CogLauncher *launcher = COG_LAUNCHER (userdata);
+
+    /*
+     * Any peer allowed by the bus policy may activate actions on the
+     * system bus, so the actions which expose host directories are only
+     * offered on the session bus.
+     */
+    g_clear_object (&launcher->system_bus_actions);
+    launcher->system_bus_actions = g_simple_action_group_new ();
+    g_auto(GStrv) action_names = g_action_group_list_actions (G_ACTION_GROUP (launcher));
+    for (unsigned i = 0; action_names[i]; i++) {
+        if (!strcmp (action_names[i], "mount") || !strcmp (action_names[i], "unmount"))
+            continue;
+        g_action_map_add_action (G_ACTION_MAP (launcher->system_bus_actions),
+                                 g_action_map_lookup_action (G_ACTION_MAP (launcher),
+                                                             action_names[i]));
+    }
+
     g_autoptr(GError) error = NULL;
     if (!g_dbus_connection_export_action_group (connection,
                                                 object_path,
-                                                G_ACTION_GROUP (userdata),
+                                                G_ACTION_GROUP (launcher->system_bus_actions),
                                                 &error))
         g_warning ("Cannot expose remote control interface to system bus: %s",
                    error->message);
+
+    g_clear_error (&error);
+    launcher->system_bus_stats_registration_id =
+        cog_launcher_export_stats (launcher, connection, object_path, &error);
+    if (launcher->system_bus_stats_registration_id) {
+        g_set_object (&launcher->system_bus, connection);
+    } else {
+        g_warning ("Cannot expose statistics interface to system bus: %s",
+                   error->message);
+    }
 }
 
 static void
@@ -264,6 +553,8 @@ cog_launcher_constructed (GObject *object)
     cog_launcher_add_action (launcher, "next", on_action_next, NULL);
     cog_launcher_add_action (launcher, "reload", on_action_reload, NULL);
     cog_launcher_add_action (launcher, "open", on_action_open, G_VARIANT_TYPE_STRING);
+    cog_launcher_add_action (launcher, "mount", on_action_mount, G_VARIANT_TYPE ("(sss)"));
+    cog_launcher_add_action (launcher, "unmount", on_action_unmount, G_VARIANT_TYPE ("(ss)"));
 
     launcher->sigint_source = g_unix_signal_add (SIGINT,
                                                  G_SOURCE_FUNC (on_signal_quit),
@@ -296,6 +587,8 @@ cog_launcher_class_init (CogLauncherClass *klass)
     application_class->open = cog_launcher_open;
     application_class->startup = cog_launcher_startup;
     application_class->shutdown = cog_launcher_shutdown;
+    application_class->dbus_register = cog_launcher_dbus_register;
+    application_class->dbus_unregister = cog_launcher_dbus_unregister;
 }
 
 
@@ -738,6 +1031,29 @@ option_entry_parse_permissions (const char          *option G_GNUC_UNUSED,
     return TRUE;
 }
 
+static gboolean
+option_entry_parse_mount_root (const char          *option G_GNUC_UNUSED,
+                               const char          *value,
+                               CogLauncher         *launcher,
+                               GError             **error)
+{
+    g_autofree char *resolved = realpath (value, NULL);
+    if (!resolved) {
+        int errsv = errno;
+        g_set_error (error,
+                     G_OPTION_ERROR,
+                     G_OPTION_ERROR_BAD_VALUE,
+                     "Invalid mount root '%s': %s",
+                     value, g_strerror (errsv));
+        return FALSE;
+    }
+
+    if (!launcher->mount_roots)
+        launcher->mount_roots = g_ptr_array_new_with_free_func (g_free);
+    g_ptr_array_add (launcher->mount_roots, g_steal_pointer (&resolved));
+    return TRUE;
+}
+
 static GOptionEntry s_permissions_options[] =
 {
     {
@@ -747,6 +1063,13 @@ static GOptionEntry s_permissions_options[] =
         .description = "Set permissions to access certain resources (default: 'none')",
         .arg_description = "[all | none]",
     },
+    {
+        .long_name = "mount-root",
+        .arg = G_OPTION_ARG_CALLBACK,
+        .arg_data = option_entry_parse_mount_root,
+        .description = "Allow mounting directories under PATH at runtime, may be repeated (default: none)",
+        .arg_description = "PATH",
+    },
     { NULL }
 };
 
@@ -0,0 +1,114 @@
+/*
+ * cog-mime-types.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "cog-mime-types.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Built-in table of MIME types for file extensions commonly used for Web
+ * content. Looking up a type here avoids going through shared-mime-info,
+ * which may involve reading the head of files to sniff their contents.
+ *
+ * NOTE: Entries must be kept sorted by extension, in lowercase.
+ */
+typedef struct {
+    const char *extension;
+    const char *mime_type;
+} MimeTypeEntry;
+
+static const MimeTypeEntry s_mime_types[] = {
+    { "avif",        "image/avif"                },
+    { "bmp",         "image/bmp"                 },
+    { "cjs",         "text/javascript"           },
+    { "css",         "text/css"                  },
+    { "csv",         "text/csv"                  },
+    { "eot",         "application/vnd.ms-fontobject" },
+    { "flac",        "audio/flac"                },
+    { "gif",         "image/gif"                 },
+    { "glb",         "model/gltf-binary"         },
+    { "gltf",        "model/gltf+json"           },
+    { "htm",         "text/html"                 },
+    { "html",        "text/html"                 },
+    { "ico",         "image/vnd.microsoft.icon"  },
+    { "jpeg",        "image/jpeg"                },
+    { "jpg",         "image/jpeg"                },
+    { "js",          "text/javascript"           },
+    { "json",        "application/json"          },
+    { "m4a",         "audio/mp4"                 },
+    { "m4v",         "video/mp4"                 },
+    { "map",         "application/json"          },
+    { "mjs",         "text/javascript"           },
+    { "mp3",         "audio/mpeg"                },
+    { "mp4",         "video/mp4"                 },
+    { "oga",         "audio/ogg"                 },
+    { "ogg",         "audio/ogg"                 },
+    { "ogv",         "video/ogg"                 },
+    { "opus",        "audio/ogg"                 },
+    { "otf",         "font/otf"                  },
+    { "pdf",         "application/pdf"           },
+    { "png",         "image/png"                 },
+    { "svg",         "image/svg+xml"             },
+    { "ttf",         "font/ttf"                  },
+    { "txt",         "text/plain"                },
+    { "vtt",         "text/vtt"                  },
+    { "wasm",        "application/wasm"          },
+    { "wav",         "audio/wav"                 },
+    { "weba",        "audio/webm"                },
+    { "webm",        "video/webm"                },
+    { "webmanifest", "application/manifest+json" },
+    { "webp",        "image/webp"                },
+    { "woff",        "font/woff"                 },
+    { "woff2",       "font/woff2"                },
+    { "xhtml",       "application/xhtml+xml"     },
+    { "xml",         "application/xml"           },
+};
+
+
+static int
+compare_extension (const void *key, const void *entry)
+{
+    return g_ascii_strcasecmp (key, ((const MimeTypeEntry*) entry)->extension);
+}
+
+/*
+ * cog_mime_type_for_extension:
+ * @extension: File name extension, without the leading dot.
+ *
+ * Returns: (nullable): MIME type for the extension from the built-in
+ *    table, or %NULL if the extension is not known.
+ */
+const char*
+cog_mime_type_for_extension (const char *extension)
+{
+    if (!extension || extension[0] == '\0')
+        return NULL;
+
+    const MimeTypeEntry *entry = bsearch (extension,
+                                 s_mime_types,
+                                 G_N_ELEMENTS (s_mime_types),
+                                 sizeof (s_mime_types[0]),
+                                 compare_extension);
+    return entry ? entry->mime_type : NULL;
+}
+
+/*
+ * cog_path_get_extension:
+ * @path: A file path.
+ *
+ * Returns: (nullable): Extension of the last component of @path, without
+ *    the leading dot; or %NULL if the file name has no extension.
+ */
+const char*
+cog_path_get_extension (const char *path)
+{
+    const char *name = strrchr (path, '/');
+    name = name ? name + 1 : path;
+
+    const char *dot = strrchr (name, '.');
+    return (dot && dot != name) ? dot + 1 : NULL;
+}
@@ -0,0 +1,20 @@
+/*
+ * cog-mime-types.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+G_GNUC_INTERNAL
+const char *cog_mime_type_for_extension (const char *extension);
+
+G_GNUC_INTERNAL
+const char *cog_path_get_extension      (const char *path);
+
+G_END_DECLS
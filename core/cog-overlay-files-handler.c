@@ -0,0 +1,724 @@
+/*
+ * cog-overlay-files-handler.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "cog-overlay-files-handler.h"
+#include "cog-io-pool.h"
+#include "cog-mime-types.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <gio/gio.h>
+#include <gio/gunixinputstream.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * CogOverlayFilesHandler:
+ *
+ * Request handler implementation that serves files from a stack of
+ * directories, or layers.
+ *
+ * Layers are given from the bottom to the top: when the same path exists
+ * in more than one of them, the file from the layer which comes later is
+ * used. This allows, for example, having a base application, a skin with
+ * customizations, and a set of hot-fixes, each in their own directory.
+ *
+ * Instead of trying each layer in turn for every request, the handler
+ * builds an index of all the files in the layers when created, which maps
+ * each path to the layer where the file is found. Resolving a request
+ * needs then a single hash table lookup and opening a single file, no
+ * matter how many layers there are. Layers are monitored for changes,
+ * and the index rebuilt in the background when files are added, removed,
+ * or renamed.
+ *
+ * As with [class@Cog.DirectoryFilesHandler], requests for paths which
+ * correspond to a directory are answered with its `index.html` file.
+ * Symbolic links to files are followed, but not those to directories.
+ */
+
+#define REBUILD_DELAY_MS  100
+
+typedef struct {
+    guint       layer;
+    const char *mime_type;  /* Interned. */
+} OverlayEntry;
+
+/*
+ * The index keeps open the directories of the layers it was built from,
+ * and files are opened relative to them. The index is swapped as a whole
+ * when rebuilt, so a layer directory which gets replaced (e.g. renaming
+ * a new version over it) is picked up together with its files. Requests
+ * keep a reference to the index they were resolved with, so directories
+ * are not closed while files are being opened from them.
+ */
+typedef struct {
+    int         ref_count;      /* (atomic) */
+    GHashTable *entries;        /* (string, OverlayEntry) */
+    GPtrArray  *directories;    /* (string), full paths to monitor. */
+    int        *layer_fds;      /* -1 for layers which cannot be opened. */
+    guint       n_layers;
+} OverlayIndex;
+
+struct _CogOverlayFilesHandler {
+    GObject parent;
+
+    GStrv         layers;
+
+    OverlayIndex *index;
+    GHashTable   *monitors;     /* (string, GFileMonitor) */
+    guint         rebuild_source;
+    gboolean      rebuilding;
+    gboolean      rebuild_pending;
+};
+
+enum {
+    PROP_0,
+    PROP_LAYERS,
+    N_PROPERTIES,
+};
+
+static GParamSpec *s_properties[N_PROPERTIES] = { NULL, };
+
+
+static void
+overlay_entry_free (void *pointer)
+{
+    g_slice_free (OverlayEntry, pointer);
+}
+
+
+static OverlayIndex*
+overlay_index_ref (OverlayIndex *index)
+{
+    g_atomic_int_inc (&index->ref_count);
+    return index;
+}
+
+
+static void
+overlay_index_unref (void *pointer)
+{
+    OverlayIndex *index = pointer;
+    if (!g_atomic_int_dec_and_test (&index->ref_count))
+        return;
+
+    for (guint i = 0; i < index->n_layers; i++) {
+        if (index->layer_fds[i] != -1)
+            close (index->layer_fds[i]);
+    }
+    g_free (index->layer_fds);
+    g_clear_pointer (&index->entries, g_hash_table_unref);
+    g_clear_pointer (&index->directories, g_ptr_array_unref);
+    g_slice_free (OverlayIndex, index);
+}
+
+
+static const char*
+guess_mime_type (const char *path)
+{
+    const char *mime_type = cog_mime_type_for_extension (cog_path_get_extension (path));
+    if (mime_type)
+        return g_intern_static_string (mime_type);
+
+    g_autofree char *content_type = g_content_type_guess (path, NULL, 0, NULL);
+    g_autofree char *guessed = g_content_type_get_mime_type (content_type);
+    return g_intern_string (guessed ? guessed : "application/octet-stream");
+}
+
+
+static void
+overlay_index_add_directory (OverlayIndex *index,
+                             guint         layer,
+                             const char   *base_path,
+                             const char   *relative_path)
+{
+    g_autofree char *dir_path = relative_path
+        ? g_build_filename (base_path, relative_path, NULL)
+        : g_strdup (base_path);
+
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GDir) dir = g_dir_open (dir_path, 0, &error);
+    if (!dir) {
+        g_debug ("%s: %s", __func__, error->message);
+        return;
+    }
+
+    g_ptr_array_add (index->directories, g_strdup (dir_path));
+
+    const char *name;
+    while ((name = g_dir_read_name (dir))) {
+        g_autofree char *path = relative_path
+            ? g_strconcat (relative_path, "/", name, NULL)
+            : g_strdup (name);
+        g_autofree char *full_path = g_build_filename (base_path, path, NULL);
+
+        GStatBuf st;
+        if (g_lstat (full_path, &st) == -1)
+            continue;
+
+        if (S_ISDIR (st.st_mode)) {
+            overlay_index_add_directory (index, layer, base_path, path);
+            continue;
+        }
+
+        /* Follow symbolic links to files, but not to directories. */
+        if (S_ISLNK (st.st_mode) && g_stat (full_path, &st) == -1)
+            continue;
+        if (!S_ISREG (st.st_mode))
+            continue;
+
+        OverlayEntry *entry = g_slice_new (OverlayEntry);
+        entry->layer = layer;
+        entry->mime_type = guess_mime_type (path);
+        g_hash_table_replace (index->entries, g_steal_pointer (&path), entry);
+    }
+}
+
+
+/*
+ * Builds the index by walking layers from the bottom to the top, so
+ * files in upper layers replace the ones with the same path below. Each
+ * layer is opened before being walked, so the files indexed are never
+ * older than the directory used to open them. Layers which cannot be
+ * opened are an error if "error" is given, and skipped otherwise.
+ */
+static OverlayIndex*
+overlay_index_build (const char * const *layers,
+                     GError            **error)
+{
+    OverlayIndex *index = g_slice_new0 (OverlayIndex);
+    index->ref_count = 1;
+    index->entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, overlay_entry_free);
+    index->directories = g_ptr_array_new_with_free_func (g_free);
+    index->n_layers = g_strv_length ((char **) layers);
+    index->layer_fds = g_new (int, index->n_layers);
+    for (guint i = 0; i < index->n_layers; i++)
+        index->layer_fds[i] = -1;
+
+    for (guint i = 0; i < index->n_layers; i++) {
+        index->layer_fds[i] = open (layers[i], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (index->layer_fds[i] == -1) {
+            int saved_errno = errno;
+            if (error) {
+                g_set_error (error,
+                             G_IO_ERROR,
+                             g_io_error_from_errno (saved_errno),
+                             "Cannot open layer '%s': %s",
+                             layers[i],
+                             g_strerror (saved_errno));
+                overlay_index_unref (index);
+                return NULL;
+            }
+            g_debug ("%s: Skipping layer '%s': %s", __func__, layers[i], g_strerror (saved_errno));
+            continue;
+        }
+
+        overlay_index_add_directory (index, i, layers[i], NULL);
+    }
+
+    return index;
+}
+
+
+static void cog_overlay_files_handler_update_monitors (CogOverlayFilesHandler *self);
+static void cog_overlay_files_handler_schedule_rebuild (CogOverlayFilesHandler *self);
+
+
+static void
+build_index_thread (GTask        *task,
+                    void         *source_object G_GNUC_UNUSED,
+                    void         *task_data,
+                    GCancellable *cancellable G_GNUC_UNUSED)
+{
+    g_task_return_pointer (task, overlay_index_build (task_data, NULL), overlay_index_unref);
+}
+
+
+static void
+on_build_index_completed (GObject      *source_object,
+                          GAsyncResult *result,
+                          void         *user_data G_GNUC_UNUSED)
+{
+    CogOverlayFilesHandler *self = COG_OVERLAY_FILES_HANDLER (source_object);
+    self->rebuilding = FALSE;
+
+    OverlayIndex *index = g_task_propagate_pointer (G_TASK (result), NULL);
+    g_assert (index);
+
+    /* The handler may have been disposed while building the index. */
+    if (!self->monitors) {
+        overlay_index_unref (index);
+        return;
+    }
+
+    g_debug ("%s: Index rebuilt, %u files", __func__, g_hash_table_size (index->entries));
+
+    g_clear_pointer (&self->index, overlay_index_unref);
+    self->index = index;
+    cog_overlay_files_handler_update_monitors (self);
+
+    if (self->rebuild_pending) {
+        self->rebuild_pending = FALSE;
+        cog_overlay_files_handler_schedule_rebuild (self);
+    }
+}
+
+
+static gboolean
+on_rebuild_timeout (void *user_data)
+{
+    CogOverlayFilesHandler *self = user_data;
+    self->rebuild_source = 0;
+
+    /* Changes made while building the index need another pass. */
+    if (self->rebuilding) {
+        self->rebuild_pending = TRUE;
+        return G_SOURCE_REMOVE;
+    }
+
+    self->rebuilding = TRUE;
+
+    g_autoptr(GTask) task = g_task_new (self, NULL, on_build_index_completed, NULL);
+    g_task_set_source_tag (task, on_rebuild_timeout);
+    g_task_set_task_data (task, g_strdupv (self->layers), (GDestroyNotify) g_strfreev);
+    cog_io_pool_run_in_thread (task, build_index_thread, COG_IO_PRIORITY_LOW);
+    return G_SOURCE_REMOVE;
+}
+
+
+/*
+ * Changes usually come in bursts (e.g. when copying a directory), wait
+ * a bit to rebuild the index once for all of them.
+ */
+static void
+cog_overlay_files_handler_schedule_rebuild (CogOverlayFilesHandler *self)
+{
+    if (self->rebuild_source)
+        return;
+
+    self->rebuild_source = g_timeout_add (REBUILD_DELAY_MS, on_rebuild_timeout, self);
+}
+
+
+static void
+on_monitor_changed (GFileMonitor     *monitor G_GNUC_UNUSED,
+                    GFile            *file G_GNUC_UNUSED,
+                    GFile            *other_file G_GNUC_UNUSED,
+                    GFileMonitorEvent event,
+                    void             *user_data)
+{
+    /* Modifying the contents of files does not change the index. */
+    if (event == G_FILE_MONITOR_EVENT_CHANGED ||
+        event == G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT ||
+        event == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+        return;
+
+    cog_overlay_files_handler_schedule_rebuild (user_data);
+}
+
+
+/*
+ * Watches the directories in the current index, keeping the monitors for
+ * directories which were already being watched.
+ */
+static void
+cog_overlay_files_handler_update_monitors (CogOverlayFilesHandler *self)
+{
+    g_autoptr(GHashTable) old_monitors = g_steal_pointer (&self->monitors);
+    self->monitors = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+
+    for (guint i = 0; i < self->index->directories->len; i++) {
+        const char *path = g_ptr_array_index (self->index->directories, i);
+
+        void *key = NULL, *monitor = NULL;
+        if (old_monitors && g_hash_table_lookup_extended (old_monitors, path, &key, &monitor)) {
+            g_hash_table_steal (old_monitors, path);
+            g_hash_table_insert (self->monitors, key, monitor);
+            continue;
+        }
+
+        g_autoptr(GFile) file = g_file_new_for_path (path);
+        g_autoptr(GError) error = NULL;
+        monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE, NULL, &error);
+        if (!monitor) {
+            g_warning ("Cannot monitor '%s': %s", path, error->message);
+            continue;
+        }
+
+        g_signal_connect_object (monitor, "changed", G_CALLBACK (on_monitor_changed), self, 0);
+        g_hash_table_insert (self->monitors, g_strdup (path), monitor);
+    }
+
+    /* Monitors for directories which no longer exist get released here. */
+    if (old_monitors) {
+        GHashTableIter iter;
+        void *monitor;
+        g_hash_table_iter_init (&iter, old_monitors);
+        while (g_hash_table_iter_next (&iter, NULL, &monitor))
+            g_file_monitor_cancel (monitor);
+    }
+}
+
+
+typedef struct {
+    WebKitURISchemeRequest *request;
+    OverlayIndex           *index;
+    int                     dir_fd;     /* Owned by "index". */
+    char                   *path;
+    const char             *mime_type;  /* Interned. */
+    int                     fd;
+    struct stat             st;
+} RequestData;
+
+
+static void
+request_data_free (void *pointer)
+{
+    RequestData *data = pointer;
+    g_clear_object (&data->request);
+    g_clear_pointer (&data->index, overlay_index_unref);
+    g_clear_pointer (&data->path, g_free);
+    if (data->fd != -1)
+        close (data->fd);
+    g_slice_free (RequestData, data);
+}
+
+
+static void
+open_file_thread (GTask        *task,
+                  void         *source_object G_GNUC_UNUSED,
+                  void         *task_data,
+                  GCancellable *cancellable G_GNUC_UNUSED)
+{
+    RequestData *data = task_data;
+
+    /*
+     * Use O_NONBLOCK to avoid getting stuck if the file was replaced
+     * by a FIFO after building the index.
+     */
+    data->fd = openat (data->dir_fd, data->path, O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+    if (data->fd == -1 || fstat (data->fd, &data->st) == -1) {
+        int saved_errno = errno;
+        g_task_return_new_error (task,
+                                 G_IO_ERROR,
+                                 g_io_error_from_errno (saved_errno),
+                                 "Cannot open '%s': %s",
+                                 data->path,
+                                 g_strerror (saved_errno));
+        return;
+    }
+
+    if (!S_ISREG (data->st.st_mode)) {
+        g_task_return_new_error (task,
+                                 G_IO_ERROR,
+                                 G_IO_ERROR_NOT_REGULAR_FILE,
+                                 "Not a regular file: %s",
+                                 data->path);
+        return;
+    }
+
+    g_task_return_boolean (task, TRUE);
+}
+
+
+static void
+on_open_file_completed (GObject      *source_object G_GNUC_UNUSED,
+                        GAsyncResult *result,
+                        void         *user_data G_GNUC_UNUSED)
+{
+    RequestData *data = g_task_get_task_data (G_TASK (result));
+
+    g_autoptr(GError) error = NULL;
+    if (!g_task_propagate_boolean (G_TASK (result), &error))
+        return cog_request_finish_error (data->request, error);
+
+    g_autoptr(GInputStream) stream = g_unix_input_stream_new (data->fd, TRUE);
+    data->fd = -1;  /* Now owned by the stream. */
+
+    cog_request_finish (data->request, stream, data->st.st_size, data->mime_type);
+}
+
+
+static void
+cog_overlay_files_handler_run (CogRequestHandler      *request_handler,
+                               WebKitURISchemeRequest *request)
+{
+    CogOverlayFilesHandler *self = COG_OVERLAY_FILES_HANDLER (request_handler);
+
+    g_autoptr(SoupURI) uri =
+        soup_uri_new (webkit_uri_scheme_request_get_uri (request));
+
+    /*
+     * If we get an empty path, redirect to the root resource "/", otherwise
+     * subresources cannot load properly as there would be no base URI.
+     */
+    const char *uri_path = soup_uri_get_path (uri);
+    if (uri_path[0] != '/') {
+        soup_uri_set_path (uri, "/");
+        g_autofree char *uri_string = soup_uri_to_string (uri, FALSE);
+        webkit_web_view_load_uri (webkit_uri_scheme_request_get_web_view (request), uri_string);
+        return;
+    }
+
+    g_autofree char *decoded_path = g_uri_unescape_string (uri_path, NULL);
+    if (!decoded_path) {
+        g_autoptr(GError) error = g_error_new (G_IO_ERROR,
+                                               G_IO_ERROR_INVALID_FILENAME,
+                                               "Invalid path in URI: %s",
+                                               uri_path);
+        return cog_request_finish_error (request, error);
+    }
+
+    /* Paths in the index do not have leading slashes. */
+    const char *path = decoded_path;
+    while (path[0] == '/')
+        ++path;
+
+    /*
+     * Only files found when building the index are looked up, which also
+     * prevents paths from escaping the layers (e.g. using "..").
+     */
+    g_autofree char *index_path = NULL;
+    OverlayEntry *entry = NULL;
+    size_t length = strlen (path);
+    if (length > 0 && path[length - 1] != '/')
+        entry = g_hash_table_lookup (self->index->entries, path);
+
+    if (!entry) {
+        index_path = (length == 0 || path[length - 1] == '/')
+            ? g_strconcat (path, "index.html", NULL)
+            : g_strconcat (path, "/index.html", NULL);
+        entry = g_hash_table_lookup (self->index->entries, index_path);
+        path = index_path;
+    }
+
+    if (!entry) {
+        g_autoptr(GError) error = g_error_new (G_IO_ERROR,
+                                               G_IO_ERROR_NOT_FOUND,
+                                               "Path '%s' not found in any layer",
+                                               decoded_path);
+        return cog_request_finish_error (request, error);
+    }
+
+    RequestData *data = g_slice_new0 (RequestData);
+    data->request = g_object_ref (request);
+    data->index = overlay_index_ref (self->index);
+    data->dir_fd = self->index->layer_fds[entry->layer];
+    data->path = g_strdup (path);
+    data->mime_type = entry->mime_type;
+    data->fd = -1;
+
+    g_autoptr(GTask) task = g_task_new (self, NULL, on_open_file_completed, NULL);
+    g_task_set_source_tag (task, cog_overlay_files_handler_run);
+    g_task_set_task_data (task, data, request_data_free);
+    cog_io_pool_run_in_thread (task,
+                               open_file_thread,
+                               cog_io_priority_for_request (request, data->mime_type));
+}
+
+
+static void
+cog_overlay_files_handler_iface_init (CogRequestHandlerInterface *iface)
+{
+    iface->run = cog_overlay_files_handler_run;
+}
+
+
+static gboolean
+cog_overlay_files_handler_initable_init (GInitable    *initable,
+                                         GCancellable *cancellable G_GNUC_UNUSED,
+                                         GError      **error)
+{
+    CogOverlayFilesHandler *self = COG_OVERLAY_FILES_HANDLER (initable);
+
+    if (!self->layers || !self->layers[0]) {
+        g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                             "No layers specified");
+        return FALSE;
+    }
+
+    self->index = overlay_index_build ((const char * const *) self->layers, error);
+    if (!self->index)
+        return FALSE;
+
+    cog_overlay_files_handler_update_monitors (self);
+
+    g_debug ("%s: Indexed %u files in %u layers", __func__,
+             g_hash_table_size (self->index->entries), self->index->n_layers);
+    return TRUE;
+}
+
+
+static void
+cog_overlay_files_handler_initable_iface_init (GInitableIface *iface)
+{
+    iface->init = cog_overlay_files_handler_initable_init;
+}
+
+
+G_DEFINE_TYPE_WITH_CODE (CogOverlayFilesHandler,
+                         cog_overlay_files_handler,
+                         G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_INITABLE,
+                                                cog_overlay_files_handler_initable_iface_init)
+                         G_IMPLEMENT_INTERFACE (COG_TYPE_REQUEST_HANDLER,
+                                                cog_overlay_files_handler_iface_init))
+
+
+static void
+cog_overlay_files_handler_get_property (GObject    *object,
+                                        unsigned    prop_id,
+                                        GValue     *value,
+                                        GParamSpec *pspec)
+{
+    CogOverlayFilesHandler *self = COG_OVERLAY_FILES_HANDLER (object);
+    switch (prop_id) {
+        case PROP_LAYERS:
+            g_value_set_boxed (value, self->layers);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+
+static void
+cog_overlay_files_handler_set_property (GObject      *object,
+                                        unsigned      prop_id,
+                                        const GValue *value,
+                                        GParamSpec   *pspec)
+{
+    CogOverlayFilesHandler *self = COG_OVERLAY_FILES_HANDLER (object);
+    switch (prop_id) {
+        case PROP_LAYERS:
+            self->layers = g_value_dup_boxed (value);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+
+static void
+cog_overlay_files_handler_dispose (GObject *object)
+{
+    CogOverlayFilesHandler *self = COG_OVERLAY_FILES_HANDLER (object);
+
+    if (self->rebuild_source) {
+        g_source_remove (self->rebuild_source);
+        self->rebuild_source = 0;
+    }
+
+    g_clear_pointer (&self->monitors, g_hash_table_unref);
+    g_clear_pointer (&self->index, overlay_index_unref);
+
+    G_OBJECT_CLASS (cog_overlay_files_handler_parent_class)->dispose (object);
+}
+
+
+static void
+cog_overlay_files_handler_finalize (GObject *object)
+{
+    CogOverlayFilesHandler *self = COG_OVERLAY_FILES_HANDLER (object);
+
+    g_clear_pointer (&self->layers, g_strfreev);
+
+    G_OBJECT_CLASS (cog_overlay_files_handler_parent_class)->finalize (object);
+}
+
+
+static void
+cog_overlay_files_handler_class_init (CogOverlayFilesHandlerClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    object_class->get_property = cog_overlay_files_handler_get_property;
+    object_class->set_property = cog_overlay_files_handler_set_property;
+    object_class->dispose = cog_overlay_files_handler_dispose;
+    object_class->finalize = cog_overlay_files_handler_finalize;
+
+    /**
+     * CogOverlayFilesHandler:layers:
+     *
+     * Paths to the directories from which to “serve” resources, from the
+     * bottom to the top layer.
+     */
+    s_properties[PROP_LAYERS] =
+        g_param_spec_boxed ("layers",
+                            "Layers",
+                            "Directories where to load files from, bottom layer first",
+                            G_TYPE_STRV,
+                            G_PARAM_READWRITE |
+                            G_PARAM_CONSTRUCT_ONLY |
+                            G_PARAM_STATIC_STRINGS);
+
+    g_object_class_install_properties (object_class, N_PROPERTIES, s_properties);
+}
+
+
+static void
+cog_overlay_files_handler_init (CogOverlayFilesHandler *self G_GNUC_UNUSED)
+{
+}
+
+
+/**
+ * cog_overlay_files_handler_new:
+ * @layers: (array zero-terminated=1): Paths to directories, bottom layer first.
+ * @error: Location where to store an error, if any.
+ *
+ * Creates a new handler which serves files from a stack of directories.
+ *
+ * The files in all the layers are indexed before returning.
+ *
+ * Returns: (transfer full) (nullable): A new request handler, or %NULL
+ *   if any of the layers cannot be opened.
+ */
+CogRequestHandler*
+cog_overlay_files_handler_new (const char * const *layers,
+                               GError            **error)
+{
+    g_return_val_if_fail (layers != NULL, NULL);
+    g_return_val_if_fail (!error || !*error, NULL);
+
+    return g_initable_new (COG_TYPE_OVERLAY_FILES_HANDLER,
+                           NULL,
+                           error,
+                           "layers", layers,
+                           NULL);
+}
+
+/**
+ * cog_overlay_files_handler_dup_layers:
+ * @self: a #CogOverlayFilesHandler
+ *
+ * Gets the value of the [property@Cog.OverlayFilesHandler:layers] property.
+ *
+ * Returns: (transfer full): Paths to the layers, bottom layer first.
+ */
+GStrv
+cog_overlay_files_handler_dup_layers (CogOverlayFilesHandler *self)
+{
+    g_return_val_if_fail (COG_IS_OVERLAY_FILES_HANDLER (self), NULL);
+    return g_strdupv (self->layers);
+}
+
+/**
+ * cog_overlay_files_handler_get_n_files:
+ * @self: a #CogOverlayFilesHandler
+ *
+ * Gets the number of files in the merged index of the layers.
+ *
+ * Returns: Number of files which can be served.
+ */
+unsigned
+cog_overlay_files_handler_get_n_files (CogOverlayFilesHandler *self)
+{
+    g_return_val_if_fail (COG_IS_OVERLAY_FILES_HANDLER (self), 0);
+    return self->index ? g_hash_table_size (self->index->entries) : 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * cog-overlay-files-handler.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#if !(defined(COG_INSIDE_COG__) && COG_INSIDE_COG__)
+# error "Do not include this header directly, use <cog.h> instead"
+#endif
+
+#include "cog-request-handler.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GError GError;
+
+#define COG_TYPE_OVERLAY_FILES_HANDLER  (cog_overlay_files_handler_get_type ())
+
+G_DECLARE_FINAL_TYPE (CogOverlayFilesHandler,
+                      cog_overlay_files_handler,
+                      COG, OVERLAY_FILES_HANDLER,
+                      GObject)
+
+struct _CogOverlayFilesHandlerClass {
+    GObjectClass parent_class;
+};
+
+
+CogRequestHandler* cog_overlay_files_handler_new          (const char * const     *layers,
+                                                           GError                **error);
+
+GStrv              cog_overlay_files_handler_dup_layers   (CogOverlayFilesHandler *self);
+unsigned           cog_overlay_files_handler_get_n_files  (CogOverlayFilesHandler *self);
+
+G_END_DECLS
@@ -34,6 +34,8 @@ struct _CogPlatform {
     void                      (*resize)            (CogPlatform   *platform,
                                                     const char *params);
     WebKitInputMethodContext* (*create_im_context) (CogPlatform   *platform);
+    void                      (*set_active_view)   (CogPlatform   *platform,
+                                                    WebKitWebView *view);
 };
 
 CogPlatform*
@@ -88,6 +90,8 @@ cog_platform_try_load (CogPlatform *platform,
                                      "cog_platform_plugin_resize");
     platform->create_im_context = dlsym (platform->so,
                                          "cog_platform_plugin_create_im_context");
+    platform->set_active_view = dlsym (platform->so,
+                                       "cog_platform_plugin_set_active_view");
 
     return TRUE;
 
@@ -149,3 +153,27 @@ cog_platform_create_im_context (CogPlatform *platform)
 
     return NULL;
 }
+
+/*
+ * Platform plug-ins which support presenting more than one web view
+ * implement cog_platform_plugin_set_active_view(). Each view gets its
+ * own view backend, and only the contents of the active one are shown.
+ */
+gboolean
+cog_platform_supports_multiple_views (CogPlatform *platform)
+{
+    g_return_val_if_fail (platform != NULL, FALSE);
+
+    return platform->set_active_view != NULL;
+}
+
+void
+cog_platform_set_active_view (CogPlatform   *platform,
+                              WebKitWebView *view)
+{
+    g_return_if_fail (platform != NULL);
+    g_return_if_fail (WEBKIT_IS_WEB_VIEW (view));
+
+    if (platform->set_active_view)
+        platform->set_active_view (platform, view);
+}
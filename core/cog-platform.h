@@ -58,6 +58,11 @@ void                      cog_platform_resize            (CogPlatform   *platfor
 
 WebKitInputMethodContext *cog_platform_create_im_context (CogPlatform   *platform);
 
+gboolean                  cog_platform_supports_multiple_views
+                                                         (CogPlatform   *platform);
+void                      cog_platform_set_active_view   (CogPlatform   *platform,
+                                                          WebKitWebView *view);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (CogPlatform, cog_platform_free)
 
 G_END_DECLS
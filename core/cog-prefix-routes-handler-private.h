@@ -0,0 +1,19 @@
+/*
+ * cog-prefix-routes-handler-private.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#include "cog-prefix-routes-handler.h"
+
+G_BEGIN_DECLS
+
+G_GNUC_INTERNAL
+CogRequestHandler* cog_prefix_routes_handler_lookup (CogPrefixRoutesHandler *self,
+                                                     const char             *path,
+                                                     size_t                 *prefix_len);
+
+G_END_DECLS
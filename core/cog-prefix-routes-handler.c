@@ -6,7 +6,9 @@
  */
 
 #include "cog-prefix-routes-handler.h"
+#include "cog-prefix-routes-handler-private.h"
 #include "cog-directory-files-handler.h"
+#include <string.h>
 
 /**
  * CogPrefixRoutesHandler:
@@ -26,6 +28,13 @@
  * are checked and the one that matches the most URI *path* components
  * will handle the request.
  *
+ * Routes can be safely modified at any time, from any thread: changes
+ * create a new version of the route table, which then replaces the one
+ * used to dispatch requests without blocking them. Requests being
+ * dispatched keep using the table they started with, and never observe
+ * partially applied changes. Replaced tables are released from the main
+ * loop.
+ *
  * This handler is typically used in tandem with
  * [class@Cog.DirectoryFilesHandler], the latter being typically a
  * fallback, or as the handler for a routed prefix.
@@ -53,13 +62,310 @@
  * ```
  */
 
+/*
+ * Routes are stored in a compressed radix tree (also known as Patricia
+ * trie) keyed by the bytes of the path prefixes. Each edge is labeled
+ * with the non-empty sequence of bytes leading to a node, and children
+ * are kept sorted by the first byte of their labels. The root node has
+ * an empty label and corresponds to the empty prefix.
+ *
+ * Finding the longest configured prefix for a path is a single walk
+ * down the tree, which does not need to allocate memory.
+ *
+ * Nodes are immutable once they are part of a published tree, and are
+ * reference counted so they can be shared among versions of the tree.
+ * Modifications copy only the nodes along the path to the changed one,
+ * and reuse the rest.
+ */
+typedef struct _RouteNode RouteNode;
+
+struct _RouteNode {
+    int                ref_count; /* (atomic) */
+    char              *label;
+    size_t             label_len;
+    CogRequestHandler *handler;   /* (nullable) */
+    GPtrArray         *children;  /* (nullable) (element-type RouteNode) */
+};
+
+
+static RouteNode*
+route_node_new (const char        *label,
+                size_t             label_len,
+                CogRequestHandler *handler)
+{
+    RouteNode *node = g_slice_new0 (RouteNode);
+    node->ref_count = 1;
+    node->label = g_strndup (label, label_len);
+    node->label_len = label_len;
+    node->handler = handler ? g_object_ref (handler) : NULL;
+    return node;
+}
+
+
+static RouteNode*
+route_node_ref (RouteNode *node)
+{
+    g_atomic_int_inc (&node->ref_count);
+    return node;
+}
+
+
+static void
+route_node_unref (void *pointer)
+{
+    RouteNode *node = pointer;
+    if (g_atomic_int_dec_and_test (&node->ref_count)) {
+        g_clear_pointer (&node->children, g_ptr_array_unref);
+        g_clear_object (&node->handler);
+        g_free (node->label);
+        g_slice_free (RouteNode, node);
+    }
+}
+
+
+static void
+route_node_add_child (RouteNode *node,
+                      unsigned   index,
+                      RouteNode *child)
+{
+    if (!node->children)
+        node->children = g_ptr_array_new_with_free_func (route_node_unref);
+    g_ptr_array_insert (node->children, index, child);
+}
+
+
+/*
+ * Creates a node with a new label, sharing the handler and the children
+ * of another one.
+ */
+static RouteNode*
+route_node_relabel (const RouteNode *node,
+                    const char      *label,
+                    size_t           label_len)
+{
+    RouteNode *copy = route_node_new (label, label_len, node->handler);
+    if (node->children) {
+        for (unsigned i = 0; i < node->children->len; i++)
+            route_node_add_child (copy, i, route_node_ref (g_ptr_array_index (node->children, i)));
+    }
+    return copy;
+}
+
+
+static inline RouteNode*
+route_node_copy (const RouteNode *node)
+{
+    return route_node_relabel (node, node->label, node->label_len);
+}
+
+
+static void
+route_node_set_child (RouteNode *node,
+                      unsigned   index,
+                      RouteNode *child)
+{
+    route_node_unref (node->children->pdata[index]);
+    node->children->pdata[index] = child;
+}
+
+
+/*
+ * Finds the child whose label starts with a given byte. When there is
+ * none, "index" is set to the position where it would be inserted.
+ */
+static RouteNode*
+route_node_find_child (const RouteNode *node,
+                       char             first,
+                       unsigned        *index)
+{
+    unsigned lo = 0, hi = node->children ? node->children->len : 0;
+    while (lo < hi) {
+        unsigned mid = lo + (hi - lo) / 2;
+        RouteNode *child = g_ptr_array_index (node->children, mid);
+        if ((guchar) child->label[0] < (guchar) first) {
+            lo = mid + 1;
+        } else if ((guchar) child->label[0] > (guchar) first) {
+            hi = mid;
+        } else {
+            if (index)
+                *index = mid;
+            return child;
+        }
+    }
+    if (index)
+        *index = lo;
+    return NULL;
+}
+
+
+/*
+ * Returns a new version of "node" with a route for "key" added, or NULL
+ * if there already is one.
+ */
+static RouteNode*
+route_node_insert (const RouteNode   *node,
+                   const char        *key,
+                   CogRequestHandler *handler)
+{
+    if (key[0] == '\0') {
+        if (node->handler)
+            return NULL;
+        RouteNode *copy = route_node_copy (node);
+        copy->handler = g_object_ref (handler);
+        return copy;
+    }
+
+    unsigned index;
+    RouteNode *child = route_node_find_child (node, key[0], &index);
+    if (!child) {
+        RouteNode *copy = route_node_copy (node);
+        route_node_add_child (copy, index, route_node_new (key, strlen (key), handler));
+        return copy;
+    }
+
+    size_t common = 0;
+    while (common < child->label_len && key[common] == child->label[common])
+        common++;
+
+    RouteNode *new_child;
+    if (common < child->label_len) {
+        /* Split the edge, adding a node for the common part. */
+        RouteNode *middle = route_node_new (child->label, common, NULL);
+        route_node_add_child (middle, 0, route_node_relabel (child,
+                                                             child->label + common,
+                                                             child->label_len - common));
+        new_child = route_node_insert (middle, key + common, handler);
+        route_node_unref (middle);
+    } else {
+        new_child = route_node_insert (child, key + common, handler);
+    }
+
+    if (!new_child)
+        return NULL;
+
+    RouteNode *copy = route_node_copy (node);
+    route_node_set_child (copy, index, new_child);
+    return copy;
+}
+
+
+/*
+ * Returns a new version of "node" with the route for "key" removed, or
+ * NULL if there is no such route.
+ */
+static RouteNode*
+route_node_remove (const RouteNode *node,
+                   const char      *key)
+{
+    if (key[0] == '\0') {
+        if (!node->handler)
+            return NULL;
+        RouteNode *copy = route_node_copy (node);
+        g_clear_object (&copy->handler);
+        return copy;
+    }
+
+    unsigned index;
+    RouteNode *child = route_node_find_child (node, key[0], &index);
+    if (!child || strncmp (key, child->label, child->label_len) != 0)
+        return NULL;
+
+    RouteNode *new_child = route_node_remove (child, key + child->label_len);
+    if (!new_child)
+        return NULL;
+
+    RouteNode *copy = route_node_copy (node);
+
+    /*
+     * Keep the tree compressed: remove nodes which lead nowhere, and merge
+     * nodes without a handler into their only child.
+     */
+    unsigned n_children = new_child->children ? new_child->children->len : 0;
+    if (!new_child->handler && n_children == 0) {
+        g_ptr_array_remove_index (copy->children, index);
+        route_node_unref (new_child);
+    } else if (!new_child->handler && n_children == 1) {
+        RouteNode *grandchild = g_ptr_array_index (new_child->children, 0);
+        g_autofree char *label = g_strconcat (new_child->label, grandchild->label, NULL);
+        route_node_set_child (copy, index, route_node_relabel (grandchild, label, strlen (label)));
+        route_node_unref (new_child);
+    } else {
+        route_node_set_child (copy, index, new_child);
+    }
+
+    return copy;
+}
+
+
+/*
+ * Finds the handler for the longest non-empty prefix of "path" which is
+ * followed by a slash.
+ */
+static CogRequestHandler*
+route_node_lookup (const RouteNode *node,
+                   const char      *path,
+                   size_t          *prefix_len)
+{
+    CogRequestHandler *handler = NULL;
+    size_t pos = 0;
+
+    for (;;) {
+        if (node->handler && pos > 0 && path[pos] == '/') {
+            handler = node->handler;
+            *prefix_len = pos;
+        }
+
+        if (path[pos] == '\0')
+            break;
+
+        node = route_node_find_child (node, path[pos], NULL);
+        if (!node || strncmp (path + pos, node->label, node->label_len) != 0)
+            break;
+
+        pos += node->label_len;
+    }
+
+    return handler;
+}
+
+
 struct _CogPrefixRoutesHandler {
     GObject parent;
 
     CogRequestHandler *fallback;
-    GHashTable        *routes;  /* string -> CogRequestHandler */
+
+    /*
+     * Root of the current version of the routes tree, which is replaced
+     * with an atomic pointer swap and read without taking any lock.
+     * Requests are dispatched from the main thread, which is also where
+     * replaced versions get released from an idle callback: by then any
+     * lookup which may have used them has already finished. Modifications
+     * are serialized with "update_lock", which is not needed for
+     * dispatching requests.
+     */
+    RouteNode         *routes;  /* (atomic) */
+    GMutex             update_lock;
 };
 
+
+static gboolean
+on_retired_routes_idle (void *routes)
+{
+    route_node_unref (routes);
+    return G_SOURCE_REMOVE;
+}
+
+
+static void
+cog_prefix_routes_handler_publish_routes (CogPrefixRoutesHandler *self,
+                                          RouteNode              *routes)
+{
+    RouteNode *old_routes = g_atomic_pointer_get (&self->routes);
+    g_atomic_pointer_set (&self->routes, routes);
+
+    g_idle_add (on_retired_routes_idle, old_routes);
+}
+
 enum {
     PROP_0,
     PROP_FALLBACK_HANDLER,
@@ -70,6 +376,27 @@ static GParamSpec *s_properties[N_PROPERTIES] = { NULL, };
 
 
 
+/*
+ * Finds the handler for the route matching a URI path, without running
+ * it. Used by the unit tests.
+ */
+CogRequestHandler*
+cog_prefix_routes_handler_lookup (CogPrefixRoutesHandler *self,
+                                  const char             *path,
+                                  size_t                 *prefix_len)
+{
+    g_return_val_if_fail (COG_IS_PREFIX_ROUTES_HANDLER (self), NULL);
+    g_return_val_if_fail (path != NULL, NULL);
+
+    size_t len = 0;
+    CogRequestHandler *handler =
+        route_node_lookup (g_atomic_pointer_get (&self->routes), path, &len);
+    if (prefix_len)
+        *prefix_len = len;
+    return handler ? g_object_ref (handler) : NULL;
+}
+
+
 static void
 cog_prefix_routes_handler_run_fallback (CogPrefixRoutesHandler *self,
                                         WebKitURISchemeRequest *request)
@@ -85,7 +412,7 @@ cog_prefix_routes_handler_run_fallback (CogPrefixRoutesHandler *self,
                          G_FILE_ERROR_NOENT,
                          "No file for URI path: %s",
                          webkit_uri_scheme_request_get_path (request));
-        webkit_uri_scheme_request_finish_error (request, error);
+        cog_request_finish_error (request, error);
     }
 }
 
@@ -104,27 +431,13 @@ cog_prefix_routes_handler_run (CogRequestHandler      *request_handler,
      * Try to find the longest path (up to a slash) for which there
      * is a route configured.
      */
-    g_autoptr(GString) prefix = g_string_new (uri_path);
-
-    while (prefix->len > 1) {
-        /* Find the position of the latest slash. */
-        size_t last_slash_pos = prefix->len - 1;
-        while (prefix->str[last_slash_pos] != '/' && last_slash_pos > 0)
-            --last_slash_pos;
-
-        /* Position 0 is always the leading slash. */
-        if (last_slash_pos == 0)
-            break;
-
-        g_string_erase (prefix, last_slash_pos, -1);
-
-        CogRequestHandler *handler =
-            g_hash_table_lookup (self->routes, prefix->str);
-        if (handler) {
-            g_debug ("Chosen route '%s' for URI '%s'", prefix->str,
-                     webkit_uri_scheme_request_get_uri (request));
-            return cog_request_handler_run (handler, request);
-        }
+    size_t prefix_len = 0;
+    CogRequestHandler *handler =
+        route_node_lookup (g_atomic_pointer_get (&self->routes), uri_path, &prefix_len);
+    if (handler) {
+        g_debug ("Chosen route '%.*s' for URI '%s'", (int) prefix_len, uri_path,
+                 webkit_uri_scheme_request_get_uri (request));
+        return cog_request_handler_run (handler, request);
     }
 
     cog_prefix_routes_handler_run_fallback (self, request);
@@ -185,15 +498,24 @@ cog_prefix_routes_handler_dispose (GObject *object)
 {
     CogPrefixRoutesHandler *self = COG_PREFIX_ROUTES_HANDLER (object);
 
-    g_hash_table_remove_all (self->routes);
-    g_clear_pointer (&self->routes, g_hash_table_unref);
-
     g_clear_object (&self->fallback);
 
     G_OBJECT_CLASS (cog_prefix_routes_handler_parent_class)->dispose (object);
 }
 
 
+static void
+cog_prefix_routes_handler_finalize (GObject *object)
+{
+    CogPrefixRoutesHandler *self = COG_PREFIX_ROUTES_HANDLER (object);
+
+    g_clear_pointer (&self->routes, route_node_unref);
+    g_mutex_clear (&self->update_lock);
+
+    G_OBJECT_CLASS (cog_prefix_routes_handler_parent_class)->finalize (object);
+}
+
+
 static void
 cog_prefix_routes_handler_class_init (CogPrefixRoutesHandlerClass *klass)
 {
@@ -201,6 +523,7 @@ cog_prefix_routes_handler_class_init (CogPrefixRoutesHandlerClass *klass)
     object_class->get_property = cog_prefix_routes_handler_get_property;
     object_class->set_property = cog_prefix_routes_handler_set_property;
     object_class->dispose = cog_prefix_routes_handler_dispose;
+    object_class->finalize = cog_prefix_routes_handler_finalize;
 
     /**
      * CogPrefixRoutesHandler:fallback-handler:
@@ -224,10 +547,8 @@ cog_prefix_routes_handler_class_init (CogPrefixRoutesHandlerClass *klass)
 static void
 cog_prefix_routes_handler_init (CogPrefixRoutesHandler *self)
 {
-    self->routes = g_hash_table_new_full (g_str_hash,
-                                          g_str_equal,
-                                          g_free,
-                                          g_object_unref);
+    g_mutex_init (&self->update_lock);
+    self->routes = route_node_new ("", 0, NULL);
 }
 
 /**
@@ -271,13 +592,14 @@ cog_prefix_routes_handler_mount (CogPrefixRoutesHandler *self,
     g_return_val_if_fail (path_prefix[0] == '/', FALSE);
     g_return_val_if_fail (COG_IS_REQUEST_HANDLER (handler), FALSE);
 
-    if (g_hash_table_contains (self->routes, path_prefix))
-        return FALSE;
+    g_mutex_lock (&self->update_lock);
+
+    RouteNode *routes = route_node_insert (g_atomic_pointer_get (&self->routes), path_prefix, handler);
+    if (routes)
+        cog_prefix_routes_handler_publish_routes (self, routes);
 
-    g_hash_table_insert (self->routes,
-                         g_strdup (path_prefix),
-                         g_object_ref (handler));
-    return TRUE;
+    g_mutex_unlock (&self->update_lock);
+    return routes != NULL;
 }
 
 /**
@@ -301,7 +623,14 @@ cog_prefix_routes_handler_unmount (CogPrefixRoutesHandler *self,
     g_return_val_if_fail (path_prefix != NULL, FALSE);
     g_return_val_if_fail (path_prefix[0] == '/', FALSE);
 
-    return g_hash_table_remove (self->routes, path_prefix);
+    g_mutex_lock (&self->update_lock);
+
+    RouteNode *routes = route_node_remove (g_atomic_pointer_get (&self->routes), path_prefix);
+    if (routes)
+        cog_prefix_routes_handler_publish_routes (self, routes);
+
+    g_mutex_unlock (&self->update_lock);
+    return routes != NULL;
 }
 
 /**
@@ -6,6 +6,7 @@
  */
 
 #include "cog-request-handler.h"
+#include <gio/gio.h>
 
 /**
  * CogRequestHandler:
@@ -24,8 +25,20 @@
  *
  * ### Implementations
  *
+ * - [class@Cog.BundleFilesHandler]
  * - [class@Cog.DirectoryFilesHandler]
+ * - [class@Cog.OverlayFilesHandler]
  * - [class@Cog.PrefixRoutesHandler]
+ * - [class@Cog.SocketProxyHandler]
+ * - [class@Cog.ThreadedRequestHandler] (abstract)
+ *
+ * ### Finishing requests
+ *
+ * Handlers should answer requests using [func@Cog.request_finish] and
+ * related functions instead of the `webkit_uri_scheme_request_finish*()`
+ * ones. This lets other parts of the program, like the middlewares applied
+ * using [func@Cog.request_handler_wrap] and the statistics provided by
+ * [method@Cog.Shell.get_request_stats], observe the responses.
  */
 
 G_DEFINE_INTERFACE (CogRequestHandler, cog_request_handler, G_TYPE_OBJECT);
@@ -51,3 +64,282 @@ cog_request_handler_run (CogRequestHandler *handler, WebKitURISchemeRequest *req
     g_return_if_fail (iface->run != NULL);
     (*iface->run) (handler, request);
 }
+
+
+/*
+ * Finished callbacks are kept in an array shared by all requests instead
+ * of being attached to each of them, which would need allocating memory
+ * for every request. Requests are dispatched and finished in the main
+ * thread, so the array does not need locking.
+ *
+ * Each entry keeps a reference to its request, so the address of a request
+ * which still has callbacks cannot be reused by a new one. Entries of
+ * requests finished without using cog_request_finish() and related
+ * functions are released once only the entries keep their request alive,
+ * see finished_callbacks_sweep().
+ */
+typedef struct {
+    WebKitURISchemeRequest *request;
+    CogRequestFinishedFunc  callback;
+    void                   *user_data;
+    GDestroyNotify          destroy_notify;
+    gint64                  start_time;
+} FinishedCallback;
+
+#define FINISHED_CALLBACKS_SWEEP_MIN 64
+
+static GArray  *s_finished_callbacks = NULL;  /* (element-type FinishedCallback) */
+static unsigned s_finished_callbacks_sweep_at = FINISHED_CALLBACKS_SWEEP_MIN;
+
+
+static void
+finished_callback_clear (FinishedCallback *item)
+{
+    if (item->destroy_notify)
+        (*item->destroy_notify) (item->user_data);
+    g_object_unref (item->request);
+}
+
+
+static gboolean
+finished_callbacks_take_last (WebKitURISchemeRequest *request,
+                              FinishedCallback       *item)
+{
+    for (unsigned i = s_finished_callbacks ? s_finished_callbacks->len : 0; i > 0; i--) {
+        if (g_array_index (s_finished_callbacks, FinishedCallback, i - 1).request == request) {
+            *item = g_array_index (s_finished_callbacks, FinishedCallback, i - 1);
+            g_array_remove_index (s_finished_callbacks, i - 1);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+
+static unsigned
+finished_callbacks_count (WebKitURISchemeRequest *request)
+{
+    unsigned count = 0;
+    for (unsigned i = 0; i < s_finished_callbacks->len; i++) {
+        if (g_array_index (s_finished_callbacks, FinishedCallback, i).request == request)
+            count++;
+    }
+    return count;
+}
+
+
+/*
+ * Releases the callbacks of requests which are only kept alive by their
+ * entries in the array, meaning that WebKit is done with them. This is
+ * done each time the array doubles its size, to keep it bounded when
+ * requests are finished without notifying the callbacks.
+ */
+static void
+finished_callbacks_sweep (void)
+{
+    unsigned i = 0;
+    while (i < s_finished_callbacks->len) {
+        FinishedCallback *item = &g_array_index (s_finished_callbacks, FinishedCallback, i);
+        if (g_atomic_int_get (&G_OBJECT (item->request)->ref_count) > finished_callbacks_count (item->request)) {
+            i++;
+            continue;
+        }
+
+        FinishedCallback stale = *item;
+        g_array_remove_index (s_finished_callbacks, i);
+        finished_callback_clear (&stale);
+    }
+
+    s_finished_callbacks_sweep_at = MAX (FINISHED_CALLBACKS_SWEEP_MIN, 2 * s_finished_callbacks->len);
+}
+
+
+/**
+ * cog_request_add_finished_callback:
+ * @request: A request which has not been finished yet.
+ * @callback: (scope notified): Function to call when the request finishes.
+ * @user_data: User data passed to @callback.
+ * @destroy_notify: (nullable): Function used to release @user_data.
+ *
+ * Arranges for @callback to be called when @request gets finished using
+ * one of the [func@Cog.request_finish] family of functions. Callbacks are
+ * invoked in the reverse order they were added, right before the response
+ * is passed to WebKit; this way a middleware which registers a callback
+ * before running the next handler sees the responses after the handlers
+ * nested inside it.
+ *
+ * The time at which the callback is added is passed back to it in the
+ * `start_time` field of the [struct@Cog.RequestResult], which allows
+ * measuring how long the request took without allocating memory for
+ * keeping track of it.
+ *
+ * Callbacks are stored without allocating memory for each request. If
+ * @request gets finished directly with
+ * [method@WebKit.URISchemeRequest.finish] or related functions, @callback
+ * is never called, and @user_data is released at some point after WebKit
+ * has released the request.
+ */
+void
+cog_request_add_finished_callback (WebKitURISchemeRequest *request,
+                                   CogRequestFinishedFunc  callback,
+                                   void                   *user_data,
+                                   GDestroyNotify          destroy_notify)
+{
+    g_return_if_fail (WEBKIT_IS_URI_SCHEME_REQUEST (request));
+    g_return_if_fail (callback != NULL);
+
+    if (G_UNLIKELY (!s_finished_callbacks)) {
+        s_finished_callbacks = g_array_sized_new (FALSE, FALSE, sizeof (FinishedCallback),
+                                                  FINISHED_CALLBACKS_SWEEP_MIN);
+    } else if (s_finished_callbacks->len >= s_finished_callbacks_sweep_at) {
+        finished_callbacks_sweep ();
+    }
+
+    const FinishedCallback item = {
+        .request = g_object_ref (request),
+        .callback = callback,
+        .user_data = user_data,
+        .destroy_notify = destroy_notify,
+        .start_time = g_get_monotonic_time (),
+    };
+    g_array_append_val (s_finished_callbacks, item);
+}
+
+
+static void
+cog_request_notify_finished (WebKitURISchemeRequest *request,
+                             const CogRequestResult *result)
+{
+    /*
+     * Entries are taken out one at a time before invoking each callback,
+     * which may finish other requests or add callbacks.
+     */
+    FinishedCallback item;
+    while (finished_callbacks_take_last (request, &item)) {
+        CogRequestResult item_result = *result;
+        item_result.start_time = item.start_time;
+        (*item.callback) (request, &item_result, item.user_data);
+        finished_callback_clear (&item);
+    }
+}
+
+
+/**
+ * cog_request_finish:
+ * @request: A request to finish.
+ * @stream: Input stream to read the response body from.
+ * @length: Length of the response body, or `-1` if unknown.
+ * @mime_type: (nullable): MIME type of the response body.
+ *
+ * Finishes a request, in the same way as
+ * [method@WebKit.URISchemeRequest.finish], invoking the callbacks added
+ * with [func@Cog.request_add_finished_callback] first.
+ */
+void
+cog_request_finish (WebKitURISchemeRequest *request,
+                    GInputStream           *stream,
+                    gint64                  length,
+                    const char             *mime_type)
+{
+    g_return_if_fail (WEBKIT_IS_URI_SCHEME_REQUEST (request));
+    g_return_if_fail (G_IS_INPUT_STREAM (stream));
+
+    const CogRequestResult result = {
+        .status = SOUP_STATUS_OK,
+        .length = length,
+        .mime_type = mime_type,
+    };
+    cog_request_notify_finished (request, &result);
+    webkit_uri_scheme_request_finish (request, stream, length, mime_type);
+}
+
+
+/**
+ * cog_request_finish_bytes:
+ * @request: A request to finish.
+ * @contents: Response body.
+ * @mime_type: (nullable): MIME type of the response body.
+ *
+ * Finishes a request with a response body which is already in memory.
+ * Callbacks added with [func@Cog.request_add_finished_callback] receive
+ * the @contents, which allows them to keep a reference to the data.
+ */
+void
+cog_request_finish_bytes (WebKitURISchemeRequest *request,
+                          GBytes                 *contents,
+                          const char             *mime_type)
+{
+    g_return_if_fail (WEBKIT_IS_URI_SCHEME_REQUEST (request));
+    g_return_if_fail (contents != NULL);
+
+    const CogRequestResult result = {
+        .status = SOUP_STATUS_OK,
+        .length = g_bytes_get_size (contents),
+        .mime_type = mime_type,
+        .contents = contents,
+    };
+    cog_request_notify_finished (request, &result);
+
+    g_autoptr(GInputStream) stream = g_memory_input_stream_new_from_bytes (contents);
+    webkit_uri_scheme_request_finish (request, stream, result.length, mime_type);
+}
+
+
+/**
+ * cog_request_finish_error:
+ * @request: A request to finish.
+ * @error: Error to report.
+ *
+ * Finishes a request with an error, in the same way as
+ * [method@WebKit.URISchemeRequest.finish_error], invoking the callbacks
+ * added with [func@Cog.request_add_finished_callback] first.
+ */
+void
+cog_request_finish_error (WebKitURISchemeRequest *request,
+                          GError                 *error)
+{
+    g_return_if_fail (WEBKIT_IS_URI_SCHEME_REQUEST (request));
+    g_return_if_fail (error != NULL);
+
+    const CogRequestResult result = {
+        .error = error,
+        .length = -1,
+    };
+    cog_request_notify_finished (request, &result);
+    webkit_uri_scheme_request_finish_error (request, error);
+}
+
+
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+/**
+ * cog_request_finish_with_response:
+ * @request: A request to finish.
+ * @response: Response to pass to WebKit.
+ * @status: HTTP status code of the @response.
+ * @length: Length of the response body, or `-1` if unknown.
+ * @mime_type: (nullable): MIME type of the response body.
+ *
+ * Finishes a request in the same way as
+ * [method@WebKit.URISchemeRequest.finish_with_response]. As responses do
+ * not allow retrieving their attributes, the values passed to the callbacks
+ * added with [func@Cog.request_add_finished_callback] need to be provided.
+ */
+void
+cog_request_finish_with_response (WebKitURISchemeRequest  *request,
+                                  WebKitURISchemeResponse *response,
+                                  unsigned                 status,
+                                  gint64                   length,
+                                  const char              *mime_type)
+{
+    g_return_if_fail (WEBKIT_IS_URI_SCHEME_REQUEST (request));
+    g_return_if_fail (WEBKIT_IS_URI_SCHEME_RESPONSE (response));
+
+    const CogRequestResult result = {
+        .status = status,
+        .length = length,
+        .mime_type = mime_type,
+    };
+    cog_request_notify_finished (request, &result);
+    webkit_uri_scheme_request_finish_with_response (request, response);
+}
+#endif /* WEBKIT_CHECK_VERSION */
@@ -31,6 +31,63 @@ struct _CogRequestHandlerInterface {
 void cog_request_handler_run (CogRequestHandler *handler, WebKitURISchemeRequest *request);
 
 
+/**
+ * CogRequestResult:
+ * @error: (nullable): Error the request was finished with, if any.
+ * @status: HTTP status code of the response.
+ * @length: Length of the response body, or `-1` if unknown.
+ * @mime_type: (nullable): MIME type of the response body.
+ * @contents: (nullable): Response body, when it is known in advance.
+ * @start_time: Monotonic time, in microseconds, at which the callback
+ *   receiving the result was added to the request.
+ *
+ * Describes how a custom URI scheme request was finished.
+ */
+typedef struct {
+    const GError *error;
+    unsigned      status;
+    gint64        length;
+    const char   *mime_type;
+    GBytes       *contents;
+    gint64        start_time;
+} CogRequestResult;
+
+/**
+ * CogRequestFinishedFunc:
+ * @request: The request which has been finished.
+ * @result: Description of the response.
+ * @user_data: User data passed to [func@Cog.request_add_finished_callback].
+ *
+ * Type of the callbacks invoked when a request is finished.
+ */
+typedef void (*CogRequestFinishedFunc) (WebKitURISchemeRequest *request,
+                                        const CogRequestResult *result,
+                                        void                   *user_data);
+
+void cog_request_add_finished_callback (WebKitURISchemeRequest *request,
+                                        CogRequestFinishedFunc  callback,
+                                        void                   *user_data,
+                                        GDestroyNotify          destroy_notify);
+
+void cog_request_finish                (WebKitURISchemeRequest *request,
+                                        GInputStream           *stream,
+                                        gint64                  length,
+                                        const char             *mime_type);
+void cog_request_finish_bytes          (WebKitURISchemeRequest *request,
+                                        GBytes                 *contents,
+                                        const char             *mime_type);
+void cog_request_finish_error          (WebKitURISchemeRequest *request,
+                                        GError                 *error);
+
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+void cog_request_finish_with_response  (WebKitURISchemeRequest *request,
+                                        WebKitURISchemeResponse *response,
+                                        unsigned                status,
+                                        gint64                  length,
+                                        const char             *mime_type);
+#endif /* WEBKIT_CHECK_VERSION */
+
+
 G_END_DECLS
 
 #endif /* !COG_REQUEST_HANDLER_H */
@@ -0,0 +1,159 @@
+/*
+ * cog-request-middleware.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "cog-request-middleware.h"
+
+/**
+ * CogRequestMiddleware:
+ *
+ * Interface for objects which process requests before and after a
+ * [iface@Cog.RequestHandler].
+ *
+ * A middleware receives each request along with the next handler in the
+ * chain, and decides whether to pass the request along (possibly after
+ * registering a callback with [func@Cog.request_add_finished_callback] to
+ * observe the response), or to answer the request by itself.
+ *
+ * Middlewares are applied to handlers using [func@Cog.request_handler_wrap],
+ * and wrapped handlers can be wrapped again, which allows composing them:
+ *
+ * ```c
+ * g_autoptr(CogRequestHandler) files = cog_directory_files_handler_new (dir);
+ * g_autoptr(CogRequestMiddleware) cache = cog_cache_middleware_new ();
+ * g_autoptr(CogRequestMiddleware) latency = cog_latency_middleware_new ();
+ *
+ * g_autoptr(CogRequestHandler) cached = cog_request_handler_wrap (files, cache);
+ * g_autoptr(CogRequestHandler) measured = cog_request_handler_wrap (cached, latency);
+ *
+ * cog_prefix_routes_handler_mount (routes, "/static", measured);
+ * ```
+ *
+ * Middlewares which are disabled are expected to pass requests to the
+ * next handler directly, without allocating any memory.
+ *
+ * ### Implementations
+ *
+ * - [class@Cog.AccessLogMiddleware]
+ * - [class@Cog.CacheMiddleware]
+ * - [class@Cog.LatencyMiddleware]
+ */
+
+G_DEFINE_INTERFACE (CogRequestMiddleware, cog_request_middleware, G_TYPE_OBJECT);
+
+static void
+cog_request_middleware_default_init (CogRequestMiddlewareInterface *iface)
+{
+}
+
+/**
+ * cog_request_middleware_run: (virtual run)
+ * @request: A request to handle.
+ * @next: Handler to pass the request to.
+ *
+ * Process a single custom URI scheme request.
+ */
+void
+cog_request_middleware_run (CogRequestMiddleware   *middleware,
+                            WebKitURISchemeRequest *request,
+                            CogRequestHandler      *next)
+{
+    g_return_if_fail (COG_IS_REQUEST_MIDDLEWARE (middleware));
+    g_return_if_fail (WEBKIT_IS_URI_SCHEME_REQUEST (request));
+    g_return_if_fail (COG_IS_REQUEST_HANDLER (next));
+
+    CogRequestMiddlewareInterface *iface = COG_REQUEST_MIDDLEWARE_GET_IFACE (middleware);
+    g_return_if_fail (iface->run != NULL);
+    (*iface->run) (middleware, request, next);
+}
+
+
+#define COG_TYPE_WRAPPED_REQUEST_HANDLER  (cog_wrapped_request_handler_get_type ())
+
+G_DECLARE_FINAL_TYPE (CogWrappedRequestHandler,
+                      cog_wrapped_request_handler,
+                      COG, WRAPPED_REQUEST_HANDLER,
+                      GObject)
+
+struct _CogWrappedRequestHandler {
+    GObject parent;
+
+    CogRequestHandler    *handler;
+    CogRequestMiddleware *middleware;
+};
+
+
+static void
+cog_wrapped_request_handler_run (CogRequestHandler      *request_handler,
+                                 WebKitURISchemeRequest *request)
+{
+    CogWrappedRequestHandler *self = COG_WRAPPED_REQUEST_HANDLER (request_handler);
+    cog_request_middleware_run (self->middleware, request, self->handler);
+}
+
+
+static void
+cog_wrapped_request_handler_iface_init (CogRequestHandlerInterface *iface)
+{
+    iface->run = cog_wrapped_request_handler_run;
+}
+
+
+G_DEFINE_TYPE_WITH_CODE (CogWrappedRequestHandler,
+                         cog_wrapped_request_handler,
+                         G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (COG_TYPE_REQUEST_HANDLER,
+                                                cog_wrapped_request_handler_iface_init))
+
+
+static void
+cog_wrapped_request_handler_dispose (GObject *object)
+{
+    CogWrappedRequestHandler *self = COG_WRAPPED_REQUEST_HANDLER (object);
+
+    g_clear_object (&self->handler);
+    g_clear_object (&self->middleware);
+
+    G_OBJECT_CLASS (cog_wrapped_request_handler_parent_class)->dispose (object);
+}
+
+
+static void
+cog_wrapped_request_handler_class_init (CogWrappedRequestHandlerClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    object_class->dispose = cog_wrapped_request_handler_dispose;
+}
+
+
+static void
+cog_wrapped_request_handler_init (CogWrappedRequestHandler *self G_GNUC_UNUSED)
+{
+}
+
+
+/**
+ * cog_request_handler_wrap:
+ * @handler: Request handler to wrap.
+ * @middleware: Middleware to apply.
+ *
+ * Creates a request handler which passes each request to @middleware,
+ * using @handler as the next handler in the chain.
+ *
+ * Returns: (transfer full): A new request handler.
+ */
+CogRequestHandler*
+cog_request_handler_wrap (CogRequestHandler    *handler,
+                          CogRequestMiddleware *middleware)
+{
+    g_return_val_if_fail (COG_IS_REQUEST_HANDLER (handler), NULL);
+    g_return_val_if_fail (COG_IS_REQUEST_MIDDLEWARE (middleware), NULL);
+
+    CogWrappedRequestHandler *self = g_object_new (COG_TYPE_WRAPPED_REQUEST_HANDLER, NULL);
+    self->handler = g_object_ref (handler);
+    self->middleware = g_object_ref (middleware);
+    return COG_REQUEST_HANDLER (self);
+}
@@ -0,0 +1,39 @@
+/*
+ * cog-request-middleware.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#if !(defined(COG_INSIDE_COG__) && COG_INSIDE_COG__)
+# error "Do not include this header directly, use <cog.h> instead"
+#endif
+
+#include "cog-request-handler.h"
+
+G_BEGIN_DECLS
+
+#define COG_TYPE_REQUEST_MIDDLEWARE  (cog_request_middleware_get_type ())
+
+G_DECLARE_INTERFACE (CogRequestMiddleware, cog_request_middleware, COG, REQUEST_MIDDLEWARE, GObject)
+
+struct _CogRequestMiddlewareInterface {
+    GTypeInterface g_iface;
+
+    /*< public >*/
+    void (*run) (CogRequestMiddleware   *middleware,
+                 WebKitURISchemeRequest *request,
+                 CogRequestHandler      *next);
+};
+
+
+void               cog_request_middleware_run (CogRequestMiddleware   *middleware,
+                                               WebKitURISchemeRequest *request,
+                                               CogRequestHandler      *next);
+
+CogRequestHandler* cog_request_handler_wrap   (CogRequestHandler      *handler,
+                                               CogRequestMiddleware   *middleware);
+
+G_END_DECLS
@@ -0,0 +1,142 @@
+/*
+ * cog-request-stats.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "cog-request-stats.h"
+
+/*
+ * Statistics about the requests handled for a custom URI scheme, see
+ * cog_shell_get_request_stats().
+ *
+ * Request latencies are recorded in a log-linear histogram: buckets for
+ * each power of two of microseconds are split in four linear sub-buckets,
+ * which keeps the relative error under 25% while covering from one
+ * microsecond up to about two minutes with a small, fixed amount of memory.
+ *
+ * Counters are updated with relaxed atomic operations, which do not need
+ * any locking or allocation, so recording a request costs a few additions
+ * and statistics can be read at any time from any thread. A snapshot may
+ * mix values from before and after a request being recorded.
+ */
+#define LATENCY_SUB_BUCKET_BITS  2
+#define LATENCY_SUB_BUCKETS      (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_N_BUCKETS        (LATENCY_SUB_BUCKETS * 26)
+
+#define counter_add(counter, value) \
+    ((void) __atomic_fetch_add (&(counter), (value), __ATOMIC_RELAXED))
+#define counter_get(counter) \
+    (__atomic_load_n (&(counter), __ATOMIC_RELAXED))
+
+struct _CogRequestStats {
+    int     ref_count;  /* (atomic) */
+    guint64 requests;
+    guint64 errors;
+    guint64 bytes;
+    guint64 total_time; /* Microseconds. */
+    guint64 latency[LATENCY_N_BUCKETS];
+};
+
+
+unsigned
+cog_request_stats_latency_bucket (guint64 usec)
+{
+    if (usec < LATENCY_SUB_BUCKETS)
+        return usec;
+
+    const unsigned exponent = g_bit_storage (usec) - 1;
+    const unsigned sub_bucket = (usec >> (exponent - LATENCY_SUB_BUCKET_BITS)) & (LATENCY_SUB_BUCKETS - 1);
+    const unsigned index = (exponent - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS + sub_bucket;
+    return MIN (index, LATENCY_N_BUCKETS - 1);
+}
+
+
+/* Exclusive upper bound of the values recorded in a bucket. */
+guint64
+cog_request_stats_latency_limit (unsigned index)
+{
+    if (index < LATENCY_SUB_BUCKETS)
+        return index + 1;
+
+    const unsigned shift = index / LATENCY_SUB_BUCKETS - 1;
+    const guint64 sub_bucket = index % LATENCY_SUB_BUCKETS;
+    return (LATENCY_SUB_BUCKETS + sub_bucket + 1) << shift;
+}
+
+
+CogRequestStats*
+cog_request_stats_new (void)
+{
+    CogRequestStats *stats = g_slice_new0 (CogRequestStats);
+    stats->ref_count = 1;
+    return stats;
+}
+
+
+CogRequestStats*
+cog_request_stats_ref (CogRequestStats *stats)
+{
+    g_atomic_int_inc (&stats->ref_count);
+    return stats;
+}
+
+
+void
+cog_request_stats_unref (void *pointer)
+{
+    CogRequestStats *stats = pointer;
+    if (g_atomic_int_dec_and_test (&stats->ref_count))
+        g_slice_free (CogRequestStats, stats);
+}
+
+
+void
+cog_request_stats_add_request (CogRequestStats *stats)
+{
+    counter_add (stats->requests, 1);
+}
+
+
+/*
+ * Only the declared length of responses is added to the amount of bytes
+ * served: counting the data actually read by WebKit from streams of unknown
+ * length would need wrapping each of them into another stream.
+ */
+void
+cog_request_stats_add_result (CogRequestStats        *stats,
+                              const CogRequestResult *result,
+                              gint64                  elapsed)
+{
+    elapsed = MAX (elapsed, 0);
+    counter_add (stats->total_time, elapsed);
+    counter_add (stats->latency[cog_request_stats_latency_bucket (elapsed)], 1);
+
+    if (result->error || result->status >= 400)
+        counter_add (stats->errors, 1);
+    else if (result->length > 0)
+        counter_add (stats->bytes, result->length);
+}
+
+
+GVariant*
+cog_request_stats_to_variant (CogRequestStats *stats)
+{
+    g_auto(GVariantBuilder) latency;
+    g_variant_builder_init (&latency, G_VARIANT_TYPE ("a(tt)"));
+    for (unsigned i = 0; i < LATENCY_N_BUCKETS; i++) {
+        const guint64 count = counter_get (stats->latency[i]);
+        if (count)
+            g_variant_builder_add (&latency, "(tt)", cog_request_stats_latency_limit (i), count);
+    }
+
+    g_auto(GVariantBuilder) builder;
+    g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add (&builder, "{sv}", "requests", g_variant_new_uint64 (counter_get (stats->requests)));
+    g_variant_builder_add (&builder, "{sv}", "errors", g_variant_new_uint64 (counter_get (stats->errors)));
+    g_variant_builder_add (&builder, "{sv}", "bytes", g_variant_new_uint64 (counter_get (stats->bytes)));
+    g_variant_builder_add (&builder, "{sv}", "total-time", g_variant_new_uint64 (counter_get (stats->total_time)));
+    g_variant_builder_add (&builder, "{sv}", "latency", g_variant_builder_end (&latency));
+    return g_variant_builder_end (&builder);
+}
@@ -0,0 +1,42 @@
+/*
+ * cog-request-stats.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#include "cog-request-handler.h"
+
+G_BEGIN_DECLS
+
+typedef struct _CogRequestStats CogRequestStats;
+
+G_GNUC_INTERNAL
+CogRequestStats* cog_request_stats_new                (void);
+
+G_GNUC_INTERNAL
+CogRequestStats* cog_request_stats_ref                (CogRequestStats        *stats);
+
+G_GNUC_INTERNAL
+void             cog_request_stats_unref              (void                   *stats);
+
+G_GNUC_INTERNAL
+void             cog_request_stats_add_request        (CogRequestStats        *stats);
+
+G_GNUC_INTERNAL
+void             cog_request_stats_add_result         (CogRequestStats        *stats,
+                                                       const CogRequestResult *result,
+                                                       gint64                  elapsed);
+
+G_GNUC_INTERNAL
+GVariant*        cog_request_stats_to_variant         (CogRequestStats        *stats);
+
+G_GNUC_INTERNAL
+unsigned         cog_request_stats_latency_bucket     (guint64                 usec);
+
+G_GNUC_INTERNAL
+guint64          cog_request_stats_latency_limit      (unsigned                index);
+
+G_END_DECLS
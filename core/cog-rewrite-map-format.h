@@ -0,0 +1,34 @@
+/*
+ * cog-rewrite-map-format.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Rewrite maps, as written by the cog-rewrite-map tool and used by the
+ * rewrite web extension, are serialized GVariant values of the type
+ * COG_REWRITE_MAP_TYPE:
+ *
+ *   (
+ *     s        COG_REWRITE_MAP_MAGIC
+ *     u        COG_REWRITE_MAP_VERSION
+ *     a{ss}    URI prefix to replacement prefix
+ *   )
+ *
+ * Serialized data is always little endian. Prefixes either end with
+ * a slash, matching all the URIs below them, or are complete URIs
+ * without a query or fragment, matching only that resource.
+ */
+
+#define COG_REWRITE_MAP_MAGIC    "CogRwMap"
+#define COG_REWRITE_MAP_VERSION  1
+#define COG_REWRITE_MAP_TYPE     "(sua{ss})"
+
+G_END_DECLS
@@ -6,6 +6,10 @@
  */
 
 #include "cog-shell.h"
+#include "cog-request-stats.h"
+#include "cog-startup-trace.h"
+#include "cog-view-pool.h"
+#include <string.h>
 
 /**
  * CogShell:
@@ -22,10 +26,12 @@ typedef struct {
     char             *name;
     WebKitSettings   *web_settings;
     WebKitWebContext *web_context;
-    WebKitWebView    *web_view;
+    WebKitWebView    *web_view;          /* Active view, owned by "views". */
+    CogViewPool      *views;             /* (WebKitWebView) */
     GKeyFile         *config_file;
     gdouble           device_scale_factor;
     GHashTable       *request_handlers;  /* (string, RequestHandlerMapEntry) */
+    GHashTable       *scheme_flags;      /* (string, CogSchemeFlags) */
 } CogShellPrivate;
 
 
@@ -68,9 +74,20 @@ cog_shell_create_view_base (CogShell *shell)
 }
 
 
+static void
+on_request_finished (WebKitURISchemeRequest *request G_GNUC_UNUSED,
+                     const CogRequestResult *result,
+                     void                   *user_data)
+{
+    cog_request_stats_add_result (user_data, result,
+                                  g_get_monotonic_time () - result->start_time);
+}
+
+
 typedef struct {
     CogRequestHandler *handler;
     gboolean           registered;
+    CogRequestStats   *stats;
 } RequestHandlerMapEntry;
 
 
@@ -81,6 +98,7 @@ request_handler_map_entry_new (CogRequestHandler *handler)
     RequestHandlerMapEntry *entry = g_slice_new (RequestHandlerMapEntry);
     entry->handler = g_object_ref_sink (handler);
     entry->registered = FALSE;
+    entry->stats = cog_request_stats_new ();
     return entry;
 }
 
@@ -91,6 +109,7 @@ request_handler_map_entry_free (void *pointer)
     if (pointer) {
         RequestHandlerMapEntry *entry = pointer;
         g_clear_object (&entry->handler);
+        g_clear_pointer (&entry->stats, cog_request_stats_unref);
         g_slice_free (RequestHandlerMapEntry, entry);
     }
 }
@@ -102,17 +121,55 @@ handle_uri_scheme_request (WebKitURISchemeRequest *request,
 {
     RequestHandlerMapEntry *entry = userdata;
     g_assert (COG_IS_REQUEST_HANDLER (entry->handler));
+
+    /*
+     * The entry may be replaced while the request is being handled, so
+     * the callback keeps its own reference to the statistics. Adding the
+     * callback does not allocate memory.
+     */
+    cog_request_stats_add_request (entry->stats);
+    cog_request_add_finished_callback (request,
+                                       on_request_finished,
+                                       cog_request_stats_ref (entry->stats),
+                                       cog_request_stats_unref);
     cog_request_handler_run (entry->handler, request);
 }
 
 
+static void
+web_context_register_scheme_flags (WebKitWebContext *context,
+                                   const char       *scheme,
+                                   CogSchemeFlags    flags)
+{
+    WebKitSecurityManager *manager = webkit_web_context_get_security_manager (context);
+
+    if (flags & COG_SCHEME_FLAGS_SECURE)
+        webkit_security_manager_register_uri_scheme_as_secure (manager, scheme);
+    if (flags & COG_SCHEME_FLAGS_CORS_ENABLED)
+        webkit_security_manager_register_uri_scheme_as_cors_enabled (manager, scheme);
+    if (flags & COG_SCHEME_FLAGS_LOCAL)
+        webkit_security_manager_register_uri_scheme_as_local (manager, scheme);
+    if (flags & COG_SCHEME_FLAGS_DISPLAY_ISOLATED)
+        webkit_security_manager_register_uri_scheme_as_display_isolated (manager, scheme);
+}
+
+
 static void
 request_handler_map_entry_register (const char             *scheme,
                                     RequestHandlerMapEntry *entry,
-                                    WebKitWebContext       *context)
+                                    CogShell               *shell)
 {
-    if (context && !entry->registered) {
-        webkit_web_context_register_uri_scheme (context,
+    CogShellPrivate *priv = PRIV (shell);
+
+    if (priv->web_context && !entry->registered) {
+        /*
+         * Apply the security flags before registering the handler, so
+         * they are in effect by the time the first request is made.
+         */
+        web_context_register_scheme_flags (priv->web_context,
+                                           scheme,
+                                           cog_shell_get_scheme_flags (shell, scheme));
+        webkit_web_context_register_uri_scheme (priv->web_context,
                                                 scheme,
                                                 handle_uri_scheme_request,
                                                 entry,
@@ -121,6 +178,16 @@ request_handler_map_entry_register (const char             *scheme,
 }
 
 
+#if WEBKIT_CHECK_VERSION(2, 24, 0)
+static void
+on_web_process_launch (WebKitWebContext *web_context G_GNUC_UNUSED,
+                       gint64           *launch_time)
+{
+    if (!*launch_time)
+        *launch_time = g_get_monotonic_time ();
+}
+#endif /* WEBKIT_CHECK_VERSION */
+
 
 static void
 cog_shell_startup_base (CogShell *shell)
@@ -130,19 +197,53 @@ cog_shell_startup_base (CogShell *shell)
     if (priv->request_handlers) {
         g_hash_table_foreach (priv->request_handlers,
                               (GHFunc) request_handler_map_entry_register,
-                              priv->web_context);
+                              shell);
     }
 
-    g_signal_emit (shell, s_signals[CREATE_VIEW], 0, &priv->web_view);
-    g_object_ref_sink (priv->web_view);
-    g_object_notify_by_pspec (G_OBJECT (shell), s_properties[PROP_WEB_VIEW]);
+#if WEBKIT_CHECK_VERSION(2, 24, 0)
+    /*
+     * Start spawning a web process right away, so that it overlaps with
+     * the setup done while handling the creation of the first view (e.g.
+     * platform plug-in initialization) instead of starting afterwards.
+     *
+     * The web context asks for the web extensions initialization data
+     * when it launches a web process, which gives the launch time.
+     */
+    gint64 launch_time = 0;
+    const gulong launch_handler =
+        g_signal_connect (priv->web_context, "initialize-web-extensions",
+                          G_CALLBACK (on_web_process_launch), &launch_time);
+
+    const gint64 prewarm_time = g_get_monotonic_time ();
+    cog_startup_trace_mark ("web-process-prewarm");
+    webkit_web_context_prewarm (priv->web_context);
+    const gint64 create_time = g_get_monotonic_time ();
+#endif /* WEBKIT_CHECK_VERSION */
+
+    WebKitWebView *web_view = cog_shell_create_view (shell);
+
+#if WEBKIT_CHECK_VERSION(2, 24, 0)
+    const gint64 created_time = g_get_monotonic_time ();
+    g_signal_handler_disconnect (priv->web_context, launch_handler);
 
     /*
-     * The web context and settings being used by the web view must be
-     * the same that were pre-created by shell.
+     * The web process starts up in parallel from its launch onwards, so
+     * view creation after that point is the most it could have overlapped.
      */
-    g_assert (webkit_web_view_get_settings (priv->web_view) == priv->web_settings);
-    g_assert (webkit_web_view_get_context (priv->web_view) == priv->web_context);
+    if (launch_time) {
+        g_debug ("%s: Web process launched %.2f ms after prewarm, its start-up"
+                 " overlapped up to %.2f ms of view creation (%.2f ms)", __func__,
+                 (launch_time - prewarm_time) / 1000.0,
+                 (created_time - MAX (launch_time, create_time)) / 1000.0,
+                 (created_time - create_time) / 1000.0);
+    } else {
+        g_debug ("%s: Web process not launched during view creation (%.2f ms)",
+                 __func__, (created_time - create_time) / 1000.0);
+    }
+#endif /* WEBKIT_CHECK_VERSION */
+
+    g_return_if_fail (web_view != NULL);
+    cog_shell_activate_view (shell, web_view);
 }
 
 
@@ -230,11 +331,13 @@ cog_shell_dispose (GObject *object)
 {
     CogShellPrivate *priv = PRIV (object);
 
-    g_clear_object (&priv->web_view);
+    priv->web_view = NULL;
+    g_clear_pointer (&priv->views, cog_view_pool_free);
     g_clear_object (&priv->web_context);
     g_clear_object (&priv->web_settings);
 
     g_clear_pointer (&priv->request_handlers, g_hash_table_unref);
+    g_clear_pointer (&priv->scheme_flags, g_hash_table_unref);
     g_clear_pointer (&priv->name, g_free);
     g_clear_pointer (&priv->config_file, g_key_file_unref);
 
@@ -261,7 +364,8 @@ cog_shell_class_init (CogShellClass *klass)
      * @user_data: User data.
      *
      * The `create-view` signal is emitted when the shell needs to create
-     * a [class@WebKit.WebView].
+     * a [class@WebKit.WebView], during startup and from
+     * [method@Cog.Shell.create_view].
      *
      * Handling this signal allows to customize how the web view is
      * configured. Note that the web view returned by a signal handler
@@ -329,7 +433,8 @@ cog_shell_class_init (CogShellClass *klass)
     /**
      * CogShell:web-view: (attributes org.gtk.Property.get=cog_shell_get_web_view):
      *
-     * The [class@WebKit.WebView] managed by this shell.
+     * The active [class@WebKit.WebView] managed by this shell, which
+     * is the one shown on screen. See [method@Cog.Shell.activate_view].
      */
     s_properties[PROP_WEB_VIEW] =
         g_param_spec_object ("web-view",
@@ -413,7 +518,7 @@ cog_shell_get_web_settings (CogShell *shell)
 /**
  * cog_shell_get_web_view:
  *
- * Obtains the [class@WebKit.WebView] for this shell.
+ * Obtains the active [class@WebKit.WebView] for this shell.
  *
  * Returns: A web view.
  */
@@ -424,6 +529,179 @@ cog_shell_get_web_view (CogShell *shell)
     return PRIV (shell)->web_view;
 }
 
+/*
+ * Activity states of the view backends for each CogViewState.
+ */
+#define VIEW_STATES_ACTIVE     (wpe_view_activity_state_visible | \
+                                wpe_view_activity_state_focused | \
+                                wpe_view_activity_state_in_window)
+#define VIEW_STATES_PRELOADED  (wpe_view_activity_state_visible | \
+                                wpe_view_activity_state_in_window)
+
+static void
+web_view_set_state (void *view, CogViewState state)
+{
+    uint32_t states = 0;
+    switch (state) {
+        case COG_VIEW_STATE_ACTIVE:
+            states = VIEW_STATES_ACTIVE;
+            break;
+        case COG_VIEW_STATE_PRELOADED:
+            states = VIEW_STATES_PRELOADED;
+            break;
+        case COG_VIEW_STATE_SUSPENDED:
+            break;
+    }
+
+    struct wpe_view_backend *backend =
+        webkit_web_view_backend_get_wpe_backend (webkit_web_view_get_backend (view));
+
+    const uint32_t current = wpe_view_backend_get_activity_state (backend);
+    if (current & ~states)
+        wpe_view_backend_remove_activity_state (backend, current & ~states);
+    if (states & ~current)
+        wpe_view_backend_add_activity_state (backend, states & ~current);
+}
+
+
+static inline gboolean
+cog_shell_has_view (CogShell *shell, WebKitWebView *view)
+{
+    CogShellPrivate *priv = PRIV (shell);
+    return priv->views && cog_view_pool_contains (priv->views, view);
+}
+
+/**
+ * cog_shell_create_view:
+ *
+ * Creates a new [class@WebKit.WebView] by emitting the
+ * [signal@Cog.Shell::create-view] signal, and adds it to the pool of
+ * views managed by the shell.
+ *
+ * All the views in the pool share the same web context and settings. The
+ * new view is kept off screen in the preloaded state, where its page keeps
+ * running and rendering, at a reduced frame rate, until it is passed to
+ * [method@Cog.Shell.activate_view].
+ *
+ * Returns: (transfer none) (nullable): A new web view, or %NULL if no
+ *    signal handler could create it.
+ */
+WebKitWebView*
+cog_shell_create_view (CogShell *shell)
+{
+    g_return_val_if_fail (COG_IS_SHELL (shell), NULL);
+
+    CogShellPrivate *priv = PRIV (shell);
+
+    WebKitWebView *view = NULL;
+    g_signal_emit (shell, s_signals[CREATE_VIEW], 0, &view);
+    if (!view)
+        return NULL;
+
+    if (g_object_is_floating (view))
+        g_object_ref_sink (view);
+
+    /*
+     * The web context and settings being used by the web view must be
+     * the same that were pre-created by shell.
+     */
+    g_assert (webkit_web_view_get_settings (view) == priv->web_settings);
+    g_assert (webkit_web_view_get_context (view) == priv->web_context);
+
+    if (!priv->views)
+        priv->views = cog_view_pool_new (web_view_set_state, g_object_unref);
+    cog_view_pool_add (priv->views, view);
+    return view;
+}
+
+/**
+ * cog_shell_activate_view:
+ * @view: A web view from the pool of the shell.
+ *
+ * Puts a @view on screen, making it the value of the
+ * [property@Cog.Shell:web-view] property. The previously active view,
+ * if any, is left in the preloaded state.
+ *
+ * Platform implementations track the property to present the contents
+ * of the active view, which means that activating a view which was
+ * already preloaded needs a single frame.
+ */
+void
+cog_shell_activate_view (CogShell      *shell,
+                         WebKitWebView *view)
+{
+    g_return_if_fail (COG_IS_SHELL (shell));
+    g_return_if_fail (WEBKIT_IS_WEB_VIEW (view));
+    g_return_if_fail (cog_shell_has_view (shell, view));
+
+    CogShellPrivate *priv = PRIV (shell);
+    if (!cog_view_pool_activate (priv->views, view))
+        return;
+
+    priv->web_view = view;
+    g_object_notify_by_pspec (G_OBJECT (shell), s_properties[PROP_WEB_VIEW]);
+}
+
+/**
+ * cog_shell_suspend_view:
+ * @view: A web view from the pool of the shell.
+ *
+ * Marks a @view as hidden, which makes the web engine throttle its page:
+ * timers and animations are paused, and the page is not rendered. Calling
+ * [method@Cog.Shell.activate_view] resumes the view.
+ *
+ * The active view cannot be suspended.
+ */
+void
+cog_shell_suspend_view (CogShell      *shell,
+                        WebKitWebView *view)
+{
+    g_return_if_fail (COG_IS_SHELL (shell));
+    g_return_if_fail (WEBKIT_IS_WEB_VIEW (view));
+    g_return_if_fail (cog_shell_has_view (shell, view));
+    g_return_if_fail (PRIV (shell)->web_view != view);
+
+    cog_view_pool_suspend (PRIV (shell)->views, view);
+}
+
+/**
+ * cog_shell_destroy_view:
+ * @view: A web view from the pool of the shell.
+ *
+ * Removes a @view from the pool of the shell, releasing the reference
+ * the shell holds on it.
+ *
+ * The active view cannot be destroyed.
+ */
+void
+cog_shell_destroy_view (CogShell      *shell,
+                        WebKitWebView *view)
+{
+    g_return_if_fail (COG_IS_SHELL (shell));
+    g_return_if_fail (WEBKIT_IS_WEB_VIEW (view));
+    g_return_if_fail (cog_shell_has_view (shell, view));
+    g_return_if_fail (PRIV (shell)->web_view != view);
+
+    cog_view_pool_remove (PRIV (shell)->views, view);
+}
+
+/**
+ * cog_shell_get_n_views:
+ *
+ * Obtains the number of views in the pool of the shell, including the
+ * active one.
+ *
+ * Returns: Number of views.
+ */
+unsigned
+cog_shell_get_n_views (CogShell *shell)
+{
+    g_return_val_if_fail (COG_IS_SHELL (shell), 0);
+
+    CogShellPrivate *priv = PRIV (shell);
+    return priv->views ? cog_view_pool_get_size (priv->views) : 0;
+}
+
 /**
  * cog_shell_get_name:
  *
@@ -491,7 +769,247 @@ cog_shell_set_request_handler (CogShell          *shell,
         entry->handler = g_object_ref_sink (handler);
     }
 
-    request_handler_map_entry_register (scheme, entry, priv->web_context);
+    request_handler_map_entry_register (scheme, entry, shell);
+}
+
+/**
+ * cog_shell_get_request_handler:
+ * @scheme: Name of the custom URI scheme.
+ *
+ * Obtains the handler installed for a custom URI scheme.
+ *
+ * Returns: (transfer none) (nullable): The handler for the @scheme, or
+ *    %NULL if no handler has been installed for it.
+ */
+CogRequestHandler*
+cog_shell_get_request_handler (CogShell   *shell,
+                               const char *scheme)
+{
+    g_return_val_if_fail (COG_IS_SHELL (shell), NULL);
+    g_return_val_if_fail (scheme != NULL, NULL);
+
+    CogShellPrivate *priv = PRIV (shell);
+    if (!priv->request_handlers)
+        return NULL;
+
+    RequestHandlerMapEntry *entry =
+        g_hash_table_lookup (priv->request_handlers, scheme);
+    return entry ? entry->handler : NULL;
+}
+
+/**
+ * cog_shell_set_scheme_flags:
+ * @scheme: Name of the custom URI scheme.
+ * @flags: Security flags for the scheme.
+ *
+ * Configures how the web engine treats content loaded from a custom URI
+ * @scheme, see [enum@Cog.SchemeFlags]. For example, marking a scheme as
+ * secure allows pages loaded from it to use service workers and the
+ * Cache API.
+ *
+ * The flags are applied to the [class@WebKit.SecurityManager] of the web
+ * context when a [iface@Cog.RequestHandler] for the @scheme gets installed,
+ * or immediately if a handler was already installed. Note that the web
+ * engine does not provide a way of unregistering flags, so removing flags
+ * from a scheme with an installed handler has no effect.
+ */
+void
+cog_shell_set_scheme_flags (CogShell      *shell,
+                            const char    *scheme,
+                            CogSchemeFlags flags)
+{
+    g_return_if_fail (COG_IS_SHELL (shell));
+    g_return_if_fail (scheme != NULL);
+
+    CogShellPrivate *priv = PRIV (shell);
+
+    if (!priv->scheme_flags)
+        priv->scheme_flags = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    g_hash_table_insert (priv->scheme_flags, g_strdup (scheme), GUINT_TO_POINTER (flags));
+
+    if (priv->web_context && priv->request_handlers &&
+        g_hash_table_contains (priv->request_handlers, scheme))
+        web_context_register_scheme_flags (priv->web_context, scheme, flags);
+}
+
+/**
+ * cog_shell_get_scheme_flags:
+ * @scheme: Name of the custom URI scheme.
+ *
+ * Obtains the security flags configured for a custom URI @scheme.
+ *
+ * Returns: The flags for the @scheme.
+ */
+CogSchemeFlags
+cog_shell_get_scheme_flags (CogShell   *shell,
+                            const char *scheme)
+{
+    g_return_val_if_fail (COG_IS_SHELL (shell), COG_SCHEME_FLAGS_NONE);
+    g_return_val_if_fail (scheme != NULL, COG_SCHEME_FLAGS_NONE);
+
+    CogShellPrivate *priv = PRIV (shell);
+    if (!priv->scheme_flags)
+        return COG_SCHEME_FLAGS_NONE;
+
+    return GPOINTER_TO_UINT (g_hash_table_lookup (priv->scheme_flags, scheme));
+}
+
+static const struct {
+    const char    *name;
+    CogSchemeFlags flag;
+} s_scheme_flag_names[] = {
+    { "secure", COG_SCHEME_FLAGS_SECURE },
+    { "cors-enabled", COG_SCHEME_FLAGS_CORS_ENABLED },
+    { "local", COG_SCHEME_FLAGS_LOCAL },
+    { "display-isolated", COG_SCHEME_FLAGS_DISPLAY_ISOLATED },
+};
+
+/**
+ * cog_scheme_flags_parse:
+ * @names: (array zero-terminated=1): Names of the flags.
+ * @flags: (inout): Flags to which the named ones are added.
+ * @error: Location where to store an error.
+ *
+ * Parses a list of [enum@Cog.SchemeFlags] names: `secure`, `cors-enabled`,
+ * `local` and `display-isolated`. Whitespace around the names is ignored,
+ * and empty names are skipped.
+ *
+ * Returns: Whether all the names were valid. On failure @flags is not
+ *    modified.
+ */
+gboolean
+cog_scheme_flags_parse (const char * const *names,
+                        CogSchemeFlags     *flags,
+                        GError            **error)
+{
+    g_return_val_if_fail (names != NULL, FALSE);
+    g_return_val_if_fail (flags != NULL, FALSE);
+
+    CogSchemeFlags result = *flags;
+
+    for (unsigned i = 0; names[i]; i++) {
+        const char *name = names[i];
+        while (g_ascii_isspace (*name))
+            name++;
+
+        size_t length = strlen (name);
+        while (length > 0 && g_ascii_isspace (name[length - 1]))
+            length--;
+
+        if (length == 0)
+            continue;
+
+        unsigned j = 0;
+        while (j < G_N_ELEMENTS (s_scheme_flag_names) &&
+               (strncmp (s_scheme_flag_names[j].name, name, length) != 0 ||
+                s_scheme_flag_names[j].name[length] != '\0'))
+            j++;
+
+        if (j == G_N_ELEMENTS (s_scheme_flag_names)) {
+            g_set_error (error,
+                         G_OPTION_ERROR,
+                         G_OPTION_ERROR_BAD_VALUE,
+                         "Invalid URI scheme flag '%.*s'",
+                         (int) length, name);
+            return FALSE;
+        }
+        result |= s_scheme_flag_names[j].flag;
+    }
+
+    *flags = result;
+    return TRUE;
+}
+
+/**
+ * cog_scheme_flags_parse_spec:
+ * @spec: Specification in the `SCHEME:FLAG[,FLAG...]` form.
+ * @scheme: (out) (transfer full): Location where to store the scheme name.
+ * @flags: (out): Location where to store the flags.
+ * @error: Location where to store an error.
+ *
+ * Parses a URI scheme name followed by a comma-separated list of flags,
+ * as accepted by [func@Cog.scheme_flags_parse].
+ *
+ * Returns: Whether the specification was valid.
+ */
+gboolean
+cog_scheme_flags_parse_spec (const char     *spec,
+                             char          **scheme,
+                             CogSchemeFlags *flags,
+                             GError        **error)
+{
+    g_return_val_if_fail (spec != NULL, FALSE);
+    g_return_val_if_fail (scheme != NULL, FALSE);
+    g_return_val_if_fail (flags != NULL, FALSE);
+
+    const char *colon = strchr (spec, ':');
+    if (!colon || colon == spec) {
+        g_set_error (error,
+                     G_OPTION_ERROR,
+                     G_OPTION_ERROR_BAD_VALUE,
+                     "Invalid URI scheme flags specification '%s'",
+                     spec);
+        return FALSE;
+    }
+
+    g_auto(GStrv) names = g_strsplit (colon + 1, ",", -1);
+    CogSchemeFlags result = COG_SCHEME_FLAGS_NONE;
+    if (!cog_scheme_flags_parse ((const char * const *) names, &result, error))
+        return FALSE;
+
+    *scheme = g_strndup (spec, colon - spec);
+    *flags = result;
+    return TRUE;
+}
+
+/**
+ * cog_shell_get_request_stats:
+ *
+ * Obtains statistics about the requests handled for each custom URI scheme
+ * which has a [iface@Cog.RequestHandler] installed.
+ *
+ * The result is a dictionary which maps scheme names to dictionaries with
+ * the following entries:
+ *
+ * - `requests` (`t`): Number of requests dispatched to the handler.
+ * - `errors` (`t`): Number of requests finished with an error, or with
+ *   an HTTP status code of 400 or higher.
+ * - `bytes` (`t`): Size of the successful responses whose length was
+ *   known when finishing them.
+ * - `total-time` (`t`): Sum of the time taken by finished requests,
+ *   in microseconds.
+ * - `latency` (`a(tt)`): Histogram of the time taken by finished requests,
+ *   as pairs of the exclusive upper limit of each bucket in microseconds
+ *   and the number of requests in it. Empty buckets are omitted.
+ *
+ * Only requests finished using [func@Cog.request_finish] and related
+ * functions are accounted as finished: requests which handlers finish
+ * directly with [method@WebKit.URISchemeRequest.finish] and related
+ * functions only count in `requests`.
+ *
+ * Returns: (transfer floating): A variant of type `a{sa{sv}}`.
+ */
+GVariant*
+cog_shell_get_request_stats (CogShell *shell)
+{
+    g_return_val_if_fail (COG_IS_SHELL (shell), NULL);
+
+    g_auto(GVariantBuilder) builder;
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sa{sv}}"));
+
+    CogShellPrivate *priv = PRIV (shell);
+    if (priv->request_handlers) {
+        GHashTableIter iter;
+        void *key, *value;
+        g_hash_table_iter_init (&iter, priv->request_handlers);
+        while (g_hash_table_iter_next (&iter, &key, &value)) {
+            RequestHandlerMapEntry *entry = value;
+            g_variant_builder_add (&builder, "{s@a{sv}}", key,
+                                   cog_request_stats_to_variant (entry->stats));
+        }
+    }
+
+    return g_variant_builder_end (&builder);
 }
 
 /**
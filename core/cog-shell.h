@@ -16,6 +16,37 @@
 
 G_BEGIN_DECLS
 
+/**
+ * CogSchemeFlags:
+ * @COG_SCHEME_FLAGS_NONE: No flags.
+ * @COG_SCHEME_FLAGS_SECURE: Content is considered secure, as if it
+ *    were loaded over HTTPS.
+ * @COG_SCHEME_FLAGS_CORS_ENABLED: Cross-origin resource sharing requests
+ *    are allowed for the scheme.
+ * @COG_SCHEME_FLAGS_LOCAL: Content is treated as local, and pages loaded
+ *    from other schemes cannot access it.
+ * @COG_SCHEME_FLAGS_DISPLAY_ISOLATED: Content can only be displayed by
+ *    pages loaded from the same scheme.
+ *
+ * Security flags for custom URI schemes, see [method@Cog.Shell.set_scheme_flags].
+ */
+typedef enum {
+    COG_SCHEME_FLAGS_NONE             = 0,
+    COG_SCHEME_FLAGS_SECURE           = 1 << 0,
+    COG_SCHEME_FLAGS_CORS_ENABLED     = 1 << 1,
+    COG_SCHEME_FLAGS_LOCAL            = 1 << 2,
+    COG_SCHEME_FLAGS_DISPLAY_ISOLATED = 1 << 3,
+} CogSchemeFlags;
+
+gboolean cog_scheme_flags_parse      (const char * const *names,
+                                      CogSchemeFlags     *flags,
+                                      GError            **error);
+gboolean cog_scheme_flags_parse_spec (const char         *spec,
+                                      char              **scheme,
+                                      CogSchemeFlags     *flags,
+                                      GError            **error);
+
+
 #define COG_TYPE_SHELL  (cog_shell_get_type ())
 
 G_DECLARE_DERIVABLE_TYPE (CogShell, cog_shell, COG, SHELL, GObject)
@@ -37,10 +68,26 @@ WebKitWebContext *cog_shell_get_web_context         (CogShell          *shell);
 WebKitSettings   *cog_shell_get_web_settings        (CogShell          *shell);
 WebKitWebView    *cog_shell_get_web_view            (CogShell          *shell);
 GKeyFile         *cog_shell_get_config_file         (CogShell          *shell);
+WebKitWebView    *cog_shell_create_view             (CogShell          *shell);
+void              cog_shell_activate_view           (CogShell          *shell,
+                                                     WebKitWebView     *view);
+void              cog_shell_suspend_view            (CogShell          *shell,
+                                                     WebKitWebView     *view);
+void              cog_shell_destroy_view            (CogShell          *shell,
+                                                     WebKitWebView     *view);
+unsigned          cog_shell_get_n_views             (CogShell          *shell);
 gdouble           cog_shell_get_device_scale_factor (CogShell          *shell);
 void              cog_shell_set_request_handler     (CogShell          *shell,
                                                      const char        *scheme,
                                                      CogRequestHandler *handler);
+CogRequestHandler *cog_shell_get_request_handler    (CogShell          *shell,
+                                                     const char        *scheme);
+void              cog_shell_set_scheme_flags        (CogShell          *shell,
+                                                     const char        *scheme,
+                                                     CogSchemeFlags     flags);
+CogSchemeFlags    cog_shell_get_scheme_flags        (CogShell          *shell,
+                                                     const char        *scheme);
+GVariant         *cog_shell_get_request_stats       (CogShell          *shell);
 
 void              cog_shell_startup                 (CogShell          *shell);
 void              cog_shell_shutdown                (CogShell          *shell);
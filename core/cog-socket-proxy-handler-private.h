@@ -0,0 +1,23 @@
+/*
+ * cog-socket-proxy-handler-private.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#include "cog-socket-proxy-handler.h"
+
+G_BEGIN_DECLS
+
+G_GNUC_INTERNAL
+GInputStream* cog_socket_proxy_handler_send (CogSocketProxyHandler *self,
+                                             const char            *method,
+                                             const char            *target,
+                                             unsigned              *status,
+                                             gint64                *length,
+                                             GCancellable          *cancellable,
+                                             GError               **error);
+
+G_END_DECLS
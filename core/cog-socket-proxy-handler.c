@@ -0,0 +1,1061 @@
+/*
+ * cog-socket-proxy-handler.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "cog-socket-proxy-handler.h"
+#include "cog-socket-proxy-handler-private.h"
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+#include <string.h>
+
+/**
+ * CogSocketProxyHandler:
+ *
+ * Request handler implementation that forwards requests to an HTTP server
+ * listening on a Unix domain socket.
+ *
+ * This avoids the overhead of TCP connections to local services, and the
+ * limits which the WebKit network process imposes on connections per host.
+ * Requests are sent using HTTP/1.1, and connections are kept open after
+ * responses are received to be reused by later requests; the amount of
+ * idle connections kept is configurable with the
+ * [property@Cog.SocketProxyHandler:max-idle-connections] property.
+ *
+ * Response bodies are passed to WebKit as they are received from the
+ * socket, without loading them in memory first. With WebKit 2.36 or newer
+ * the HTTP status and headers of responses are passed along as well, and
+ * the method and headers of requests are forwarded to the server.
+ * Request bodies are forwarded with WebKit 2.40 or newer.
+ *
+ * The path and query of request URIs are used as the request target,
+ * optionally after removing leading path components (see the
+ * [property@Cog.SocketProxyHandler:strip-components] property), which is
+ * useful when mounting the handler using [class@Cog.PrefixRoutesHandler].
+ */
+
+#define DEFAULT_MAX_IDLE_CONNECTIONS  4
+
+typedef struct {
+    GSocketConnection *connection;
+    GDataInputStream  *input;   /* Buffered, kept across requests. */
+} ProxyConnection;
+
+struct _CogSocketProxyHandler {
+    GObject parent;
+
+    char          *socket_path;
+    unsigned       strip_components;
+
+    GSocketClient *client;
+    GMutex         idle_lock;
+    GQueue         idle;        /* (ProxyConnection) */
+    unsigned       max_idle;
+};
+
+enum {
+    PROP_0,
+    PROP_SOCKET_PATH,
+    PROP_MAX_IDLE_CONNECTIONS,
+    PROP_STRIP_COMPONENTS,
+    N_PROPERTIES,
+};
+
+static GParamSpec *s_properties[N_PROPERTIES] = { NULL, };
+
+
+static void
+proxy_connection_free (ProxyConnection *conn)
+{
+    g_io_stream_close (G_IO_STREAM (conn->connection), NULL, NULL);
+    g_clear_object (&conn->input);
+    g_clear_object (&conn->connection);
+    g_slice_free (ProxyConnection, conn);
+}
+
+
+/*
+ * Takes an idle connection from the pool, or opens a new one. Called from
+ * worker threads.
+ */
+static ProxyConnection*
+cog_socket_proxy_handler_take_connection (CogSocketProxyHandler *self,
+                                          gboolean              *reused,
+                                          GCancellable          *cancellable,
+                                          GError               **error)
+{
+    g_mutex_lock (&self->idle_lock);
+    ProxyConnection *conn = g_queue_pop_head (&self->idle);
+    g_mutex_unlock (&self->idle_lock);
+
+    if ((*reused = !!conn))
+        return conn;
+
+    g_autoptr(GSocketAddress) address = g_unix_socket_address_new (self->socket_path);
+    g_autoptr(GSocketConnection) connection =
+        g_socket_client_connect (self->client,
+                                 G_SOCKET_CONNECTABLE (address),
+                                 cancellable,
+                                 error);
+    if (!connection)
+        return NULL;
+
+    GInputStream *input = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+
+    conn = g_slice_new0 (ProxyConnection);
+    conn->connection = g_steal_pointer (&connection);
+    conn->input = g_data_input_stream_new (input);
+    g_data_input_stream_set_newline_type (conn->input, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+    g_filter_input_stream_set_close_base_stream (G_FILTER_INPUT_STREAM (conn->input), FALSE);
+    return conn;
+}
+
+
+/*
+ * Returns a connection to the pool once a response has been read in full.
+ * May be called from any thread.
+ */
+static void
+cog_socket_proxy_handler_release_connection (CogSocketProxyHandler *self,
+                                             ProxyConnection       *conn)
+{
+    g_mutex_lock (&self->idle_lock);
+    if (g_queue_get_length (&self->idle) < self->max_idle) {
+        g_queue_push_head (&self->idle, conn);
+        conn = NULL;
+    }
+    g_mutex_unlock (&self->idle_lock);
+
+    if (conn)
+        proxy_connection_free (conn);
+}
+
+
+/*
+ * Input stream which reads a response body from a connection, honoring
+ * its framing, and gives the connection back to the pool when the end of
+ * the body is reached.
+ */
+typedef enum {
+    BODY_FRAMING_LENGTH,
+    BODY_FRAMING_CHUNKED,
+    BODY_FRAMING_EOF,
+} BodyFraming;
+
+#define COG_TYPE_PROXY_BODY_STREAM  (cog_proxy_body_stream_get_type ())
+
+G_DECLARE_FINAL_TYPE (CogProxyBodyStream,
+                      cog_proxy_body_stream,
+                      COG, PROXY_BODY_STREAM,
+                      GInputStream)
+
+struct _CogProxyBodyStream {
+    GInputStream parent;
+
+    CogSocketProxyHandler *handler;
+    ProxyConnection       *conn;
+    BodyFraming            framing;
+    guint64                remaining;   /* In the body, or current chunk. */
+    gboolean               keep_alive;
+    gboolean               done;
+};
+
+G_DEFINE_TYPE (CogProxyBodyStream, cog_proxy_body_stream, G_TYPE_INPUT_STREAM)
+
+
+static void
+cog_proxy_body_stream_complete (CogProxyBodyStream *self)
+{
+    self->done = TRUE;
+
+    ProxyConnection *conn = g_steal_pointer (&self->conn);
+    if (self->keep_alive)
+        cog_socket_proxy_handler_release_connection (self->handler, conn);
+    else
+        proxy_connection_free (conn);
+}
+
+
+static gboolean
+cog_proxy_body_stream_next_chunk (CogProxyBodyStream *self,
+                                  GCancellable       *cancellable,
+                                  GError            **error)
+{
+    g_autofree char *line =
+        g_data_input_stream_read_line (self->conn->input, NULL, cancellable, error);
+    if (!line) {
+        if (error && !*error)
+            g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT, "Truncated chunked body");
+        return FALSE;
+    }
+
+    char *end = NULL;
+    self->remaining = g_ascii_strtoull (line, &end, 16);
+    if (end == line || (*end != '\0' && *end != ';' && *end != ' ' && *end != '\t')) {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Invalid chunk size '%s'", line);
+        return FALSE;
+    }
+    if (self->remaining > 0)
+        return TRUE;
+
+    /* Last chunk, skip the trailer. */
+    do {
+        g_free (line);
+        line = g_data_input_stream_read_line (self->conn->input, NULL, cancellable, error);
+        if (!line) {
+            if (error && !*error)
+                g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT, "Truncated chunked body");
+            return FALSE;
+        }
+    } while (line[0] != '\0');
+
+    cog_proxy_body_stream_complete (self);
+    return TRUE;
+}
+
+
+static gssize
+cog_proxy_body_stream_read (GInputStream *stream,
+                            void         *buffer,
+                            gsize         count,
+                            GCancellable *cancellable,
+                            GError      **error)
+{
+    CogProxyBodyStream *self = COG_PROXY_BODY_STREAM (stream);
+
+    if (self->done || count == 0)
+        return 0;
+
+    if (self->framing == BODY_FRAMING_CHUNKED && self->remaining == 0) {
+        if (!cog_proxy_body_stream_next_chunk (self, cancellable, error))
+            return -1;
+        if (self->done)
+            return 0;
+    }
+
+    if (self->framing != BODY_FRAMING_EOF)
+        count = MIN (count, self->remaining);
+
+    gssize n_read = g_input_stream_read (G_INPUT_STREAM (self->conn->input),
+                                         buffer, count, cancellable, error);
+    if (n_read < 0)
+        return -1;
+
+    if (n_read == 0) {
+        if (self->framing != BODY_FRAMING_EOF) {
+            g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT,
+                                 "Connection closed before the end of the response");
+            return -1;
+        }
+        cog_proxy_body_stream_complete (self);
+        return 0;
+    }
+
+    if (self->framing == BODY_FRAMING_EOF)
+        return n_read;
+
+    self->remaining -= n_read;
+    if (self->remaining == 0) {
+        if (self->framing == BODY_FRAMING_LENGTH) {
+            cog_proxy_body_stream_complete (self);
+        } else {
+            /* Each chunk is followed by an empty line. */
+            g_autofree char *line =
+                g_data_input_stream_read_line (self->conn->input, NULL, cancellable, error);
+            if (!line || line[0] != '\0') {
+                if (error && !*error)
+                    g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Invalid chunk terminator");
+                return -1;
+            }
+        }
+    }
+
+    return n_read;
+}
+
+
+static gboolean
+cog_proxy_body_stream_close (GInputStream *stream,
+                             GCancellable *cancellable G_GNUC_UNUSED,
+                             GError      **error G_GNUC_UNUSED)
+{
+    CogProxyBodyStream *self = COG_PROXY_BODY_STREAM (stream);
+
+    /* The body was not read in full, the connection cannot be reused. */
+    if (self->conn) {
+        g_debug ("%s: Discarding connection with unread response data", __func__);
+        g_clear_pointer (&self->conn, proxy_connection_free);
+    }
+    return TRUE;
+}
+
+
+static void
+cog_proxy_body_stream_finalize (GObject *object)
+{
+    CogProxyBodyStream *self = COG_PROXY_BODY_STREAM (object);
+
+    g_clear_pointer (&self->conn, proxy_connection_free);
+    g_clear_object (&self->handler);
+
+    G_OBJECT_CLASS (cog_proxy_body_stream_parent_class)->finalize (object);
+}
+
+
+static void
+cog_proxy_body_stream_class_init (CogProxyBodyStreamClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    object_class->finalize = cog_proxy_body_stream_finalize;
+
+    GInputStreamClass *stream_class = G_INPUT_STREAM_CLASS (klass);
+    stream_class->read_fn = cog_proxy_body_stream_read;
+    stream_class->close_fn = cog_proxy_body_stream_close;
+}
+
+
+static void
+cog_proxy_body_stream_init (CogProxyBodyStream *self G_GNUC_UNUSED)
+{
+}
+
+
+static GInputStream*
+cog_proxy_body_stream_new (CogSocketProxyHandler *handler,
+                           ProxyConnection       *conn,
+                           BodyFraming            framing,
+                           guint64                length,
+                           gboolean               keep_alive)
+{
+    CogProxyBodyStream *self = g_object_new (COG_TYPE_PROXY_BODY_STREAM, NULL);
+    self->handler = g_object_ref (handler);
+    self->conn = conn;
+    self->framing = framing;
+    self->remaining = (framing == BODY_FRAMING_LENGTH) ? length : 0;
+    self->keep_alive = keep_alive && framing != BODY_FRAMING_EOF;
+    return G_INPUT_STREAM (self);
+}
+
+
+typedef struct {
+    WebKitURISchemeRequest *request;    /* Weak, cleared if dropped. */
+    GCancellable           *cancellable;
+    char                   *method;
+    char                   *head;       /* Request line and headers. */
+    GInputStream           *body;
+
+    /* Response, filled in by the worker thread. */
+    unsigned                status;
+    char                   *reason;
+    SoupMessageHeaders     *headers;
+    GInputStream           *stream;
+    gint64                  length;
+} ProxyRequest;
+
+
+static void
+proxy_request_free (void *pointer)
+{
+    /*
+     * The weak reference to the request is removed from the main thread
+     * on completion, as this may be called from a worker thread.
+     */
+    ProxyRequest *data = pointer;
+    g_clear_object (&data->cancellable);
+    g_clear_pointer (&data->method, g_free);
+    g_clear_pointer (&data->head, g_free);
+    g_clear_object (&data->body);
+    g_clear_pointer (&data->reason, g_free);
+    g_clear_pointer (&data->headers, soup_message_headers_free);
+    g_clear_object (&data->stream);
+    g_slice_free (ProxyRequest, data);
+}
+
+
+static void
+on_request_dropped (void    *user_data,
+                    GObject *where_the_object_was G_GNUC_UNUSED)
+{
+    ProxyRequest *data = user_data;
+    data->request = NULL;
+    g_cancellable_cancel (data->cancellable);
+}
+
+
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+/* Headers which only apply to a single connection, and are not forwarded. */
+static const char * const s_hop_by_hop_headers[] = {
+    "Connection",
+    "Keep-Alive",
+    "Proxy-Authenticate",
+    "Proxy-Authorization",
+    "Proxy-Connection",
+    "TE",
+    "Trailer",
+    "Transfer-Encoding",
+    "Upgrade",
+};
+
+
+static gboolean
+header_is_hop_by_hop (const char *name)
+{
+    for (unsigned i = 0; i < G_N_ELEMENTS (s_hop_by_hop_headers); i++) {
+        if (g_ascii_strcasecmp (name, s_hop_by_hop_headers[i]) == 0)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+
+static void
+append_request_header (const char *name,
+                       const char *value,
+                       void       *user_data)
+{
+    if (header_is_hop_by_hop (name) ||
+        g_ascii_strcasecmp (name, "Host") == 0 ||
+        g_ascii_strcasecmp (name, "Content-Length") == 0)
+        return;
+
+    g_string_append_printf (user_data, "%s: %s\r\n", name, value);
+}
+#endif /* WEBKIT_CHECK_VERSION */
+
+
+static gboolean
+proxy_request_read_head (CogSocketProxyHandler *handler,
+                         ProxyRequest          *data,
+                         ProxyConnection       *conn,
+                         gboolean              *got_response,
+                         GCancellable          *cancellable,
+                         GError               **error)
+{
+    SoupHTTPVersion version;
+
+    /* Informational (1xx) responses are skipped. */
+    do {
+        g_autoptr(GString) head = g_string_new (NULL);
+        for (;;) {
+            g_autofree char *line = g_data_input_stream_read_line (conn->input, NULL, cancellable, error);
+            if (!line) {
+                if (error && !*error) {
+                    g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_CONNECTION_CLOSED,
+                                         "Connection closed before receiving a response");
+                }
+                return FALSE;
+            }
+            *got_response = TRUE;
+
+            g_string_append (head, line);
+            g_string_append (head, "\r\n");
+            if (line[0] == '\0')
+                break;
+        }
+
+        g_clear_pointer (&data->reason, g_free);
+        g_clear_pointer (&data->headers, soup_message_headers_free);
+        data->headers = soup_message_headers_new (SOUP_MESSAGE_HEADERS_RESPONSE);
+        if (!soup_headers_parse_response (head->str, head->len, data->headers,
+                                          &version, &data->status, &data->reason)) {
+            g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                                 "Invalid HTTP response headers");
+            return FALSE;
+        }
+    } while (SOUP_STATUS_IS_INFORMATIONAL (data->status));
+
+    gboolean keep_alive = (version == SOUP_HTTP_1_1)
+        ? !soup_message_headers_header_contains (data->headers, "Connection", "close")
+        : soup_message_headers_header_contains (data->headers, "Connection", "keep-alive");
+
+    gboolean has_body = strcmp (data->method, "HEAD") != 0 &&
+        data->status != SOUP_STATUS_NO_CONTENT &&
+        data->status != SOUP_STATUS_NOT_MODIFIED;
+
+    BodyFraming framing = BODY_FRAMING_EOF;
+    data->length = -1;
+    if (has_body) {
+        switch (soup_message_headers_get_encoding (data->headers)) {
+            case SOUP_ENCODING_CHUNKED:
+                framing = BODY_FRAMING_CHUNKED;
+                break;
+            case SOUP_ENCODING_CONTENT_LENGTH:
+                framing = BODY_FRAMING_LENGTH;
+                data->length = soup_message_headers_get_content_length (data->headers);
+                break;
+            case SOUP_ENCODING_NONE:
+                framing = BODY_FRAMING_LENGTH;
+                data->length = 0;
+                break;
+            default:
+                break;
+        }
+    } else {
+        framing = BODY_FRAMING_LENGTH;
+        data->length = 0;
+    }
+
+    /* The connection is owned by the body stream, or released, from here on. */
+    if (data->length == 0) {
+        data->stream = g_memory_input_stream_new ();
+        if (keep_alive)
+            cog_socket_proxy_handler_release_connection (handler, conn);
+        else
+            proxy_connection_free (conn);
+    } else {
+        data->stream = cog_proxy_body_stream_new (handler, conn, framing, data->length, keep_alive);
+    }
+    return TRUE;
+}
+
+
+static gboolean
+proxy_request_send (CogSocketProxyHandler *handler,
+                    ProxyRequest          *data,
+                    ProxyConnection       *conn,
+                    GBytes                *body,
+                    gboolean              *got_response,
+                    GCancellable          *cancellable,
+                    GError               **error)
+{
+    GOutputStream *output = g_io_stream_get_output_stream (G_IO_STREAM (conn->connection));
+
+    g_autofree char *length_header = body
+        ? g_strdup_printf ("Content-Length: %zu\r\n\r\n", g_bytes_get_size (body))
+        : NULL;
+
+    if (!g_output_stream_write_all (output, data->head, strlen (data->head), NULL, cancellable, error) ||
+        !g_output_stream_write_all (output,
+                                    length_header ? length_header : "\r\n",
+                                    length_header ? strlen (length_header) : 2,
+                                    NULL, cancellable, error))
+        return FALSE;
+
+    if (body && g_bytes_get_size (body) > 0 &&
+        !g_output_stream_write_all (output,
+                                    g_bytes_get_data (body, NULL),
+                                    g_bytes_get_size (body),
+                                    NULL, cancellable, error))
+        return FALSE;
+
+    if (!g_output_stream_flush (output, cancellable, error))
+        return FALSE;
+
+    return proxy_request_read_head (handler, data, conn, got_response, cancellable, error);
+}
+
+
+static GBytes*
+proxy_request_read_body (ProxyRequest *data,
+                         GCancellable *cancellable,
+                         GError      **error)
+{
+    if (!data->body)
+        return NULL;
+
+    g_autoptr(GOutputStream) output = g_memory_output_stream_new_resizable ();
+    if (g_output_stream_splice (output, data->body,
+                                G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+                                cancellable, error) < 0)
+        return NULL;
+
+    return g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (output));
+}
+
+
+/*
+ * Sends a request and reads the response head. Blocks, and is called from
+ * worker threads.
+ */
+static gboolean
+proxy_request_transact (CogSocketProxyHandler *handler,
+                        ProxyRequest          *data,
+                        GBytes                *body,
+                        GCancellable          *cancellable,
+                        GError               **error)
+{
+    /*
+     * Idle connections may have been closed by the server in the meantime.
+     * In that case nothing is received, and sending the request again
+     * using a new connection is safe.
+     */
+    for (;;) {
+        gboolean reused = FALSE, got_response = FALSE;
+        GError *send_error = NULL;
+        ProxyConnection *conn =
+            cog_socket_proxy_handler_take_connection (handler, &reused, cancellable, error);
+        if (!conn)
+            return FALSE;
+
+        if (proxy_request_send (handler, data, conn, body, &got_response, cancellable, &send_error))
+            return TRUE;
+
+        proxy_connection_free (conn);
+        if (!reused || got_response || g_cancellable_is_cancelled (cancellable)) {
+            g_propagate_error (error, send_error);
+            return FALSE;
+        }
+
+        g_debug ("%s: Retrying with a new connection, %s", __func__, send_error->message);
+        g_clear_error (&send_error);
+    }
+}
+
+
+static void
+proxy_request_thread (GTask        *task,
+                      void         *source_object,
+                      void         *task_data,
+                      GCancellable *cancellable)
+{
+    CogSocketProxyHandler *handler = COG_SOCKET_PROXY_HANDLER (source_object);
+    ProxyRequest *data = task_data;
+
+    GError *error = NULL;
+    g_autoptr(GBytes) body = proxy_request_read_body (data, cancellable, &error);
+    if (error)
+        return g_task_return_error (task, error);
+
+    if (!proxy_request_transact (handler, data, body, cancellable, &error))
+        return g_task_return_error (task, error);
+
+    g_task_return_boolean (task, TRUE);
+}
+
+
+/* Request line and headers common to all requests. */
+static GString*
+proxy_request_head_new (const char *method,
+                        const char *path,
+                        const char *query)
+{
+    GString *head = g_string_new (NULL);
+    g_string_append_printf (head, "%s %s%s%s%s HTTP/1.1\r\n"
+                                  "Host: localhost\r\n"
+                                  "Connection: keep-alive\r\n",
+                            method,
+                            path[0] == '/' ? "" : "/", path,
+                            query ? "?" : "", query ? query : "");
+    return head;
+}
+
+
+/*
+ * Sends a request without going through WebKit, and returns a stream for
+ * the response body. Used by the unit tests.
+ */
+GInputStream*
+cog_socket_proxy_handler_send (CogSocketProxyHandler *self,
+                               const char            *method,
+                               const char            *target,
+                               unsigned              *status,
+                               gint64                *length,
+                               GCancellable          *cancellable,
+                               GError               **error)
+{
+    g_return_val_if_fail (COG_IS_SOCKET_PROXY_HANDLER (self), NULL);
+    g_return_val_if_fail (method != NULL, NULL);
+    g_return_val_if_fail (target != NULL, NULL);
+
+    ProxyRequest *data = g_slice_new0 (ProxyRequest);
+    data->method = g_strdup (method);
+    data->head = g_string_free (proxy_request_head_new (method, target, NULL), FALSE);
+
+    GInputStream *stream = NULL;
+    if (proxy_request_transact (self, data, NULL, cancellable, error)) {
+        if (status)
+            *status = data->status;
+        if (length)
+            *length = data->length;
+        stream = g_steal_pointer (&data->stream);
+    }
+
+    proxy_request_free (data);
+    return stream;
+}
+
+
+static void
+on_proxy_request_completed (GObject      *source_object G_GNUC_UNUSED,
+                            GAsyncResult *result,
+                            void         *user_data G_GNUC_UNUSED)
+{
+    ProxyRequest *data = g_task_get_task_data (G_TASK (result));
+    if (!data->request)
+        return;
+
+    g_autoptr(WebKitURISchemeRequest) request = g_object_ref (data->request);
+    g_object_weak_unref (G_OBJECT (request), on_request_dropped, data);
+    data->request = NULL;
+
+    g_autoptr(GError) error = NULL;
+    if (!g_task_propagate_boolean (G_TASK (result), &error))
+        return cog_request_finish_error (request, error);
+
+    g_autofree char *mime_type =
+        g_strdup (soup_message_headers_get_content_type (data->headers, NULL));
+
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+    for (unsigned i = 0; i < G_N_ELEMENTS (s_hop_by_hop_headers); i++)
+        soup_message_headers_remove (data->headers, s_hop_by_hop_headers[i]);
+
+    g_autoptr(WebKitURISchemeResponse) response =
+        webkit_uri_scheme_response_new (data->stream, data->length);
+    webkit_uri_scheme_response_set_status (response, data->status, data->reason);
+    if (mime_type)
+        webkit_uri_scheme_response_set_content_type (response, mime_type);
+    webkit_uri_scheme_response_set_http_headers (response, g_steal_pointer (&data->headers));
+    cog_request_finish_with_response (request, response, data->status, data->length, mime_type);
+#else
+    /* The status cannot be passed along, report errors as such. */
+    if (!SOUP_STATUS_IS_SUCCESSFUL (data->status)) {
+        error = g_error_new (G_IO_ERROR, G_IO_ERROR_FAILED, "HTTP %u %s",
+                             data->status, data->reason ? data->reason : "");
+        return cog_request_finish_error (request, error);
+    }
+    cog_request_finish (request, data->stream, data->length, mime_type);
+#endif /* WEBKIT_CHECK_VERSION */
+}
+
+
+static void
+cog_socket_proxy_handler_run (CogRequestHandler      *request_handler,
+                              WebKitURISchemeRequest *request)
+{
+    CogSocketProxyHandler *handler = COG_SOCKET_PROXY_HANDLER (request_handler);
+
+    g_autoptr(SoupURI) uri = soup_uri_new (webkit_uri_scheme_request_get_uri (request));
+    if (!uri) {
+        g_autoptr(GError) error = g_error_new (G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                                               "Invalid URI: %s",
+                                               webkit_uri_scheme_request_get_uri (request));
+        return cog_request_finish_error (request, error);
+    }
+
+    /* Discard non-empty leading path components. */
+    const char *path = soup_uri_get_path (uri);
+    for (unsigned i = 0; i < handler->strip_components; i++) {
+        while (path[0] == '/')
+            ++path;
+        if (path[0] == '\0')
+            break;
+        while (path[0] != '/' && path[0] != '\0')
+            ++path;
+    }
+    while (path[0] == '/' && path[1] == '/')
+        ++path;
+
+    ProxyRequest *data = g_slice_new0 (ProxyRequest);
+    data->request = request;
+    data->cancellable = g_cancellable_new ();
+
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+    data->method = g_strdup (webkit_uri_scheme_request_get_http_method (request));
+#endif /* WEBKIT_CHECK_VERSION */
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+    data->body = webkit_uri_scheme_request_get_http_body (request);
+#endif /* WEBKIT_CHECK_VERSION */
+    if (!data->method)
+        data->method = g_strdup ("GET");
+
+    g_autoptr(GString) head =
+        proxy_request_head_new (data->method, path, soup_uri_get_query (uri));
+
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+    SoupMessageHeaders *headers = webkit_uri_scheme_request_get_http_headers (request);
+    if (headers)
+        soup_message_headers_foreach (headers, append_request_header, head);
+#endif /* WEBKIT_CHECK_VERSION */
+
+    /* The empty line is written by the worker, along with Content-Length. */
+    data->head = g_string_free (g_steal_pointer (&head), FALSE);
+
+    /*
+     * WebKit keeps a reference to the request until it is finished or
+     * the load is stopped; do not hold another one, to notice the latter.
+     */
+    g_object_weak_ref (G_OBJECT (request), on_request_dropped, data);
+
+    /*
+     * Waiting for the server may take long, so use the default GTask pool
+     * to avoid blocking the I/O pool used by the files handlers.
+     */
+    g_autoptr(GTask) task = g_task_new (handler, data->cancellable, on_proxy_request_completed, NULL);
+    g_task_set_source_tag (task, cog_socket_proxy_handler_run);
+    g_task_set_task_data (task, data, proxy_request_free);
+    g_task_run_in_thread (task, proxy_request_thread);
+}
+
+
+static void
+cog_socket_proxy_handler_iface_init (CogRequestHandlerInterface *iface)
+{
+    iface->run = cog_socket_proxy_handler_run;
+}
+
+
+G_DEFINE_TYPE_WITH_CODE (CogSocketProxyHandler,
+                         cog_socket_proxy_handler,
+                         G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (COG_TYPE_REQUEST_HANDLER,
+                                                cog_socket_proxy_handler_iface_init))
+
+
+static void
+cog_socket_proxy_handler_trim_idle (CogSocketProxyHandler *self,
+                                    unsigned               max_idle)
+{
+    GQueue removed = G_QUEUE_INIT;
+
+    g_mutex_lock (&self->idle_lock);
+    while (g_queue_get_length (&self->idle) > max_idle)
+        g_queue_push_tail (&removed, g_queue_pop_tail (&self->idle));
+    g_mutex_unlock (&self->idle_lock);
+
+    ProxyConnection *conn;
+    while ((conn = g_queue_pop_head (&removed)))
+        proxy_connection_free (conn);
+}
+
+
+static void
+cog_socket_proxy_handler_get_property (GObject    *object,
+                                       unsigned    prop_id,
+                                       GValue     *value,
+                                       GParamSpec *pspec)
+{
+    CogSocketProxyHandler *self = COG_SOCKET_PROXY_HANDLER (object);
+    switch (prop_id) {
+        case PROP_SOCKET_PATH:
+            g_value_set_string (value, cog_socket_proxy_handler_get_socket_path (self));
+            break;
+        case PROP_MAX_IDLE_CONNECTIONS:
+            g_value_set_uint (value, cog_socket_proxy_handler_get_max_idle_connections (self));
+            break;
+        case PROP_STRIP_COMPONENTS:
+            g_value_set_uint (value, cog_socket_proxy_handler_get_strip_components (self));
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+
+static void
+cog_socket_proxy_handler_set_property (GObject      *object,
+                                       unsigned      prop_id,
+                                       const GValue *value,
+                                       GParamSpec   *pspec)
+{
+    CogSocketProxyHandler *self = COG_SOCKET_PROXY_HANDLER (object);
+    switch (prop_id) {
+        case PROP_SOCKET_PATH:
+            self->socket_path = g_value_dup_string (value);
+            break;
+        case PROP_MAX_IDLE_CONNECTIONS:
+            cog_socket_proxy_handler_set_max_idle_connections (self, g_value_get_uint (value));
+            break;
+        case PROP_STRIP_COMPONENTS:
+            cog_socket_proxy_handler_set_strip_components (self, g_value_get_uint (value));
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+
+static void
+cog_socket_proxy_handler_finalize (GObject *object)
+{
+    CogSocketProxyHandler *self = COG_SOCKET_PROXY_HANDLER (object);
+
+    cog_socket_proxy_handler_trim_idle (self, 0);
+    g_mutex_clear (&self->idle_lock);
+    g_clear_object (&self->client);
+    g_clear_pointer (&self->socket_path, g_free);
+
+    G_OBJECT_CLASS (cog_socket_proxy_handler_parent_class)->finalize (object);
+}
+
+
+static void
+cog_socket_proxy_handler_class_init (CogSocketProxyHandlerClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    object_class->get_property = cog_socket_proxy_handler_get_property;
+    object_class->set_property = cog_socket_proxy_handler_set_property;
+    object_class->finalize = cog_socket_proxy_handler_finalize;
+
+    /**
+     * CogSocketProxyHandler:socket-path: (attributes org.gtk.Property.get=cog_socket_proxy_handler_get_socket_path):
+     *
+     * Path to the Unix domain socket where the HTTP server listens.
+     */
+    s_properties[PROP_SOCKET_PATH] =
+        g_param_spec_string ("socket-path",
+                             "Socket path",
+                             "Path to the Unix socket of the HTTP server",
+                             NULL,
+                             G_PARAM_READWRITE |
+                             G_PARAM_CONSTRUCT_ONLY |
+                             G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogSocketProxyHandler:max-idle-connections: (attributes org.gtk.Property.get=cog_socket_proxy_handler_get_max_idle_connections org.gtk.Property.set=cog_socket_proxy_handler_set_max_idle_connections):
+     *
+     * Maximum number of idle connections kept open for reuse. Setting
+     * the value to zero disables reusing connections.
+     */
+    s_properties[PROP_MAX_IDLE_CONNECTIONS] =
+        g_param_spec_uint ("max-idle-connections",
+                           "Maximum idle connections",
+                           "Maximum number of idle connections kept open",
+                           0, G_MAXUINT, DEFAULT_MAX_IDLE_CONNECTIONS,
+                           G_PARAM_READWRITE |
+                           G_PARAM_CONSTRUCT |
+                           G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogSocketProxyHandler:strip-components: (attributes org.gtk.Property.get=cog_socket_proxy_handler_get_strip_components org.gtk.Property.set=cog_socket_proxy_handler_set_strip_components):
+     *
+     * Number of leading path components to strip (ignore) at the beginning
+     * of request URIs before forwarding them. See
+     * [property@Cog.DirectoryFilesHandler:strip-components].
+     */
+    s_properties[PROP_STRIP_COMPONENTS] =
+        g_param_spec_uint ("strip-components",
+                           "Strip path components",
+                           "Number of leading URI path components to ignore",
+                           0, G_MAXUINT, 0,
+                           G_PARAM_READWRITE |
+                           G_PARAM_CONSTRUCT |
+                           G_PARAM_STATIC_STRINGS);
+
+    g_object_class_install_properties (object_class, N_PROPERTIES, s_properties);
+}
+
+
+static void
+cog_socket_proxy_handler_init (CogSocketProxyHandler *self)
+{
+    self->client = g_socket_client_new ();
+    g_mutex_init (&self->idle_lock);
+    g_queue_init (&self->idle);
+}
+
+
+/**
+ * cog_socket_proxy_handler_new:
+ * @socket_path: Path to a Unix domain socket.
+ *
+ * Creates a new handler which forwards requests to the HTTP server
+ * listening on @socket_path.
+ *
+ * Returns: (transfer full): A new request handler.
+ */
+CogRequestHandler*
+cog_socket_proxy_handler_new (const char *socket_path)
+{
+    g_return_val_if_fail (socket_path != NULL, NULL);
+
+    return g_object_new (COG_TYPE_SOCKET_PROXY_HANDLER,
+                         "socket-path", socket_path,
+                         NULL);
+}
+
+/**
+ * cog_socket_proxy_handler_get_socket_path:
+ * @self: a #CogSocketProxyHandler
+ *
+ * Gets the value of the [property@Cog.SocketProxyHandler:socket-path]
+ * property.
+ *
+ * Returns: Path to the Unix socket of the HTTP server.
+ */
+const char*
+cog_socket_proxy_handler_get_socket_path (CogSocketProxyHandler *self)
+{
+    g_return_val_if_fail (COG_IS_SOCKET_PROXY_HANDLER (self), NULL);
+    return self->socket_path;
+}
+
+/**
+ * cog_socket_proxy_handler_get_max_idle_connections:
+ * @self: a #CogSocketProxyHandler
+ *
+ * Gets the value of the [property@Cog.SocketProxyHandler:max-idle-connections]
+ * property.
+ *
+ * Returns: Maximum number of idle connections kept open.
+ */
+unsigned
+cog_socket_proxy_handler_get_max_idle_connections (CogSocketProxyHandler *self)
+{
+    g_return_val_if_fail (COG_IS_SOCKET_PROXY_HANDLER (self), 0);
+    return self->max_idle;
+}
+
+/**
+ * cog_socket_proxy_handler_set_max_idle_connections:
+ * @self: a #CogSocketProxyHandler
+ * @count: Maximum number of idle connections kept open.
+ *
+ * Sets the value of the [property@Cog.SocketProxyHandler:max-idle-connections]
+ * property. Idle connections in excess are closed.
+ */
+void
+cog_socket_proxy_handler_set_max_idle_connections (CogSocketProxyHandler *self,
+                                                   unsigned               count)
+{
+    g_return_if_fail (COG_IS_SOCKET_PROXY_HANDLER (self));
+
+    g_mutex_lock (&self->idle_lock);
+    gboolean changed = (self->max_idle != count);
+    self->max_idle = count;
+    g_mutex_unlock (&self->idle_lock);
+
+    if (!changed)
+        return;
+
+    cog_socket_proxy_handler_trim_idle (self, count);
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_MAX_IDLE_CONNECTIONS]);
+}
+
+/**
+ * cog_socket_proxy_handler_get_strip_components:
+ * @self: a #CogSocketProxyHandler
+ *
+ * Gets the value of the [property@Cog.SocketProxyHandler:strip-components]
+ * property.
+ *
+ * Returns: Number of leading URI path components to ignore.
+ */
+unsigned
+cog_socket_proxy_handler_get_strip_components (CogSocketProxyHandler *self)
+{
+    g_return_val_if_fail (COG_IS_SOCKET_PROXY_HANDLER (self), 0);
+    return self->strip_components;
+}
+
+/**
+ * cog_socket_proxy_handler_set_strip_components:
+ * @self: a #CogSocketProxyHandler
+ * @count: Number of leading URI path components to ignore.
+ *
+ * Sets the value of the [property@Cog.SocketProxyHandler:strip-components]
+ * property.
+ */
+void
+cog_socket_proxy_handler_set_strip_components (CogSocketProxyHandler *self,
+                                               unsigned               count)
+{
+    g_return_if_fail (COG_IS_SOCKET_PROXY_HANDLER (self));
+
+    if (self->strip_components == count)
+        return;
+
+    self->strip_components = count;
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_STRIP_COMPONENTS]);
+}
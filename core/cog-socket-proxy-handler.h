@@ -0,0 +1,47 @@
+/*
+ * cog-socket-proxy-handler.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#if !(defined(COG_INSIDE_COG__) && COG_INSIDE_COG__)
+# error "Do not include this header directly, use <cog.h> instead"
+#endif
+
+#include "cog-request-handler.h"
+
+G_BEGIN_DECLS
+
+#define COG_TYPE_SOCKET_PROXY_HANDLER  (cog_socket_proxy_handler_get_type ())
+
+G_DECLARE_FINAL_TYPE (CogSocketProxyHandler,
+                      cog_socket_proxy_handler,
+                      COG, SOCKET_PROXY_HANDLER,
+                      GObject)
+
+struct _CogSocketProxyHandlerClass {
+    GObjectClass parent_class;
+};
+
+
+CogRequestHandler* cog_socket_proxy_handler_new (const char *socket_path);
+
+const char*        cog_socket_proxy_handler_get_socket_path
+                                                (CogSocketProxyHandler *self);
+
+unsigned           cog_socket_proxy_handler_get_max_idle_connections
+                                                (CogSocketProxyHandler *self);
+void               cog_socket_proxy_handler_set_max_idle_connections
+                                                (CogSocketProxyHandler *self,
+                                                 unsigned               count);
+
+unsigned           cog_socket_proxy_handler_get_strip_components
+                                                (CogSocketProxyHandler *self);
+void               cog_socket_proxy_handler_set_strip_components
+                                                (CogSocketProxyHandler *self,
+                                                 unsigned               count);
+
+G_END_DECLS
@@ -0,0 +1,266 @@
+/*
+ * cog-startup-trace.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "cog-startup-trace.h"
+#include <unistd.h>
+
+
+typedef struct {
+    char    *name;
+    char     phase;         /* As in the Chrome trace event format. */
+    gint64   timestamp;     /* Monotonic, in microseconds. */
+    GThread *thread;
+} TraceEvent;
+
+
+static struct {
+    GMutex   mutex;
+    char    *path;              /* Where to write the trace. */
+    GArray  *events;            /* NULL when disabled, or after finishing. */
+    gboolean frame_shown;
+    gboolean finish_requested;  /* Waiting for the first frame. */
+    guint    finish_source;     /* Main thread only. */
+} s_trace;
+
+
+static void
+trace_event_clear (TraceEvent *event)
+{
+    g_free (event->name);
+}
+
+
+static void
+startup_trace_init (void)
+{
+    static gsize initialized = 0;
+
+    if (g_once_init_enter (&initialized)) {
+        const char *path = g_getenv ("COG_STARTUP_TRACE");
+        if (path && *path) {
+            s_trace.path = g_strdup (path);
+            s_trace.events = g_array_new (FALSE, FALSE, sizeof (TraceEvent));
+            g_array_set_clear_func (s_trace.events, (GDestroyNotify) trace_event_clear);
+        }
+        g_once_init_leave (&initialized, 1);
+    }
+}
+
+
+static void
+startup_trace_record (const char *name, char phase)
+{
+    startup_trace_init ();
+    if (!s_trace.path)
+        return;
+
+    TraceEvent event = {
+        .phase = phase,
+        .timestamp = g_get_monotonic_time (),
+        .thread = g_thread_self (),
+    };
+
+    g_mutex_lock (&s_trace.mutex);
+    if (s_trace.events) {
+        event.name = g_strdup (name);
+        g_array_append_val (s_trace.events, event);
+    }
+    g_mutex_unlock (&s_trace.mutex);
+}
+
+
+static void
+append_json_string (GString *json, const char *s)
+{
+    g_string_append_c (json, '"');
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            g_string_append_printf (json, "\\%c", *s);
+        else if ((unsigned char) *s < 0x20)
+            g_string_append_printf (json, "\\u%04x", (unsigned) *s);
+        else
+            g_string_append_c (json, *s);
+    }
+    g_string_append_c (json, '"');
+}
+
+
+/**
+ * cog_startup_trace_begin:
+ * @name: Name of the phase.
+ *
+ * Records the start of a startup phase, which ends with a call to
+ * [func@startup_trace_end] from the same thread.
+ *
+ * Startup phases are only recorded when the `COG_STARTUP_TRACE`
+ * environment variable is set to the path of a file, where they will be
+ * written by [func@startup_trace_finish].
+ */
+void
+cog_startup_trace_begin (const char *name)
+{
+    g_return_if_fail (name != NULL);
+    startup_trace_record (name, 'B');
+}
+
+/**
+ * cog_startup_trace_end:
+ * @name: Name of the phase.
+ *
+ * Records the end of a startup phase started with
+ * [func@startup_trace_begin].
+ */
+void
+cog_startup_trace_end (const char *name)
+{
+    g_return_if_fail (name != NULL);
+    startup_trace_record (name, 'E');
+}
+
+/**
+ * cog_startup_trace_mark:
+ * @name: Name of the event.
+ *
+ * Records an event which happens at a single point in time during startup.
+ */
+void
+cog_startup_trace_mark (const char *name)
+{
+    g_return_if_fail (name != NULL);
+    startup_trace_record (name, 'i');
+}
+
+/**
+ * cog_startup_trace_frame_shown:
+ *
+ * Records that a frame has been shown on screen. Only the first call
+ * records an event, so platform plug-ins may call this for every frame.
+ *
+ * If [func@startup_trace_finish_after_frame] was called before, this
+ * writes the trace.
+ */
+void
+cog_startup_trace_frame_shown (void)
+{
+    startup_trace_init ();
+    if (!s_trace.path)
+        return;
+
+    g_mutex_lock (&s_trace.mutex);
+    const gboolean first = !s_trace.frame_shown;
+    s_trace.frame_shown = TRUE;
+    const gboolean finish = first && s_trace.finish_requested;
+    g_mutex_unlock (&s_trace.mutex);
+
+    if (first)
+        startup_trace_record ("first-frame-shown", 'i');
+    if (finish)
+        cog_startup_trace_finish ();
+}
+
+static gboolean
+on_finish_timeout (void *data G_GNUC_UNUSED)
+{
+    s_trace.finish_source = 0;
+    startup_trace_record ("first-frame-timeout", 'i');
+    cog_startup_trace_finish ();
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * cog_startup_trace_finish_after_frame:
+ * @timeout: Maximum time to wait, in milliseconds.
+ *
+ * Writes the trace as soon as a frame has been shown, see
+ * [func@startup_trace_frame_shown], or after @timeout if no frame is shown
+ * before. Startup may finish loading the page before its contents reach
+ * the screen, and this allows the trace to include the first frame.
+ *
+ * This function must be called from the main thread.
+ */
+void
+cog_startup_trace_finish_after_frame (unsigned timeout)
+{
+    startup_trace_init ();
+    if (!s_trace.path)
+        return;
+
+    g_mutex_lock (&s_trace.mutex);
+    const gboolean finish = s_trace.frame_shown;
+    s_trace.finish_requested = TRUE;
+    g_mutex_unlock (&s_trace.mutex);
+
+    if (finish)
+        cog_startup_trace_finish ();
+    else if (!s_trace.finish_source)
+        s_trace.finish_source = g_timeout_add (timeout, on_finish_timeout, NULL);
+}
+
+/**
+ * cog_startup_trace_finish:
+ *
+ * Stops recording startup phases, and writes the ones recorded so far to
+ * the file named by the `COG_STARTUP_TRACE` environment variable using the
+ * Chrome trace event format, which can be opened by tools like Perfetto or
+ * `chrome://tracing`. Threads are numbered in the order in which they first
+ * recorded an event.
+ *
+ * Calling this function more than once has no effect.
+ */
+void
+cog_startup_trace_finish (void)
+{
+    startup_trace_init ();
+
+    if (s_trace.finish_source) {
+        g_source_remove (s_trace.finish_source);
+        s_trace.finish_source = 0;
+    }
+
+    g_mutex_lock (&s_trace.mutex);
+    g_autoptr(GArray) events = g_steal_pointer (&s_trace.events);
+    g_mutex_unlock (&s_trace.mutex);
+
+    if (!events)
+        return;
+
+    const unsigned pid = (unsigned) getpid ();
+    g_autoptr(GPtrArray) threads = g_ptr_array_new ();
+    g_autoptr(GString) json = g_string_new ("{\"traceEvents\":[\n");
+
+    for (unsigned i = 0; i < events->len; i++) {
+        const TraceEvent *event = &g_array_index (events, TraceEvent, i);
+
+        unsigned tid;
+        for (tid = 0; tid < threads->len; tid++)
+            if (g_ptr_array_index (threads, tid) == event->thread)
+                break;
+        if (tid == threads->len)
+            g_ptr_array_add (threads, event->thread);
+
+        g_string_append (json, "{\"name\":");
+        append_json_string (json, event->name);
+        g_string_append_printf (json,
+                                ",\"ph\":\"%c\",\"ts\":%" G_GINT64_FORMAT
+                                ",\"pid\":%u,\"tid\":%u%s},\n",
+                                event->phase, event->timestamp, pid, tid + 1,
+                                event->phase == 'i' ? ",\"s\":\"p\"" : "");
+    }
+
+    g_string_append_printf (json,
+                            "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,"
+                            "\"args\":{\"name\":",
+                            pid);
+    append_json_string (json, g_get_prgname () ? g_get_prgname () : "cog");
+    g_string_append (json, "}}\n]}\n");
+
+    g_autoptr(GError) error = NULL;
+    if (!g_file_set_contents (s_trace.path, json->str, json->len, &error))
+        g_warning ("Cannot write startup trace: %s", error->message);
+    else
+        g_debug ("Startup trace written to %s", s_trace.path);
+}
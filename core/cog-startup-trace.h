@@ -0,0 +1,25 @@
+/*
+ * cog-startup-trace.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#if !(defined(COG_INSIDE_COG__) && COG_INSIDE_COG__)
+# error "Do not include this header directly, use <cog.h> instead"
+#endif
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+void cog_startup_trace_begin              (const char *name);
+void cog_startup_trace_end                (const char *name);
+void cog_startup_trace_mark               (const char *name);
+void cog_startup_trace_frame_shown        (void);
+void cog_startup_trace_finish_after_frame (unsigned timeout);
+void cog_startup_trace_finish             (void);
+
+G_END_DECLS
@@ -0,0 +1,201 @@
+/*
+ * cog-threaded-request-handler.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "cog-threaded-request-handler.h"
+#include "cog-io-pool.h"
+
+/**
+ * CogThreadedRequestHandler:
+ *
+ * Base class for request handlers which do their work in a thread pool.
+ *
+ * Request handlers are run in the main thread, which means that any
+ * blocking operation done while handling a request delays processing
+ * input events and rendering. Subclasses of this type implement the
+ * [vfunc@Cog.ThreadedRequestHandler.run_in_thread] method instead of
+ * [vfunc@Cog.RequestHandler.run]; it runs in a worker thread and produces
+ * a [struct@Cog.ThreadedResponse], which is then used to finish the
+ * request from the main thread.
+ *
+ * The [class@WebKit.URISchemeRequest] object is not thread-safe, so the
+ * worker only receives the request URI. If WebKit drops a request before
+ * it is finished, for example because the page that issued it has been
+ * navigated away, the cancellable passed to the worker is triggered and
+ * the response discarded.
+ *
+ * ```c
+ * static gboolean
+ * my_handler_run_in_thread (CogThreadedRequestHandler *handler,
+ *                           const char                *uri,
+ *                           CogThreadedResponse       *response,
+ *                           GCancellable              *cancellable,
+ *                           GError                   **error)
+ * {
+ *     g_autofree char *json = query_database (uri, cancellable, error);
+ *     if (!json)
+ *         return FALSE;
+ *
+ *     const size_t length = strlen (json);
+ *     response->contents = g_bytes_new_take (g_steal_pointer (&json), length);
+ *     response->mime_type = g_strdup ("application/json");
+ *     return TRUE;
+ * }
+ * ```
+ */
+
+typedef struct {
+    WebKitURISchemeRequest *request;    /* Weak, cleared if dropped. */
+    char                   *uri;
+    GCancellable           *cancellable;
+    CogThreadedResponse     response;
+} ThreadedRequest;
+
+
+static void cog_threaded_request_handler_iface_init (CogRequestHandlerInterface *iface);
+
+G_DEFINE_ABSTRACT_TYPE_WITH_CODE (CogThreadedRequestHandler,
+                                  cog_threaded_request_handler,
+                                  G_TYPE_OBJECT,
+                                  G_IMPLEMENT_INTERFACE (COG_TYPE_REQUEST_HANDLER,
+                                                         cog_threaded_request_handler_iface_init))
+
+
+static void
+on_request_dropped (void    *user_data,
+                    GObject *where_the_object_was G_GNUC_UNUSED)
+{
+    ThreadedRequest *data = user_data;
+    g_debug ("%s: Request for %s dropped", __func__, data->uri);
+    data->request = NULL;
+    g_cancellable_cancel (data->cancellable);
+}
+
+
+static void
+threaded_request_free (void *pointer)
+{
+    /*
+     * The weak reference to the request is removed from the main thread
+     * on completion, as this may be called from a worker thread.
+     */
+    ThreadedRequest *data = pointer;
+    g_clear_pointer (&data->uri, g_free);
+    g_clear_object (&data->cancellable);
+    g_clear_pointer (&data->response.contents, g_bytes_unref);
+    g_clear_object (&data->response.stream);
+    g_clear_pointer (&data->response.mime_type, g_free);
+    g_slice_free (ThreadedRequest, data);
+}
+
+
+static void
+run_request_thread (GTask        *task,
+                    void         *source_object,
+                    void         *task_data,
+                    GCancellable *cancellable)
+{
+    CogThreadedRequestHandler *handler = COG_THREADED_REQUEST_HANDLER (source_object);
+    ThreadedRequest *data = task_data;
+
+    if (g_task_return_error_if_cancelled (task))
+        return;
+
+    g_autoptr(GError) error = NULL;
+    CogThreadedRequestHandlerClass *klass = COG_THREADED_REQUEST_HANDLER_GET_CLASS (handler);
+    if (!(*klass->run_in_thread) (handler, data->uri, &data->response, cancellable, &error)) {
+        g_assert (error);
+        g_task_return_error (task, g_steal_pointer (&error));
+        return;
+    }
+
+    if (!data->response.contents && !data->response.stream) {
+        g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                                 "No response produced for %s", data->uri);
+        return;
+    }
+
+    g_task_return_boolean (task, TRUE);
+}
+
+
+static void
+on_run_request_completed (GObject      *source_object G_GNUC_UNUSED,
+                          GAsyncResult *result,
+                          void         *user_data G_GNUC_UNUSED)
+{
+    ThreadedRequest *data = g_task_get_task_data (G_TASK (result));
+
+    if (!data->request) {
+        g_debug ("%s: Discarding response for %s", __func__, data->uri);
+        return;
+    }
+
+    g_autoptr(WebKitURISchemeRequest) request = g_object_ref (data->request);
+    g_object_weak_unref (G_OBJECT (request), on_request_dropped, data);
+    data->request = NULL;
+
+    g_autoptr(GError) error = NULL;
+    if (!g_task_propagate_boolean (G_TASK (result), &error)) {
+        cog_request_finish_error (request, error);
+    } else if (data->response.contents) {
+        cog_request_finish_bytes (request,
+                                  data->response.contents,
+                                  data->response.mime_type);
+    } else {
+        cog_request_finish (request,
+                            data->response.stream,
+                            data->response.length,
+                            data->response.mime_type);
+    }
+}
+
+
+static void
+cog_threaded_request_handler_run (CogRequestHandler      *request_handler,
+                                  WebKitURISchemeRequest *request)
+{
+    CogThreadedRequestHandler *handler = COG_THREADED_REQUEST_HANDLER (request_handler);
+    g_return_if_fail (COG_THREADED_REQUEST_HANDLER_GET_CLASS (handler)->run_in_thread != NULL);
+
+    ThreadedRequest *data = g_slice_new0 (ThreadedRequest);
+    data->request = request;
+    data->uri = g_strdup (webkit_uri_scheme_request_get_uri (request));
+    data->cancellable = g_cancellable_new ();
+    data->response.length = -1;
+
+    /*
+     * WebKit keeps a reference to the request until it is finished or
+     * the load is stopped; do not hold another one, to notice the latter.
+     */
+    g_object_weak_ref (G_OBJECT (request), on_request_dropped, data);
+
+    g_autoptr(GTask) task = g_task_new (handler, data->cancellable, on_run_request_completed, NULL);
+    g_task_set_source_tag (task, cog_threaded_request_handler_run);
+    g_task_set_task_data (task, data, threaded_request_free);
+    cog_io_pool_run_in_thread (task,
+                               run_request_thread,
+                               cog_io_priority_for_request (request, NULL));
+}
+
+
+static void
+cog_threaded_request_handler_iface_init (CogRequestHandlerInterface *iface)
+{
+    iface->run = cog_threaded_request_handler_run;
+}
+
+
+static void
+cog_threaded_request_handler_class_init (CogThreadedRequestHandlerClass *klass G_GNUC_UNUSED)
+{
+}
+
+
+static void
+cog_threaded_request_handler_init (CogThreadedRequestHandler *self G_GNUC_UNUSED)
+{
+}
@@ -0,0 +1,56 @@
+/*
+ * cog-threaded-request-handler.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#if !(defined(COG_INSIDE_COG__) && COG_INSIDE_COG__)
+# error "Do not include this header directly, use <cog.h> instead"
+#endif
+
+#include "cog-request-handler.h"
+
+G_BEGIN_DECLS
+
+/**
+ * CogThreadedResponse:
+ * @contents: (nullable): Response body, if it is produced in memory.
+ * @stream: (nullable): Stream to read the response body from, used
+ *    when @contents is %NULL.
+ * @length: Length of the data in @stream, or `-1` if unknown.
+ * @mime_type: (nullable): MIME type of the response body.
+ *
+ * Response produced by [vfunc@Cog.ThreadedRequestHandler.run_in_thread].
+ * All the fields are owned by the response, and released after it has
+ * been passed to WebKit.
+ */
+typedef struct {
+    GBytes       *contents;
+    GInputStream *stream;
+    gint64        length;
+    char         *mime_type;
+} CogThreadedResponse;
+
+
+#define COG_TYPE_THREADED_REQUEST_HANDLER  (cog_threaded_request_handler_get_type ())
+
+G_DECLARE_DERIVABLE_TYPE (CogThreadedRequestHandler,
+                          cog_threaded_request_handler,
+                          COG, THREADED_REQUEST_HANDLER,
+                          GObject)
+
+struct _CogThreadedRequestHandlerClass {
+    GObjectClass parent_class;
+
+    /*< public >*/
+    gboolean (*run_in_thread) (CogThreadedRequestHandler *handler,
+                               const char                *uri,
+                               CogThreadedResponse       *response,
+                               GCancellable              *cancellable,
+                               GError                   **error);
+};
+
+G_END_DECLS
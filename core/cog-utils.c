@@ -116,6 +116,54 @@ cog_uri_guess_from_user_input (const char *uri_like,
     return g_strconcat ("http://", utf8_uri_like, NULL);
 }
 
+/**
+ * cog_uri_list_load:
+ * @path: Path to a file.
+ * @error: Location where to store an error.
+ *
+ * Loads a list of URIs from a text file with one entry per line. Empty
+ * lines and lines starting with `#` are skipped, and each entry is passed
+ * through [func@uri_guess_from_user_input], so they may be given in the
+ * same way as in the command line.
+ *
+ * Returns: (transfer full) (array zero-terminated=1): The list of URIs,
+ *    or %NULL if the file cannot be read or it does not contain any URI.
+ */
+GStrv
+cog_uri_list_load (const char *path,
+                   GError    **error)
+{
+    g_return_val_if_fail (path, NULL);
+
+    g_autofree char *contents = NULL;
+    if (!g_file_get_contents (path, &contents, NULL, error))
+        return NULL;
+
+    g_autoptr(GPtrArray) uris = g_ptr_array_new_with_free_func (g_free);
+    g_auto(GStrv) lines = g_strsplit (contents, "\n", -1);
+    for (unsigned i = 0; lines[i]; i++) {
+        char *line = g_strstrip (lines[i]);
+        if (line[0] == '\0' || line[0] == '#')
+            continue;
+
+        char *uri = cog_uri_guess_from_user_input (line, TRUE, error);
+        if (!uri) {
+            g_prefix_error (error, "%s:%u: ", path, i + 1);
+            return NULL;
+        }
+        g_ptr_array_add (uris, uri);
+    }
+
+    if (uris->len == 0) {
+        g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                     "File '%s' does not contain any URI", path);
+        return NULL;
+    }
+
+    g_ptr_array_add (uris, NULL);
+    return (GStrv) g_ptr_array_free (g_steal_pointer (&uris), FALSE);
+}
+
 
 static gboolean
 option_entry_parse_to_property (const char *option,
@@ -29,6 +29,9 @@ char* cog_uri_guess_from_user_input (const char *uri_like,
                                      gboolean    is_cli_arg,
                                      GError    **error);
 
+GStrv cog_uri_list_load (const char *path,
+                         GError    **error);
+
 GOptionEntry* cog_option_entries_from_class (GObjectClass *klass);
 
 
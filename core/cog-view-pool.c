@@ -0,0 +1,201 @@
+/*
+ * cog-view-pool.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "cog-view-pool.h"
+
+/*
+ * Bookkeeping for the pool of views of a shell. The pool owns the views,
+ * tracks the state of each one, and calls a function to apply the state
+ * whenever it changes. Views are opaque, which keeps the state transitions
+ * independent from the web engine.
+ */
+
+typedef struct {
+    void        *view;
+    CogViewState state;
+} ViewEntry;
+
+struct _CogViewPool {
+    GArray          *entries;  /* (ViewEntry) */
+    void            *active;
+    CogViewStateFunc state_func;
+    GDestroyNotify   view_free_func;
+};
+
+
+static ViewEntry*
+cog_view_pool_find (CogViewPool *pool, void *view, unsigned *index)
+{
+    for (unsigned i = 0; i < pool->entries->len; i++) {
+        ViewEntry *entry = &g_array_index (pool->entries, ViewEntry, i);
+        if (entry->view == view) {
+            if (index)
+                *index = i;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+
+static void
+view_entry_set_state (CogViewPool *pool, ViewEntry *entry, CogViewState state)
+{
+    if (entry->state == state)
+        return;
+
+    entry->state = state;
+    (*pool->state_func) (entry->view, state);
+}
+
+
+CogViewPool*
+cog_view_pool_new (CogViewStateFunc state_func,
+                   GDestroyNotify   view_free_func)
+{
+    g_return_val_if_fail (state_func, NULL);
+
+    CogViewPool *pool = g_slice_new0 (CogViewPool);
+    pool->entries = g_array_new (FALSE, FALSE, sizeof (ViewEntry));
+    pool->state_func = state_func;
+    pool->view_free_func = view_free_func;
+    return pool;
+}
+
+
+void
+cog_view_pool_free (CogViewPool *pool)
+{
+    g_return_if_fail (pool);
+
+    for (unsigned i = 0; pool->view_free_func && i < pool->entries->len; i++)
+        (*pool->view_free_func) (g_array_index (pool->entries, ViewEntry, i).view);
+
+    g_array_free (pool->entries, TRUE);
+    g_slice_free (CogViewPool, pool);
+}
+
+
+/*
+ * Adds a view, taking ownership of it, and puts it in the preloaded state.
+ */
+void
+cog_view_pool_add (CogViewPool *pool,
+                   void        *view)
+{
+    g_return_if_fail (pool);
+    g_return_if_fail (view);
+    g_return_if_fail (!cog_view_pool_contains (pool, view));
+
+    /*
+     * The state function is always called, as the initial state of the
+     * view is not known.
+     */
+    ViewEntry entry = { view, COG_VIEW_STATE_PRELOADED };
+    g_array_append_val (pool->entries, entry);
+    (*pool->state_func) (view, COG_VIEW_STATE_PRELOADED);
+}
+
+
+/*
+ * Makes a view the active one, leaving the previously active view in the
+ * preloaded state. Returns whether the active view changed.
+ */
+gboolean
+cog_view_pool_activate (CogViewPool *pool,
+                        void        *view)
+{
+    g_return_val_if_fail (pool, FALSE);
+
+    ViewEntry *entry = cog_view_pool_find (pool, view, NULL);
+    g_return_val_if_fail (entry, FALSE);
+
+    if (pool->active == view)
+        return FALSE;
+
+    if (pool->active)
+        view_entry_set_state (pool, cog_view_pool_find (pool, pool->active, NULL), COG_VIEW_STATE_PRELOADED);
+
+    pool->active = view;
+    view_entry_set_state (pool, entry, COG_VIEW_STATE_ACTIVE);
+    return TRUE;
+}
+
+
+/*
+ * Suspends a view which is not the active one.
+ */
+void
+cog_view_pool_suspend (CogViewPool *pool,
+                       void        *view)
+{
+    g_return_if_fail (pool);
+    g_return_if_fail (pool->active != view);
+
+    ViewEntry *entry = cog_view_pool_find (pool, view, NULL);
+    g_return_if_fail (entry);
+
+    view_entry_set_state (pool, entry, COG_VIEW_STATE_SUSPENDED);
+}
+
+
+/*
+ * Removes a view which is not the active one, releasing it.
+ */
+void
+cog_view_pool_remove (CogViewPool *pool,
+                      void        *view)
+{
+    g_return_if_fail (pool);
+    g_return_if_fail (pool->active != view);
+
+    unsigned index;
+    if (!cog_view_pool_find (pool, view, &index))
+        g_return_if_reached ();
+
+    g_array_remove_index (pool->entries, index);
+    if (pool->view_free_func)
+        (*pool->view_free_func) (view);
+}
+
+
+gboolean
+cog_view_pool_contains (CogViewPool *pool,
+                        void        *view)
+{
+    g_return_val_if_fail (pool, FALSE);
+    return cog_view_pool_find (pool, view, NULL) != NULL;
+}
+
+
+CogViewState
+cog_view_pool_get_state (CogViewPool *pool,
+                         void        *view)
+{
+    g_return_val_if_fail (pool, COG_VIEW_STATE_SUSPENDED);
+
+    const ViewEntry *entry = cog_view_pool_find (pool, view, NULL);
+    g_return_val_if_fail (entry, COG_VIEW_STATE_SUSPENDED);
+
+    return entry->state;
+}
+
+
+void*
+cog_view_pool_get_active (CogViewPool *pool)
+{
+    g_return_val_if_fail (pool, NULL);
+    return pool->active;
+}
+
+
+unsigned
+cog_view_pool_get_size (CogViewPool *pool)
+{
+    g_return_val_if_fail (pool, 0);
+    return pool->entries->len;
+}
@@ -0,0 +1,62 @@
+/*
+ * cog-view-pool.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * States of the views in a pool:
+ *
+ *  - Active: on screen, visible and focused. At most one view is active.
+ *  - Preloaded: visible but not focused, so pages keep running and
+ *    rendering, which allows them to be activated immediately.
+ *  - Suspended: neither visible nor in a window, pages are throttled.
+ */
+typedef enum {
+    COG_VIEW_STATE_SUSPENDED,
+    COG_VIEW_STATE_PRELOADED,
+    COG_VIEW_STATE_ACTIVE,
+} CogViewState;
+
+typedef void (*CogViewStateFunc) (void *view, CogViewState state);
+
+typedef struct _CogViewPool CogViewPool;
+
+G_GNUC_INTERNAL
+CogViewPool *cog_view_pool_new        (CogViewStateFunc state_func,
+                                       GDestroyNotify   view_free_func);
+G_GNUC_INTERNAL
+void         cog_view_pool_free       (CogViewPool     *pool);
+
+G_GNUC_INTERNAL
+void         cog_view_pool_add        (CogViewPool     *pool,
+                                       void            *view);
+G_GNUC_INTERNAL
+gboolean     cog_view_pool_activate   (CogViewPool     *pool,
+                                       void            *view);
+G_GNUC_INTERNAL
+void         cog_view_pool_suspend    (CogViewPool     *pool,
+                                       void            *view);
+G_GNUC_INTERNAL
+void         cog_view_pool_remove     (CogViewPool     *pool,
+                                       void            *view);
+
+G_GNUC_INTERNAL
+gboolean     cog_view_pool_contains   (CogViewPool     *pool,
+                                       void            *view);
+G_GNUC_INTERNAL
+CogViewState cog_view_pool_get_state  (CogViewPool     *pool,
+                                       void            *view);
+G_GNUC_INTERNAL
+void        *cog_view_pool_get_active (CogViewPool     *pool);
+G_GNUC_INTERNAL
+unsigned     cog_view_pool_get_size   (CogViewPool     *pool);
+
+G_END_DECLS
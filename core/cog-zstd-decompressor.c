@@ -0,0 +1,144 @@
+/*
+ * cog-zstd-decompressor.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "cog-zstd-decompressor.h"
+#include <zstd.h>
+
+/*
+ * CogZstdDecompressor:
+ *
+ * Implementation of [iface@Gio.Converter] which decompresses data in the
+ * Zstandard format, to be used with [class@Gio.ConverterInputStream] in
+ * the same way as [class@Gio.ZlibDecompressor].
+ */
+
+struct _CogZstdDecompressor {
+    GObject parent;
+
+    ZSTD_DStream *dstream;
+    gboolean      frame_finished;
+};
+
+
+static GConverterResult
+cog_zstd_decompressor_convert (GConverter     *converter,
+                               const void     *inbuf,
+                               gsize           inbuf_size,
+                               void           *outbuf,
+                               gsize           outbuf_size,
+                               GConverterFlags flags,
+                               gsize          *bytes_read,
+                               gsize          *bytes_written,
+                               GError        **error)
+{
+    CogZstdDecompressor *self = COG_ZSTD_DECOMPRESSOR (converter);
+
+    if (outbuf_size == 0) {
+        g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE,
+                             "Need more output space");
+        return G_CONVERTER_ERROR;
+    }
+
+    ZSTD_inBuffer input = { .src = inbuf, .size = inbuf_size, .pos = 0 };
+    ZSTD_outBuffer output = { .dst = outbuf, .size = outbuf_size, .pos = 0 };
+
+    size_t ret = ZSTD_decompressStream (self->dstream, &output, &input);
+    if (ZSTD_isError (ret)) {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                     "Invalid compressed data: %s", ZSTD_getErrorName (ret));
+        return G_CONVERTER_ERROR;
+    }
+
+    *bytes_read = input.pos;
+    *bytes_written = output.pos;
+
+    /*
+     * A zero return value means that a frame was completely decoded and
+     * flushed. Input may contain more than one frame, so only consider
+     * the conversion finished once all the input has been consumed.
+     */
+    if (input.pos > 0 || output.pos > 0)
+        self->frame_finished = (ret == 0);
+
+    if (flags & G_CONVERTER_INPUT_AT_END) {
+        if (input.pos == inbuf_size && self->frame_finished)
+            return G_CONVERTER_FINISHED;
+        if (input.pos == 0 && output.pos == 0) {
+            g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                                 "Compressed data is truncated");
+            return G_CONVERTER_ERROR;
+        }
+    } else if (input.pos == 0 && output.pos == 0) {
+        g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT,
+                             "Need more input");
+        return G_CONVERTER_ERROR;
+    }
+
+    if ((flags & G_CONVERTER_FLUSH) && input.pos == inbuf_size && output.pos < outbuf_size)
+        return G_CONVERTER_FLUSHED;
+
+    return G_CONVERTER_CONVERTED;
+}
+
+
+static void
+cog_zstd_decompressor_reset (GConverter *converter)
+{
+    CogZstdDecompressor *self = COG_ZSTD_DECOMPRESSOR (converter);
+
+    ZSTD_initDStream (self->dstream);
+    self->frame_finished = FALSE;
+}
+
+
+static void
+cog_zstd_decompressor_converter_iface_init (GConverterIface *iface)
+{
+    iface->convert = cog_zstd_decompressor_convert;
+    iface->reset = cog_zstd_decompressor_reset;
+}
+
+
+G_DEFINE_TYPE_WITH_CODE (CogZstdDecompressor,
+                         cog_zstd_decompressor,
+                         G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_CONVERTER,
+                                                cog_zstd_decompressor_converter_iface_init))
+
+
+static void
+cog_zstd_decompressor_finalize (GObject *object)
+{
+    CogZstdDecompressor *self = COG_ZSTD_DECOMPRESSOR (object);
+
+    g_clear_pointer (&self->dstream, ZSTD_freeDStream);
+
+    G_OBJECT_CLASS (cog_zstd_decompressor_parent_class)->finalize (object);
+}
+
+
+static void
+cog_zstd_decompressor_class_init (CogZstdDecompressorClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    object_class->finalize = cog_zstd_decompressor_finalize;
+}
+
+
+static void
+cog_zstd_decompressor_init (CogZstdDecompressor *self)
+{
+    self->dstream = ZSTD_createDStream ();
+    ZSTD_initDStream (self->dstream);
+}
+
+
+GConverter*
+cog_zstd_decompressor_new (void)
+{
+    return g_object_new (COG_TYPE_ZSTD_DECOMPRESSOR, NULL);
+}
@@ -0,0 +1,25 @@
+/*
+ * cog-zstd-decompressor.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define COG_TYPE_ZSTD_DECOMPRESSOR  (cog_zstd_decompressor_get_type ())
+
+G_GNUC_INTERNAL
+G_DECLARE_FINAL_TYPE (CogZstdDecompressor,
+                      cog_zstd_decompressor,
+                      COG, ZSTD_DECOMPRESSOR,
+                      GObject)
+
+G_GNUC_INTERNAL
+GConverter *cog_zstd_decompressor_new (void);
+
+G_END_DECLS
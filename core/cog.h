@@ -15,10 +15,19 @@
 #include "cog-config.h"
 #include "cog-webkit-utils.h"
 #include "cog-request-handler.h"
+#include "cog-request-middleware.h"
+#include "cog-access-log-middleware.h"
+#include "cog-cache-middleware.h"
+#include "cog-latency-middleware.h"
+#include "cog-threaded-request-handler.h"
 #include "cog-directory-files-handler.h"
+#include "cog-bundle-files-handler.h"
+#include "cog-overlay-files-handler.h"
 #include "cog-prefix-routes-handler.h"
+#include "cog-socket-proxy-handler.h"
 #include "cog-launcher.h"
 #include "cog-shell.h"
+#include "cog-startup-trace.h"
 #include "cog-utils.h"
 #include "cog-platform.h"
 
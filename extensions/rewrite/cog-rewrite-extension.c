@@ -0,0 +1,101 @@
+/*
+ * cog-rewrite-extension.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+/*
+ * Web extension which rewrites the URIs of resources requested by pages
+ * using the prefixes from a compiled rewrite map (see cog-rewrite-map(1)).
+ * This allows serving well-known remote resources, e.g. libraries loaded
+ * from a CDN, from a local custom URI scheme without going to the network.
+ *
+ * The path to the map is taken from the "rewrite-map" entry of the
+ * initialization user data set by the launcher, or from the COG_REWRITE_MAP
+ * environment variable. Web extensions run in the main thread of each web
+ * process, so no locking is needed.
+ */
+
+#include "cog-rewrite-map.h"
+
+#include <gmodule.h>
+#include <wpe/webkit-web-extension.h>
+
+
+static struct {
+    CogRewriteMap *map;
+    guint64        hits;
+    guint64        misses;
+} s_rewrites = { NULL, };
+
+
+static gboolean
+on_page_send_request (WebKitWebPage     *page G_GNUC_UNUSED,
+                      WebKitURIRequest  *request,
+                      WebKitURIResponse *redirected_response G_GNUC_UNUSED,
+                      void              *user_data G_GNUC_UNUSED)
+{
+    const char *uri = webkit_uri_request_get_uri (request);
+
+    /* Only account for requests which would have gone to the network. */
+    if (!g_str_has_prefix (uri, "http://") && !g_str_has_prefix (uri, "https://"))
+        return FALSE;
+
+    const char *remainder;
+    const char *replacement = cog_rewrite_map_lookup (s_rewrites.map, uri, &remainder);
+    if (!replacement) {
+        s_rewrites.misses++;
+        return FALSE;
+    }
+
+    s_rewrites.hits++;
+    g_autofree char *new_uri = g_strconcat (replacement, remainder, NULL);
+    g_debug ("Rewriting %s -> %s", uri, new_uri);
+    webkit_uri_request_set_uri (request, new_uri);
+    return FALSE;
+}
+
+
+static void
+on_page_document_loaded (WebKitWebPage *page,
+                         void          *user_data G_GNUC_UNUSED)
+{
+    g_info ("Page %" G_GUINT64_FORMAT " loaded, rewrites: %" G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT " misses",
+            webkit_web_page_get_id (page), s_rewrites.hits, s_rewrites.misses);
+}
+
+
+static void
+on_page_created (WebKitWebExtension *extension G_GNUC_UNUSED,
+                 WebKitWebPage      *page,
+                 void               *user_data G_GNUC_UNUSED)
+{
+    g_signal_connect (page, "send-request", G_CALLBACK (on_page_send_request), NULL);
+    g_signal_connect (page, "document-loaded", G_CALLBACK (on_page_document_loaded), NULL);
+}
+
+
+G_MODULE_EXPORT void
+webkit_web_extension_initialize_with_user_data (WebKitWebExtension *extension,
+                                                const GVariant     *user_data)
+{
+    const char *path = NULL;
+    if (user_data && g_variant_is_of_type ((GVariant*) user_data, G_VARIANT_TYPE_VARDICT))
+        g_variant_lookup ((GVariant*) user_data, "rewrite-map", "&s", &path);
+    if (!path)
+        path = g_getenv ("COG_REWRITE_MAP");
+    if (!path) {
+        g_debug ("No rewrite map configured");
+        return;
+    }
+
+    g_autoptr(GError) error = NULL;
+    if (!(s_rewrites.map = cog_rewrite_map_load (path, &error))) {
+        g_warning ("Cannot load rewrite map: %s", error->message);
+        return;
+    }
+
+    g_debug ("Loaded %u rewrites from %s", cog_rewrite_map_get_size (s_rewrites.map), path);
+    g_signal_connect (extension, "page-created", G_CALLBACK (on_page_created), NULL);
+}
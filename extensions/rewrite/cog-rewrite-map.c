@@ -0,0 +1,127 @@
+/*
+ * cog-rewrite-map.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "cog-rewrite-map.h"
+#include "../../core/cog-rewrite-map-format.h"
+
+#include <string.h>
+
+
+struct _CogRewriteMap {
+    GMappedFile *file;
+    GVariant    *map;
+    GHashTable  *prefixes;  /* (string, string), pointing into map. */
+    GString     *scratch;
+};
+
+
+/*
+ * Loads a rewrite map written by cog-rewrite-map(1). The file is mapped
+ * into memory, and the table of prefixes points into the mapped data.
+ */
+CogRewriteMap*
+cog_rewrite_map_load (const char *path, GError **error)
+{
+    g_autoptr(GMappedFile) file = g_mapped_file_new (path, FALSE, error);
+    if (!file)
+        return NULL;
+
+    g_autoptr(GBytes) bytes = g_mapped_file_get_bytes (file);
+    g_autoptr(GVariant) map =
+        g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (COG_REWRITE_MAP_TYPE), bytes, FALSE));
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+    g_autoptr(GVariant) swapped = g_variant_byteswap (map);
+    g_variant_unref (map);
+    map = g_steal_pointer (&swapped);
+#endif
+
+    const char *magic;
+    guint32 version;
+    g_autoptr(GVariantIter) iter = NULL;
+    g_variant_get (map, "(&sua{ss})", &magic, &version, &iter);
+    if (strcmp (magic, COG_REWRITE_MAP_MAGIC) != 0 || version != COG_REWRITE_MAP_VERSION) {
+        g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                     "File '%s' is not a valid rewrite map", path);
+        return NULL;
+    }
+
+    CogRewriteMap *self = g_slice_new (CogRewriteMap);
+    self->prefixes = g_hash_table_new (g_str_hash, g_str_equal);
+    const char *prefix, *replacement;
+    while (g_variant_iter_next (iter, "{&s&s}", &prefix, &replacement))
+        g_hash_table_insert (self->prefixes, (char*) prefix, (char*) replacement);
+
+    self->file = g_steal_pointer (&file);
+    self->map = g_steal_pointer (&map);
+    self->scratch = g_string_sized_new (256);
+    return self;
+}
+
+
+void
+cog_rewrite_map_free (CogRewriteMap *self)
+{
+    g_return_if_fail (self);
+
+    g_hash_table_unref (self->prefixes);
+    g_variant_unref (self->map);
+    g_mapped_file_unref (self->file);
+    g_string_free (self->scratch, TRUE);
+    g_slice_free (CogRewriteMap, self);
+}
+
+
+unsigned
+cog_rewrite_map_get_size (CogRewriteMap *self)
+{
+    g_return_val_if_fail (self, 0);
+    return g_hash_table_size (self->prefixes);
+}
+
+
+/*
+ * Finds the longest prefix of an URI which has a replacement. The whole
+ * URI up to the query or fragment is tried first, and then shorter prefixes
+ * ending in slashes, which needs as many lookups as path components. On
+ * success, the remainder points to the part of the URI after the prefix.
+ *
+ * Maps are not thread safe, because lookups reuse a scratch buffer.
+ */
+const char*
+cog_rewrite_map_lookup (CogRewriteMap *self,
+                        const char    *uri,
+                        const char   **remainder)
+{
+    g_return_val_if_fail (self, NULL);
+    g_return_val_if_fail (uri, NULL);
+    g_return_val_if_fail (remainder, NULL);
+
+    const char *authority = strstr (uri, "://");
+    if (!authority)
+        return NULL;
+    authority += 3;
+
+    size_t length = strcspn (uri, "?#");
+    for (;;) {
+        g_string_truncate (self->scratch, 0);
+        g_string_append_len (self->scratch, uri, length);
+
+        const char *replacement = g_hash_table_lookup (self->prefixes, self->scratch->str);
+        if (replacement) {
+            *remainder = uri + length;
+            return replacement;
+        }
+
+        /* Continue with the prefix ending in the previous slash. */
+        if (length > 0 && uri[length - 1] == '/')
+            length--;
+        while (length > (size_t) (authority - uri) && uri[length - 1] != '/')
+            length--;
+        if (length <= (size_t) (authority - uri))
+            return NULL;
+    }
+}
@@ -0,0 +1,26 @@
+/*
+ * cog-rewrite-map.h
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CogRewriteMap CogRewriteMap;
+
+CogRewriteMap *cog_rewrite_map_load     (const char    *path,
+                                         GError       **error);
+void           cog_rewrite_map_free     (CogRewriteMap *map);
+unsigned       cog_rewrite_map_get_size (CogRewriteMap *map);
+const char    *cog_rewrite_map_lookup   (CogRewriteMap *map,
+                                         const char    *uri,
+                                         const char   **remainder);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (CogRewriteMap, cog_rewrite_map_free)
+
+G_END_DECLS
@@ -45,6 +45,8 @@ typedef EGLDisplay (EGLAPIENTRYP PFNEGLGETPLATFORMDISPLAYEXTPROC) (EGLenum platf
 #define KEY_STARTUP_DELAY 500000
 #define KEY_REPEAT_DELAY 100000
 
+struct drm_view;
+
 struct buffer_object {
     struct wl_list link;
     struct wl_listener destroy_listener;
@@ -52,6 +54,7 @@ struct buffer_object {
     uint32_t fb_id;
     struct gbm_bo *bo;
     struct wl_resource *buffer_resource;
+    struct drm_view *view;      /* NULL once the view is destroyed. */
 
     struct  {
         struct wl_resource* resource;
@@ -92,6 +95,7 @@ static struct {
 
     bool atomic_modesetting;
     bool mode_set;
+    bool page_flip_pending;
     struct wl_list buffer_list;
     struct buffer_object *committed_buffer;
 } drm_data = {
@@ -111,6 +115,7 @@ static struct {
     .device_scale = 1.0,
     .atomic_modesetting = true,
     .mode_set = false,
+    .page_flip_pending = false,
     .committed_buffer = NULL,
 };
 
@@ -179,14 +184,55 @@ static struct {
     .key_repeat_source = NULL,
 };
 
-static struct {
+/*
+ * Each web view gets its own exportable. Only the buffers of the active
+ * view are scanned out. Other views keep rendering off screen, but their
+ * frame completion is dispatched from a timer instead of page flips, every
+ * OFFSCREEN_FRAME_INTERVAL milliseconds, so they do not compete with the
+ * active view. Only the latest buffer of an off screen view is kept, to be
+ * scanned out when it gets activated.
+ */
+#define OFFSCREEN_FRAME_INTERVAL 100
+
+struct drm_view {
     struct wpe_view_backend_exportable_fdo *exportable;
+    struct wpe_view_backend *backend;
+    struct buffer_object *pending_buffer;   /* Waiting to be committed. */
+    bool frame_pending;                     /* Frame completion due. */
+    unsigned offscreen_frame_source;
+};
+
+static struct {
+    struct drm_view *active_view;
+    GList *views;
 } wpe_host_data;
 
 static struct {
     struct wpe_view_backend *backend;
 } wpe_view_data;
 
+/*
+ * Page flip timings sampled during the first frames after switching the
+ * active view, used to check that swapping in a preloaded view does not
+ * drop any. The buffer on screen is committed again during the sampling
+ * when there is no new one, because a view showing static content does
+ * not produce new frames. A new buffer may then wait for one more page
+ * flip, which only happens during the sampled frames.
+ */
+#define VIEW_SWITCH_SAMPLE_FRAMES  10
+#define VIEW_SWITCH_SAMPLE_TIMEOUT 1    /* Seconds. */
+
+static struct {
+    guint    timeout_source;
+    bool     sampling;
+    unsigned frames_sampled;
+    gint64   switch_time;       /* Monotonic, in microseconds. */
+    unsigned last_sequence;     /* From page flips, in vertical blanks. */
+    gint64   last_flip_time;    /* From page flips, in microseconds. */
+    gint64   max_interval;
+    unsigned dropped_frames;
+} view_switch_stats;
+
 
 static void
 init_config (CogShell *shell)
@@ -226,23 +272,33 @@ init_config (CogShell *shell)
 
 
 static void
-destroy_buffer (struct buffer_object *buffer)
+release_buffer (struct buffer_object *buffer)
 {
-    drmModeRmFB (drm_data.fd, buffer->fb_id);
-    gbm_bo_destroy (buffer->bo);
-
     if (buffer->export.resource) {
-        wpe_view_backend_exportable_fdo_dispatch_release_buffer (wpe_host_data.exportable,
-                                                                 buffer->export.resource);
+        if (buffer->view) {
+            wpe_view_backend_exportable_fdo_dispatch_release_buffer (buffer->view->exportable,
+                                                                     buffer->export.resource);
+        }
         buffer->export.resource = NULL;
     }
 #if HAVE_SHM_EXPORTED_BUFFER
     if (buffer->export.shm_buffer) {
-        wpe_view_backend_exportable_fdo_dispatch_release_shm_exported_buffer (wpe_host_data.exportable,
-                                                                              buffer->export.shm_buffer);
+        if (buffer->view) {
+            wpe_view_backend_exportable_fdo_dispatch_release_shm_exported_buffer (buffer->view->exportable,
+                                                                                  buffer->export.shm_buffer);
+        }
         buffer->export.shm_buffer = NULL;
     }
 #endif
+}
+
+static void
+destroy_buffer (struct buffer_object *buffer)
+{
+    drmModeRmFB (drm_data.fd, buffer->fb_id);
+    gbm_bo_destroy (buffer->bo);
+
+    release_buffer (buffer);
     g_free (buffer);
 }
 
@@ -253,6 +309,8 @@ destroy_buffer_notify (struct wl_listener *listener, void *data)
 
     if (drm_data.committed_buffer == buffer)
         drm_data.committed_buffer = NULL;
+    if (buffer->view && buffer->view->pending_buffer == buffer)
+        buffer->view->pending_buffer = NULL;
 
     wl_list_remove (&buffer->link);
     destroy_buffer (buffer);
@@ -627,28 +685,113 @@ init_cursor (void)
     return TRUE;
 }
 
+static void drm_view_dispatch_frame_complete (struct drm_view *view);
+static void drm_view_commit_pending_buffer (struct drm_view *view);
+static void drm_commit_buffer (struct buffer_object *buffer);
+
 static void
-drm_page_flip_handler (int fd, unsigned int frame, unsigned int sec, unsigned int usec, void *data)
+view_switch_stats_clear (void)
 {
-    if (drm_data.committed_buffer) {
-        struct buffer_object* buffer = drm_data.committed_buffer;
+    if (view_switch_stats.timeout_source) {
+        g_source_remove (view_switch_stats.timeout_source);
+        view_switch_stats.timeout_source = 0;
+    }
+    view_switch_stats.sampling = false;
+}
 
-        if (buffer->export.resource) {
-            wpe_view_backend_exportable_fdo_dispatch_release_buffer (wpe_host_data.exportable,
-                                                                     buffer->export.resource);
-            buffer->export.resource = NULL;
-        }
-#if HAVE_SHM_EXPORTED_BUFFER
-        if (buffer->export.shm_buffer) {
-            wpe_view_backend_exportable_fdo_dispatch_release_shm_exported_buffer (wpe_host_data.exportable,
-                                                                                  buffer->export.shm_buffer);
-            buffer->export.shm_buffer = NULL;
-        }
-#endif
+static void
+view_switch_stats_stop (void)
+{
+    view_switch_stats_clear ();
+
+    g_message ("View switch: %u dropped frames, max frame interval %.2f ms "
+               "(refresh %u Hz, %u frames sampled)",
+               view_switch_stats.dropped_frames, view_switch_stats.max_interval / 1000.0,
+               drm_data.mode ? drm_data.mode->vrefresh : 0, view_switch_stats.frames_sampled);
+}
+
+static gboolean
+on_view_switch_stats_timeout (void *data)
+{
+    /* Page flips may stop coming e.g. when a commit fails. */
+    view_switch_stats.timeout_source = 0;
+    view_switch_stats_stop ();
+    return G_SOURCE_REMOVE;
+}
+
+static void
+view_switch_stats_start (gint64 switch_time)
+{
+    view_switch_stats_clear ();
+
+    view_switch_stats.sampling = true;
+    view_switch_stats.frames_sampled = 0;
+    view_switch_stats.switch_time = switch_time;
+    view_switch_stats.max_interval = 0;
+    view_switch_stats.dropped_frames = 0;
+
+    view_switch_stats.timeout_source = g_timeout_add_seconds (VIEW_SWITCH_SAMPLE_TIMEOUT,
+                                                              on_view_switch_stats_timeout,
+                                                              NULL);
+}
+
+static void
+view_switch_stats_sample (struct buffer_object *buffer,
+                          unsigned int          sequence,
+                          gint64                flip_time)
+{
+    /* A flip of a buffer from the view switched away from does not count. */
+    if (!buffer->view || buffer->view != wpe_host_data.active_view)
+        return;
+
+    if (view_switch_stats.frames_sampled == 0) {
+        g_debug ("View switch: first frame after %.2f ms",
+                 (g_get_monotonic_time () - view_switch_stats.switch_time) / 1000.0);
+    } else {
+        view_switch_stats.max_interval = MAX (view_switch_stats.max_interval,
+                                              flip_time - view_switch_stats.last_flip_time);
+
+        /* Each vertical blank skipped between flips is a missed frame. */
+        if (sequence > view_switch_stats.last_sequence + 1)
+            view_switch_stats.dropped_frames += sequence - view_switch_stats.last_sequence - 1;
     }
+    view_switch_stats.last_sequence = sequence;
+    view_switch_stats.last_flip_time = flip_time;
+
+    if (++view_switch_stats.frames_sampled == VIEW_SWITCH_SAMPLE_FRAMES)
+        view_switch_stats_stop ();
+}
+
+static void
+drm_page_flip_handler (int fd, unsigned int frame, unsigned int sec, unsigned int usec, void *data)
+{
+    cog_startup_trace_frame_shown ();
+
+    drm_data.page_flip_pending = false;
+
+    /* The same buffer is flipped again while sampling a view switch. */
+    if (drm_data.committed_buffer && drm_data.committed_buffer != data)
+        release_buffer (drm_data.committed_buffer);
     drm_data.committed_buffer = (struct buffer_object *) data;
 
-    wpe_view_backend_exportable_fdo_dispatch_frame_complete (wpe_host_data.exportable);
+    if (view_switch_stats.sampling)
+        view_switch_stats_sample (drm_data.committed_buffer, frame, sec * G_USEC_PER_SEC + (gint64) usec);
+
+    /*
+     * The buffer shown may be from a view which has been switched away
+     * from in the meantime, which gets completed by its off screen timer.
+     * The active view may be waiting for the page flip to present its
+     * own buffer.
+     */
+    struct drm_view *view = wpe_host_data.active_view;
+    if (view && view->pending_buffer)
+        drm_view_commit_pending_buffer (view);
+    else if (view && view->frame_pending)
+        drm_view_dispatch_frame_complete (view);
+
+    if (view_switch_stats.sampling && !drm_data.page_flip_pending &&
+        drm_data.committed_buffer && drm_data.committed_buffer->view == view)
+        drm_commit_buffer (drm_data.committed_buffer);
 }
 
 static struct buffer_object *
@@ -925,6 +1068,12 @@ drm_commit_buffer_atomic (struct buffer_object *buffer)
 static void
 drm_commit_buffer (struct buffer_object *buffer)
 {
+    static bool first_frame_committed = false;
+    if (!first_frame_committed) {
+        cog_startup_trace_mark ("first-frame-commit");
+        first_frame_committed = true;
+    }
+
     int ret;
     if (drm_data.atomic_modesetting)
         ret = drm_commit_buffer_atomic (buffer);
@@ -933,6 +1082,73 @@ drm_commit_buffer (struct buffer_object *buffer)
 
     if (ret)
         g_warning ("failed to schedule a page flip: %s", strerror (errno));
+    else
+        drm_data.page_flip_pending = true;
+}
+
+static void
+drm_view_dispatch_frame_complete (struct drm_view *view)
+{
+    view->frame_pending = false;
+    wpe_view_backend_exportable_fdo_dispatch_frame_complete (view->exportable);
+}
+
+static void
+drm_view_cancel_offscreen_frame (struct drm_view *view)
+{
+    if (view->offscreen_frame_source) {
+        g_source_remove (view->offscreen_frame_source);
+        view->offscreen_frame_source = 0;
+    }
+}
+
+static gboolean
+on_offscreen_frame_timeout (void *data)
+{
+    struct drm_view *view = data;
+
+    view->offscreen_frame_source = 0;
+    if (view != wpe_host_data.active_view && view->frame_pending)
+        drm_view_dispatch_frame_complete (view);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+drm_view_schedule_offscreen_frame (struct drm_view *view)
+{
+    if (!view->offscreen_frame_source) {
+        view->offscreen_frame_source = g_timeout_add (OFFSCREEN_FRAME_INTERVAL,
+                                                      on_offscreen_frame_timeout,
+                                                      view);
+    }
+}
+
+static void
+drm_view_commit_pending_buffer (struct drm_view *view)
+{
+    struct buffer_object *buffer = view->pending_buffer;
+    view->pending_buffer = NULL;
+    drm_commit_buffer (buffer);
+}
+
+static void
+drm_view_present_buffer (struct drm_view *view, struct buffer_object *buffer)
+{
+    buffer->view = view;
+    view->frame_pending = true;
+
+    if (view == wpe_host_data.active_view && !drm_data.page_flip_pending) {
+        drm_commit_buffer (buffer);
+        return;
+    }
+
+    /* Keep only the latest buffer, to be committed once possible. */
+    if (view->pending_buffer && view->pending_buffer != buffer)
+        release_buffer (view->pending_buffer);
+    view->pending_buffer = buffer;
+
+    if (view != wpe_host_data.active_view)
+        drm_view_schedule_offscreen_frame (view);
 }
 
 
@@ -1251,9 +1467,6 @@ init_input (void)
     if (ret)
         return FALSE;
 
-    input_data.input_width = drm_data.mode->hdisplay;
-    input_data.input_height = drm_data.mode->vdisplay;
-
     for (int i = 0; i < G_N_ELEMENTS (input_data.touch_points); ++i) {
         struct wpe_input_touch_event_raw *touch_point = &input_data.touch_points[i];
 
@@ -1265,6 +1478,35 @@ init_input (void)
 }
 
 
+/*
+ * Enumerating input devices through udev may take a long time, and does
+ * not depend on the display setup, so it is done in a thread while the
+ * DRM, GBM, and EGL initialization happens.
+ */
+static void*
+init_input_thread (void *data G_GNUC_UNUSED)
+{
+    cog_startup_trace_begin ("init-input");
+    gint64 start_time = g_get_monotonic_time ();
+    gboolean ok = init_input ();
+    g_debug ("init_input: done in %.2f ms",
+             (g_get_monotonic_time () - start_time) / 1000.0);
+    cog_startup_trace_end ("init-input");
+
+    return GINT_TO_POINTER (ok);
+}
+
+static gboolean
+join_input_thread (GThread *thread)
+{
+    gint64 start_time = g_get_monotonic_time ();
+    gboolean ok = GPOINTER_TO_INT (g_thread_join (thread));
+    g_debug ("init_input: waited %.2f ms for input initialization to finish",
+             (g_get_monotonic_time () - start_time) / 1000.0);
+    return ok;
+}
+
+
 struct drm_source {
     GSource source;
     GPollFD pfd;
@@ -1413,7 +1655,7 @@ on_export_buffer_resource (void *data, struct wl_resource *buffer_resource)
     struct buffer_object *buffer = drm_buffer_for_resource (buffer_resource);
     if (buffer) {
         buffer->export.resource = buffer_resource;
-        drm_commit_buffer (buffer);
+        drm_view_present_buffer (data, buffer);
         return;
     }
 
@@ -1431,7 +1673,7 @@ on_export_buffer_resource (void *data, struct wl_resource *buffer_resource)
     buffer = drm_create_buffer_for_bo (bo, buffer_resource, width, height, format);
     if (buffer) {
         buffer->export.resource = buffer_resource;
-        drm_commit_buffer (buffer);
+        drm_view_present_buffer (data, buffer);
     }
 }
 
@@ -1441,7 +1683,7 @@ on_export_dmabuf_resource (void *data, struct wpe_view_backend_exportable_fdo_dm
     struct buffer_object *buffer = drm_buffer_for_resource (dmabuf_resource->buffer_resource);
     if (buffer) {
         buffer->export.resource = dmabuf_resource->buffer_resource;
-        drm_commit_buffer (buffer);
+        drm_view_present_buffer (data, buffer);
         return;
     }
 
@@ -1470,7 +1712,7 @@ on_export_dmabuf_resource (void *data, struct wpe_view_backend_exportable_fdo_dm
                                        dmabuf_resource->format);
     if (buffer) {
         buffer->export.resource = dmabuf_resource->buffer_resource;
-        drm_commit_buffer (buffer);
+        drm_view_present_buffer (data, buffer);
     }
 }
 
@@ -1486,7 +1728,7 @@ on_export_shm_buffer (void* data, struct wpe_fdo_shm_exported_buffer *exported_b
         drm_copy_shm_buffer_into_bo (exported_shm_buffer, buffer->bo);
 
         buffer->export.shm_buffer = exported_buffer;
-        drm_commit_buffer (buffer);
+        drm_view_present_buffer (data, buffer);
         return;
     }
 
@@ -1495,37 +1737,24 @@ on_export_shm_buffer (void* data, struct wpe_fdo_shm_exported_buffer *exported_b
         drm_copy_shm_buffer_into_bo (exported_shm_buffer, buffer->bo);
 
         buffer->export.shm_buffer = exported_buffer;
-        drm_commit_buffer (buffer);
+        drm_view_present_buffer (data, buffer);
     }
 }
 #endif
 
-gboolean
-cog_platform_plugin_setup (CogPlatform *platform,
-                           CogShell    *shell,
-                           const char  *params,
-                           GError     **error)
+static gboolean
+init_display (GError **error)
 {
-    g_assert (platform);
-    g_return_val_if_fail (COG_IS_SHELL (shell), FALSE);
-
-    init_config (shell);
-
-    if (!wpe_loader_init ("libWPEBackend-fdo-1.0.so")) {
-        g_set_error_literal (error,
-                             COG_PLATFORM_WPE_ERROR,
-                             COG_PLATFORM_WPE_ERROR_INIT,
-                             "Failed to set backend library name");
-        return FALSE;
-    }
-
+    cog_startup_trace_begin ("init-drm");
     if (!init_drm ()) {
         g_set_error_literal (error,
                              COG_PLATFORM_WPE_ERROR,
                              COG_PLATFORM_WPE_ERROR_INIT,
                              "Failed to initialize DRM");
+        cog_startup_trace_end ("init-drm");
         return FALSE;
     }
+    cog_startup_trace_end ("init-drm");
 
     if (g_getenv ("COG_PLATFORM_DRM_CURSOR")) {
         if (!init_cursor ()) {
@@ -1533,23 +1762,58 @@ cog_platform_plugin_setup (CogPlatform *platform,
         }
     }
 
+    cog_startup_trace_begin ("init-gbm");
     if (!init_gbm ()) {
         g_set_error_literal (error,
                              COG_PLATFORM_WPE_ERROR,
                              COG_PLATFORM_WPE_ERROR_INIT,
                              "Failed to initialize GBM");
+        cog_startup_trace_end ("init-gbm");
         return FALSE;
     }
+    cog_startup_trace_end ("init-gbm");
 
+    cog_startup_trace_begin ("init-egl");
     if (!init_egl ()) {
         g_set_error_literal (error,
                              COG_PLATFORM_WPE_ERROR,
                              COG_PLATFORM_WPE_ERROR_INIT,
                              "Failed to initialize EGL");
+        cog_startup_trace_end ("init-egl");
+        return FALSE;
+    }
+    cog_startup_trace_end ("init-egl");
+
+    return TRUE;
+}
+
+gboolean
+cog_platform_plugin_setup (CogPlatform *platform,
+                           CogShell    *shell,
+                           const char  *params,
+                           GError     **error)
+{
+    g_assert (platform);
+    g_return_val_if_fail (COG_IS_SHELL (shell), FALSE);
+
+    init_config (shell);
+
+    if (!wpe_loader_init ("libWPEBackend-fdo-1.0.so")) {
+        g_set_error_literal (error,
+                             COG_PLATFORM_WPE_ERROR,
+                             COG_PLATFORM_WPE_ERROR_INIT,
+                             "Failed to set backend library name");
+        return FALSE;
+    }
+
+    GThread *input_thread = g_thread_new ("cog-drm-input", init_input_thread, NULL);
+
+    if (!init_display (error)) {
+        join_input_thread (input_thread);
         return FALSE;
     }
 
-    if (!init_input ()) {
+    if (!join_input_thread (input_thread)) {
         g_set_error_literal (error,
                              COG_PLATFORM_WPE_ERROR,
                              COG_PLATFORM_WPE_ERROR_INIT,
@@ -1557,6 +1821,9 @@ cog_platform_plugin_setup (CogPlatform *platform,
         return FALSE;
     }
 
+    input_data.input_width = drm_data.mode->hdisplay;
+    input_data.input_height = drm_data.mode->vdisplay;
+
     if (!init_glib ()) {
         g_set_error_literal (error,
                              COG_PLATFORM_WPE_ERROR,
@@ -1575,6 +1842,7 @@ cog_platform_plugin_teardown (CogPlatform *platform)
 {
     g_assert (platform);
 
+    view_switch_stats_clear ();
     clear_buffers ();
 
     clear_glib ();
@@ -1585,6 +1853,43 @@ cog_platform_plugin_teardown (CogPlatform *platform)
     clear_drm ();
 }
 
+static void
+drm_view_activate (struct drm_view *view)
+{
+    wpe_host_data.active_view = view;
+    wpe_view_data.backend = view->backend;
+}
+
+static void
+drm_view_destroy (void *data)
+{
+    struct drm_view *view = data;
+
+    drm_view_cancel_offscreen_frame (view);
+    if (view->pending_buffer) {
+        release_buffer (view->pending_buffer);
+        view->pending_buffer = NULL;
+    }
+
+    /* Buffers may outlive the view until their resources get destroyed. */
+    struct buffer_object *buffer;
+    wl_list_for_each (buffer, &drm_data.buffer_list, link) {
+        if (buffer->view == view) {
+            release_buffer (buffer);
+            buffer->view = NULL;
+        }
+    }
+
+    if (wpe_host_data.active_view == view) {
+        wpe_host_data.active_view = NULL;
+        wpe_view_data.backend = NULL;
+    }
+    wpe_host_data.views = g_list_remove (wpe_host_data.views, view);
+
+    wpe_view_backend_exportable_fdo_destroy (view->exportable);
+    g_slice_free (struct drm_view, view);
+}
+
 WebKitWebViewBackend *
 cog_platform_plugin_get_view_backend (CogPlatform   *platform,
                                       WebKitWebView *related_view,
@@ -1598,19 +1903,26 @@ cog_platform_plugin_get_view_backend (CogPlatform   *platform,
 #endif
     };
 
-    wpe_host_data.exportable = wpe_view_backend_exportable_fdo_create (&exportable_client,
-                                                                       NULL,
-                                                                       drm_data.width / drm_data.device_scale,
-                                                                       drm_data.height / drm_data.device_scale);
-    g_assert (wpe_host_data.exportable);
+    struct drm_view *view = g_slice_new0 (struct drm_view);
+    view->exportable = wpe_view_backend_exportable_fdo_create (&exportable_client,
+                                                               view,
+                                                               drm_data.width / drm_data.device_scale,
+                                                               drm_data.height / drm_data.device_scale);
+    g_assert (view->exportable);
+
+    view->backend = wpe_view_backend_exportable_fdo_get_view_backend (view->exportable);
+    g_assert (view->backend);
+
+    wpe_host_data.views = g_list_prepend (wpe_host_data.views, view);
 
-    wpe_view_data.backend = wpe_view_backend_exportable_fdo_get_view_backend (wpe_host_data.exportable);
-    g_assert (wpe_view_data.backend);
+    /* The first view is active until told otherwise. */
+    if (!wpe_host_data.active_view)
+        drm_view_activate (view);
 
     WebKitWebViewBackend *wk_view_backend =
-        webkit_web_view_backend_new (wpe_view_data.backend,
-                                     (GDestroyNotify) wpe_view_backend_exportable_fdo_destroy,
-                                     wpe_host_data.exportable);
+        webkit_web_view_backend_new (view->backend,
+                                     drm_view_destroy,
+                                     view);
     g_assert (wk_view_backend);
 
     return wk_view_backend;
@@ -1621,7 +1933,53 @@ cog_platform_plugin_init_web_view (CogPlatform   *platform,
                                    WebKitWebView *view)
 {
 #ifdef HAVE_DEVICE_SCALING
-    wpe_view_backend_dispatch_set_device_scale_factor (wpe_view_data.backend,
+    wpe_view_backend_dispatch_set_device_scale_factor (webkit_web_view_backend_get_wpe_backend (webkit_web_view_get_backend (view)),
                                                        drm_data.device_scale);
 #endif
 }
+
+void
+cog_platform_plugin_set_active_view (CogPlatform   *platform,
+                                     WebKitWebView *web_view)
+{
+    struct wpe_view_backend *backend =
+        webkit_web_view_backend_get_wpe_backend (webkit_web_view_get_backend (web_view));
+
+    struct drm_view *view = NULL;
+    for (GList *item = wpe_host_data.views; item; item = g_list_next (item)) {
+        if (((struct drm_view*) item->data)->backend == backend) {
+            view = item->data;
+            break;
+        }
+    }
+
+    if (!view) {
+        g_warning ("Web view %p does not use a view backend from this platform", web_view);
+        return;
+    }
+    if (view == wpe_host_data.active_view)
+        return;
+
+    const gint64 switch_time = g_get_monotonic_time ();
+    struct drm_view *previous_view = wpe_host_data.active_view;
+    drm_view_cancel_offscreen_frame (view);
+    drm_view_activate (view);
+    view_switch_stats_start (switch_time);
+
+    /* Page flips will not complete the previous view any more. */
+    if (previous_view && previous_view->frame_pending)
+        drm_view_schedule_offscreen_frame (previous_view);
+
+    /*
+     * Scan out right away the buffer rendered while off screen, or let the
+     * view produce a new one if it was paused waiting for completion. With
+     * a page flip in flight, this happens once it is done.
+     */
+    if (drm_data.page_flip_pending)
+        return;
+
+    if (view->pending_buffer)
+        drm_view_commit_pending_buffer (view);
+    else if (view->frame_pending)
+        drm_view_dispatch_frame_complete (view);
+}
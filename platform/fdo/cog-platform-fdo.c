@@ -110,10 +110,13 @@ struct video_surface {
 #endif
 
 #if HAVE_SHM_EXPORTED_BUFFER
+struct fdo_view;
+
 struct shm_buffer {
     struct wl_list link;
     struct wl_listener destroy_listener;
 
+    struct fdo_view *view;
     struct wl_resource *buffer_resource;
     struct wpe_fdo_shm_exported_buffer *exported_buffer;
 
@@ -297,8 +300,34 @@ static struct {
     uint8_t modifiers;
 } xkb_data = {NULL, };
 
+/*
+ * Each web view gets its own exportable. Only the contents of the active
+ * view are attached to the window surface. Other views keep rendering off
+ * screen, but their frame completion is dispatched from a timer instead of
+ * the surface frame callbacks, every OFFSCREEN_FRAME_INTERVAL milliseconds,
+ * so they do not compete with the active view. Only the latest frame of an
+ * off screen view is kept, to be presented when it gets activated.
+ */
+#define OFFSCREEN_FRAME_INTERVAL 100
+
+struct fdo_view {
+    unsigned ref_count;
+    struct wpe_view_backend_exportable_fdo *exportable; /* NULL once destroyed. */
+    struct wpe_view_backend *backend;
+    struct wpe_fdo_egl_exported_image *pending_image;   /* Exported off screen. */
+    bool frame_pending;                                 /* Frame completion due. */
+    unsigned offscreen_frame_source;
+};
+
+struct exported_image {
+    struct fdo_view *view;
+    struct wpe_fdo_egl_exported_image *image;
+};
+
 static struct {
-    struct wpe_view_backend_exportable_fdo *exportable;
+    struct wpe_view_backend_exportable_fdo *exportable; /* Of the active view. */
+    struct fdo_view *active_view;
+    GList *views;
 } wpe_host_data;
 
 static struct {
@@ -311,6 +340,28 @@ static struct {
     .should_update_opaque_region = true, /* Force initial update. */
 };
 
+/*
+ * Frame timings sampled during the first frames after switching the active
+ * view, used to check that swapping in a preloaded view does not drop any.
+ * Frame callbacks are requested on their own during the sampling, because
+ * a view showing static content does not produce new frames.
+ */
+#define VIEW_SWITCH_SAMPLE_FRAMES  10
+#define VIEW_SWITCH_SAMPLE_TIMEOUT 1    /* Seconds. */
+
+static struct {
+    struct wl_callback *frame_callback;
+    guint    timeout_source;
+    unsigned frames_sampled;
+    gint64   switch_time;       /* Monotonic, in microseconds. */
+    uint32_t last_frame_time;   /* From frame callbacks, in milliseconds. */
+    uint32_t max_interval;
+    unsigned dropped_frames;
+    uint32_t refresh_nsec;      /* From presentation feedback, if available. */
+} view_switch_stats = {
+    .refresh_nsec = 16666667,
+};
+
 
 struct wl_event_source {
     GSource source;
@@ -1589,17 +1640,163 @@ static const struct wl_registry_listener registry_listener = {
     .global_remove = registry_global_remove
 };
 
+static struct fdo_view*
+fdo_view_ref (struct fdo_view *view)
+{
+    view->ref_count++;
+    return view;
+}
+
+static void
+fdo_view_unref (struct fdo_view *view)
+{
+    if (--view->ref_count == 0)
+        g_slice_free (struct fdo_view, view);
+}
+
+static void
+fdo_view_dispatch_frame_complete (struct fdo_view *view)
+{
+    view->frame_pending = false;
+    wpe_view_backend_exportable_fdo_dispatch_frame_complete (view->exportable);
+}
+
+static void
+fdo_view_cancel_offscreen_frame (struct fdo_view *view)
+{
+    if (view->offscreen_frame_source) {
+        g_source_remove (view->offscreen_frame_source);
+        view->offscreen_frame_source = 0;
+    }
+}
+
+static gboolean
+on_offscreen_frame_timeout (void *data)
+{
+    struct fdo_view *view = data;
+
+    view->offscreen_frame_source = 0;
+    if (view != wpe_host_data.active_view && view->frame_pending)
+        fdo_view_dispatch_frame_complete (view);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+fdo_view_schedule_offscreen_frame (struct fdo_view *view)
+{
+    if (!view->offscreen_frame_source) {
+        view->offscreen_frame_source = g_timeout_add (OFFSCREEN_FRAME_INTERVAL,
+                                                      on_offscreen_frame_timeout,
+                                                      view);
+    }
+}
+
+static void
+view_switch_stats_clear (void)
+{
+    if (view_switch_stats.timeout_source) {
+        g_source_remove (view_switch_stats.timeout_source);
+        view_switch_stats.timeout_source = 0;
+    }
+    g_clear_pointer (&view_switch_stats.frame_callback, wl_callback_destroy);
+}
+
+static void
+view_switch_stats_stop (void)
+{
+    view_switch_stats_clear ();
+
+    g_message ("View switch: %u dropped frames, max frame interval %" PRIu32 " ms "
+               "(refresh %.2f ms, %u frames sampled)",
+               view_switch_stats.dropped_frames, view_switch_stats.max_interval,
+               view_switch_stats.refresh_nsec / 1000000.0, view_switch_stats.frames_sampled);
+}
+
+static gboolean
+on_view_switch_stats_timeout (void *data)
+{
+    /* Frames may stop coming e.g. when the window gets hidden. */
+    view_switch_stats.timeout_source = 0;
+    view_switch_stats_stop ();
+    return G_SOURCE_REMOVE;
+}
+
+static void view_switch_stats_request_frame (void);
+
+static void
+on_view_switch_stats_frame (void *data, struct wl_callback *callback, uint32_t time)
+{
+    g_assert (view_switch_stats.frame_callback == callback);
+    g_clear_pointer (&view_switch_stats.frame_callback, wl_callback_destroy);
+
+    if (view_switch_stats.frames_sampled == 0) {
+        g_debug ("View switch: first frame after %.2f ms",
+                 (g_get_monotonic_time () - view_switch_stats.switch_time) / 1000.0);
+    } else {
+        const uint32_t interval = time - view_switch_stats.last_frame_time;
+        const uint32_t refresh_msec = MAX (1, (view_switch_stats.refresh_nsec + 500000) / 1000000);
+        view_switch_stats.max_interval = MAX (view_switch_stats.max_interval, interval);
+
+        /* Intervals spanning more than one refresh and a half missed a frame. */
+        if (2 * interval > 3 * refresh_msec)
+            view_switch_stats.dropped_frames += (interval + refresh_msec / 2) / refresh_msec - 1;
+    }
+    view_switch_stats.last_frame_time = time;
+
+    if (++view_switch_stats.frames_sampled == VIEW_SWITCH_SAMPLE_FRAMES)
+        view_switch_stats_stop ();
+    else
+        view_switch_stats_request_frame ();
+}
+
+static const struct wl_callback_listener view_switch_stats_frame_listener = {
+    .done = on_view_switch_stats_frame,
+};
+
+static void
+view_switch_stats_request_frame (void)
+{
+    view_switch_stats.frame_callback = wl_surface_frame (win_data.wl_surface);
+    wl_callback_add_listener (view_switch_stats.frame_callback,
+                              &view_switch_stats_frame_listener,
+                              NULL);
+    wl_surface_commit (win_data.wl_surface);
+}
+
+static void
+view_switch_stats_start (gint64 switch_time)
+{
+    view_switch_stats_clear ();
+
+    view_switch_stats.frames_sampled = 0;
+    view_switch_stats.switch_time = switch_time;
+    view_switch_stats.max_interval = 0;
+    view_switch_stats.dropped_frames = 0;
+
+    view_switch_stats_request_frame ();
+    view_switch_stats.timeout_source = g_timeout_add_seconds (VIEW_SWITCH_SAMPLE_TIMEOUT,
+                                                              on_view_switch_stats_timeout,
+                                                              NULL);
+}
+
 static void
 on_surface_frame (void *data, struct wl_callback *callback, uint32_t time)
 {
+    cog_startup_trace_frame_shown ();
+
     if (wpe_view_data.frame_callback != NULL) {
         g_assert (wpe_view_data.frame_callback == callback);
         wl_callback_destroy (wpe_view_data.frame_callback);
         wpe_view_data.frame_callback = NULL;
     }
 
-    wpe_view_backend_exportable_fdo_dispatch_frame_complete
-        (wpe_host_data.exportable);
+    /*
+     * The frame shown is always from the active view. Views which were
+     * switched away from before their frame got shown are completed by
+     * their off screen timer instead.
+     */
+    if (wpe_host_data.active_view && wpe_host_data.active_view->frame_pending)
+        fdo_view_dispatch_frame_complete (wpe_host_data.active_view);
 }
 
 static const struct wl_callback_listener frame_listener = {
@@ -1616,6 +1813,8 @@ on_presentation_feedback_presented (void *data, struct wp_presentation_feedback
     uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec, uint32_t refresh,
     uint32_t seq_hi, uint32_t seq_lo, uint32_t flags)
 {
+    if (refresh)
+        view_switch_stats.refresh_nsec = refresh;
     wp_presentation_feedback_destroy (presentation_feedback);
 }
 
@@ -1634,6 +1833,12 @@ static const struct wp_presentation_feedback_listener presentation_feedback_list
 static void
 request_frame (void)
 {
+    static bool first_frame_committed = false;
+    if (!first_frame_committed) {
+        cog_startup_trace_mark ("first-frame-commit");
+        first_frame_committed = true;
+    }
+
     if (wpe_view_data.frame_callback == NULL) {
         wpe_view_data.frame_callback = wl_surface_frame (win_data.wl_surface);
         wl_callback_add_listener (wpe_view_data.frame_callback,
@@ -1653,9 +1858,13 @@ request_frame (void)
 static void
 on_buffer_release (void* data, struct wl_buffer* buffer)
 {
-    struct wpe_fdo_egl_exported_image * image = data;
-    wpe_view_backend_exportable_fdo_egl_dispatch_release_exported_image (wpe_host_data.exportable,
-                                                                         image);
+    struct exported_image *exported = data;
+    if (exported->view->exportable) {
+        wpe_view_backend_exportable_fdo_egl_dispatch_release_exported_image (exported->view->exportable,
+                                                                             exported->image);
+    }
+    fdo_view_unref (exported->view);
+    g_slice_free (struct exported_image, exported);
     g_clear_pointer (&buffer, wl_buffer_destroy);
 }
 
@@ -1695,9 +1904,10 @@ static const struct wl_buffer_listener dmabuf_buffer_listener = {
 #endif /* COG_ENABLE_WESTON_DIRECT_DISPLAY */
 
 static void
-on_export_fdo_egl_image(void *data, struct wpe_fdo_egl_exported_image *image)
+present_fdo_egl_image (struct fdo_view *view, struct wpe_fdo_egl_exported_image *image)
 {
     wpe_view_data.image = image;
+    view->frame_pending = true;
 
     if (wpe_view_data.should_update_opaque_region) {
         wpe_view_data.should_update_opaque_region = false;
@@ -1722,7 +1932,11 @@ on_export_fdo_egl_image(void *data, struct wpe_fdo_egl_exported_image *image)
 
     wpe_view_data.buffer = s_eglCreateWaylandBufferFromImageWL (egl_data.display, wpe_fdo_egl_exported_image_get_egl_image (wpe_view_data.image));
     g_assert (wpe_view_data.buffer);
-    wl_buffer_add_listener(wpe_view_data.buffer, &buffer_listener, image);
+
+    struct exported_image *exported = g_slice_new (struct exported_image);
+    exported->view = fdo_view_ref (view);
+    exported->image = image;
+    wl_buffer_add_listener(wpe_view_data.buffer, &buffer_listener, exported);
 
     wl_surface_attach (win_data.wl_surface, wpe_view_data.buffer, 0, 0);
     wl_surface_damage (win_data.wl_surface,
@@ -1735,6 +1949,26 @@ on_export_fdo_egl_image(void *data, struct wpe_fdo_egl_exported_image *image)
     wl_surface_commit (win_data.wl_surface);
 }
 
+static void
+on_export_fdo_egl_image(void *data, struct wpe_fdo_egl_exported_image *image)
+{
+    struct fdo_view *view = data;
+
+    if (view != wpe_host_data.active_view) {
+        /* Keep only the latest frame, to be presented on activation. */
+        if (view->pending_image) {
+            wpe_view_backend_exportable_fdo_egl_dispatch_release_exported_image (view->exportable,
+                                                                                 view->pending_image);
+        }
+        view->pending_image = image;
+        view->frame_pending = true;
+        fdo_view_schedule_offscreen_frame (view);
+        return;
+    }
+
+    present_fdo_egl_image (view, image);
+}
+
 #if HAVE_SHM_EXPORTED_BUFFER
 static struct shm_buffer *
 shm_buffer_for_resource (struct wl_resource *buffer_resource)
@@ -1752,7 +1986,7 @@ static void
 shm_buffer_destroy_notify (struct wl_listener *listener, void *data);
 
 static struct shm_buffer *
-shm_buffer_create (struct wl_resource *buffer_resource, size_t size)
+shm_buffer_create (struct fdo_view *view, struct wl_resource *buffer_resource, size_t size)
 {
     int fd = os_create_anonymous_file (size);
     if (fd < 0)
@@ -1765,6 +1999,7 @@ shm_buffer_create (struct wl_resource *buffer_resource, size_t size)
     }
 
     struct shm_buffer *buffer = g_new0 (struct shm_buffer, 1);
+    buffer->view = fdo_view_ref (view);
     buffer->destroy_listener.notify = shm_buffer_destroy_notify;
     buffer->buffer_resource = buffer_resource;
     wl_resource_add_destroy_listener (buffer_resource, &buffer->destroy_listener);
@@ -1780,10 +2015,11 @@ shm_buffer_create (struct wl_resource *buffer_resource, size_t size)
 static void
 shm_buffer_destroy (struct shm_buffer *buffer)
 {
-    if (buffer->exported_buffer) {
-        wpe_view_backend_exportable_fdo_egl_dispatch_release_shm_exported_buffer (wpe_host_data.exportable,
+    if (buffer->exported_buffer && buffer->view->exportable) {
+        wpe_view_backend_exportable_fdo_egl_dispatch_release_shm_exported_buffer (buffer->view->exportable,
                                                                                   buffer->exported_buffer);
     }
+    fdo_view_unref (buffer->view);
 
     wl_buffer_destroy (buffer->buffer);
     wl_shm_pool_destroy (buffer->shm_pool);
@@ -1806,8 +2042,10 @@ on_shm_buffer_release (void *data, struct wl_buffer *wl_buffer)
 {
     struct shm_buffer* buffer = data;
     if (buffer->exported_buffer) {
-        wpe_view_backend_exportable_fdo_egl_dispatch_release_shm_exported_buffer (wpe_host_data.exportable,
-                                                                                  buffer->exported_buffer);
+        if (buffer->view->exportable) {
+            wpe_view_backend_exportable_fdo_egl_dispatch_release_shm_exported_buffer (buffer->view->exportable,
+                                                                                      buffer->exported_buffer);
+        }
         buffer->exported_buffer = NULL;
     }
 }
@@ -1835,6 +2073,17 @@ shm_buffer_copy_contents (struct shm_buffer *buffer, struct wl_shm_buffer *expor
 static void
 on_export_shm_buffer (void* data, struct wpe_fdo_shm_exported_buffer* exported_buffer)
 {
+    struct fdo_view *view = data;
+
+    /* Contents are copied when presenting, so nothing is kept off screen. */
+    if (view != wpe_host_data.active_view) {
+        wpe_view_backend_exportable_fdo_egl_dispatch_release_shm_exported_buffer (view->exportable,
+                                                                                  exported_buffer);
+        view->frame_pending = true;
+        fdo_view_schedule_offscreen_frame (view);
+        return;
+    }
+
     struct wl_resource *exported_resource = wpe_fdo_shm_exported_buffer_get_resource (exported_buffer);
     struct wl_shm_buffer *exported_shm_buffer = wpe_fdo_shm_exported_buffer_get_shm_buffer (exported_buffer);
 
@@ -1846,7 +2095,7 @@ on_export_shm_buffer (void* data, struct wpe_fdo_shm_exported_buffer* exported_b
         uint32_t format = wl_shm_buffer_get_format (exported_shm_buffer);
 
         size_t size = stride * height;
-        buffer = shm_buffer_create (exported_resource, size);
+        buffer = shm_buffer_create (view, exported_resource, size);
         if (!buffer)
             return;
         wl_list_insert (&wl_data.shm_buffer_list, &buffer->link);
@@ -1857,6 +2106,7 @@ on_export_shm_buffer (void* data, struct wpe_fdo_shm_exported_buffer* exported_b
 
     buffer->exported_buffer = exported_buffer;
     shm_buffer_copy_contents (buffer, exported_shm_buffer);
+    view->frame_pending = true;
 
     wl_surface_attach (win_data.wl_surface, buffer->buffer, 0, 0);
     wl_surface_damage (win_data.wl_surface,
@@ -2349,24 +2599,57 @@ update_popup (void)
     wl_surface_commit (popup_data.wl_surface);
 }
 
+/*
+ * Compiling the compose table for the current locale may take a while, and
+ * does not need the Wayland connection, so it is done in a thread while the
+ * Wayland and EGL initialization happens.
+ */
+static void*
+init_xkb_thread (void *data G_GNUC_UNUSED)
+{
+    cog_startup_trace_begin ("init-xkb");
+
+    xkb_data.context = xkb_context_new (XKB_CONTEXT_NO_FLAGS);
+    g_assert (xkb_data.context);
+    xkb_data.compose_table =
+        xkb_compose_table_new_from_locale (xkb_data.context,
+                                           setlocale (LC_CTYPE, NULL),
+                                           XKB_COMPOSE_COMPILE_NO_FLAGS);
+    if (xkb_data.compose_table != NULL) {
+        xkb_data.compose_state =
+            xkb_compose_state_new (xkb_data.compose_table,
+                                   XKB_COMPOSE_STATE_NO_FLAGS);
+    }
+
+    cog_startup_trace_end ("init-xkb");
+    return NULL;
+}
+
+static void
+clear_xkb (void)
+{
+    g_clear_pointer (&xkb_data.state, xkb_state_unref);
+    g_clear_pointer (&xkb_data.compose_state, xkb_compose_state_unref);
+    g_clear_pointer (&xkb_data.compose_table, xkb_compose_table_unref);
+    g_clear_pointer (&xkb_data.keymap, xkb_keymap_unref);
+    g_clear_pointer (&xkb_data.context, xkb_context_unref);
+}
+
+static void
+join_xkb_thread (GThread *thread)
+{
+    gint64 start_time = g_get_monotonic_time ();
+    g_thread_join (thread);
+    g_debug ("%s: waited %.2f ms for XKB initialization to finish",
+             __func__, (g_get_monotonic_time () - start_time) / 1000.0);
+}
+
 static gboolean
 init_input (GError **error)
 {
     if (wl_data.seat != NULL) {
         wl_seat_add_listener (wl_data.seat, &seat_listener, NULL);
 
-        xkb_data.context = xkb_context_new (XKB_CONTEXT_NO_FLAGS);
-        g_assert (xkb_data.context);
-        xkb_data.compose_table =
-            xkb_compose_table_new_from_locale (xkb_data.context,
-                                               setlocale (LC_CTYPE, NULL),
-                                               XKB_COMPOSE_COMPILE_NO_FLAGS);
-        if (xkb_data.compose_table != NULL) {
-            xkb_data.compose_state =
-                xkb_compose_state_new (xkb_data.compose_table,
-                                       XKB_COMPOSE_STATE_NO_FLAGS);
-        }
-
 #if COG_IM_API_SUPPORTED
         if (wl_data.text_input_manager != NULL) {
             struct zwp_text_input_v3 *text_input =
@@ -2400,11 +2683,7 @@ clear_input (void)
     g_clear_pointer (&wl_data.text_input_manager_v1, zwp_text_input_manager_v1_destroy);
 #endif
 
-    g_clear_pointer (&xkb_data.state, xkb_state_unref);
-    g_clear_pointer (&xkb_data.compose_state, xkb_compose_state_unref);
-    g_clear_pointer (&xkb_data.compose_table, xkb_compose_table_unref);
-    g_clear_pointer (&xkb_data.keymap, xkb_keymap_unref);
-    g_clear_pointer (&xkb_data.context, xkb_context_unref);
+    clear_xkb ();
 }
 
 static void
@@ -2440,26 +2719,49 @@ cog_platform_plugin_setup (CogPlatform *platform,
         return FALSE;
     }
 
-    if (!init_wayland (error))
+    GThread *xkb_thread = g_thread_new ("cog-fdo-xkb", init_xkb_thread, NULL);
+
+    cog_startup_trace_begin ("init-wayland");
+    if (!init_wayland (error)) {
+        cog_startup_trace_end ("init-wayland");
+        join_xkb_thread (xkb_thread);
+        clear_xkb ();
         return FALSE;
+    }
+    cog_startup_trace_end ("init-wayland");
 
+    cog_startup_trace_begin ("init-egl");
     if (!init_egl (error)) {
+        cog_startup_trace_end ("init-egl");
+        join_xkb_thread (xkb_thread);
+        clear_xkb ();
         clear_wayland ();
         return FALSE;
     }
+    cog_startup_trace_end ("init-egl");
 
+    cog_startup_trace_begin ("create-window");
     if (!create_window (error)) {
+        cog_startup_trace_end ("create-window");
+        join_xkb_thread (xkb_thread);
+        clear_xkb ();
         clear_egl ();
         clear_wayland ();
         return FALSE;
     }
+    cog_startup_trace_end ("create-window");
+
+    join_xkb_thread (xkb_thread);
 
+    cog_startup_trace_begin ("init-input");
     if (!init_input (error)) {
+        cog_startup_trace_end ("init-input");
         destroy_window ();
         clear_egl ();
         clear_wayland ();
         return FALSE;
     }
+    cog_startup_trace_end ("init-input");
 
     /* init WPE host data */
     wpe_fdo_initialize_for_egl_display (egl_data.display);
@@ -2476,6 +2778,8 @@ cog_platform_plugin_teardown (CogPlatform *platform)
 {
     g_assert (platform);
 
+    view_switch_stats_clear ();
+
     /* free WPE view data */
     if (wpe_view_data.frame_callback != NULL)
         wl_callback_destroy (wpe_view_data.frame_callback);
@@ -2503,6 +2807,44 @@ cog_platform_plugin_teardown (CogPlatform *platform)
     clear_wayland ();
 }
 
+static void
+fdo_view_activate (struct fdo_view *view)
+{
+    wpe_host_data.active_view = view;
+    wpe_host_data.exportable = view->exportable;
+    wpe_view_data.backend = view->backend;
+
+#if COG_IM_API_SUPPORTED
+    if (wl_data.text_input_manager_v1 != NULL)
+        cog_im_context_fdo_v1_set_view_backend (view->backend);
+#endif
+}
+
+static void
+fdo_view_destroy (void *data)
+{
+    struct fdo_view *view = data;
+
+    fdo_view_cancel_offscreen_frame (view);
+    if (view->pending_image) {
+        wpe_view_backend_exportable_fdo_egl_dispatch_release_exported_image (view->exportable,
+                                                                             view->pending_image);
+        view->pending_image = NULL;
+    }
+
+    if (wpe_host_data.active_view == view) {
+        wpe_host_data.active_view = NULL;
+        wpe_host_data.exportable = NULL;
+        wpe_view_data.backend = NULL;
+    }
+    wpe_host_data.views = g_list_remove (wpe_host_data.views, view);
+
+    /* Buffers still in use may keep a reference, see on_buffer_release(). */
+    g_clear_pointer (&view->exportable, wpe_view_backend_exportable_fdo_destroy);
+    view->backend = NULL;
+    fdo_view_unref (view);
+}
+
 WebKitWebViewBackend*
 cog_platform_plugin_get_view_backend (CogPlatform   *platform,
                                       WebKitWebView *related_view,
@@ -2515,27 +2857,30 @@ cog_platform_plugin_get_view_backend (CogPlatform   *platform,
 #endif
     };
 
-    wpe_host_data.exportable =
+    struct fdo_view *view = g_slice_new0 (struct fdo_view);
+    view->ref_count = 1;
+    view->exportable =
         wpe_view_backend_exportable_fdo_egl_create (&exportable_egl_client,
-                                                    NULL,
+                                                    view,
                                                     win_data.width,
                                                     win_data.height);
-    g_assert (wpe_host_data.exportable);
+    g_assert (view->exportable);
 
     /* init WPE view backend */
-    wpe_view_data.backend =
-        wpe_view_backend_exportable_fdo_get_view_backend (wpe_host_data.exportable);
-    g_assert (wpe_view_data.backend);
+    view->backend =
+        wpe_view_backend_exportable_fdo_get_view_backend (view->exportable);
+    g_assert (view->backend);
 
-#if COG_IM_API_SUPPORTED
-    if (wl_data.text_input_manager_v1 != NULL)
-        cog_im_context_fdo_v1_set_view_backend (wpe_view_data.backend);
-#endif
+    wpe_host_data.views = g_list_prepend (wpe_host_data.views, view);
+
+    /* The first view is active until told otherwise. */
+    if (!wpe_host_data.active_view)
+        fdo_view_activate (view);
 
     WebKitWebViewBackend *wk_view_backend =
-        webkit_web_view_backend_new (wpe_view_data.backend,
-                       (GDestroyNotify) wpe_view_backend_exportable_fdo_destroy,
-                                     wpe_host_data.exportable);
+        webkit_web_view_backend_new (view->backend,
+                                     fdo_view_destroy,
+                                     view);
     g_assert (wk_view_backend);
 
     if (!wl_data.event_src) {
@@ -2563,6 +2908,58 @@ cog_platform_plugin_init_web_view (CogPlatform   *platform,
     g_signal_connect (view, "show-option-menu", G_CALLBACK (on_show_option_menu), NULL);
 }
 
+void
+cog_platform_plugin_set_active_view (CogPlatform   *platform,
+                                     WebKitWebView *web_view)
+{
+    struct wpe_view_backend *backend =
+        webkit_web_view_backend_get_wpe_backend (webkit_web_view_get_backend (web_view));
+
+    struct fdo_view *view = NULL;
+    for (GList *item = wpe_host_data.views; item; item = g_list_next (item)) {
+        if (((struct fdo_view*) item->data)->backend == backend) {
+            view = item->data;
+            break;
+        }
+    }
+
+    if (!view) {
+        g_warning ("Web view %p does not use a view backend from this platform", web_view);
+        return;
+    }
+    if (view == wpe_host_data.active_view)
+        return;
+
+    const gint64 switch_time = g_get_monotonic_time ();
+    struct fdo_view *previous_view = wpe_host_data.active_view;
+    fdo_view_cancel_offscreen_frame (view);
+    fdo_view_activate (view);
+
+    /* The frame callback will not complete the previous view any more. */
+    if (previous_view && previous_view->frame_pending)
+        fdo_view_schedule_offscreen_frame (previous_view);
+
+    /* The window may have changed while the view was not active. */
+    resize_window ();
+#if HAVE_DEVICE_SCALING
+    wpe_view_backend_dispatch_set_device_scale_factor (view->backend, wl_data.current_output.scale);
+#endif /* HAVE_DEVICE_SCALING */
+
+    /*
+     * Present right away the frame rendered while off screen, or let the
+     * view produce a new one if it was paused waiting for completion.
+     */
+    if (view->pending_image) {
+        struct wpe_fdo_egl_exported_image *image = view->pending_image;
+        view->pending_image = NULL;
+        present_fdo_egl_image (view, image);
+    } else if (view->frame_pending) {
+        fdo_view_dispatch_frame_complete (view);
+    }
+
+    view_switch_stats_start (switch_time);
+}
+
 void
 cog_platform_plugin_resize (CogPlatform   *platform,
                             const char *size_spec)
@@ -0,0 +1,137 @@
+/*
+ * bench-decompression.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include <gio/gio.h>
+#include <stdlib.h>
+
+#if COG_USE_ZSTD
+# include "../core/cog-zstd-decompressor.h"
+# include <zstd.h>
+#endif
+
+/*
+ * Measures the throughput of the streaming decompression used to serve
+ * compressed files from CogDirectoryFilesHandler: the same converters are
+ * read through a GConverterInputStream in chunks of the size WebKit reads,
+ * and the amount of decompressed data produced per second is reported.
+ *
+ * The input is generated text resembling minified scripts, compressed in
+ * memory so storage speed does not affect the results.
+ *
+ * Usage: bench-decompression [MEGABYTES]
+ */
+
+#define READ_CHUNK_SIZE (64 * 1024)
+
+
+static GBytes*
+generate_input (gsize size)
+{
+    GString *data = g_string_sized_new (size);
+    GRand *rand = g_rand_new_with_seed (42);
+    while (data->len < size) {
+        g_string_append_printf (data,
+                                "function f%u(a,b){return a*%u+b.length-%u;}var v%u=\"%08x\";",
+                                g_rand_int_range (rand, 0, 1000),
+                                g_rand_int_range (rand, 0, 100),
+                                g_rand_int_range (rand, 0, 100),
+                                g_rand_int_range (rand, 0, 1000),
+                                g_rand_int (rand));
+    }
+    g_string_truncate (data, size);
+    g_rand_free (rand);
+    return g_string_free_to_bytes (data);
+}
+
+
+static GBytes*
+compress_gzip (GBytes *input)
+{
+    g_autoptr(GZlibCompressor) compressor = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP, 9);
+    g_autoptr(GInputStream) source = g_memory_input_stream_new_from_bytes (input);
+    g_autoptr(GInputStream) stream = g_converter_input_stream_new (source, G_CONVERTER (compressor));
+    g_autoptr(GOutputStream) output = g_memory_output_stream_new_resizable ();
+
+    g_autoptr(GError) error = NULL;
+    g_output_stream_splice (output, stream,
+                            G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+                            NULL, &error);
+    g_assert_no_error (error);
+
+    return g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (output));
+}
+
+
+#if COG_USE_ZSTD
+static GBytes*
+compress_zstd (GBytes *input)
+{
+    gsize input_size;
+    const void *input_data = g_bytes_get_data (input, &input_size);
+
+    const size_t bound = ZSTD_compressBound (input_size);
+    void *output = g_malloc (bound);
+    const size_t output_size = ZSTD_compress (output, bound, input_data, input_size, 19);
+    g_assert_false (ZSTD_isError (output_size));
+
+    return g_bytes_new_take (output, output_size);
+}
+#endif
+
+
+static void
+run (const char *name,
+     GBytes     *compressed,
+     GConverter *decompressor,
+     gsize       expected_size)
+{
+    g_autoptr(GInputStream) source = g_memory_input_stream_new_from_bytes (compressed);
+    g_autoptr(GInputStream) stream = g_converter_input_stream_new (source, decompressor);
+    g_autofree char *buffer = g_malloc (READ_CHUNK_SIZE);
+
+    g_autoptr(GTimer) timer = g_timer_new ();
+    gsize total = 0;
+    for (;;) {
+        g_autoptr(GError) error = NULL;
+        gssize n_read = g_input_stream_read (stream, buffer, READ_CHUNK_SIZE, NULL, &error);
+        g_assert_no_error (error);
+        if (n_read == 0)
+            break;
+        total += n_read;
+    }
+    const double elapsed = g_timer_elapsed (timer, NULL);
+    g_assert_cmpuint (total, ==, expected_size);
+
+    g_print ("%-5s %6.1f MB/s (ratio %.2f)\n", name,
+             total / elapsed / 1e6,
+             (double) expected_size / g_bytes_get_size (compressed));
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    const unsigned megabytes = (argc > 1) ? strtoul (argv[1], NULL, 10) : 64;
+    if (!megabytes)
+        return EXIT_FAILURE;
+
+    const gsize size = (gsize) megabytes * 1024 * 1024;
+    g_autoptr(GBytes) input = generate_input (size);
+
+    g_autoptr(GBytes) gzip_data = compress_gzip (input);
+    g_autoptr(GConverter) gzip_decompressor =
+        G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+    run ("gzip", gzip_data, gzip_decompressor, size);
+
+#if COG_USE_ZSTD
+    g_autoptr(GBytes) zstd_data = compress_zstd (input);
+    g_autoptr(GConverter) zstd_decompressor = cog_zstd_decompressor_new ();
+    run ("zstd", zstd_data, zstd_decompressor, size);
+#endif
+
+    return EXIT_SUCCESS;
+}
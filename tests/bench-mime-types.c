@@ -0,0 +1,107 @@
+/*
+ * bench-mime-types.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "../core/cog-mime-types.h"
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+
+/*
+ * Compares the cost of finding out the MIME type of the files served by
+ * the file handlers using the built-in table of Web extensions, guessing
+ * it from the file name with GIO, and querying the content type of the
+ * file with GIO, which is what the directory handler used to do for every
+ * request and may read the head of the file.
+ *
+ * Usage: bench-mime-types [ITERATIONS]
+ */
+
+static const char * const s_names[] = {
+    "index.html", "app.js", "module.mjs", "style.css", "data.json",
+    "logo.svg", "font.woff2", "photo.jpg", "icon.png", "image.webp",
+    "video.mp4", "code.wasm", "strings.txt", "README",
+};
+
+
+static double
+run_table (unsigned iterations)
+{
+    g_autoptr(GTimer) timer = g_timer_new ();
+    unsigned found = 0;
+    for (unsigned i = 0; i < iterations; i++) {
+        const char *name = s_names[i % G_N_ELEMENTS (s_names)];
+        if (cog_mime_type_for_extension (cog_path_get_extension (name)))
+            found++;
+    }
+    g_assert_cmpuint (found, >, 0);
+    return g_timer_elapsed (timer, NULL) * 1e9 / iterations;
+}
+
+
+static double
+run_guess (unsigned iterations)
+{
+    g_autoptr(GTimer) timer = g_timer_new ();
+    for (unsigned i = 0; i < iterations; i++) {
+        const char *name = s_names[i % G_N_ELEMENTS (s_names)];
+        g_autofree char *content_type = g_content_type_guess (name, NULL, 0, NULL);
+        g_autofree char *mime_type = g_content_type_get_mime_type (content_type);
+    }
+    return g_timer_elapsed (timer, NULL) * 1e9 / iterations;
+}
+
+
+static double
+run_query_info (unsigned iterations, GFile **files)
+{
+    g_autoptr(GTimer) timer = g_timer_new ();
+    for (unsigned i = 0; i < iterations; i++) {
+        GFile *file = files[i % G_N_ELEMENTS (s_names)];
+        g_autoptr(GFileInfo) info = g_file_query_info (file,
+                                                       G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE,
+                                                       G_FILE_QUERY_INFO_NONE,
+                                                       NULL,
+                                                       NULL);
+        g_assert_nonnull (info);
+    }
+    return g_timer_elapsed (timer, NULL) * 1e9 / iterations;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    const unsigned iterations = (argc > 1) ? strtoul (argv[1], NULL, 10) : 100000;
+    if (!iterations)
+        return EXIT_FAILURE;
+
+    g_autoptr(GError) error = NULL;
+    g_autofree char *base_path = g_dir_make_tmp ("cog-bench-XXXXXX", &error);
+    g_assert_no_error (error);
+
+    GFile *files[G_N_ELEMENTS (s_names)];
+    for (unsigned i = 0; i < G_N_ELEMENTS (s_names); i++) {
+        g_autofree char *path = g_build_filename (base_path, s_names[i], NULL);
+        g_file_set_contents (path, "<!DOCTYPE html>\n", -1, &error);
+        g_assert_no_error (error);
+        files[i] = g_file_new_for_path (path);
+    }
+
+    /* Let GIO load the shared-mime-info database before measuring. */
+    run_query_info (G_N_ELEMENTS (s_names), files);
+
+    g_print ("built-in table:       %8.1f ns/lookup\n", run_table (iterations));
+    g_print ("g_content_type_guess: %8.1f ns/lookup\n", run_guess (iterations));
+    g_print ("g_file_query_info:    %8.1f ns/lookup\n", run_query_info (iterations, files));
+
+    for (unsigned i = 0; i < G_N_ELEMENTS (s_names); i++) {
+        g_file_delete (files[i], NULL, NULL);
+        g_object_unref (files[i]);
+    }
+    g_rmdir (base_path);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+/*
+ * bench-prefix-routes-handler.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "../core/cog-prefix-routes-handler-private.h"
+#include <stdlib.h>
+
+/*
+ * Compares finding the route for deep URI paths among 1k mounted prefixes
+ * using the radix tree of CogPrefixRoutesHandler, and using the previous
+ * approach of copying the path and looking up each of its prefixes in a
+ * hash table, longest first. Lookups in the tree go through the function
+ * used by the unit tests, which adds taking and releasing a reference to
+ * the handler found.
+ *
+ * Usage: bench-prefix-routes-handler [LOOKUPS]
+ */
+
+#define N_APPS      10
+#define N_MODULES   100
+#define N_PATHS     1024
+#define PATH_DEPTH  16
+
+
+/* Lookup as done before routes were stored in a radix tree. */
+static CogRequestHandler*
+hash_table_lookup (GHashTable *routes,
+                   const char *path,
+                   size_t     *prefix_len)
+{
+    g_autoptr(GString) prefix = g_string_new (path);
+
+    while (prefix->len > 1) {
+        size_t last_slash_pos = prefix->len - 1;
+        while (prefix->str[last_slash_pos] != '/' && last_slash_pos > 0)
+            --last_slash_pos;
+
+        if (last_slash_pos == 0)
+            break;
+
+        g_string_erase (prefix, last_slash_pos, -1);
+
+        CogRequestHandler *handler = g_hash_table_lookup (routes, prefix->str);
+        if (handler) {
+            *prefix_len = prefix->len;
+            return handler;
+        }
+    }
+
+    return NULL;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    const unsigned n_lookups = (argc > 1) ? strtoul (argv[1], NULL, 10) : 1000000;
+    if (!n_lookups)
+        return EXIT_FAILURE;
+
+    g_autoptr(CogRequestHandler) handler = cog_prefix_routes_handler_new (NULL);
+    g_autoptr(CogRequestHandler) routes_handler = cog_prefix_routes_handler_new (NULL);
+    CogPrefixRoutesHandler *routes = COG_PREFIX_ROUTES_HANDLER (routes_handler);
+    g_autoptr(GHashTable) table = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    /* One prefix for each application, and one for each of its modules. */
+    for (unsigned app = 0; app < N_APPS; app++) {
+        for (unsigned module = 0; module < N_MODULES; module++) {
+            g_autofree char *prefix = module
+                ? g_strdup_printf ("/app%02u/module%02u", app, module)
+                : g_strdup_printf ("/app%02u", app);
+            g_assert_true (cog_prefix_routes_handler_mount (routes, prefix, handler));
+            g_hash_table_insert (table, g_steal_pointer (&prefix), handler);
+        }
+    }
+
+    /* Release the versions of the routes replaced while mounting. */
+    while (g_main_context_iteration (NULL, FALSE));
+
+    /* Deep paths, some of which do not match any prefix. */
+    GRand *rand = g_rand_new_with_seed (42);
+    char *paths[N_PATHS];
+    for (unsigned i = 0; i < N_PATHS; i++) {
+        GString *path = g_string_new (NULL);
+        g_string_append_printf (path, "/app%02u/module%02u",
+                                g_rand_int_range (rand, 0, N_APPS + 1),
+                                g_rand_int_range (rand, 0, N_MODULES));
+        for (unsigned depth = 2; depth < PATH_DEPTH; depth++)
+            g_string_append_printf (path, "/dir%u", g_rand_int_range (rand, 0, 10));
+        g_string_append (path, "/file.js");
+        paths[i] = g_string_free (path, FALSE);
+    }
+    g_rand_free (rand);
+
+    /* Both must find the same routes. */
+    for (unsigned i = 0; i < N_PATHS; i++) {
+        size_t tree_len = 0, table_len = 0;
+        g_autoptr(CogRequestHandler) found = cog_prefix_routes_handler_lookup (routes, paths[i], &tree_len);
+        g_assert_true (found == hash_table_lookup (table, paths[i], &table_len));
+        g_assert_cmpuint (tree_len, ==, table_len);
+    }
+
+    g_autoptr(GTimer) timer = g_timer_new ();
+    for (unsigned i = 0; i < n_lookups; i++) {
+        size_t prefix_len;
+        CogRequestHandler *found = cog_prefix_routes_handler_lookup (routes, paths[i % N_PATHS], &prefix_len);
+        if (found)
+            g_object_unref (found);
+    }
+    const double tree_time = g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    for (unsigned i = 0; i < n_lookups; i++) {
+        size_t prefix_len;
+        hash_table_lookup (table, paths[i % N_PATHS], &prefix_len);
+    }
+    const double table_time = g_timer_elapsed (timer, NULL);
+
+    g_print ("radix tree: %7.1f ns/lookup\n", tree_time * 1e9 / n_lookups);
+    g_print ("hash table: %7.1f ns/lookup\n", table_time * 1e9 / n_lookups);
+
+    for (unsigned i = 0; i < N_PATHS; i++)
+        g_free (paths[i]);
+    return EXIT_SUCCESS;
+}
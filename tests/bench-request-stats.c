@@ -0,0 +1,52 @@
+/*
+ * bench-request-stats.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "../core/cog-request-stats.h"
+#include <stdlib.h>
+
+/*
+ * Measures the cost of recording requests in the statistics kept for each
+ * custom URI scheme, which is paid for every request dispatched.
+ *
+ * Usage: bench-request-stats [ITERATIONS]
+ */
+
+int
+main (int argc, char *argv[])
+{
+    const unsigned iterations = (argc > 1) ? strtoul (argv[1], NULL, 10) : 10000000;
+
+    CogRequestStats *stats = cog_request_stats_new ();
+    const CogRequestResult result = { .status = 200, .length = 4096 };
+
+    /* Spread the latencies over the histogram buckets. */
+    GRand *rand = g_rand_new_with_seed (42);
+    gint64 *latencies = g_new (gint64, 1024);
+    for (unsigned i = 0; i < 1024; i++)
+        latencies[i] = 1 << g_rand_int_range (rand, 0, 24);
+
+    g_autoptr(GTimer) timer = g_timer_new ();
+    for (unsigned i = 0; i < iterations; i++) {
+        cog_request_stats_add_request (stats);
+        cog_request_stats_add_result (stats, &result, latencies[i % 1024]);
+    }
+    const double record_time = g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    for (unsigned i = 0; i < 1000; i++)
+        g_variant_unref (g_variant_ref_sink (cog_request_stats_to_variant (stats)));
+    const double variant_time = g_timer_elapsed (timer, NULL);
+
+    g_print ("record:     %.2f ns/request (%u requests)\n",
+             record_time * 1e9 / iterations, iterations);
+    g_print ("to-variant: %.2f us/call\n", variant_time * 1e3);
+
+    g_free (latencies);
+    g_rand_free (rand);
+    cog_request_stats_unref (stats);
+    return EXIT_SUCCESS;
+}
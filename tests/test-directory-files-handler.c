@@ -0,0 +1,112 @@
+/*
+ * test-directory-files-handler.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "../core/cog-directory-files-handler-private.h"
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+
+static void
+test_preload_path_is_valid (void)
+{
+    static const struct {
+        const char *path;
+        gboolean    valid;
+    } cases[] = {
+        { "index.html",            TRUE  },
+        { "js/app.js",             TRUE  },
+        { "./css/style.css",       TRUE  },
+        { "a//b",                  TRUE  },
+        { "...",                   TRUE  },
+        { "..hidden",              TRUE  },
+        { "dir../file",            TRUE  },
+        { "/etc/passwd",           FALSE },
+        { "/",                     FALSE },
+        { "..",                    FALSE },
+        { "../secret",             FALSE },
+        { "a/../../secret",        FALSE },
+        { "a/b/..",                FALSE },
+        { "a/../b",                FALSE },
+    };
+
+    for (unsigned i = 0; i < G_N_ELEMENTS (cases); i++) {
+        g_test_message ("Path: '%s'", cases[i].path);
+        g_assert_cmpint (cog_directory_files_handler_preload_path_is_valid (cases[i].path),
+                         ==, cases[i].valid);
+    }
+}
+
+
+static void
+on_preloaded (GObject      *source_object,
+              GAsyncResult *result,
+              void         *user_data)
+{
+    GAsyncResult **result_out = user_data;
+    *result_out = g_object_ref (result);
+}
+
+
+static void
+test_preload (void)
+{
+    g_autoptr(GError) error = NULL;
+    g_autofree char *base_dir = g_dir_make_tmp ("cog-test-XXXXXX", &error);
+    g_assert_no_error (error);
+
+    g_autofree char *sub_dir = g_build_filename (base_dir, "sub", NULL);
+    g_autofree char *file_a = g_build_filename (base_dir, "a.txt", NULL);
+    g_autofree char *file_b = g_build_filename (sub_dir, "b.txt", NULL);
+    g_autofree char *manifest_path = g_build_filename (base_dir, "manifest", NULL);
+
+    g_assert_cmpint (g_mkdir (sub_dir, 0700), ==, 0);
+    g_assert_true (g_file_set_contents (file_a, "0123456789", -1, NULL));
+    g_assert_true (g_file_set_contents (file_b, "01234567890123456789", -1, NULL));
+    g_assert_true (g_file_set_contents (manifest_path,
+                                        "# Comment\n"
+                                        "\n"
+                                        "a.txt\n"
+                                        "  sub/b.txt  \n"
+                                        "missing.txt\n"
+                                        "sub\n",
+                                        -1, NULL));
+
+    g_autoptr(GFile) base_path = g_file_new_for_path (base_dir);
+    g_autoptr(GFile) manifest = g_file_new_for_path (manifest_path);
+    g_autoptr(CogRequestHandler) handler = cog_directory_files_handler_new (base_path);
+
+    g_autoptr(GAsyncResult) result = NULL;
+    cog_directory_files_handler_preload_async (COG_DIRECTORY_FILES_HANDLER (handler),
+                                               manifest, NULL, on_preloaded, &result);
+    while (!result)
+        g_main_context_iteration (NULL, TRUE);
+
+    guint64 n_files = 0, n_bytes = 0;
+    g_assert_true (cog_directory_files_handler_preload_finish (COG_DIRECTORY_FILES_HANDLER (handler),
+                                                               result, &n_files, &n_bytes, &error));
+    g_assert_no_error (error);
+    g_assert_cmpuint (n_files, ==, 2);
+    g_assert_cmpuint (n_bytes, ==, 30);
+
+    g_unlink (manifest_path);
+    g_unlink (file_b);
+    g_unlink (file_a);
+    g_rmdir (sub_dir);
+    g_rmdir (base_dir);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/directory-files-handler/preload-path-is-valid", test_preload_path_is_valid);
+    g_test_add_func ("/directory-files-handler/preload", test_preload);
+
+    return g_test_run ();
+}
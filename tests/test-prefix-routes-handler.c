@@ -0,0 +1,144 @@
+/*
+ * test-prefix-routes-handler.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "../core/cog-prefix-routes-handler-private.h"
+#include <string.h>
+
+#define N_HANDLERS   8
+#define N_OPERATIONS 20000
+
+
+/*
+ * Path components used to build prefixes and paths. They share leading
+ * bytes to exercise splitting and merging of radix tree edges, and the
+ * empty one produces repeated slashes.
+ */
+static const char * const s_components[] = {
+    "", "a", "b", "ab", "aa", "ba", "aab", "abc",
+};
+
+
+static char*
+random_path (unsigned max_components)
+{
+    GString *path = g_string_new (NULL);
+
+    unsigned n_components = g_test_rand_int_range (1, max_components + 1);
+    for (unsigned i = 0; i < n_components; i++) {
+        g_string_append_c (path, '/');
+        g_string_append (path, s_components[g_test_rand_int_range (0, G_N_ELEMENTS (s_components))]);
+    }
+    if (g_test_rand_bit ())
+        g_string_append_c (path, '/');
+
+    return g_string_free (path, FALSE);
+}
+
+
+/*
+ * Lookup as done before routes were stored in a radix tree: try each
+ * prefix of the path which is followed by a slash, longest first.
+ */
+static CogRequestHandler*
+reference_lookup (GHashTable *routes,
+                  const char *path,
+                  size_t     *prefix_len)
+{
+    g_autoptr(GString) prefix = g_string_new (path);
+
+    while (prefix->len > 1) {
+        size_t last_slash_pos = prefix->len - 1;
+        while (prefix->str[last_slash_pos] != '/' && last_slash_pos > 0)
+            --last_slash_pos;
+
+        if (last_slash_pos == 0)
+            break;
+
+        g_string_erase (prefix, last_slash_pos, -1);
+
+        CogRequestHandler *handler = g_hash_table_lookup (routes, prefix->str);
+        if (handler) {
+            *prefix_len = prefix->len;
+            return handler;
+        }
+    }
+
+    return NULL;
+}
+
+
+static void
+test_compare_reference (void)
+{
+    CogRequestHandler *handlers[N_HANDLERS];
+    for (unsigned i = 0; i < N_HANDLERS; i++)
+        handlers[i] = cog_prefix_routes_handler_new (NULL);
+
+    g_autoptr(CogRequestHandler) routes_handler = cog_prefix_routes_handler_new (NULL);
+    CogPrefixRoutesHandler *self = COG_PREFIX_ROUTES_HANDLER (routes_handler);
+    g_autoptr(GHashTable) reference = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    for (unsigned i = 0; i < N_OPERATIONS; i++) {
+        switch (g_test_rand_int_range (0, 4)) {
+            case 0: {
+                g_autofree char *prefix = random_path (3);
+                CogRequestHandler *handler = handlers[g_test_rand_int_range (0, N_HANDLERS)];
+
+                gboolean expected = !g_hash_table_contains (reference, prefix);
+                if (expected)
+                    g_hash_table_insert (reference, g_strdup (prefix), handler);
+
+                gboolean mounted = cog_prefix_routes_handler_mount (self, prefix, handler);
+                g_assert_cmpint (mounted, ==, expected);
+                break;
+            }
+            case 1: {
+                g_autofree char *prefix = random_path (3);
+
+                gboolean expected = g_hash_table_remove (reference, prefix);
+                gboolean unmounted = cog_prefix_routes_handler_unmount (self, prefix);
+                g_assert_cmpint (unmounted, ==, expected);
+                break;
+            }
+            default: {
+                g_autofree char *path = random_path (5);
+
+                size_t expected_len = 0;
+                CogRequestHandler *expected = reference_lookup (reference, path, &expected_len);
+
+                size_t prefix_len = 0;
+                g_autoptr(CogRequestHandler) handler =
+                    cog_prefix_routes_handler_lookup (self, path, &prefix_len);
+
+                if (handler != expected)
+                    g_test_message ("Lookup mismatch for path '%s'", path);
+                g_assert_true (handler == expected);
+                if (expected)
+                    g_assert_cmpuint (prefix_len, ==, expected_len);
+                break;
+            }
+        }
+
+        /* Release the versions of the routes replaced so far. */
+        if (i % 100 == 0)
+            while (g_main_context_iteration (NULL, FALSE));
+    }
+
+    for (unsigned i = 0; i < N_HANDLERS; i++)
+        g_object_unref (handlers[i]);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/prefix-routes-handler/compare-reference", test_compare_reference);
+
+    return g_test_run ();
+}
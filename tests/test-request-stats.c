@@ -0,0 +1,123 @@
+/*
+ * test-request-stats.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "../core/cog-request-stats.h"
+
+
+static void
+test_latency_buckets (void)
+{
+    /* The smallest values get a bucket each. */
+    for (guint64 usec = 0; usec < 4; usec++) {
+        g_assert_cmpuint (cog_request_stats_latency_bucket (usec), ==, usec);
+        g_assert_cmpuint (cog_request_stats_latency_limit (usec), ==, usec + 1);
+    }
+
+    /*
+     * Each value falls between the limit of the previous bucket and its
+     * own, and buckets are at most a quarter of their lower limit wide.
+     */
+    const unsigned last_bucket = cog_request_stats_latency_bucket (G_MAXUINT64);
+    for (guint64 usec = 1; usec < G_GUINT64_CONSTANT (100000000); usec += 1 + usec / 64) {
+        const unsigned index = cog_request_stats_latency_bucket (usec);
+        g_assert_cmpuint (index, <, last_bucket);
+        g_assert_cmpuint (usec, <, cog_request_stats_latency_limit (index));
+        g_assert_cmpuint (usec, >=, cog_request_stats_latency_limit (index - 1));
+
+        if (index >= 4) {
+            const guint64 lower = cog_request_stats_latency_limit (index - 1);
+            g_assert_cmpuint (4 * (cog_request_stats_latency_limit (index) - lower), <=, lower);
+        }
+    }
+
+    /* Limits grow with the index. */
+    for (unsigned index = 1; index <= last_bucket; index++) {
+        g_assert_cmpuint (cog_request_stats_latency_limit (index - 1), <,
+                          cog_request_stats_latency_limit (index));
+    }
+
+    /* Values over the range covered are clamped to the last bucket. */
+    g_assert_cmpuint (cog_request_stats_latency_bucket (G_MAXUINT64 / 2), ==, last_bucket);
+    g_assert_cmpuint (cog_request_stats_latency_bucket (cog_request_stats_latency_limit (last_bucket)),
+                      ==, last_bucket);
+}
+
+
+static guint64
+lookup_uint64 (GVariant *dict, const char *key)
+{
+    guint64 value = 0;
+    g_assert_true (g_variant_lookup (dict, key, "t", &value));
+    return value;
+}
+
+
+static void
+test_to_variant (void)
+{
+    CogRequestStats *stats = cog_request_stats_new ();
+
+    g_autoptr(GVariant) empty = g_variant_ref_sink (cog_request_stats_to_variant (stats));
+    g_assert_cmpstr (g_variant_get_type_string (empty), ==, "a{sv}");
+    g_assert_cmpuint (lookup_uint64 (empty, "requests"), ==, 0);
+    g_autoptr(GVariant) empty_latency = g_variant_lookup_value (empty, "latency", G_VARIANT_TYPE ("a(tt)"));
+    g_assert_nonnull (empty_latency);
+    g_assert_cmpuint (g_variant_n_children (empty_latency), ==, 0);
+
+    for (unsigned i = 0; i < 5; i++)
+        cog_request_stats_add_request (stats);
+
+    const CogRequestResult ok = { .status = 200, .length = 100 };
+    const CogRequestResult unknown_length = { .status = 200, .length = -1 };
+    const CogRequestResult not_found = { .status = 404, .length = 10 };
+    g_autoptr(GError) error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_FAILED, "Failed");
+    const CogRequestResult failed = { .error = error, .length = -1 };
+
+    cog_request_stats_add_result (stats, &ok, 2);
+    cog_request_stats_add_result (stats, &ok, 1000);
+    cog_request_stats_add_result (stats, &unknown_length, 1000);
+    cog_request_stats_add_result (stats, &not_found, 10);
+    cog_request_stats_add_result (stats, &failed, -5);  /* Clock went backwards. */
+
+    g_autoptr(GVariant) dict = g_variant_ref_sink (cog_request_stats_to_variant (stats));
+    g_assert_cmpuint (lookup_uint64 (dict, "requests"), ==, 5);
+    g_assert_cmpuint (lookup_uint64 (dict, "errors"), ==, 2);
+    g_assert_cmpuint (lookup_uint64 (dict, "bytes"), ==, 200);
+    g_assert_cmpuint (lookup_uint64 (dict, "total-time"), ==, 2012);
+
+    /* Non-empty buckets only, in increasing order, with all results. */
+    g_autoptr(GVariant) latency = g_variant_lookup_value (dict, "latency", G_VARIANT_TYPE ("a(tt)"));
+    g_assert_nonnull (latency);
+    g_assert_cmpuint (g_variant_n_children (latency), ==, 4);
+
+    const guint64 expected[][2] = {
+        { cog_request_stats_latency_limit (cog_request_stats_latency_bucket (0)), 1 },
+        { cog_request_stats_latency_limit (cog_request_stats_latency_bucket (2)), 1 },
+        { cog_request_stats_latency_limit (cog_request_stats_latency_bucket (10)), 1 },
+        { cog_request_stats_latency_limit (cog_request_stats_latency_bucket (1000)), 2 },
+    };
+    for (unsigned i = 0; i < G_N_ELEMENTS (expected); i++) {
+        guint64 limit, count;
+        g_variant_get_child (latency, i, "(tt)", &limit, &count);
+        g_assert_cmpuint (limit, ==, expected[i][0]);
+        g_assert_cmpuint (count, ==, expected[i][1]);
+    }
+
+    cog_request_stats_unref (stats);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/request-stats/latency-buckets", test_latency_buckets);
+    g_test_add_func ("/request-stats/to-variant", test_to_variant);
+
+    return g_test_run ();
+}
@@ -0,0 +1,136 @@
+/*
+ * test-rewrite-map.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "../core/cog-rewrite-map-format.h"
+#include "../extensions/rewrite/cog-rewrite-map.h"
+#include <glib/gstdio.h>
+#include <unistd.h>
+
+
+static const char * const s_prefixes[][2] = {
+    { "https://cdn.example.com/lib/", "app:///lib/" },
+    { "https://cdn.example.com/lib/jquery/3.6/", "app:///jquery/" },
+    { "https://cdn.example.com/lib/app.js", "app:///app.js" },
+    { "https://fonts.example.com/", "app:///fonts/" },
+};
+
+
+/*
+ * Writes a map in the same way as cog-rewrite-map(1), and returns the
+ * path to the file, which the caller must remove.
+ */
+static char*
+write_map (const char *magic, guint32 version)
+{
+    GVariantBuilder builder;
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{ss}"));
+    for (unsigned i = 0; i < G_N_ELEMENTS (s_prefixes); i++)
+        g_variant_builder_add (&builder, "{ss}", s_prefixes[i][0], s_prefixes[i][1]);
+
+    g_autoptr(GVariant) map = g_variant_ref_sink (g_variant_new (COG_REWRITE_MAP_TYPE,
+                                                                 magic, version, &builder));
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+    g_autoptr(GVariant) swapped = g_variant_byteswap (map);
+    g_variant_unref (map);
+    map = g_steal_pointer (&swapped);
+#endif
+
+    g_autoptr(GError) error = NULL;
+    char *path = NULL;
+    int fd = g_file_open_tmp ("cog-test-XXXXXX.rwmap", &path, &error);
+    g_assert_no_error (error);
+    close (fd);
+
+    g_assert_true (g_file_set_contents (path, g_variant_get_data (map), g_variant_get_size (map), &error));
+    g_assert_no_error (error);
+    return path;
+}
+
+
+static void
+test_lookup (void)
+{
+    static const struct {
+        const char *uri;
+        const char *replacement;
+        const char *remainder;
+    } cases[] = {
+        { "https://cdn.example.com/lib/x.js", "app:///lib/", "x.js" },
+        { "https://cdn.example.com/lib/", "app:///lib/", "" },
+        { "https://cdn.example.com/lib/?q=1", "app:///lib/", "?q=1" },
+        { "https://cdn.example.com/lib//x.js", "app:///lib/", "/x.js" },
+        { "https://cdn.example.com/lib/jquery/3.6/jquery.min.js?v=1", "app:///jquery/", "jquery.min.js?v=1" },
+        { "https://cdn.example.com/lib/jquery/3.5/jquery.min.js", "app:///lib/", "jquery/3.5/jquery.min.js" },
+        { "https://cdn.example.com/lib/app.js", "app:///app.js", "" },
+        { "https://cdn.example.com/lib/app.js#main", "app:///app.js", "#main" },
+        { "https://cdn.example.com/lib/app.jsx", "app:///lib/", "app.jsx" },
+        { "https://cdn.example.com/lib/app.js/x", "app:///lib/", "app.js/x" },
+        { "https://fonts.example.com/", "app:///fonts/", "" },
+        { "https://fonts.example.com/a/b/c.woff2", "app:///fonts/", "a/b/c.woff2" },
+        { "https://cdn.example.com/lib", NULL, NULL },
+        { "https://cdn.example.com/other/lib/x.js", NULL, NULL },
+        { "https://cdn.example.com/x?u=https://cdn.example.com/lib/x.js", NULL, NULL },
+        { "https://fonts.example.com", NULL, NULL },
+        { "http://fonts.example.com/a.woff2", NULL, NULL },
+        { "https://", NULL, NULL },
+        { "fonts.example.com/", NULL, NULL },
+        { "", NULL, NULL },
+    };
+
+    g_autofree char *path = write_map (COG_REWRITE_MAP_MAGIC, COG_REWRITE_MAP_VERSION);
+    g_autoptr(GError) error = NULL;
+    g_autoptr(CogRewriteMap) map = cog_rewrite_map_load (path, &error);
+    g_assert_no_error (error);
+    g_assert_nonnull (map);
+    g_unlink (path);
+
+    g_assert_cmpuint (cog_rewrite_map_get_size (map), ==, G_N_ELEMENTS (s_prefixes));
+
+    for (unsigned i = 0; i < G_N_ELEMENTS (cases); i++) {
+        g_test_message ("URI: '%s'", cases[i].uri);
+
+        const char *remainder = NULL;
+        const char *replacement = cog_rewrite_map_lookup (map, cases[i].uri, &remainder);
+        g_assert_cmpstr (replacement, ==, cases[i].replacement);
+        if (cases[i].replacement)
+            g_assert_cmpstr (remainder, ==, cases[i].remainder);
+    }
+}
+
+
+static void
+test_load_invalid (void)
+{
+    static const struct {
+        const char *magic;
+        guint32     version;
+    } cases[] = {
+        { "NotAMap", COG_REWRITE_MAP_VERSION },
+        { COG_REWRITE_MAP_MAGIC, COG_REWRITE_MAP_VERSION + 1 },
+    };
+
+    for (unsigned i = 0; i < G_N_ELEMENTS (cases); i++) {
+        g_autofree char *path = write_map (cases[i].magic, cases[i].version);
+        g_autoptr(GError) error = NULL;
+        g_autoptr(CogRewriteMap) map = cog_rewrite_map_load (path, &error);
+        g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL);
+        g_assert_null (map);
+        g_unlink (path);
+    }
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/rewrite-map/lookup", test_lookup);
+    g_test_add_func ("/rewrite-map/load-invalid", test_load_invalid);
+
+    return g_test_run ();
+}
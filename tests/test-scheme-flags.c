@@ -0,0 +1,133 @@
+/*
+ * test-scheme-flags.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "../core/cog-shell.h"
+
+
+static void
+test_parse (void)
+{
+    static const struct {
+        const char    *names[4];
+        CogSchemeFlags flags;
+    } cases[] = {
+        { { NULL }, COG_SCHEME_FLAGS_NONE },
+        { { "", NULL }, COG_SCHEME_FLAGS_NONE },
+        { { "secure", NULL }, COG_SCHEME_FLAGS_SECURE },
+        { { " local ", "\tcors-enabled", NULL },
+          COG_SCHEME_FLAGS_LOCAL | COG_SCHEME_FLAGS_CORS_ENABLED },
+        { { "display-isolated", "", "secure", NULL },
+          COG_SCHEME_FLAGS_DISPLAY_ISOLATED | COG_SCHEME_FLAGS_SECURE },
+        { { "secure", "secure", NULL }, COG_SCHEME_FLAGS_SECURE },
+    };
+
+    for (unsigned i = 0; i < G_N_ELEMENTS (cases); i++) {
+        g_autoptr(GError) error = NULL;
+        CogSchemeFlags flags = COG_SCHEME_FLAGS_NONE;
+        g_assert_true (cog_scheme_flags_parse (cases[i].names, &flags, &error));
+        g_assert_no_error (error);
+        g_assert_cmphex (flags, ==, cases[i].flags);
+    }
+}
+
+
+static void
+test_parse_adds (void)
+{
+    static const char * const names[] = { "local", NULL };
+
+    CogSchemeFlags flags = COG_SCHEME_FLAGS_SECURE;
+    g_assert_true (cog_scheme_flags_parse (names, &flags, NULL));
+    g_assert_cmphex (flags, ==, COG_SCHEME_FLAGS_SECURE | COG_SCHEME_FLAGS_LOCAL);
+}
+
+
+static void
+test_parse_invalid (void)
+{
+    const char * const * const cases[] = {
+        (const char * const[]) { "insecure", NULL },
+        (const char * const[]) { "secure", "bogus", NULL },
+        (const char * const[]) { "secur", NULL },
+        (const char * const[]) { "secure-", NULL },
+        (const char * const[]) { "secure local", NULL },
+        (const char * const[]) { "SECURE", NULL },
+    };
+
+    for (unsigned i = 0; i < G_N_ELEMENTS (cases); i++) {
+        g_autoptr(GError) error = NULL;
+        CogSchemeFlags flags = COG_SCHEME_FLAGS_CORS_ENABLED;
+        g_assert_false (cog_scheme_flags_parse (cases[i], &flags, &error));
+        g_assert_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE);
+        g_assert_cmphex (flags, ==, COG_SCHEME_FLAGS_CORS_ENABLED);
+    }
+}
+
+
+static void
+test_parse_spec (void)
+{
+    static const struct {
+        const char    *spec;
+        const char    *scheme;
+        CogSchemeFlags flags;
+    } cases[] = {
+        { "app:secure", "app", COG_SCHEME_FLAGS_SECURE },
+        { "app:", "app", COG_SCHEME_FLAGS_NONE },
+        { "my-app:secure,cors-enabled", "my-app",
+          COG_SCHEME_FLAGS_SECURE | COG_SCHEME_FLAGS_CORS_ENABLED },
+        { "app:local, display-isolated,", "app",
+          COG_SCHEME_FLAGS_LOCAL | COG_SCHEME_FLAGS_DISPLAY_ISOLATED },
+    };
+
+    for (unsigned i = 0; i < G_N_ELEMENTS (cases); i++) {
+        g_autoptr(GError) error = NULL;
+        g_autofree char *scheme = NULL;
+        CogSchemeFlags flags;
+        g_assert_true (cog_scheme_flags_parse_spec (cases[i].spec, &scheme, &flags, &error));
+        g_assert_no_error (error);
+        g_assert_cmpstr (scheme, ==, cases[i].scheme);
+        g_assert_cmphex (flags, ==, cases[i].flags);
+    }
+}
+
+
+static void
+test_parse_spec_invalid (void)
+{
+    static const char * const cases[] = {
+        "",
+        "app",
+        ":secure",
+        "app:bogus",
+        "app:secure,,nope",
+    };
+
+    for (unsigned i = 0; i < G_N_ELEMENTS (cases); i++) {
+        g_autoptr(GError) error = NULL;
+        char *scheme = NULL;
+        CogSchemeFlags flags = COG_SCHEME_FLAGS_NONE;
+        g_assert_false (cog_scheme_flags_parse_spec (cases[i], &scheme, &flags, &error));
+        g_assert_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE);
+        g_assert_null (scheme);
+    }
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/scheme-flags/parse", test_parse);
+    g_test_add_func ("/scheme-flags/parse-adds", test_parse_adds);
+    g_test_add_func ("/scheme-flags/parse-invalid", test_parse_invalid);
+    g_test_add_func ("/scheme-flags/parse-spec", test_parse_spec);
+    g_test_add_func ("/scheme-flags/parse-spec-invalid", test_parse_spec_invalid);
+
+    return g_test_run ();
+}
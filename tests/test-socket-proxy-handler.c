@@ -0,0 +1,281 @@
+/*
+ * test-socket-proxy-handler.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "../core/cog-socket-proxy-handler-private.h"
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#define RESPONSE_LENGTH \
+    "HTTP/1.1 200 OK\r\n" \
+    "Content-Length: 5\r\n" \
+    "\r\n" \
+    "hello"
+
+#define RESPONSE_CHUNKED \
+    "HTTP/1.1 200 OK\r\n" \
+    "Transfer-Encoding: chunked\r\n" \
+    "\r\n" \
+    "5\r\nhello\r\n" \
+    "6\r\n world\r\n" \
+    "0\r\n" \
+    "\r\n"
+
+#define RESPONSE_NOT_FOUND \
+    "HTTP/1.1 404 Not Found\r\n" \
+    "Content-Length: 0\r\n" \
+    "\r\n"
+
+
+/*
+ * HTTP server listening on a Unix socket, which runs in its own thread so
+ * that the tests may use the blocking proxy handler functions.
+ */
+typedef struct {
+    char                  *tmpdir;
+    char                  *socket_path;
+    CogSocketProxyHandler *handler;
+
+    GThread      *thread;
+    GMainContext *context;
+    GMainLoop    *loop;
+    GMutex        lock;
+    GCond         started;
+    gboolean      listening;
+    int           n_connections;   /* Atomic. */
+} TestServer;
+
+
+/* Reads a request, returning its request line after skipping headers. */
+static char*
+server_read_request (GDataInputStream *input)
+{
+    g_autofree char *request_line = g_data_input_stream_read_line (input, NULL, NULL, NULL);
+    if (!request_line)
+        return NULL;
+
+    for (;;) {
+        g_autofree char *line = g_data_input_stream_read_line (input, NULL, NULL, NULL);
+        if (!line)
+            return NULL;
+        if (line[0] == '\0')
+            return g_steal_pointer (&request_line);
+    }
+}
+
+
+static gboolean
+on_server_run (GThreadedSocketService *service G_GNUC_UNUSED,
+               GSocketConnection      *connection,
+               GObject                *source_object G_GNUC_UNUSED,
+               TestServer             *server)
+{
+    g_atomic_int_inc (&server->n_connections);
+
+    g_autoptr(GDataInputStream) input =
+        g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+    g_data_input_stream_set_newline_type (input, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+    g_filter_input_stream_set_close_base_stream (G_FILTER_INPUT_STREAM (input), FALSE);
+    GOutputStream *output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+    for (;;) {
+        g_autofree char *request_line = server_read_request (input);
+        if (!request_line)
+            break;
+
+        const char *response = RESPONSE_NOT_FOUND;
+        gboolean close_after = FALSE;
+        if (g_str_has_prefix (request_line, "GET /length ")) {
+            response = RESPONSE_LENGTH;
+        } else if (g_str_has_prefix (request_line, "GET /chunked ")) {
+            response = RESPONSE_CHUNKED;
+        } else if (g_str_has_prefix (request_line, "GET /close ")) {
+            /* Advertised as kept alive, but closed right away. */
+            response = RESPONSE_LENGTH;
+            close_after = TRUE;
+        }
+
+        if (!g_output_stream_write_all (output, response, strlen (response), NULL, NULL, NULL) ||
+            close_after)
+            break;
+    }
+
+    g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+    return FALSE;
+}
+
+
+static void*
+server_thread (TestServer *server)
+{
+    g_main_context_push_thread_default (server->context);
+
+    g_autoptr(GSocketService) service = g_threaded_socket_service_new (-1);
+    g_signal_connect (service, "run", G_CALLBACK (on_server_run), server);
+
+    g_autoptr(GSocketAddress) address = g_unix_socket_address_new (server->socket_path);
+    g_autoptr(GError) error = NULL;
+    g_socket_listener_add_address (G_SOCKET_LISTENER (service), address,
+                                   G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT,
+                                   NULL, NULL, &error);
+    g_assert_no_error (error);
+    g_socket_service_start (service);
+
+    g_mutex_lock (&server->lock);
+    server->listening = TRUE;
+    g_cond_signal (&server->started);
+    g_mutex_unlock (&server->lock);
+
+    g_main_loop_run (server->loop);
+
+    g_socket_service_stop (service);
+    g_socket_listener_close (G_SOCKET_LISTENER (service));
+    g_main_context_pop_thread_default (server->context);
+    return NULL;
+}
+
+
+static void
+test_server_setup (TestServer *server, const void *data G_GNUC_UNUSED)
+{
+    g_autoptr(GError) error = NULL;
+    server->tmpdir = g_dir_make_tmp ("cog-test-XXXXXX", &error);
+    g_assert_no_error (error);
+    server->socket_path = g_build_filename (server->tmpdir, "http.sock", NULL);
+
+    server->context = g_main_context_new ();
+    server->loop = g_main_loop_new (server->context, FALSE);
+    g_mutex_init (&server->lock);
+    g_cond_init (&server->started);
+
+    server->thread = g_thread_new ("test-server", (GThreadFunc) server_thread, server);
+    g_mutex_lock (&server->lock);
+    while (!server->listening)
+        g_cond_wait (&server->started, &server->lock);
+    g_mutex_unlock (&server->lock);
+
+    server->handler = COG_SOCKET_PROXY_HANDLER (cog_socket_proxy_handler_new (server->socket_path));
+}
+
+
+static gboolean
+quit_loop (GMainLoop *loop)
+{
+    g_main_loop_quit (loop);
+    return G_SOURCE_REMOVE;
+}
+
+
+static void
+test_server_teardown (TestServer *server, const void *data G_GNUC_UNUSED)
+{
+    /* Closes idle connections, letting the server threads finish. */
+    g_clear_object (&server->handler);
+
+    g_main_context_invoke (server->context, (GSourceFunc) quit_loop, server->loop);
+    g_thread_join (server->thread);
+
+    g_main_loop_unref (server->loop);
+    g_main_context_unref (server->context);
+    g_cond_clear (&server->started);
+    g_mutex_clear (&server->lock);
+
+    g_unlink (server->socket_path);
+    g_rmdir (server->tmpdir);
+    g_free (server->socket_path);
+    g_free (server->tmpdir);
+}
+
+
+/* Sends a GET request, and returns the whole response body. */
+static char*
+fetch (TestServer *server, const char *target, gint64 *length)
+{
+    g_autoptr(GError) error = NULL;
+    unsigned status = 0;
+    g_autoptr(GInputStream) stream =
+        cog_socket_proxy_handler_send (server->handler, "GET", target, &status, length, NULL, &error);
+    g_assert_no_error (error);
+    g_assert_nonnull (stream);
+    g_assert_cmpuint (status, ==, 200);
+
+    g_autoptr(GOutputStream) output = g_memory_output_stream_new_resizable ();
+    g_output_stream_splice (output, stream,
+                            G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+                            NULL, &error);
+    g_assert_no_error (error);
+
+    g_autoptr(GBytes) body = g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (output));
+    return g_strndup (g_bytes_get_data (body, NULL), g_bytes_get_size (body));
+}
+
+
+static void
+test_content_length (TestServer *server, const void *data G_GNUC_UNUSED)
+{
+    gint64 length = 0;
+    g_autofree char *body = fetch (server, "/length", &length);
+    g_assert_cmpstr (body, ==, "hello");
+    g_assert_cmpint (length, ==, 5);
+}
+
+
+static void
+test_chunked (TestServer *server, const void *data G_GNUC_UNUSED)
+{
+    gint64 length = 0;
+    g_autofree char *body = fetch (server, "/chunked", &length);
+    g_assert_cmpstr (body, ==, "hello world");
+    g_assert_cmpint (length, ==, -1);
+}
+
+
+static void
+test_keep_alive (TestServer *server, const void *data G_GNUC_UNUSED)
+{
+    static const char * const targets[] = { "/length", "/chunked", "/length", "/chunked" };
+
+    for (unsigned i = 0; i < G_N_ELEMENTS (targets); i++) {
+        g_autofree char *body = fetch (server, targets[i], NULL);
+        g_assert_true (g_str_has_prefix (body, "hello"));
+    }
+
+    /* All requests are sent over the connection kept idle in between. */
+    g_assert_cmpint (g_atomic_int_get (&server->n_connections), ==, 1);
+}
+
+
+static void
+test_stale_connection (TestServer *server, const void *data G_GNUC_UNUSED)
+{
+    g_autofree char *first = fetch (server, "/close", NULL);
+    g_assert_cmpstr (first, ==, "hello");
+
+    /* The idle connection was closed by the server, a new one is opened. */
+    g_autofree char *second = fetch (server, "/length", NULL);
+    g_assert_cmpstr (second, ==, "hello");
+    g_assert_cmpint (g_atomic_int_get (&server->n_connections), ==, 2);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add ("/socket-proxy-handler/content-length", TestServer, NULL,
+                test_server_setup, test_content_length, test_server_teardown);
+    g_test_add ("/socket-proxy-handler/chunked", TestServer, NULL,
+                test_server_setup, test_chunked, test_server_teardown);
+    g_test_add ("/socket-proxy-handler/keep-alive", TestServer, NULL,
+                test_server_setup, test_keep_alive, test_server_teardown);
+    g_test_add ("/socket-proxy-handler/stale-connection", TestServer, NULL,
+                test_server_setup, test_stale_connection, test_server_teardown);
+
+    return g_test_run ();
+}
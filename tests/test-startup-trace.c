@@ -0,0 +1,229 @@
+/*
+ * test-startup-trace.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "../core/cog-startup-trace.h"
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Traces are recorded in global state which can only be finished once,
+ * so each test runs in a subprocess. The path of the trace file is passed
+ * down in the COG_STARTUP_TRACE environment variable.
+ */
+
+
+static char*
+read_trace (void)
+{
+    char *contents = NULL;
+    if (!g_file_get_contents (g_getenv ("COG_STARTUP_TRACE"), &contents, NULL, NULL))
+        return NULL;
+    return contents;
+}
+
+
+/*
+ * Checks that each of the fragments appears in the trace, in order.
+ */
+static void
+assert_trace_contains (const char *trace, const char * const *fragments)
+{
+    const char *position = trace;
+    for (unsigned i = 0; fragments[i]; i++) {
+        const char *found = strstr (position, fragments[i]);
+        if (!found)
+            g_test_message ("Fragment '%s' not found in trace:\n%s", fragments[i], trace);
+        g_assert_nonnull (found);
+        position = found + strlen (fragments[i]);
+    }
+}
+
+
+static void*
+record_in_thread (void *data)
+{
+    cog_startup_trace_mark (data);
+    return NULL;
+}
+
+
+static void
+run_in_subprocess (void)
+{
+    g_autofree char *path = NULL;
+    int fd = g_file_open_tmp ("cog-test-XXXXXX.json", &path, NULL);
+    g_assert_cmpint (fd, !=, -1);
+    close (fd);
+    g_unlink (path);
+
+    g_setenv ("COG_STARTUP_TRACE", path, TRUE);
+    g_test_trap_subprocess (NULL, 0, 0);
+    g_unsetenv ("COG_STARTUP_TRACE");
+    g_unlink (path);
+
+    g_test_trap_assert_passed ();
+}
+
+
+static void
+test_output (void)
+{
+    if (!g_test_subprocess ()) {
+        run_in_subprocess ();
+        return;
+    }
+
+    cog_startup_trace_begin ("parse \"options\"");
+    cog_startup_trace_end ("parse \"options\"");
+    cog_startup_trace_mark ("a\\b\nc\001");
+
+    GThread *thread = g_thread_new ("trace", record_in_thread, "from-thread");
+    g_thread_join (thread);
+
+    cog_startup_trace_mark ("last");
+    g_assert_null (read_trace ());
+
+    cog_startup_trace_finish ();
+    g_autofree char *trace = read_trace ();
+    g_assert_nonnull (trace);
+
+    g_autofree char *process_name = g_strdup_printf ("\"args\":{\"name\":\"%s\"}}\n]}\n", g_get_prgname ());
+    const char * const fragments[] = {
+        "{\"traceEvents\":[\n",
+        "{\"name\":\"parse \\\"options\\\"\",\"ph\":\"B\",\"ts\":",
+        ",\"tid\":1},\n",
+        "{\"name\":\"parse \\\"options\\\"\",\"ph\":\"E\",\"ts\":",
+        ",\"tid\":1},\n",
+        "{\"name\":\"a\\\\b\\u000ac\\u0001\",\"ph\":\"i\",\"ts\":",
+        ",\"tid\":1,\"s\":\"p\"},\n",
+        "{\"name\":\"from-thread\",\"ph\":\"i\",\"ts\":",
+        ",\"tid\":2,\"s\":\"p\"},\n",
+        "{\"name\":\"last\",\"ph\":\"i\",\"ts\":",
+        ",\"tid\":1,\"s\":\"p\"},\n",
+        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":",
+        process_name,
+        NULL,
+    };
+    assert_trace_contains (trace, fragments);
+    g_assert_true (g_str_has_suffix (trace, process_name));
+
+    /* Finishing again does not write the trace again. */
+    g_unlink (g_getenv ("COG_STARTUP_TRACE"));
+    cog_startup_trace_mark ("after-finish");
+    cog_startup_trace_finish ();
+    g_assert_null (read_trace ());
+}
+
+
+static void
+test_finish_after_frame (void)
+{
+    if (!g_test_subprocess ()) {
+        run_in_subprocess ();
+        return;
+    }
+
+    cog_startup_trace_mark ("loaded");
+    cog_startup_trace_finish_after_frame (60 * 1000);
+    g_assert_null (read_trace ());
+
+    cog_startup_trace_frame_shown ();
+    g_autofree char *trace = read_trace ();
+    g_assert_nonnull (trace);
+
+    const char * const fragments[] = {
+        "{\"name\":\"loaded\",\"ph\":\"i\"",
+        "{\"name\":\"first-frame-shown\",\"ph\":\"i\"",
+        "{\"name\":\"process_name\"",
+        NULL,
+    };
+    assert_trace_contains (trace, fragments);
+}
+
+
+static void
+test_finish_after_frame_shown (void)
+{
+    if (!g_test_subprocess ()) {
+        run_in_subprocess ();
+        return;
+    }
+
+    /* Only the first frame is recorded. */
+    cog_startup_trace_frame_shown ();
+    cog_startup_trace_frame_shown ();
+    g_assert_null (read_trace ());
+
+    cog_startup_trace_finish_after_frame (60 * 1000);
+    g_autofree char *trace = read_trace ();
+    g_assert_nonnull (trace);
+
+    const char * const fragments[] = { "\"first-frame-shown\"", NULL };
+    assert_trace_contains (trace, fragments);
+    g_assert_null (strstr (strstr (trace, "\"first-frame-shown\"") + 1, "\"first-frame-shown\""));
+}
+
+
+static void
+test_finish_timeout (void)
+{
+    if (!g_test_subprocess ()) {
+        run_in_subprocess ();
+        return;
+    }
+
+    cog_startup_trace_finish_after_frame (10);
+
+    char *trace;
+    while (!(trace = read_trace ()))
+        g_main_context_iteration (NULL, TRUE);
+
+    const char * const fragments[] = { "{\"name\":\"first-frame-timeout\",\"ph\":\"i\"", NULL };
+    assert_trace_contains (trace, fragments);
+    g_free (trace);
+
+    /* A late frame does not write the trace again. */
+    g_unlink (g_getenv ("COG_STARTUP_TRACE"));
+    cog_startup_trace_frame_shown ();
+    g_assert_null (read_trace ());
+}
+
+
+static void
+test_disabled (void)
+{
+    if (!g_test_subprocess ()) {
+        g_unsetenv ("COG_STARTUP_TRACE");
+        g_test_trap_subprocess (NULL, 0, 0);
+        g_test_trap_assert_passed ();
+        return;
+    }
+
+    cog_startup_trace_begin ("phase");
+    cog_startup_trace_end ("phase");
+    cog_startup_trace_mark ("mark");
+    cog_startup_trace_frame_shown ();
+    cog_startup_trace_finish_after_frame (0);
+    cog_startup_trace_finish ();
+    g_assert_false (g_main_context_pending (NULL));
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/startup-trace/output", test_output);
+    g_test_add_func ("/startup-trace/finish-after-frame", test_finish_after_frame);
+    g_test_add_func ("/startup-trace/finish-after-frame-shown", test_finish_after_frame_shown);
+    g_test_add_func ("/startup-trace/finish-timeout", test_finish_timeout);
+    g_test_add_func ("/startup-trace/disabled", test_disabled);
+
+    return g_test_run ();
+}
@@ -0,0 +1,104 @@
+/*
+ * test-uri-list.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "../core/cog-utils.h"
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
+
+
+static char*
+write_list (const char *contents)
+{
+    g_autoptr(GError) error = NULL;
+    char *path = NULL;
+    int fd = g_file_open_tmp ("cog-test-XXXXXX.txt", &path, &error);
+    g_assert_no_error (error);
+    close (fd);
+
+    g_assert_true (g_file_set_contents (path, contents, -1, &error));
+    g_assert_no_error (error);
+    return path;
+}
+
+
+static void
+test_load (void)
+{
+    g_autofree char *local_path = write_list ("");
+    g_autofree char *local_uri = g_filename_to_uri (local_path, NULL, NULL);
+
+    g_autofree char *contents = g_strdup_printf ("# Playlist\n"
+                                                 "\n"
+                                                 "https://example.com/a?b=c#d\n"
+                                                 "  http://example.org/  \n"
+                                                 "\t# Indented comment\n"
+                                                 "%s\n"
+                                                 "https://example.com/last",
+                                                 local_path);
+    g_autofree char *path = write_list (contents);
+
+    g_autoptr(GError) error = NULL;
+    g_auto(GStrv) uris = cog_uri_list_load (path, &error);
+    g_assert_no_error (error);
+    g_assert_nonnull (uris);
+
+    g_assert_cmpuint (g_strv_length (uris), ==, 4);
+    g_assert_cmpstr (uris[0], ==, "https://example.com/a?b=c#d");
+    g_assert_cmpstr (uris[1], ==, "http://example.org/");
+    g_assert_cmpstr (uris[2], ==, local_uri);
+    g_assert_cmpstr (uris[3], ==, "https://example.com/last");
+
+    g_unlink (path);
+    g_unlink (local_path);
+}
+
+
+static void
+test_load_empty (void)
+{
+    static const char * const cases[] = {
+        "",
+        "\n\n",
+        "# Only\n  # comments\n",
+    };
+
+    for (unsigned i = 0; i < G_N_ELEMENTS (cases); i++) {
+        g_autofree char *path = write_list (cases[i]);
+        g_autoptr(GError) error = NULL;
+        g_auto(GStrv) uris = cog_uri_list_load (path, &error);
+        g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL);
+        g_assert_null (uris);
+        g_unlink (path);
+    }
+}
+
+
+static void
+test_load_missing (void)
+{
+    g_autofree char *path = write_list ("");
+    g_unlink (path);
+
+    g_autoptr(GError) error = NULL;
+    g_auto(GStrv) uris = cog_uri_list_load (path, &error);
+    g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+    g_assert_null (uris);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/uri-list/load", test_load);
+    g_test_add_func ("/uri-list/load-empty", test_load_empty);
+    g_test_add_func ("/uri-list/load-missing", test_load_missing);
+
+    return g_test_run ();
+}
@@ -0,0 +1,179 @@
+/*
+ * test-view-pool.c
+ * Copyright (C) 2021 Igalia S.L.
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "../core/cog-view-pool.h"
+
+
+typedef struct {
+    CogViewState state;
+    unsigned     n_changes;
+    gboolean     freed;
+} FakeView;
+
+
+static void
+fake_view_set_state (void *view, CogViewState state)
+{
+    FakeView *fake = view;
+    g_assert_false (fake->freed);
+    fake->state = state;
+    fake->n_changes++;
+}
+
+
+static void
+fake_view_free (void *view)
+{
+    FakeView *fake = view;
+    g_assert_false (fake->freed);
+    fake->freed = TRUE;
+}
+
+
+static void
+assert_view (CogViewPool *pool, FakeView *view, CogViewState state, unsigned n_changes)
+{
+    g_assert_true (cog_view_pool_contains (pool, view));
+    g_assert_cmpint (cog_view_pool_get_state (pool, view), ==, state);
+    g_assert_cmpint (view->state, ==, state);
+    g_assert_cmpuint (view->n_changes, ==, n_changes);
+}
+
+
+static void
+test_add (void)
+{
+    FakeView a = { COG_VIEW_STATE_SUSPENDED, }, b = a;
+    CogViewPool *pool = cog_view_pool_new (fake_view_set_state, fake_view_free);
+    g_assert_cmpuint (cog_view_pool_get_size (pool), ==, 0);
+    g_assert_null (cog_view_pool_get_active (pool));
+
+    cog_view_pool_add (pool, &a);
+    cog_view_pool_add (pool, &b);
+    g_assert_cmpuint (cog_view_pool_get_size (pool), ==, 2);
+    g_assert_null (cog_view_pool_get_active (pool));
+    assert_view (pool, &a, COG_VIEW_STATE_PRELOADED, 1);
+    assert_view (pool, &b, COG_VIEW_STATE_PRELOADED, 1);
+
+    cog_view_pool_free (pool);
+    g_assert_true (a.freed);
+    g_assert_true (b.freed);
+}
+
+
+static void
+test_activate (void)
+{
+    FakeView a = { COG_VIEW_STATE_SUSPENDED, }, b = a;
+    CogViewPool *pool = cog_view_pool_new (fake_view_set_state, fake_view_free);
+    cog_view_pool_add (pool, &a);
+    cog_view_pool_add (pool, &b);
+
+    g_assert_true (cog_view_pool_activate (pool, &a));
+    g_assert_true (cog_view_pool_get_active (pool) == &a);
+    assert_view (pool, &a, COG_VIEW_STATE_ACTIVE, 2);
+    assert_view (pool, &b, COG_VIEW_STATE_PRELOADED, 1);
+
+    /* Activating the active view again does nothing. */
+    g_assert_false (cog_view_pool_activate (pool, &a));
+    assert_view (pool, &a, COG_VIEW_STATE_ACTIVE, 2);
+
+    /* The previously active view is left preloaded. */
+    g_assert_true (cog_view_pool_activate (pool, &b));
+    g_assert_true (cog_view_pool_get_active (pool) == &b);
+    assert_view (pool, &a, COG_VIEW_STATE_PRELOADED, 3);
+    assert_view (pool, &b, COG_VIEW_STATE_ACTIVE, 2);
+
+    cog_view_pool_free (pool);
+    g_assert_true (a.freed);
+    g_assert_true (b.freed);
+}
+
+
+static void
+test_suspend (void)
+{
+    FakeView a = { COG_VIEW_STATE_SUSPENDED, }, b = a;
+    CogViewPool *pool = cog_view_pool_new (fake_view_set_state, fake_view_free);
+    cog_view_pool_add (pool, &a);
+    cog_view_pool_add (pool, &b);
+    cog_view_pool_activate (pool, &a);
+
+    cog_view_pool_suspend (pool, &b);
+    assert_view (pool, &b, COG_VIEW_STATE_SUSPENDED, 2);
+
+    /* Suspending again does not change the state. */
+    cog_view_pool_suspend (pool, &b);
+    assert_view (pool, &b, COG_VIEW_STATE_SUSPENDED, 2);
+
+    /* The active view cannot be suspended. */
+    g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_CRITICAL, "*assertion*failed*");
+    cog_view_pool_suspend (pool, &a);
+    g_test_assert_expected_messages ();
+    assert_view (pool, &a, COG_VIEW_STATE_ACTIVE, 2);
+
+    /* Activating a suspended view resumes it directly. */
+    g_assert_true (cog_view_pool_activate (pool, &b));
+    assert_view (pool, &a, COG_VIEW_STATE_PRELOADED, 3);
+    assert_view (pool, &b, COG_VIEW_STATE_ACTIVE, 3);
+
+    cog_view_pool_suspend (pool, &a);
+    assert_view (pool, &a, COG_VIEW_STATE_SUSPENDED, 4);
+
+    cog_view_pool_free (pool);
+}
+
+
+static void
+test_remove (void)
+{
+    FakeView a = { COG_VIEW_STATE_SUSPENDED, }, b = a, c = a;
+    CogViewPool *pool = cog_view_pool_new (fake_view_set_state, fake_view_free);
+    cog_view_pool_add (pool, &a);
+    cog_view_pool_add (pool, &b);
+    cog_view_pool_add (pool, &c);
+    cog_view_pool_activate (pool, &a);
+    cog_view_pool_suspend (pool, &c);
+
+    /* The active view cannot be removed. */
+    g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_CRITICAL, "*assertion*failed*");
+    cog_view_pool_remove (pool, &a);
+    g_test_assert_expected_messages ();
+    g_assert_false (a.freed);
+    g_assert_cmpuint (cog_view_pool_get_size (pool), ==, 3);
+
+    cog_view_pool_remove (pool, &b);
+    g_assert_true (b.freed);
+    g_assert_false (cog_view_pool_contains (pool, &b));
+    cog_view_pool_remove (pool, &c);
+    g_assert_true (c.freed);
+    g_assert_cmpuint (cog_view_pool_get_size (pool), ==, 1);
+    assert_view (pool, &a, COG_VIEW_STATE_ACTIVE, 2);
+
+    /* Views not in the pool are rejected. */
+    g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_CRITICAL, "*assertion*failed*");
+    g_assert_false (cog_view_pool_activate (pool, &b));
+    g_test_assert_expected_messages ();
+    g_assert_true (cog_view_pool_get_active (pool) == &a);
+
+    cog_view_pool_free (pool);
+    g_assert_true (a.freed);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/view-pool/add", test_add);
+    g_test_add_func ("/view-pool/activate", test_activate);
+    g_test_add_func ("/view-pool/suspend", test_suspend);
+    g_test_add_func ("/view-pool/remove", test_remove);
+
+    return g_test_run ();
+}